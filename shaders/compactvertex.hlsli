@@ -0,0 +1,25 @@
+// Compressed vertex layout, see CompactVertex in compactvertex.h
+// The position dequantization is folded into the Model matrix
+struct CompactVertex
+{
+    float4 Position : POSITION;           // R16G16B16A16_UNORM
+    float2 TextureCoord : TEXTURE_COORD;  // R16G16_FLOAT
+    float2 Normal : NORMAL;               // R16G16_SNORM octahedral
+};
+
+float3 DecodeOctahedral(float2 e)
+{
+    float3 n = float3(e.xy, 1.0f - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.xy += n.xy >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
+Vertex DecodeVertex(CompactVertex IN)
+{
+    Vertex OUT;
+    OUT.Position = IN.Position.xyz;
+    OUT.TextureCoord = IN.TextureCoord;
+    OUT.Normal = DecodeOctahedral(IN.Normal);
+    return OUT;
+}
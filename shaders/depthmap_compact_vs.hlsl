@@ -0,0 +1,4 @@
+/// Depth map Vertex Shader for the CompactVertex layout
+
+#define COMPACT_VERTEX
+#include "depthmap_vs.hlsl"
@@ -1,9 +1,13 @@
 
-cbuffer ObjectModelCB : register(b0)
+// Root constant of the draw, index of the model matrix in the model buffer
+cbuffer DrawCB : register(b0)
 {
-    matrix Model;
+    uint ModelIndex;
 }
 
+// Model matrix per draw
+StructuredBuffer<matrix> Models : register(t0);
+
 struct DirectionalLight
 {
     float4 Direction;
@@ -26,9 +30,19 @@ struct Vertex
     float3 Normal : NORMAL;
 };
 
+#ifdef COMPACT_VERTEX
+#include "compactvertex.hlsli"
+#endif
+
+#ifdef COMPACT_VERTEX
+float4 main(CompactVertex COMPACT_IN) : SV_POSITION
+{
+    Vertex IN = DecodeVertex(COMPACT_IN);
+#else
 float4 main(Vertex IN) : SV_POSITION
 {
-    matrix mvp = mul(Model, DirLight.LightSpaceMatrix);
+#endif
+    matrix Model = Models[ModelIndex];
     float4 pos = mul(float4(IN.Position, 1.0f), Model);
     pos = mul(pos, DirLight.LightSpaceMatrix);
     return pos;
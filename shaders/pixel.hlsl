@@ -3,16 +3,28 @@
 #include "scenebuffer.hlsli"
 
 Texture2D depthMap : register(t0);
-Texture2D diffuseMap : register(t1);
+
+// Descriptors of the frame, the draw selects its diffuse texture
+Texture2D frameTextures[] : register(t0, space1);
+
+// Root constants of the draw, the instance offset also selects the material
+cbuffer DrawCB : register(b0)
+{
+    uint InstanceOffset;
+    uint TextureIndex;
+}
 
 SamplerState sampleWrap : register(s0);
 SamplerState sampleClamp : register(s1);
 
-cbuffer MaterialCB : register(b1) 
+struct Material
 {
     float metallic;
     float roughness;
-}
+};
+
+// Material per instance
+StructuredBuffer<Material> Materials : register(t1);
 
 struct PixelShaderInput
 {
@@ -133,7 +145,9 @@ float4 main(PixelShaderInput IN) : SV_TARGET
 	float3 N = normalize(IN.Normal);
 	float3 V = normalize(CameraPosition.xyz - IN.WorldPosition);
 	float3 R = reflect(-V, N);
-	float3 albedo = diffuseMap.Sample(sampleWrap, IN.TextureCoord).xyz;
+	float3 albedo = frameTextures[TextureIndex].Sample(sampleWrap, IN.TextureCoord).xyz;
+    float metallic = Materials[InstanceOffset].metallic;
+    float roughness = Materials[InstanceOffset].roughness;
 
     float3 F0 = float3(0.04, 0.04, 0.04);
     F0 = lerp(F0, albedo, metallic);
@@ -25,11 +25,16 @@ float3x3 inverse(float3x3 m)
     return minv;
 }
 
-cbuffer ObjectModelCB : register(b0)
+// Root constants of the draw, first instance of the draw in the instance buffer and the texture index of the pixel shader
+cbuffer DrawCB : register(b0)
 {
-    matrix Model;
+    uint InstanceOffset;
+    uint TextureIndex;
 }
 
+// Model matrix per instance
+StructuredBuffer<matrix> Instances : register(t2);
+
 struct Vertex
 {
     float3 Position : POSITION;
@@ -37,6 +42,10 @@ struct Vertex
     float3 Normal : NORMAL;
 };
 
+#ifdef COMPACT_VERTEX
+#include "compactvertex.hlsli"
+#endif
+
 struct VertexShaderOutput
 {
     float4 WorldPosition : WORLD_POSITION;
@@ -45,9 +54,16 @@ struct VertexShaderOutput
     float4 Position : SV_Position;
 };
 
-VertexShaderOutput main(Vertex IN)
+#ifdef COMPACT_VERTEX
+VertexShaderOutput main(CompactVertex COMPACT_IN, uint InstanceID : SV_InstanceID)
+{
+    Vertex IN = DecodeVertex(COMPACT_IN);
+#else
+VertexShaderOutput main(Vertex IN, uint InstanceID : SV_InstanceID)
 {
+#endif
     VertexShaderOutput OUT;
+    matrix Model = Instances[InstanceOffset + InstanceID];
 
     OUT.WorldPosition = mul(float4(IN.Position, 1.0f), Model);
     matrix mvp = mul(Model, mul(View, Projection));
@@ -0,0 +1,4 @@
+/// Vertex Shader for the CompactVertex layout
+
+#define COMPACT_VERTEX
+#include "vertex.hlsl"
@@ -45,9 +45,17 @@ LRESULT CALLBACK Application::WndProc(HWND hwnd, UINT message, WPARAM wParam, LP
         Update();
         m_renderer->Render();
         break;
+    case WM_MOUSEMOVE:
+    case WM_LBUTTONDOWN:
+    case WM_RBUTTONDOWN:
+    case WM_MOUSEWHEEL:
+        // The gui has handled the mouse, the next frame shows the result
+        m_renderer->OnInput();
+        return ::DefWindowProcW(hwnd, message, wParam, lParam);
     case WM_SYSKEYDOWN:
     case WM_KEYDOWN:
     {
+        m_renderer->OnInput();
         bool alt = (::GetAsyncKeyState(VK_MENU) & 0x8000) != 0;
 
         switch (wParam)
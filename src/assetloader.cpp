@@ -0,0 +1,275 @@
+#include "assetloader.h"
+
+#include <chrono>
+#include <fstream>
+
+#include "utility.h"
+#include "texture.h"
+#include "mappedfile.h"
+#include "meshcache.h"
+#include "jobsystem.h"
+
+bool AssetLoader::s_blocking_load = false;
+
+AssetLoader::AssetLoader(TextureLibrary* texture_library, size_t queue_capacity) :
+    m_texture_library(texture_library), m_command_queue(D3D12_COMMAND_LIST_TYPE_COPY), m_read_queue(0), m_decode_queue(queue_capacity),
+    m_upload_queue(queue_capacity), m_num_pending(0), m_cancelled(false), m_stats{}
+{
+}
+
+AssetLoader::~AssetLoader()
+{
+    Cancel();
+    if (m_read_thread.joinable())
+        m_read_thread.join();
+    if (m_decode_thread.joinable())
+        m_decode_thread.join();
+    if (m_upload_thread.joinable())
+        m_upload_thread.join();
+    m_command_queue.Flush();
+}
+
+void AssetLoader::LoadMesh(Mesh* mesh, const std::filesystem::path& file_path, const MeshImportOptions& options)
+{
+    if (m_upload_thread.joinable())
+        throw std::exception("AssetLoader::LoadMesh(): Loading has already started");
+
+    ++m_num_pending;
+    m_read_queue.Push({ mesh, nullptr, file_path, options });
+}
+
+void AssetLoader::Start()
+{
+    if (m_num_pending == 0) {
+        m_read_queue.Close();
+        return;
+    }
+
+    m_read_thread = std::thread(&AssetLoader::RunReadStage, this);
+    m_decode_thread = std::thread(&AssetLoader::RunDecodeStage, this);
+    m_upload_thread = std::thread(&AssetLoader::RunUploadStage, this);
+}
+
+void AssetLoader::CollectResident(std::vector<Mesh*>& meshes, std::vector<Texture*>& textures)
+{
+    std::lock_guard<std::mutex> lock(m_submitted_mutex);
+    if (m_error)
+        std::rethrow_exception(m_error);
+
+    // The fence is only read here, the queue itself belongs to the upload thread
+    std::erase_if(m_submitted, [&](const SubmittedAsset& asset) {
+        if (!m_command_queue.IsFenceComplete(asset.fence_value))
+            return false;
+
+        if (asset.mesh)
+            meshes.push_back(asset.mesh);
+        else
+            textures.push_back(asset.texture);
+        return true;
+    });
+}
+
+void AssetLoader::Wait()
+{
+    if (m_read_thread.joinable())
+        m_read_thread.join();
+    if (m_decode_thread.joinable())
+        m_decode_thread.join();
+    if (m_upload_thread.joinable())
+        m_upload_thread.join();
+    m_command_queue.Flush();
+}
+
+bool AssetLoader::IsDone()
+{
+    std::lock_guard<std::mutex> lock(m_submitted_mutex);
+    return m_num_pending == 0 && m_submitted.empty();
+}
+
+void AssetLoader::ReportStats(const wchar_t* name)
+{
+    wchar_t buffer[500];
+    swprintf_s(buffer, 500, L"%s: %u meshes and %u textures, read %llu bytes in %f ms, decoded in %f ms, uploaded %llu bytes in %f ms with %u submissions\n", name,
+        m_stats.num_meshes, m_stats.num_textures, m_stats.bytes_read, m_stats.read_time * 1e3, m_stats.decode_time * 1e3, m_stats.bytes_uploaded,
+        m_stats.upload_time * 1e3, m_stats.num_submissions);
+    OutputDebugString(buffer);
+
+    m_command_queue.GetUploadAllocator()->ReportStats(name);
+}
+
+void AssetLoader::RunReadStage()
+{
+    try {
+        Request request;
+        while (!m_cancelled && m_read_queue.Pop(request)) {
+            auto read_start = std::chrono::high_resolution_clock::now();
+            ReadAsset asset{ request };
+
+            if (request.mesh) {
+                // Bring the file the decode stage is going to map into memory, the cooked cache if it exists
+                std::filesystem::path cache_path = MeshCache::GetCachePath(request.file_path);
+                std::filesystem::path mapped_path = std::filesystem::exists(cache_path) ? cache_path : request.file_path;
+                if (std::filesystem::exists(mapped_path) && std::filesystem::file_size(mapped_path) > 0) {
+                    asset.mapped_file = std::make_shared<MappedFile>(mapped_path);
+                    const volatile uint8_t* data = asset.mapped_file->GetData();
+                    for (size_t offset = 0; offset < asset.mapped_file->GetSize(); offset += 4096)
+                        static_cast<void>(data[offset]);
+                    m_stats.bytes_read += asset.mapped_file->GetSize();
+                }
+            }
+            else {
+                std::ifstream file(request.file_path, std::ios::binary | std::ios::ate);
+                if (!file)
+                    throw std::exception("AssetLoader::RunReadStage(): Texture file not found");
+
+                asset.file_data.resize(static_cast<size_t>(file.tellg()));
+                file.seekg(0);
+                file.read(reinterpret_cast<char*>(asset.file_data.data()), asset.file_data.size());
+                m_stats.bytes_read += asset.file_data.size();
+            }
+
+            std::chrono::duration<double> read_time = std::chrono::high_resolution_clock::now() - read_start;
+            m_stats.read_time += read_time.count();
+            m_decode_queue.Push(std::move(asset));
+        }
+    }
+    catch (...) {
+        Fail(std::current_exception());
+    }
+    m_decode_queue.Close();
+}
+
+void AssetLoader::RunDecodeStage()
+{
+    bool com_initialized = false;
+    try {
+        // Initialize required for DirectXTex library https://github.com/microsoft/DirectXTex/wiki/DirectXTex
+        // The worker threads of the job system initialize it when they start
+        ThrowIfFailed(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+        com_initialized = true;
+
+        JobSystem* job_system = JobSystem::Get();
+        std::vector<ReadAsset> batch;
+        ReadAsset asset;
+        while (!m_cancelled && m_decode_queue.Pop(asset)) {
+            // Decode everything which has been read so far in parallel, at most one asset per thread
+            batch.clear();
+            batch.push_back(std::move(asset));
+            while (batch.size() < job_system->GetNumWorkers() && m_decode_queue.TryPop(asset))
+                batch.push_back(std::move(asset));
+
+            // Background jobs, so the frames waiting for their own jobs do not run them
+            auto decode_start = std::chrono::high_resolution_clock::now();
+            JobSystem::Counter counter;
+            for (ReadAsset& read_asset : batch) {
+                job_system->Run([this, &read_asset]() {
+                    Request& request = read_asset.request;
+                    if (request.mesh)
+                        *request.mesh = Mesh::ReadFile(request.file_path.string(), m_texture_library, request.options);
+                    else
+                        request.texture->Decode(read_asset.file_data);
+                }, &counter, nullptr, JobSystem::JOB_PRIORITY_LOW);
+            }
+            job_system->Wait(counter, JobSystem::JOB_PRIORITY_LOW);
+
+            std::chrono::duration<double> decode_time = std::chrono::high_resolution_clock::now() - decode_start;
+            m_stats.decode_time += decode_time.count();
+
+            // Passed on in the order they were read
+            for (ReadAsset& decoded_asset : batch) {
+                Request& request = decoded_asset.request;
+                if (request.mesh) {
+                    ++m_stats.num_meshes;
+
+                    // Read the textures before the next mesh so the first items can be drawn early
+                    for (Texture* texture : request.mesh->GetTextures()) {
+                        if (!m_requested_textures.insert(texture).second)
+                            continue;
+                        ++m_num_pending;
+                        m_read_queue.Push({ nullptr, texture, texture->GetFileName(), {} }, true);
+                    }
+                }
+                else {
+                    ++m_stats.num_textures;
+                }
+
+                // The file is no longer needed once decoded
+                decoded_asset.mapped_file.reset();
+                decoded_asset.file_data = {};
+                m_upload_queue.Push(std::move(request));
+            }
+        }
+    }
+    catch (...) {
+        Fail(std::current_exception());
+    }
+    m_upload_queue.Close();
+
+    if (com_initialized)
+        CoUninitialize();
+}
+
+void AssetLoader::RunUploadStage()
+{
+    try {
+        UploadAllocator* upload_allocator = m_command_queue.GetUploadAllocator();
+        Request request;
+        while (!m_cancelled && m_upload_queue.Pop(request)) {
+            auto upload_start = std::chrono::high_resolution_clock::now();
+            uint64_t uploaded_bytes = upload_allocator->GetStats().bytes_uploaded;
+
+            // Record everything that has been decoded so far in the same command list
+            std::vector<SubmittedAsset> batch;
+            auto command_list = m_command_queue.GetCommandList();
+            do {
+                if (request.mesh)
+                    request.mesh->Upload(command_list);
+                else
+                    request.texture->Upload(command_list);
+                batch.push_back({ request.mesh, request.texture, 0 });
+            } while (upload_allocator->GetStats().bytes_uploaded - uploaded_bytes < s_max_batch_upload_size && m_upload_queue.TryPop(request));
+
+            uint64_t fence_value = m_command_queue.ExecuteCommandList(std::move(command_list));
+            ++m_stats.num_submissions;
+            m_stats.bytes_uploaded += upload_allocator->GetStats().bytes_uploaded - uploaded_bytes;
+            std::chrono::duration<double> upload_time = std::chrono::high_resolution_clock::now() - upload_start;
+            m_stats.upload_time += upload_time.count();
+
+            // The pending count changes together with the submitted assets so IsDone() does not see them in between
+            bool all_submitted = false;
+            {
+                std::lock_guard<std::mutex> lock(m_submitted_mutex);
+                for (SubmittedAsset& asset : batch) {
+                    asset.fence_value = fence_value;
+                    m_submitted.push_back(asset);
+                }
+                all_submitted = m_num_pending.fetch_sub(batch.size()) == batch.size();
+            }
+
+            // Everything has been submitted, the read stage stops and closes the queues after it
+            if (all_submitted)
+                m_read_queue.Close();
+        }
+    }
+    catch (...) {
+        Fail(std::current_exception());
+    }
+}
+
+void AssetLoader::Fail(std::exception_ptr error)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_submitted_mutex);
+        if (!m_error)
+            m_error = error;
+    }
+    Cancel();
+}
+
+void AssetLoader::Cancel()
+{
+    m_cancelled = true;
+    m_read_queue.Close();
+    m_decode_queue.Close();
+    m_upload_queue.Close();
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "commandqueue.h"
+#include "mesh.h"
+
+// Forward declaration
+class Texture;
+class TextureLibrary;
+class MappedFile;
+
+// Queue between two loader stages, Push() blocks while the queue is full and Pop() while it is empty
+template <typename T>
+class BoundedQueue {
+private:
+    std::deque<T> m_items;
+    size_t m_capacity; // 0 does not limit the queue
+    bool m_closed;
+
+    std::mutex m_mutex;
+    std::condition_variable m_not_empty;
+    std::condition_variable m_not_full;
+
+public:
+    BoundedQueue(size_t capacity) : m_capacity(capacity), m_closed(false) {}
+
+    // The item is dropped if the queue has been closed
+    void Push(T item, bool front = false)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_not_full.wait(lock, [this] { return m_closed || m_capacity == 0 || m_items.size() < m_capacity; });
+        if (m_closed)
+            return;
+
+        if (front)
+            m_items.push_front(std::move(item));
+        else
+            m_items.push_back(std::move(item));
+        m_not_empty.notify_one();
+    }
+
+    // Returns false once the queue has been closed and all items have been taken
+    bool Pop(T& item)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_not_empty.wait(lock, [this] { return m_closed || !m_items.empty(); });
+        return Take(item);
+    }
+
+    // Returns false without waiting if the queue is empty
+    bool TryPop(T& item)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return Take(item);
+    }
+
+    void Close()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_not_empty.notify_all();
+        m_not_full.notify_all();
+    }
+
+private:
+    bool Take(T& item)
+    {
+        if (m_items.empty())
+            return false;
+
+        item = std::move(m_items.front());
+        m_items.pop_front();
+        m_not_full.notify_one();
+        return true;
+    }
+};
+
+// Loads the meshes and their textures on three threads connected by bounded queues, so reading the files,
+// decoding them on the CPU and copying them to the GPU overlap. The decode stage spreads the assets over the job system
+// Each asset becomes resident once the fence of the command list with its copies has completed, which lets the scene
+// render before everything has been loaded
+class AssetLoader {
+public:
+    struct Stats {
+        unsigned int num_meshes;
+        unsigned int num_textures;
+        uint64_t bytes_read;
+        uint64_t bytes_uploaded;
+        unsigned int num_submissions;
+        double read_time; // seconds each stage has been busy
+        double decode_time;
+        double upload_time;
+    };
+
+    static constexpr size_t s_default_queue_capacity = 4;
+
+    // Pending upload size after which the recorded command list is submitted and a new one started
+    static constexpr uint64_t s_max_batch_upload_size = 256 * 1024 * 1024;
+
+private:
+    // Either the mesh or the texture is set
+    struct Request {
+        Mesh* mesh;
+        Texture* texture;
+        std::filesystem::path file_path;
+        MeshImportOptions options;
+    };
+
+    struct ReadAsset {
+        Request request;
+        std::shared_ptr<MappedFile> mapped_file; // mesh file kept mapped until it has been decoded so the pages stay in memory
+        std::vector<uint8_t> file_data; // texture files are decoded from memory
+    };
+
+    struct SubmittedAsset {
+        Mesh* mesh;
+        Texture* texture;
+        uint64_t fence_value;
+    };
+
+    TextureLibrary* m_texture_library;
+
+    // Copy queue only used by the upload thread
+    CommandQueue m_command_queue;
+
+    BoundedQueue<Request> m_read_queue; // not limited, the decode stage adds the textures of the meshes
+    BoundedQueue<ReadAsset> m_decode_queue;
+    BoundedQueue<Request> m_upload_queue;
+
+    std::thread m_read_thread;
+    std::thread m_decode_thread;
+    std::thread m_upload_thread;
+
+    // Requested assets which have not been submitted yet, the stages stop when it reaches 0
+    std::atomic<size_t> m_num_pending;
+    std::atomic<bool> m_cancelled;
+
+    // Textures requested by the decode stage
+    std::set<Texture*> m_requested_textures;
+
+    // Submitted assets waiting for their fence, and the first error of the loader threads
+    std::mutex m_submitted_mutex;
+    std::vector<SubmittedAsset> m_submitted;
+    std::exception_ptr m_error;
+
+    // Each stage writes its own members, read once loading has finished
+    Stats m_stats;
+
+    // Wait for all assets in Scene::LoadResources() to compare against loading before the first frame
+    static bool s_blocking_load;
+
+public:
+    AssetLoader(TextureLibrary* texture_library, size_t queue_capacity = s_default_queue_capacity);
+    ~AssetLoader();
+
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    // Request a mesh and its textures, to be called before Start()
+    void LoadMesh(Mesh* mesh, const std::filesystem::path& file_path, const MeshImportOptions& options);
+
+    void Start();
+
+    // Assets whose copies have completed since the last call, rethrows the errors of the loader threads
+    void CollectResident(std::vector<Mesh*>& meshes, std::vector<Texture*>& textures);
+
+    // Block until every requested asset has been copied to the GPU
+    void Wait();
+
+    // True once every requested asset has been returned by CollectResident()
+    bool IsDone();
+
+    const Stats& GetStats() const { return m_stats; }
+
+    // Report the stats with OutputDebugString, once loading has finished
+    void ReportStats(const wchar_t* name);
+
+    static void SetBlockingLoad(bool blocking_load) { s_blocking_load = blocking_load; }
+    static bool IsBlockingLoad() { return s_blocking_load; }
+
+private:
+    void RunReadStage();
+    void RunDecodeStage();
+    void RunUploadStage();
+
+    // Store the error and stop the stages
+    void Fail(std::exception_ptr error);
+    void Cancel();
+};
@@ -0,0 +1,103 @@
+#include "buddyallocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+BuddyAllocator::BuddyAllocator(uint64_t size, uint64_t min_block_size) :
+    m_size(size), m_min_block_size(min_block_size), m_num_orders(0), m_stats{}
+{
+    if (!IsPowerOfTwo(size) || !IsPowerOfTwo(min_block_size) || min_block_size > size)
+        throw std::invalid_argument("BuddyAllocator::BuddyAllocator(): Sizes need to be powers of two");
+
+    while (GetBlockSize(m_num_orders) < m_size)
+        ++m_num_orders;
+    ++m_num_orders;
+
+    // Start with a single free block of the whole size
+    m_free_blocks.resize(m_num_orders);
+    m_free_blocks[m_num_orders - 1].insert(0);
+    m_stats.free_bytes = m_size;
+    m_stats.largest_free_block = m_size;
+}
+
+uint64_t BuddyAllocator::Allocate(uint64_t size, uint64_t alignment)
+{
+    uint64_t block_size = std::max(std::max(size, alignment), m_min_block_size);
+    if (size == 0 || block_size > m_size)
+        return s_invalid_offset;
+
+    unsigned int order = 0;
+    while (GetBlockSize(order) < block_size)
+        ++order;
+
+    // Smallest free block that fits
+    unsigned int free_order = order;
+    while (free_order < m_num_orders && m_free_blocks[free_order].empty())
+        ++free_order;
+    if (free_order == m_num_orders)
+        return s_invalid_offset;
+
+    uint64_t offset = *m_free_blocks[free_order].begin();
+    m_free_blocks[free_order].erase(m_free_blocks[free_order].begin());
+
+    // Split down to the requested order, the upper halves become free buddies
+    while (free_order > order) {
+        --free_order;
+        m_free_blocks[free_order].insert(offset + GetBlockSize(free_order));
+    }
+
+    m_allocations[offset] = { order, size };
+    ++m_stats.num_allocations;
+    m_stats.allocated_bytes += size;
+    m_stats.used_bytes += GetBlockSize(order);
+    m_stats.free_bytes -= GetBlockSize(order);
+    UpdateLargestFreeBlock();
+    return offset;
+}
+
+void BuddyAllocator::Free(uint64_t offset)
+{
+    auto allocation = m_allocations.find(offset);
+    if (allocation == m_allocations.end())
+        throw std::invalid_argument("BuddyAllocator::Free(): Offset was not allocated");
+
+    unsigned int order = allocation->second.order;
+    --m_stats.num_allocations;
+    m_stats.allocated_bytes -= allocation->second.size;
+    m_stats.used_bytes -= GetBlockSize(order);
+    m_stats.free_bytes += GetBlockSize(order);
+    m_allocations.erase(allocation);
+
+    // Merge with the buddy as long as it is free
+    while (order + 1 < m_num_orders) {
+        uint64_t buddy = offset ^ GetBlockSize(order);
+        auto free_buddy = m_free_blocks[order].find(buddy);
+        if (free_buddy == m_free_blocks[order].end())
+            break;
+
+        m_free_blocks[order].erase(free_buddy);
+        offset = std::min(offset, buddy);
+        ++order;
+    }
+    m_free_blocks[order].insert(offset);
+    UpdateLargestFreeBlock();
+}
+
+float BuddyAllocator::GetFragmentation() const
+{
+    if (m_stats.free_bytes == 0)
+        return 0.0f;
+    return 1.0f - static_cast<float>(m_stats.largest_free_block) / static_cast<float>(m_stats.free_bytes);
+}
+
+void BuddyAllocator::UpdateLargestFreeBlock()
+{
+    m_stats.largest_free_block = 0;
+    for (unsigned int order = m_num_orders; order > 0; --order) {
+        if (!m_free_blocks[order - 1].empty()) {
+            m_stats.largest_free_block = GetBlockSize(order - 1);
+            break;
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+// Buddy allocator for offsets into a memory block, the memory itself is not touched so it has no dependency on D3D12
+// Blocks are powers of two and naturally aligned to their size, so any alignment up to the block size is satisfied
+class BuddyAllocator {
+public:
+    struct Stats {
+        uint64_t num_allocations;
+        uint64_t allocated_bytes; // requested sizes
+        uint64_t used_bytes; // block sizes including the rounding up to a power of two
+        uint64_t free_bytes;
+        uint64_t largest_free_block;
+    };
+
+    static constexpr uint64_t s_invalid_offset = UINT64_MAX;
+
+private:
+    uint64_t m_size;
+    uint64_t m_min_block_size;
+    unsigned int m_num_orders; // order 0 is m_min_block_size, the last order is m_size
+
+    // Free block offsets for every order, ordered so the lowest address is used first
+    std::vector<std::set<uint64_t>> m_free_blocks;
+
+    // Order and requested size of every allocation by offset
+    struct AllocationInfo {
+        unsigned int order;
+        uint64_t size;
+    };
+    std::unordered_map<uint64_t, AllocationInfo> m_allocations;
+
+    Stats m_stats;
+
+public:
+    // size and min_block_size need to be powers of two
+    BuddyAllocator(uint64_t size, uint64_t min_block_size);
+
+    // Returns s_invalid_offset if there is no free block large enough
+    uint64_t Allocate(uint64_t size, uint64_t alignment = 1);
+    void Free(uint64_t offset);
+
+    uint64_t GetSize() const { return m_size; }
+    bool IsEmpty() const { return m_allocations.empty(); }
+    const Stats& GetStats() const { return m_stats; }
+
+    // 0 if all free memory is in one block, close to 1 if the free memory is split into many small blocks
+    float GetFragmentation() const;
+
+    static bool IsPowerOfTwo(uint64_t value) { return value != 0 && (value & (value - 1)) == 0; }
+
+private:
+    uint64_t GetBlockSize(unsigned int order) const { return m_min_block_size << order; }
+    void UpdateLargestFreeBlock();
+};
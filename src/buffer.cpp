@@ -3,10 +3,20 @@
 #include "utility.h"
 #include "renderer.h"
 #include "commandlist.h"
+#include "compactvertex.h"
+#include "heapallocator.h"
+#include "residencymanager.h"
 
 /// Gpu Resource
 
 void GpuResource::TransitionResourceState(CommandList& command_list, D3D12_RESOURCE_STATES updated_state) {
+    // A use in another state still completes the split transition first
+    if (m_split_begun) {
+        command_list.ResourceBarrier(m_resource.Get(), m_resource_state, m_split_state, D3D12_RESOURCE_BARRIER_FLAG_END_ONLY);
+        m_resource_state = m_split_state;
+        m_split_begun = false;
+    }
+
     if (updated_state == m_resource_state)
         return;
 
@@ -14,8 +24,62 @@ void GpuResource::TransitionResourceState(CommandList& command_list, D3D12_RESOU
     m_resource_state = updated_state; // state should only actually change after execution of the command list
 }
 
+void GpuResource::BeginTransition(CommandList& command_list, D3D12_RESOURCE_STATES next_state)
+{
+    if (next_state == m_resource_state || m_split_begun)
+        return;
+
+    command_list.ResourceBarrier(m_resource.Get(), m_resource_state, next_state, D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY);
+    m_split_state = next_state;
+    m_split_begun = true;
+}
+
+GpuResource GpuResource::ReleaseResource()
+{
+    GpuResource released;
+    released.m_resource = std::move(m_resource);
+    released.m_allocation = std::move(m_allocation);
+    released.m_resource_state = m_resource_state;
+    released.m_split_state = m_split_state;
+    released.m_split_begun = m_split_begun;
+    return released;
+}
+
+void GpuResource::MarkUsed() const
+{
+    if (m_residency)
+        m_residency->MarkUsed();
+}
+
+void GpuResource::TrackResidency(ResidencyPolicy::ResourceCategory category)
+{
+    Microsoft::WRL::ComPtr<ID3D12Device2> device = Renderer::GetDevice();
+    D3D12_RESOURCE_DESC resource_desc = m_resource->GetDesc();
+    uint64_t size = device->GetResourceAllocationInfo(0, 1, &resource_desc).SizeInBytes;
+
+    if (m_residency)
+        m_residency->SetSize(size);
+    else
+        m_residency = Renderer::GetResidencyManager()->Track(category, size);
+}
+
+GpuResource GpuResource::CreatePlacedResource(ID3D12Heap* heap, uint64_t offset, const D3D12_CLEAR_VALUE* clear_value)
+{
+    Microsoft::WRL::ComPtr<ID3D12Device2> device = Renderer::GetDevice();
+    D3D12_RESOURCE_DESC resource_desc = m_resource->GetDesc();
+
+    Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+    ThrowIfFailed(device->CreatePlacedResource(heap, offset, &resource_desc, m_resource_state, clear_value, IID_PPV_ARGS(&resource)));
+
+    // The owner of the heap accounts its memory
+    GpuResource previous = ReleaseResource();
+    m_resource = std::move(resource);
+    m_residency.reset();
+    return previous;
+}
+
 // IShader Resource
-IShaderResource::IShaderResource() : m_shader_visible_cpu_handles(Renderer::s_num_frames), m_shader_visible_gpu_handles(Renderer::s_num_frames), m_srv_handle{}  {}
+IShaderResource::IShaderResource() : m_shader_visible_cpu_handles(Renderer::GetNumFrames()), m_shader_visible_gpu_handles(Renderer::GetNumFrames()), m_srv_handle{}  {}
 
 void IShaderResource::CreateShaderResourceView(ID3D12Resource* resource, const D3D12_CPU_DESCRIPTOR_HANDLE& handle, D3D12_SHADER_RESOURCE_VIEW_DESC* desc)
 {
@@ -44,13 +108,25 @@ void IShaderResource::ResourceChanged(ID3D12Resource* resource)
     // recreate
     CreateShaderResourceView(resource, m_srv_handle);
 
-    for (unsigned int frame_idx = 0; frame_idx < Renderer::s_num_frames; ++frame_idx) {
+    for (unsigned int frame_idx = 0; frame_idx < Renderer::GetNumFrames(); ++frame_idx) {
         if (m_shader_visible_cpu_handles[frame_idx].ptr) {
             BindShaderResourceView(frame_idx, m_shader_visible_cpu_handles[frame_idx], m_shader_visible_gpu_handles[frame_idx]);
         }
     }
 }
 
+void IShaderResource::ResourceChanged(ID3D12Resource* resource, unsigned int frame_idx)
+{
+    CreateShaderResourceView(resource, m_srv_handle);
+    RebindShaderResourceView(frame_idx);
+}
+
+void IShaderResource::RebindShaderResourceView(unsigned int frame_idx)
+{
+    if (m_shader_visible_cpu_handles[frame_idx].ptr)
+        BindShaderResourceView(frame_idx, m_shader_visible_cpu_handles[frame_idx], m_shader_visible_gpu_handles[frame_idx]);
+}
+
 // IConstant Buffer Resource
 
 void IConstantBufferResource::CreateConstantBufferView(ID3D12Resource* resource, const D3D12_CPU_DESCRIPTOR_HANDLE& handle, const D3D12_GPU_DESCRIPTOR_HANDLE& gpu_handle)
@@ -99,6 +175,7 @@ void UploadBuffer::Create(size_t buffer_size)
     // Set appropriate initial resource state
     m_resource_state = D3D12_RESOURCE_STATE_GENERIC_READ;
     m_resource->SetName(L"Upload Buffer");
+    TrackResidency(ResidencyPolicy::RESOURCE_CATEGORY_UPLOAD);
 }
 
 void UploadBuffer::Map(unsigned int subresource, const D3D12_RANGE* read_range, void** buffer_WO)
@@ -114,33 +191,25 @@ void GpuBuffer<T>::Create(size_t num_elements)
 {
     m_buffer_size = num_elements * sizeof(T);
 
-    Microsoft::WRL::ComPtr<ID3D12Device2> device = Renderer::GetDevice();
-
-    auto heap_props = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+    // Create a placed resource for the GPU resource in a default heap.
     auto heap_resource_desc = CD3DX12_RESOURCE_DESC::Buffer(m_buffer_size);
-    // Create a committed resource for the GPU resource in a default heap.
-    ThrowIfFailed(device->CreateCommittedResource(
-        &heap_props,
-        D3D12_HEAP_FLAG_NONE,
-        &heap_resource_desc,
-        D3D12_RESOURCE_STATE_COPY_DEST,
-        nullptr,
-        IID_PPV_ARGS(&m_resource)));
+    m_resource = Renderer::GetHeapAllocator()->CreateResource(heap_resource_desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, m_allocation);
 
     // Set appropriate initial resource state
     m_resource_state = D3D12_RESOURCE_STATE_COPY_DEST;
     m_resource->SetName(L"Templated Gpu Buffer");
+    TrackResidency(ResidencyPolicy::RESOURCE_CATEGORY_MESH);
 }
 
 template <class T>
-void GpuBuffer<T>::Upload(CommandList& command_list, const std::vector<T>& buffer_data) 
+void GpuBuffer<T>::Upload(CommandList& command_list, std::span<const T> buffer_data) 
 {
-    if (m_buffer_size != buffer_data.size() * sizeof(T))
+    if (m_buffer_size != buffer_data.size_bytes())
         throw std::exception();
 
     // Upload function commandlist, uploadbuffer
     D3D12_SUBRESOURCE_DATA subresource_data = {};
-    subresource_data.pData = std::data(buffer_data);
+    subresource_data.pData = buffer_data.data();
     subresource_data.RowPitch = m_buffer_size;
     subresource_data.SlicePitch = subresource_data.RowPitch;
 
@@ -164,7 +233,7 @@ D3D12_INDEX_BUFFER_VIEW GpuBuffer<T>::GetIndexBufferView() const requires IsInde
 {
     D3D12_INDEX_BUFFER_VIEW index_buffer_view{};
     index_buffer_view.BufferLocation = m_resource->GetGPUVirtualAddress();
-    index_buffer_view.Format = DXGI_FORMAT_R32_UINT; // Should check Type num bits
+    index_buffer_view.Format = (sizeof(T) == sizeof(uint16_t)) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
     index_buffer_view.SizeInBytes = CastToUint(m_buffer_size);
     return index_buffer_view;
 }
@@ -172,4 +241,6 @@ D3D12_INDEX_BUFFER_VIEW GpuBuffer<T>::GetIndexBufferView() const requires IsInde
 // Declare the GpuBuffer types to be used to avoid Linker errors https://isocpp.org/wiki/faq/templates#separate-template-fn-defn-from-decl
 template class GpuBuffer<ScreenVertex>;
 template class GpuBuffer<Vertex>;
+template class GpuBuffer<CompactVertex>;
+template class GpuBuffer<uint16_t>;
 template class GpuBuffer<uint32_t>;
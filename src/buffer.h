@@ -6,29 +6,65 @@
 #include <DirectXMath.h>
 
 #include <vector>
+#include <span>
+#include <memory>
 
+#include "residencypolicy.h"
+#include "vertex.h"
 
 // Forward Declarations
 class CommandList;
+class HeapAllocation;
+class ResidencyHandle;
 
 // Resources which need to be uploaded to GPU and are not changed afterwards via CPU side
 class GpuResource {
 protected:
     Microsoft::WRL::ComPtr<ID3D12Resource> m_resource;
 
+    // Heap memory of placed resources, shared by the copies of the resource
+    std::shared_ptr<HeapAllocation> m_allocation;
+
+    // Size and last use in the GPU memory budget, shared by the copies of the resource
+    std::shared_ptr<ResidencyHandle> m_residency;
+
     // Naive way of tracking resource state
     D3D12_RESOURCE_STATES m_resource_state;
+    // Target of the split transition begun on the command list, if any
+    D3D12_RESOURCE_STATES m_split_state;
+    bool m_split_begun;
+
+    // Account the created resource in the residency manager, a recreated resource updates the size of its entry
+    void TrackResidency(ResidencyPolicy::ResourceCategory category);
+
+    // Replace the resource by one with the same description placed in a heap owned by someone else, it is no longer accounted
+    // Returns the previous resource and its heap memory
+    GpuResource CreatePlacedResource(ID3D12Heap* heap, uint64_t offset, const D3D12_CLEAR_VALUE* clear_value);
 
 public:
-    GpuResource() : m_resource_state(D3D12_RESOURCE_STATE_COMMON) {}
+    GpuResource() : m_resource_state(D3D12_RESOURCE_STATE_COMMON), m_split_state(D3D12_RESOURCE_STATE_COMMON), m_split_begun(false) {}
     virtual ~GpuResource() { Destroy(); }
 
-    virtual void Destroy() { m_resource.Reset(); }
+    virtual void Destroy() { m_resource.Reset(); m_allocation.reset(); m_residency.reset(); }
+
+    // Move the resource and its heap memory out to keep them alive while the GPU may still use them, the residency entry stays
+    GpuResource ReleaseResource();
+
+    // Move the resource into memory shared with other transient resources, derived classes recreate their views
+    // Returns the previous resource, which needs to be kept alive until the GPU no longer uses it
+    virtual GpuResource PlaceResource(ID3D12Heap* heap, uint64_t offset) { return CreatePlacedResource(heap, offset, nullptr); }
 
     ID3D12Resource* GetResource() { return m_resource.Get(); }
+    ResidencyHandle* GetResidencyHandle() const { return m_residency.get(); }
+
+    // Record the use in the current frame for the least recently used eviction
+    void MarkUsed() const;
 
     // TODO: look at how to make this work for multithreaded situation
     void TransitionResourceState(CommandList& command_list, D3D12_RESOURCE_STATES updated_state);
+    // Begin the transition to the state the resource is used in next, the GPU can overlap it with the commands recorded
+    // until the next TransitionResourceState() ends it. Both have to be recorded on the same command list
+    void BeginTransition(CommandList& command_list, D3D12_RESOURCE_STATES next_state);
     D3D12_RESOURCE_STATES GetResourceState() const { return m_resource_state; }
 };
 
@@ -58,6 +94,11 @@ public:
     
     // Used in case resource has been reset and recreated for resize
     void ResourceChanged(ID3D12Resource* resource);
+
+    // Recreate the view of a resource replaced while the GPU is running, only the descriptor of the frame is updated
+    // since the others may still be in use; they are updated with RebindShaderResourceView() at the start of their frame
+    void ResourceChanged(ID3D12Resource* resource, unsigned int frame_idx);
+    void RebindShaderResourceView(unsigned int frame_idx);
 };
 
 
@@ -89,28 +130,6 @@ public:
 };
 
 
-// Define vertex
-struct ScreenVertex
-{
-    DirectX::XMFLOAT2 position;
-    DirectX::XMFLOAT2 texture_coord;
-};
-
-
-struct Vertex
-{
-    DirectX::XMFLOAT3 position;
-    DirectX::XMFLOAT2 texture_coord;
-    DirectX::XMFLOAT3 normal;
-};
-
-// Concept to ensure vertex type struct is used for Meshes
-template<class T>
-concept IsVertex = std::is_class_v<Vertex> || std::is_class_v<ScreenVertex>;
-
-template<class T>
-concept IsIndex = std::is_unsigned_v<T>;
-
 template <class T>
 class GpuBuffer : public GpuResource {
     size_t m_buffer_size;
@@ -119,7 +138,7 @@ public:
     GpuBuffer() : m_buffer_size(0) {}
 
     void Create(size_t num_elements);
-    void Upload(CommandList& command_list, const std::vector<T>& buffer_data);
+    void Upload(CommandList& command_list, std::span<const T> buffer_data);
 
 
     D3D12_VERTEX_BUFFER_VIEW GetVertexBufferView() const requires IsVertex<T>;
@@ -0,0 +1,36 @@
+#include "bundlecache.h"
+
+#include "renderer.h"
+#include "utility.h"
+#include "dx12_api.h"
+
+
+void BundleCache::ReportStats(const wchar_t* name) const
+{
+    wchar_t buffer[500];
+    swprintf_s(buffer, 500, L"%s: replayed %llu and recorded %llu bundles\n", name, m_num_replayed.load(), m_num_recorded.load());
+    OutputDebugString(buffer);
+}
+
+BundleCache::Entry& BundleCache::GetEntry(unsigned int frame_idx, size_t range_begin)
+{
+    // Map nodes stay in place, so the entry can be used after the lock is released
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (frame_idx >= m_entries.size())
+        m_entries.resize(frame_idx + 1);
+    return m_entries[frame_idx][range_begin];
+}
+
+void BundleCache::Reset(Entry& entry)
+{
+    entry.key.clear();
+    if (!entry.bundle) {
+        entry.allocator = directx::CreateCommandAllocator(Renderer::GetDevice(), D3D12_COMMAND_LIST_TYPE_BUNDLE);
+        entry.bundle = std::make_unique<CommandList>(entry.allocator, CommandAllocatorPool::Handle{}, D3D12_COMMAND_LIST_TYPE_BUNDLE, nullptr);
+        return;
+    }
+
+    // The frame which executed the bundle last has completed
+    ThrowIfFailed(entry.allocator->Reset());
+    entry.bundle->SetCommandAllocator(entry.allocator, CommandAllocatorPool::Handle{});
+}
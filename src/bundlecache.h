@@ -0,0 +1,97 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "commandlist.h"
+
+// Bundles of the draw ranges of a pass, kept per frame and keyed by the first draw of the range. A bundle is replayed
+// as long as its range records the same draw parameters it was recorded with, and recorded again otherwise
+// Per frame data which the parameters leave out, e.g. the instance transforms behind an inherited root argument, is
+// picked up by the replay. A bundle is only recorded again by its own frame, once the fence of the frame has completed
+// Ranges of a frame can be executed concurrently by different threads
+class BundleCache {
+public:
+    struct Stats {
+        uint64_t num_recorded; // ranges recorded into their bundle since the last ResetStats()
+        uint64_t num_replayed; // ranges whose bundle was replayed since the last ResetStats()
+    };
+
+private:
+    struct Entry {
+        Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator;
+        std::unique_ptr<CommandList> bundle;
+        std::vector<std::byte> key; // draw parameters the bundle was recorded with
+    };
+
+    // Indexed by frame, grows on demand
+    std::vector<std::map<size_t, Entry>> m_entries;
+    std::mutex m_mutex;
+
+    std::atomic<uint64_t> m_num_recorded;
+    std::atomic<uint64_t> m_num_replayed;
+
+public:
+    BundleCache() : m_num_recorded(0), m_num_replayed(0) {}
+
+    BundleCache(const BundleCache&) = delete;
+    BundleCache& operator=(const BundleCache&) = delete;
+
+    // Execute the bundle of the frame and range on the command list. It is recorded by record(bundle) first when the draws
+    // differ from the ones it was recorded with, which are compared by their bytes
+    template <typename Draw, typename Record>
+    void Execute(unsigned int frame_idx, size_t range_begin, const std::vector<Draw>& draws, CommandList& command_list, Record&& record);
+
+    Stats GetStats() const { return { m_num_recorded, m_num_replayed }; }
+    void ResetStats() { m_num_recorded = 0; m_num_replayed = 0; }
+
+    // Report the recorded and replayed ranges since the last ResetStats() with OutputDebugString
+    void ReportStats(const wchar_t* name) const;
+
+private:
+    Entry& GetEntry(unsigned int frame_idx, size_t range_begin);
+
+    // Reset the bundle of the entry for recording, it is created on first use
+    void Reset(Entry& entry);
+};
+
+template <typename Draw, typename Record>
+void BundleCache::Execute(unsigned int frame_idx, size_t range_begin, const std::vector<Draw>& draws, CommandList& command_list, Record&& record)
+{
+    static_assert(std::has_unique_object_representations_v<Draw>, "BundleCache::Execute(): Draws without padding are compared by their bytes");
+    if (draws.empty())
+        return;
+
+    Entry& entry = GetEntry(frame_idx, range_begin);
+    std::span<const std::byte> key = std::as_bytes(std::span<const Draw>(draws));
+    if (entry.bundle && std::ranges::equal(entry.key, key)) {
+        ++m_num_replayed;
+    }
+    else {
+        // The key is only kept once the bundle has been recorded completely
+        Reset(entry);
+        try {
+            record(*entry.bundle);
+        }
+        catch (...) {
+            entry.bundle->Close();
+            throw;
+        }
+        entry.bundle->Close();
+        entry.key.assign(key.begin(), key.end());
+        ++m_num_recorded;
+    }
+
+    command_list.ExecuteBundle(*entry.bundle);
+}
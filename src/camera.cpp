@@ -1,5 +1,7 @@
 #include "camera.h"
 
+#include <cmath>
+
 
 DirectX::XMMATRIX Camera::GetViewMatrix() const {
     DirectX::XMFLOAT4 target(0.0f, 0.0f, 0.0f, 0.0f);
@@ -8,4 +10,8 @@ DirectX::XMMATRIX Camera::GetViewMatrix() const {
 
 DirectX::XMMATRIX Camera::GetProjectionMatrix() const {
     return DirectX::XMMatrixPerspectiveFovLH(DirectX::XMConvertToRadians(m_fov), m_aspect_ratio, m_near, m_far);
+}
+
+float Camera::GetPixelsPerUnit(float distance) const {
+    return m_viewport_height / (2.0f * std::tan(DirectX::XMConvertToRadians(m_fov) * 0.5f) * distance);
 }
\ No newline at end of file
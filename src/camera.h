@@ -10,6 +10,7 @@ private:
     float m_far;
 
     float m_aspect_ratio;
+    float m_viewport_height;
 
     DirectX::XMFLOAT4 m_position;
     DirectX::XMFLOAT4 m_up;
@@ -24,6 +25,10 @@ public:
     DirectX::XMMATRIX GetViewMatrix() const;
     DirectX::XMMATRIX GetProjectionMatrix() const;
     DirectX::XMFLOAT4 GetPosition() const { return m_position; }
+    float GetNear() const { return m_near; }
+
+    // Number of pixels covered by one world unit at the given view distance
+    float GetPixelsPerUnit(float distance) const;
     
-    void Resize(unsigned int width, unsigned int height) { m_aspect_ratio = width / static_cast<float>(height); }
+    void Resize(unsigned int width, unsigned int height) { m_aspect_ratio = width / static_cast<float>(height); m_viewport_height = static_cast<float>(height); }
 };
@@ -0,0 +1,51 @@
+#include "commandallocatorpool.h"
+
+#include "renderer.h"
+#include "utility.h"
+#include "dx12_api.h"
+
+
+Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CommandAllocatorPool::Acquire(unsigned int frame_idx, unsigned int context_idx, Handle& handle)
+{
+    if (frame_idx >= m_entries.size())
+        m_entries.resize(frame_idx + 1);
+    if (context_idx >= m_entries[frame_idx].size())
+        m_entries[frame_idx].resize(context_idx + 1);
+
+    // Usually a single allocator per context, which the last use of the frame has left completed
+    std::vector<Entry>& entries = m_entries[frame_idx][context_idx];
+    uint64_t completed_value = m_fence->GetCompletedValue();
+    for (size_t entry_idx = 0; entry_idx < entries.size(); ++entry_idx) {
+        Entry& entry = entries[entry_idx];
+        if (entry.in_use || entry.fence_value > completed_value)
+            continue;
+
+        ThrowIfFailed(entry.allocator->Reset());
+        entry.in_use = true;
+        ++m_stats.num_reset;
+        handle = { frame_idx, context_idx, entry_idx };
+        return entry.allocator;
+    }
+
+    Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator = directx::CreateCommandAllocator(Renderer::GetDevice(), m_command_list_type);
+    entries.push_back({ allocator, 0, true });
+    ++m_stats.num_created;
+    ++m_stats.num_allocators;
+    handle = { frame_idx, context_idx, entries.size() - 1 };
+    return allocator;
+}
+
+void CommandAllocatorPool::Release(const Handle& handle, uint64_t fence_value)
+{
+    Entry& entry = m_entries[handle.frame_idx][handle.context_idx][handle.entry_idx];
+    entry.fence_value = fence_value;
+    entry.in_use = false;
+}
+
+void CommandAllocatorPool::ReportStats(const wchar_t* name) const
+{
+    wchar_t buffer[500];
+    swprintf_s(buffer, 500, L"%s: created %llu and reset %llu command allocators, %llu allocators in the pool\n", name,
+        m_stats.num_created, m_stats.num_reset, m_stats.num_allocators);
+    OutputDebugString(buffer);
+}
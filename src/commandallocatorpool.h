@@ -0,0 +1,64 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Command allocators of a command queue, kept per frame and per recording context so a frame reuses the allocators
+// of the frame with the same index, whose fence has completed by then. A recording context is the position of a command
+// list in the submission order of its frame, each list is recorded by one thread. Once every frame has recorded its
+// command lists, Acquire() only resets allocators and never creates one
+// Not synchronized, allocators are acquired and released by CommandQueue when it hands out and executes the command lists,
+// worker threads only record into the command lists they were given
+class CommandAllocatorPool {
+public:
+    struct Stats {
+        uint64_t num_created; // since the last ResetStats()
+        uint64_t num_reset; // since the last ResetStats()
+        uint64_t num_allocators;
+    };
+
+    // Allocator of a command list, returned with Release() once the command list has been executed
+    struct Handle {
+        unsigned int frame_idx;
+        unsigned int context_idx;
+        size_t entry_idx;
+    };
+
+private:
+    struct Entry {
+        Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator;
+        uint64_t fence_value;
+        bool in_use;
+    };
+
+    D3D12_COMMAND_LIST_TYPE m_command_list_type;
+    Microsoft::WRL::ComPtr<ID3D12Fence> m_fence;
+
+    // Indexed by frame and recording context, both grow on demand
+    std::vector<std::vector<std::vector<Entry>>> m_entries;
+
+    Stats m_stats;
+
+public:
+    // The fence is the one signaled by the command queue
+    CommandAllocatorPool(D3D12_COMMAND_LIST_TYPE type, Microsoft::WRL::ComPtr<ID3D12Fence> fence) : m_command_list_type(type), m_fence(fence), m_stats{} {}
+
+    CommandAllocatorPool(const CommandAllocatorPool&) = delete;
+    CommandAllocatorPool& operator=(const CommandAllocatorPool&) = delete;
+
+    // Reset an allocator of the frame and context whose command lists have completed, or create one if there is none
+    Microsoft::WRL::ComPtr<ID3D12CommandAllocator> Acquire(unsigned int frame_idx, unsigned int context_idx, Handle& handle);
+
+    // The allocator can be reset once fence_value has completed
+    void Release(const Handle& handle, uint64_t fence_value);
+
+    const Stats& GetStats() const { return m_stats; }
+    void ResetStats() { m_stats.num_created = 0; m_stats.num_reset = 0; }
+
+    // Report the allocator creations and resets since the last ResetStats() with OutputDebugString
+    void ReportStats(const wchar_t* name) const;
+};
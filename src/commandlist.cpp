@@ -8,32 +8,36 @@
 #include "buffer.h"
 #include "descriptorheap.h"
 #include "rendertarget.h"
+#include "uploadallocator.h"
 
 
-CommandList::CommandList(Microsoft::WRL::ComPtr<ID3D12CommandAllocator> command_allocator, D3D12_COMMAND_LIST_TYPE command_list_type) :
-	m_command_allocator(command_allocator), m_command_list_type(command_list_type)
+CommandList::CommandList(Microsoft::WRL::ComPtr<ID3D12CommandAllocator> command_allocator, const CommandAllocatorPool::Handle& allocator_handle, D3D12_COMMAND_LIST_TYPE command_list_type, UploadAllocator* upload_allocator) :
+	m_command_allocator(command_allocator), m_allocator_handle(allocator_handle), m_command_list_type(command_list_type), m_upload_allocator(upload_allocator), m_barrier_stats{}
 {
 	Microsoft::WRL::ComPtr<ID3D12Device2> device = Renderer::GetDevice();
 	m_command_list = directx::CreateCommandList(device, command_allocator, m_command_list_type);
 }
 
-void CommandList::SetCommandAllocator(Microsoft::WRL::ComPtr<ID3D12CommandAllocator> command_allocator) 
+void CommandList::SetCommandAllocator(Microsoft::WRL::ComPtr<ID3D12CommandAllocator> command_allocator, const CommandAllocatorPool::Handle& allocator_handle) 
 {
 	m_command_allocator = command_allocator;
+	m_allocator_handle = allocator_handle;
 	ThrowIfFailed(m_command_list->Reset(m_command_allocator.Get(), nullptr));
-	// Clearing previously made upload buffers
-	m_upload_buffers.clear();
+	m_upload_blocks.clear();
+	m_pending_barriers.clear();
 }
 
 void CommandList::UploadBufferData(uint64_t upload_size, ID3D12Resource* destination_resource, unsigned int num_subresources, D3D12_SUBRESOURCE_DATA* subresources_data) 
 {
-	// Create upload buffer of appropriate size
-	UploadBuffer upload_buffer;
-	upload_buffer.Create(upload_size);
-	// Store upload buffer for in-flight uploads
-	m_upload_buffers.push_back(upload_buffer);
+	// Textures need their upload data placed at 512 byte alignment
+	D3D12_RESOURCE_DESC destination_desc = destination_resource->GetDesc();
+	uint64_t alignment = (destination_desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER) ? 16 : D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT;
 
-	UpdateSubresources(m_command_list.Get(), destination_resource, upload_buffer.GetResource(), 0, 0, num_subresources, subresources_data);
+	UploadAllocator::Allocation allocation = m_upload_allocator->Allocate(upload_size, alignment);
+	m_upload_blocks.push_back(allocation.block_id);
+
+	FlushBarriers();
+	UpdateSubresources(m_command_list.Get(), destination_resource, allocation.resource, allocation.offset, 0, num_subresources, subresources_data);
 }
 
 void CommandList::SetDescriptorHeaps(std::vector<IDescriptorHeap*> heaps)
@@ -59,8 +63,49 @@ void CommandList::SetRenderTargets(const std::vector<IRenderTarget*>& render_tar
 	m_command_list->OMSetRenderTargets(CastToUint(render_target_views.size()), rtv_handle.ptr ? &rtv_handle : nullptr, FALSE, dsv_handle.ptr ? &dsv_handle : nullptr);
 }
 
-void CommandList::ResourceBarrier(ID3D12Resource* resource, D3D12_RESOURCE_STATES state_before, D3D12_RESOURCE_STATES state_after)
+void CommandList::ResourceBarrier(ID3D12Resource* resource, D3D12_RESOURCE_STATES state_before, D3D12_RESOURCE_STATES state_after, D3D12_RESOURCE_BARRIER_FLAGS flags)
+{
+	++m_barrier_stats.num_requested;
+
+	// No command has used the resource since its pending transition, so the two become one. Barriers are not merged
+	// across an aliasing barrier, which may depend on the state before
+	for (size_t barrier_idx = m_pending_barriers.size(); barrier_idx-- > 0;) {
+		D3D12_RESOURCE_BARRIER& pending = m_pending_barriers[barrier_idx];
+		if (pending.Type != D3D12_RESOURCE_BARRIER_TYPE_TRANSITION)
+			break;
+		if (pending.Transition.pResource != resource)
+			continue;
+
+		// The end of a split transition begun since the last flush, nothing was overlapped with it
+		bool ends_split = pending.Flags == D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY && flags == D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+		if (ends_split && pending.Transition.StateBefore == state_before && pending.Transition.StateAfter == state_after) {
+			pending.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+			return;
+		}
+
+		if (pending.Flags != D3D12_RESOURCE_BARRIER_FLAG_NONE || flags != D3D12_RESOURCE_BARRIER_FLAG_NONE || pending.Transition.StateAfter != state_before)
+			break;
+
+		if (pending.Transition.StateBefore == state_after)
+			m_pending_barriers.erase(m_pending_barriers.begin() + barrier_idx);
+		else
+			pending.Transition.StateAfter = state_after;
+		return;
+	}
+
+	m_pending_barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, state_before, state_after, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, flags));
+}
+
+void CommandList::AliasingBarrier(ID3D12Resource* resource_before, ID3D12Resource* resource_after)
+{
+	++m_barrier_stats.num_requested;
+	m_pending_barriers.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(resource_before, resource_after));
+}
+
+void CommandList::RecordPendingBarriers()
 {
-	CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(resource, state_before, state_after);
-	m_command_list->ResourceBarrier(1, &barrier);
+	m_command_list->ResourceBarrier(CastToUint(m_pending_barriers.size()), m_pending_barriers.data());
+	m_barrier_stats.num_recorded += m_pending_barriers.size();
+	++m_barrier_stats.num_calls;
+	m_pending_barriers.clear();
 }
@@ -6,30 +6,57 @@
 
 #include <vector>
 
+#include "commandallocatorpool.h"
+
 // Forward declarations
-class UploadBuffer;
+class UploadAllocator;
 class IDescriptorHeap;
 class IRenderTarget;
 class IDepthStencilTarget;
 
 class CommandList {
+public:
+	struct BarrierStats {
+		uint64_t num_requested; // transition and aliasing barriers queued on the command list
+		uint64_t num_recorded;  // barriers left after removing the redundant transitions
+		uint64_t num_calls;     // ResourceBarrier calls which recorded them
+	};
+
 private:
 	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> m_command_list;
 	D3D12_COMMAND_LIST_TYPE m_command_list_type;
 
 	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> m_command_allocator;
+	// Returned to the allocator pool of the command queue when the command list is executed
+	CommandAllocatorPool::Handle m_allocator_handle;
+
+	// Upload memory of the command queue, blocks of the recorded upload commands are submitted with the command list
+	UploadAllocator* m_upload_allocator;
+	std::vector<uint64_t> m_upload_blocks;
+
+	// Barriers are queued and recorded with a single call before the next command which depends on them
+	std::vector<D3D12_RESOURCE_BARRIER> m_pending_barriers;
+	BarrierStats m_barrier_stats;
 
-	// Store uploadbuffers for recorded upload commands
-	std::vector<UploadBuffer> m_upload_buffers;
+	void RecordPendingBarriers();
 public:
-	CommandList(Microsoft::WRL::ComPtr<ID3D12CommandAllocator> command_allocator, D3D12_COMMAND_LIST_TYPE command_list_type);
+	CommandList(Microsoft::WRL::ComPtr<ID3D12CommandAllocator> command_allocator, const CommandAllocatorPool::Handle& allocator_handle, D3D12_COMMAND_LIST_TYPE command_list_type, UploadAllocator* upload_allocator);
+
+	// A recording context, moved between the command queue and the code recording it
+	CommandList(const CommandList&) = delete;
+	CommandList& operator=(const CommandList&) = delete;
+	CommandList(CommandList&&) = default;
+	CommandList& operator=(CommandList&&) = default;
 
 	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> GetD12CommandList() const { return m_command_list; }
 	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> GetD12CommandAllocator() const { return m_command_allocator; }
-	void SetCommandAllocator(Microsoft::WRL::ComPtr<ID3D12CommandAllocator> command_allocator);
+	const CommandAllocatorPool::Handle& GetAllocatorHandle() const { return m_allocator_handle; }
+	void SetCommandAllocator(Microsoft::WRL::ComPtr<ID3D12CommandAllocator> command_allocator, const CommandAllocatorPool::Handle& allocator_handle);
 
-	// Use Uploadbuffer to copy data to GPU and keep buffer in-flight during execution of commandlist
+	// Copy data to GPU via the upload allocator, the memory stays in-flight during execution of commandlist
 	void UploadBufferData(uint64_t upload_size, ID3D12Resource* destination_resource, unsigned int num_subresources, D3D12_SUBRESOURCE_DATA* subresources_data);
+	const std::vector<uint64_t>& GetUploadBlocks() const { return m_upload_blocks; }
+	void ClearUploadBlocks() { m_upload_blocks.clear(); }
 
 	// Pipeline state
 	void SetPipelineState(ID3D12PipelineState* pipeline_state) { m_command_list->SetPipelineState(pipeline_state); }
@@ -43,6 +70,8 @@ public:
 	void SetGraphicsRootSignature(ID3D12RootSignature* root_signature) { m_command_list->SetGraphicsRootSignature(root_signature); }
 	void SetGraphicsRootDescriptorTable(unsigned int param_idx, const D3D12_GPU_DESCRIPTOR_HANDLE& descriptor) { m_command_list->SetGraphicsRootDescriptorTable(param_idx, descriptor); }
 	void SetGraphicsRoot32BitConstants(unsigned int root_param_idx, unsigned int num_values, const void* data,  unsigned int num_offset_values) { m_command_list->SetGraphicsRoot32BitConstants(root_param_idx, num_values, data, num_offset_values); }
+	void SetGraphicsRootShaderResourceView(unsigned int root_param_idx, D3D12_GPU_VIRTUAL_ADDRESS buffer_location) { m_command_list->SetGraphicsRootShaderResourceView(root_param_idx, buffer_location); }
+	void SetGraphicsRootConstantBufferView(unsigned int root_param_idx, D3D12_GPU_VIRTUAL_ADDRESS buffer_location) { m_command_list->SetGraphicsRootConstantBufferView(root_param_idx, buffer_location); }
 	void SetDescriptorHeaps(std::vector<IDescriptorHeap*> heaps);
 
 	// Viewport and scissorRect
@@ -51,12 +80,25 @@ public:
 
 	// Render target
 	void SetRenderTargets(const std::vector<IRenderTarget*>& render_target_views, IDepthStencilTarget* depth_stencil_view);
-	void ClearRenderTargetView(const D3D12_CPU_DESCRIPTOR_HANDLE& rtv, const float clear_color[4]) { m_command_list->ClearRenderTargetView(rtv, clear_color, 0, nullptr); }
-	void ClearDepthStencilView(const D3D12_CPU_DESCRIPTOR_HANDLE& dsv, float depth) { m_command_list->ClearDepthStencilView(dsv, D3D12_CLEAR_FLAG_DEPTH, depth, 0, 0, nullptr); }
-
-	void DrawIndexedInstanced(unsigned int num_indices, unsigned int num_instances) { m_command_list->DrawIndexedInstanced(num_indices, num_instances, 0, 0, 0); }
-
-	void ResourceBarrier(ID3D12Resource* resource, D3D12_RESOURCE_STATES state_before, D3D12_RESOURCE_STATES state_after);
-
-	void Close() { m_command_list->Close(); }
+	void ClearRenderTargetView(const D3D12_CPU_DESCRIPTOR_HANDLE& rtv, const float clear_color[4]) { FlushBarriers(); m_command_list->ClearRenderTargetView(rtv, clear_color, 0, nullptr); }
+	void ClearDepthStencilView(const D3D12_CPU_DESCRIPTOR_HANDLE& dsv, float depth) { FlushBarriers(); m_command_list->ClearDepthStencilView(dsv, D3D12_CLEAR_FLAG_DEPTH, depth, 0, 0, nullptr); }
+
+	void DrawIndexedInstanced(unsigned int num_indices, unsigned int num_instances, unsigned int start_index = 0, int base_vertex = 0) { FlushBarriers(); m_command_list->DrawIndexedInstanced(num_indices, num_instances, start_index, base_vertex, 0); }
+	// The bundle inherits the root arguments and descriptor heaps of this command list
+	void ExecuteBundle(const CommandList& bundle) { FlushBarriers(); m_command_list->ExecuteBundle(bundle.m_command_list.Get()); }
+	// Draw the commands of the argument buffer in the layout of the command signature
+	void ExecuteIndirect(ID3D12CommandSignature* command_signature, unsigned int num_commands, ID3D12Resource* argument_buffer, uint64_t argument_buffer_offset) { FlushBarriers(); m_command_list->ExecuteIndirect(command_signature, num_commands, argument_buffer, argument_buffer_offset, nullptr, 0); }
+
+	// Queue the transition, a transition onwards from the pending one of the resource is merged into it and one back cancels it
+	// The BEGIN_ONLY and END_ONLY flags split the transition around the commands in between
+	void ResourceBarrier(ID3D12Resource* resource, D3D12_RESOURCE_STATES state_before, D3D12_RESOURCE_STATES state_after, D3D12_RESOURCE_BARRIER_FLAGS flags = D3D12_RESOURCE_BARRIER_FLAG_NONE);
+	// Placed resources sharing memory, resource_after becomes the active one; nullptr before means any resource in the memory
+	void AliasingBarrier(ID3D12Resource* resource_before, ID3D12Resource* resource_after);
+
+	// Record the queued barriers, done by the commands above; needed before recording on GetD12CommandList() directly
+	void FlushBarriers() { if (!m_pending_barriers.empty()) RecordPendingBarriers(); }
+	const BarrierStats& GetBarrierStats() const { return m_barrier_stats; }
+	void ResetBarrierStats() { m_barrier_stats = {}; }
+
+	void Close() { FlushBarriers(); m_command_list->Close(); }
 };
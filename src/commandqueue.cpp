@@ -5,7 +5,7 @@
 #include "dx12_api.h"
 
 CommandQueue::CommandQueue(D3D12_COMMAND_LIST_TYPE type) :
-	m_fence_value(0), m_command_list_type(type)
+	m_fence_value(0), m_command_list_type(type), m_barrier_stats{}
 {
 	Microsoft::WRL::ComPtr<ID3D12Device2> device = Renderer::GetDevice();
 	m_command_queue = directx::CreateCommandQueue(device, type);
@@ -13,50 +13,65 @@ CommandQueue::CommandQueue(D3D12_COMMAND_LIST_TYPE type) :
 	m_fence = directx::CreateFence(device);
 	m_fence_event = directx::CreateEventHandle();
 
+	m_allocator_pool = std::make_unique<CommandAllocatorPool>(type, m_fence);
+	m_upload_allocator = std::make_unique<UploadAllocator>(m_fence);
+	m_release_queue = std::make_unique<DeferredReleaseQueue>(m_fence);
 }
 
-CommandList CommandQueue::GetCommandList()
+CommandList CommandQueue::GetCommandList(unsigned int frame_idx, unsigned int context_idx)
 {
-	Microsoft::WRL::ComPtr<ID3D12Device2> device = Renderer::GetDevice();
-	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> command_allocator;
-
-	if (!m_command_allocator_queue.empty() && IsFenceComplete(m_command_allocator_queue.front().fence_value))
-	{
-		command_allocator = m_command_allocator_queue.front().command_allocator;
-		m_command_allocator_queue.pop();
+	// Release what the completed command lists were the last to use
+	m_release_queue->Collect();
 
-		ThrowIfFailed(command_allocator->Reset());
-	}
-	else
-	{
-		command_allocator = directx::CreateCommandAllocator(device, m_command_list_type);
-	}
+	CommandAllocatorPool::Handle allocator_handle;
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> command_allocator = m_allocator_pool->Acquire(frame_idx, context_idx, allocator_handle);
 
+	// A command list can be reset as soon as it has been executed
 	if (!m_command_list_queue.empty())
 	{
-		CommandList command_list = m_command_list_queue.front();
+		CommandList command_list = std::move(m_command_list_queue.front());
 		m_command_list_queue.pop();
 
-		command_list.SetCommandAllocator(command_allocator);
+		command_list.SetCommandAllocator(command_allocator, allocator_handle);
 		return command_list;
 	}
 
-	return CommandList(command_allocator, m_command_list_type);
+	return CommandList(command_allocator, allocator_handle, m_command_list_type, m_upload_allocator.get());
 }
 
-uint64_t CommandQueue::ExecuteCommandList(CommandList& command_list)
+uint64_t CommandQueue::ExecuteCommandList(CommandList&& command_list)
 {
-	command_list.Close();
+	return ExecuteCommandLists(std::span<CommandList>(&command_list, 1));
+}
 
-	ID3D12CommandList* const command_lists[] = {
-		command_list.GetD12CommandList().Get()
-	};
+uint64_t CommandQueue::ExecuteCommandLists(std::span<CommandList> command_lists)
+{
+	std::vector<ID3D12CommandList*> d3d12_command_lists;
+	d3d12_command_lists.reserve(command_lists.size());
+	for (CommandList& command_list : command_lists)
+	{
+		command_list.Close();
+		d3d12_command_lists.push_back(command_list.GetD12CommandList().Get());
+	}
 
-	m_command_queue->ExecuteCommandLists(1, command_lists);
+	m_command_queue->ExecuteCommandLists(static_cast<UINT>(d3d12_command_lists.size()), d3d12_command_lists.data());
 	uint64_t fence_value = Signal();
 
-	m_command_allocator_queue.emplace(CommandAllocatorEntry{ fence_value, command_list.GetD12CommandAllocator().Get() });
-	m_command_list_queue.push(command_list);
+	for (CommandList& command_list : command_lists)
+	{
+		// The upload memory of the command list is in use until the fence value is reached
+		m_upload_allocator->Submit(command_list.GetUploadBlocks(), fence_value);
+		command_list.ClearUploadBlocks();
+
+		const CommandList::BarrierStats& barrier_stats = command_list.GetBarrierStats();
+		m_barrier_stats.num_requested += barrier_stats.num_requested;
+		m_barrier_stats.num_recorded += barrier_stats.num_recorded;
+		m_barrier_stats.num_calls += barrier_stats.num_calls;
+		command_list.ResetBarrierStats();
+
+		m_allocator_pool->Release(command_list.GetAllocatorHandle(), fence_value);
+		m_command_list_queue.push(std::move(command_list));
+	}
 
 	return fence_value;
 }
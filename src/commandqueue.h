@@ -5,20 +5,18 @@
 #include <wrl.h>
 
 #include <queue>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
 #include "commandlist.h"
+#include "commandallocatorpool.h"
+#include "uploadallocator.h"
+#include "deferredreleasequeue.h"
 
 
 class CommandQueue {
 private:
-	// Keep track of command allocators that are "in-flight"
-	struct CommandAllocatorEntry
-	{
-		uint64_t fence_value;
-		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> command_allocator;
-	};
-
-	using CommandAllocatorQueue = std::queue<CommandAllocatorEntry>;
-
 	Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_command_queue;
 	D3D12_COMMAND_LIST_TYPE m_command_list_type;
 
@@ -27,14 +25,29 @@ private:
 	uint64_t m_fence_value = 0;
 	HANDLE m_fence_event;
 
-	CommandAllocatorQueue m_command_allocator_queue;
+	// Allocators of the command lists, and the executed command lists which are reset with a new allocator
+	std::unique_ptr<CommandAllocatorPool> m_allocator_pool;
 	std::queue<CommandList> m_command_list_queue;
 
+	// Upload memory for the command lists of this queue, released with the fence of the queue
+	std::unique_ptr<UploadAllocator> m_upload_allocator;
+
+	// Objects replaced while the command lists of this queue may still use them
+	std::unique_ptr<DeferredReleaseQueue> m_release_queue;
+
+	// Barriers of the command lists executed since the last ResetBarrierStats()
+	CommandList::BarrierStats m_barrier_stats;
+
 public:
 	CommandQueue(D3D12_COMMAND_LIST_TYPE type);
 
-	CommandList GetCommandList();
-	uint64_t ExecuteCommandList(CommandList& command_list);
+	// The allocator comes from the pool of the frame and recording context, queues without frames use the defaults
+	CommandList GetCommandList(unsigned int frame_idx = 0, unsigned int context_idx = 0);
+
+	// The command lists are moved back into the queue and cannot be used afterwards
+	uint64_t ExecuteCommandList(CommandList&& command_list);
+	// Execute the command lists in order with a single submission and signal once after the last one
+	uint64_t ExecuteCommandLists(std::span<CommandList> command_lists);
 	
 	uint64_t Signal();
 	void Signal(uint64_t fence_value);
@@ -46,5 +59,16 @@ public:
 
 	void Flush();
 
+	UploadAllocator* GetUploadAllocator() { return m_upload_allocator.get(); }
+	CommandAllocatorPool* GetAllocatorPool() { return m_allocator_pool.get(); }
+
+	const CommandList::BarrierStats& GetBarrierStats() const { return m_barrier_stats; }
+	void ResetBarrierStats() { m_barrier_stats = {}; }
+
+	// Keep the object alive until the command lists executed so far and the one being recorded have completed
+	template <typename T>
+	void ReleaseDeferred(T&& object) { m_release_queue->Release(std::forward<T>(object), m_fence_value + 1); }
+	DeferredReleaseQueue* GetReleaseQueue() { return m_release_queue.get(); }
+
 	Microsoft::WRL::ComPtr<ID3D12CommandQueue> GetD12CommandQueue() const { return m_command_queue; }
 };
@@ -0,0 +1,140 @@
+#include "compactvertex.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+VertexQuantization VertexCompressor::ComputeQuantization(std::span<const Vertex> vertices)
+{
+    VertexQuantization quantization{ DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), 1.0f };
+    if (vertices.empty())
+        return quantization;
+
+    DirectX::XMVECTOR min_pos = DirectX::XMLoadFloat3(&vertices[0].position);
+    DirectX::XMVECTOR max_pos = min_pos;
+    for (const Vertex& vertex : vertices) {
+        min_pos = DirectX::XMVectorMin(min_pos, DirectX::XMLoadFloat3(&vertex.position));
+        max_pos = DirectX::XMVectorMax(max_pos, DirectX::XMLoadFloat3(&vertex.position));
+    }
+
+    DirectX::XMFLOAT3 extent;
+    DirectX::XMStoreFloat3(&quantization.offset, min_pos);
+    DirectX::XMStoreFloat3(&extent, DirectX::XMVectorSubtract(max_pos, min_pos));
+    quantization.scale = std::max(extent.x, std::max(extent.y, extent.z));
+    if (quantization.scale <= 0.0f)
+        quantization.scale = 1.0f;
+    return quantization;
+}
+
+CompactVertex VertexCompressor::Encode(const Vertex& vertex, const VertexQuantization& quantization)
+{
+    CompactVertex compact{};
+
+    const float position[3] = { vertex.position.x, vertex.position.y, vertex.position.z };
+    const float offset[3] = { quantization.offset.x, quantization.offset.y, quantization.offset.z };
+    for (int i = 0; i < 3; ++i) {
+        float unorm = std::clamp((position[i] - offset[i]) / quantization.scale, 0.0f, 1.0f);
+        compact.position[i] = static_cast<uint16_t>(std::lround(unorm * 65535.0f));
+    }
+    compact.position[3] = 0;
+
+    compact.texture_coord[0] = DirectX::PackedVector::XMConvertFloatToHalf(vertex.texture_coord.x);
+    compact.texture_coord[1] = DirectX::PackedVector::XMConvertFloatToHalf(vertex.texture_coord.y);
+
+    EncodeOctahedral(vertex.normal, compact.normal);
+    return compact;
+}
+
+Vertex VertexCompressor::Decode(const CompactVertex& vertex, const VertexQuantization& quantization)
+{
+    // Same math as the input assembler format conversion and the vertex shader decode
+    Vertex decoded;
+    decoded.position = DirectX::XMFLOAT3(
+        quantization.offset.x + vertex.position[0] / 65535.0f * quantization.scale,
+        quantization.offset.y + vertex.position[1] / 65535.0f * quantization.scale,
+        quantization.offset.z + vertex.position[2] / 65535.0f * quantization.scale);
+    decoded.texture_coord = DirectX::XMFLOAT2(
+        DirectX::PackedVector::XMConvertHalfToFloat(vertex.texture_coord[0]),
+        DirectX::PackedVector::XMConvertHalfToFloat(vertex.texture_coord[1]));
+    decoded.normal = DecodeOctahedral(vertex.normal);
+    return decoded;
+}
+
+std::vector<CompactVertex> VertexCompressor::Encode(std::span<const Vertex> vertices, const VertexQuantization& quantization)
+{
+    std::vector<CompactVertex> compact_vertices(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i)
+        compact_vertices[i] = Encode(vertices[i], quantization);
+    return compact_vertices;
+}
+
+DirectX::XMMATRIX VertexCompressor::GetDequantizeMatrix(const VertexQuantization& quantization)
+{
+    return DirectX::XMMatrixMultiply(DirectX::XMMatrixScaling(quantization.scale, quantization.scale, quantization.scale),
+        DirectX::XMMatrixTranslation(quantization.offset.x, quantization.offset.y, quantization.offset.z));
+}
+
+VertexCompressor::Error VertexCompressor::MeasureError(std::span<const Vertex> vertices, std::span<const CompactVertex> compact_vertices, const VertexQuantization& quantization)
+{
+    Error error{};
+    for (size_t i = 0; i < vertices.size() && i < compact_vertices.size(); ++i) {
+        Vertex decoded = Decode(compact_vertices[i], quantization);
+
+        DirectX::XMVECTOR position = DirectX::XMLoadFloat3(&vertices[i].position);
+        DirectX::XMVECTOR decoded_position = DirectX::XMLoadFloat3(&decoded.position);
+        error.position = std::max(error.position, DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(position, decoded_position))));
+
+        // Missing normals (zero length) can not be represented and are skipped
+        DirectX::XMVECTOR normal = DirectX::XMLoadFloat3(&vertices[i].normal);
+        if (DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(normal)) > 0.0f) {
+            // acos of the dot product can not resolve angles below ~5e-4 radians in single precision
+            normal = DirectX::XMVector3Normalize(normal);
+            DirectX::XMVECTOR decoded_normal = DirectX::XMLoadFloat3(&decoded.normal);
+            float angle = std::atan2(DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVector3Cross(normal, decoded_normal))),
+                DirectX::XMVectorGetX(DirectX::XMVector3Dot(normal, decoded_normal)));
+            error.normal = std::max(error.normal, angle);
+        }
+
+        error.texture_coord = std::max(error.texture_coord, std::abs(vertices[i].texture_coord.x - decoded.texture_coord.x));
+        error.texture_coord = std::max(error.texture_coord, std::abs(vertices[i].texture_coord.y - decoded.texture_coord.y));
+    }
+    return error;
+}
+
+void VertexCompressor::EncodeOctahedral(const DirectX::XMFLOAT3& normal, int16_t encoded[2])
+{
+    // Project onto the octahedron |x| + |y| + |z| = 1 and fold the lower hemisphere over the diagonals
+    float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (length == 0.0f) {
+        encoded[0] = 0;
+        encoded[1] = 0;
+        return;
+    }
+
+    float x = normal.x / length;
+    float y = normal.y / length;
+    if (normal.z < 0.0f) {
+        float folded_x = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float folded_y = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = folded_x;
+        y = folded_y;
+    }
+
+    encoded[0] = static_cast<int16_t>(std::lround(std::clamp(x, -1.0f, 1.0f) * 32767.0f));
+    encoded[1] = static_cast<int16_t>(std::lround(std::clamp(y, -1.0f, 1.0f) * 32767.0f));
+}
+
+DirectX::XMFLOAT3 VertexCompressor::DecodeOctahedral(const int16_t encoded[2])
+{
+    // Matches DecodeOctahedral in compactvertex.hlsli
+    float x = std::max(encoded[0] / 32767.0f, -1.0f);
+    float y = std::max(encoded[1] / 32767.0f, -1.0f);
+    float z = 1.0f - std::abs(x) - std::abs(y);
+    float t = std::clamp(-z, 0.0f, 1.0f);
+    x += x >= 0.0f ? -t : t;
+    y += y >= 0.0f ? -t : t;
+
+    DirectX::XMFLOAT3 normal;
+    DirectX::XMStoreFloat3(&normal, DirectX::XMVector3Normalize(DirectX::XMVectorSet(x, y, z, 0.0f)));
+    return normal;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "vertex.h"
+
+// 16 byte compressed Vertex, input layout:
+// POSITION      R16G16B16A16_UNORM position quantized to the mesh bounds (w unused)
+// TEXTURE_COORD R16G16_FLOAT
+// NORMAL        R16G16_SNORM octahedral encoded unit normal
+struct CompactVertex
+{
+    uint16_t position[4];
+    DirectX::PackedVector::HALF texture_coord[2];
+    int16_t normal[2];
+};
+
+// Position dequantization of a mesh, object space position = offset + unorm position * scale
+// A uniform scale keeps the normal transform of the model matrix valid when it is folded into it
+struct VertexQuantization
+{
+    DirectX::XMFLOAT3 offset;
+    float scale;
+};
+
+class VertexCompressor {
+public:
+    // Largest CPU decode error of a set of vertices
+    struct Error {
+        float position; // object space distance
+        float normal; // angle in radians
+        float texture_coord; // absolute difference
+    };
+
+    static VertexQuantization ComputeQuantization(std::span<const Vertex> vertices);
+
+    static CompactVertex Encode(const Vertex& vertex, const VertexQuantization& quantization);
+    static Vertex Decode(const CompactVertex& vertex, const VertexQuantization& quantization);
+    static std::vector<CompactVertex> Encode(std::span<const Vertex> vertices, const VertexQuantization& quantization);
+
+    // Matrix that maps the unorm positions to object space, multiply with the model matrix
+    static DirectX::XMMATRIX GetDequantizeMatrix(const VertexQuantization& quantization);
+
+    static Error MeasureError(std::span<const Vertex> vertices, std::span<const CompactVertex> compact_vertices, const VertexQuantization& quantization);
+
+    // Error bound of the position quantization, half a quantization step along each axis
+    static float GetPositionErrorBound(const VertexQuantization& quantization) { return 0.5f * quantization.scale / 65535.0f * 1.7320508f; }
+
+private:
+    static void EncodeOctahedral(const DirectX::XMFLOAT3& normal, int16_t encoded[2]);
+    static DirectX::XMFLOAT3 DecodeOctahedral(const int16_t encoded[2]);
+};
@@ -0,0 +1,65 @@
+#include "deferredreleasequeue.h"
+
+#include <algorithm>
+
+#include "utility.h"
+
+
+void DeferredReleaseQueue::Release(GpuResource&& resource, uint64_t fence_value)
+{
+    Push({ fence_value, std::move(resource), nullptr, nullptr, std::chrono::high_resolution_clock::now() });
+}
+
+void DeferredReleaseQueue::Release(Microsoft::WRL::ComPtr<IUnknown> object, uint64_t fence_value)
+{
+    Push({ fence_value, GpuResource(), std::move(object), nullptr, std::chrono::high_resolution_clock::now() });
+}
+
+void DeferredReleaseQueue::Release(std::function<void()> callback, uint64_t fence_value)
+{
+    Push({ fence_value, GpuResource(), nullptr, std::move(callback), std::chrono::high_resolution_clock::now() });
+}
+
+void DeferredReleaseQueue::Collect()
+{
+    if (m_entries.empty())
+        return;
+
+    uint64_t completed_value = m_fence->GetCompletedValue();
+    auto now = std::chrono::high_resolution_clock::now();
+
+    // Fence values are added in increasing order by the command queue, a callback never runs before the entries added before it
+    size_t num_released = 0;
+    for (; num_released < m_entries.size() && m_entries[num_released].fence_value <= completed_value; ++num_released) {
+        Entry& entry = m_entries[num_released];
+        entry.resource.Destroy();
+        entry.object.Reset();
+        if (entry.callback)
+            entry.callback();
+
+        std::chrono::duration<double> latency = now - entry.release_time;
+        m_stats.total_latency += latency.count();
+        m_stats.max_latency = std::max(m_stats.max_latency, latency.count());
+    }
+
+    m_entries.erase(m_entries.begin(), m_entries.begin() + num_released);
+    m_stats.num_released += num_released;
+    m_stats.num_pending = m_entries.size();
+}
+
+void DeferredReleaseQueue::ReportStats(const wchar_t* name) const
+{
+    double average_latency = m_stats.num_released ? m_stats.total_latency / m_stats.num_released : 0.0;
+
+    wchar_t buffer[500];
+    swprintf_s(buffer, 500, L"%s: released %llu entries with an average latency of %f ms (max %f ms), %llu pending (peak %llu)\n", name,
+        m_stats.num_released, average_latency * 1e3, m_stats.max_latency * 1e3, m_stats.num_pending, m_stats.peak_pending);
+    OutputDebugString(buffer);
+}
+
+void DeferredReleaseQueue::Push(Entry&& entry)
+{
+    m_entries.push_back(std::move(entry));
+    m_stats.num_pending = m_entries.size();
+    m_stats.peak_pending = std::max(m_stats.peak_pending, m_stats.num_pending);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "buffer.h"
+
+// Keeps resources, heaps and other objects alive until the fence value of the last command list which may use them
+// has completed, so they can be replaced without waiting for the GPU. Collect() releases the completed entries in the
+// order they were added, callbacks can be queued to run after the entries before them, e.g. to reuse their memory
+// Not synchronized, it is filled by CommandQueue::ReleaseDeferred() and collected by CommandQueue::GetCommandList(), both on the
+// thread which submits to the queue
+class DeferredReleaseQueue {
+public:
+    struct Stats {
+        uint64_t num_pending; // entries waiting for their fence value
+        uint64_t peak_pending; // since the last ResetStats()
+        uint64_t num_released; // since the last ResetStats()
+        double total_latency; // seconds from Release() to the release of the entries, since the last ResetStats()
+        double max_latency;
+    };
+
+private:
+    struct Entry {
+        uint64_t fence_value;
+        GpuResource resource;
+        Microsoft::WRL::ComPtr<IUnknown> object;
+        std::function<void()> callback;
+        std::chrono::high_resolution_clock::time_point release_time;
+    };
+
+    Microsoft::WRL::ComPtr<ID3D12Fence> m_fence;
+    std::vector<Entry> m_entries;
+
+    Stats m_stats;
+
+public:
+    // The fence is the one signaled by the command queue
+    DeferredReleaseQueue(Microsoft::WRL::ComPtr<ID3D12Fence> fence) : m_fence(fence), m_stats{} {}
+
+    DeferredReleaseQueue(const DeferredReleaseQueue&) = delete;
+    DeferredReleaseQueue& operator=(const DeferredReleaseQueue&) = delete;
+
+    // The entries are released once fence_value has completed
+    void Release(GpuResource&& resource, uint64_t fence_value);
+    void Release(Microsoft::WRL::ComPtr<IUnknown> object, uint64_t fence_value);
+    void Release(std::function<void()> callback, uint64_t fence_value);
+
+    // Release the entries whose fence value has completed, stops at the first one which has not to keep the order
+    void Collect();
+
+    const Stats& GetStats() const { return m_stats; }
+    void ResetStats() { m_stats = { m_stats.num_pending, m_stats.num_pending, 0, 0.0, 0.0 }; }
+
+    // Report the queue depth and the reclaim latency since the last ResetStats() with OutputDebugString
+    void ReportStats(const wchar_t* name) const;
+
+private:
+    void Push(Entry&& entry);
+};
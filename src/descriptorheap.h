@@ -46,6 +46,7 @@ public:
     }
 
     ID3D12DescriptorHeap* GetDescriptorHeap() { return m_descriptor_heap.Get(); }
+    unsigned int GetDescriptorSize() const { return m_descriptor_size; }
 
     bool IsShaderVisible() const { return m_shader_visible; }
     D3D12_DESCRIPTOR_HEAP_TYPE GetHeapType() const { return m_heap_type; }
@@ -179,6 +179,8 @@ namespace directx
         swap_chain_desc.AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED;
         // It is recommended to always allow tearing if tearing support is available.
         swap_chain_desc.Flags = CheckTearingSupport() ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0;
+        // The renderer waits on the frame latency object before it starts a frame
+        swap_chain_desc.Flags |= DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
 
         Microsoft::WRL::ComPtr<IDXGISwapChain1> swap_chain1;
         ThrowIfFailed(dxgi_factory4->CreateSwapChainForHwnd(
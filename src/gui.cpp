@@ -43,7 +43,7 @@ void GUI::Bind(FrameDescriptorHeap* descriptor_heap, DXGI_FORMAT render_target_f
 		ImGui_ImplDX12_Shutdown(); // gave bool initialize
 
 	// Setup Renderer backends
-	ImGui_ImplDX12_Init(Renderer::GetDevice().Get(), Renderer::s_num_frames, render_target_format,
+	ImGui_ImplDX12_Init(Renderer::GetDevice().Get(), Renderer::GetNumFrames(), render_target_format,
 		descriptor_heap->GetDescriptorHeap(),
 		// You'll need to designate a descriptor from your descriptor heap for Dear ImGui to use internally for its font texture's SRV
 		descriptor_heap->GetImguiCpuHandle(bind_idx),
@@ -79,6 +79,7 @@ void GUI::Render(CommandList& command_list)
 	// Rendering
 	// (Your code clears your framebuffer, renders your other stuff etc.)
 	ImGui::Render();
+	command_list.FlushBarriers();
 	ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), command_list.GetD12CommandList().Get());
 	// (Your code calls ExecuteCommandLists, swapchain's Present(), etc.)
 }
@@ -0,0 +1,153 @@
+#include "heapallocator.h"
+
+#include <d3dx12.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "utility.h"
+#include "renderer.h"
+
+
+HeapAllocation::~HeapAllocation()
+{
+    m_allocator->Free(m_category, m_block_idx, m_offset);
+}
+
+Microsoft::WRL::ComPtr<ID3D12Resource> HeapAllocator::CreateResource(const D3D12_RESOURCE_DESC& resource_desc, D3D12_RESOURCE_STATES initial_state,
+    const D3D12_CLEAR_VALUE* clear_value, std::shared_ptr<HeapAllocation>& allocation)
+{
+    Microsoft::WRL::ComPtr<ID3D12Device2> device = Renderer::GetDevice();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto create_start = std::chrono::high_resolution_clock::now();
+    Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+    allocation.reset();
+
+    // Small textures can use 4KB alignment instead of 64KB, the device tells if the texture qualifies
+    HeapCategory category = GetHeapCategory(resource_desc);
+    D3D12_RESOURCE_DESC placed_desc = resource_desc;
+    D3D12_RESOURCE_ALLOCATION_INFO allocation_info{};
+    if (category == HEAP_CATEGORY_TEXTURE && resource_desc.SampleDesc.Count <= 1) {
+        placed_desc.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+        allocation_info = device->GetResourceAllocationInfo(0, 1, &placed_desc);
+    }
+    if (allocation_info.Alignment != D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT) {
+        placed_desc.Alignment = 0;
+        allocation_info = device->GetResourceAllocationInfo(0, 1, &placed_desc);
+    }
+
+    if (!m_use_placed_resources || allocation_info.SizeInBytes > s_block_size) {
+        auto heap_props = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+        ThrowIfFailed(device->CreateCommittedResource(&heap_props, D3D12_HEAP_FLAG_NONE, &resource_desc, initial_state, clear_value, IID_PPV_ARGS(&resource)));
+        ++m_stats.num_committed;
+    }
+    else {
+        // First block with enough free space, a new block is added if none has
+        std::vector<std::unique_ptr<Block>>& blocks = m_blocks[category];
+        size_t block_idx = 0;
+        uint64_t offset = BuddyAllocator::s_invalid_offset;
+        for (; block_idx < blocks.size(); ++block_idx) {
+            if (!blocks[block_idx]->heap)
+                continue;
+            offset = blocks[block_idx]->allocator.Allocate(allocation_info.SizeInBytes, allocation_info.Alignment);
+            if (offset != BuddyAllocator::s_invalid_offset)
+                break;
+        }
+
+        if (offset == BuddyAllocator::s_invalid_offset) {
+            static const D3D12_HEAP_FLAGS s_heap_flags[HEAP_CATEGORY_COUNT] = {
+                D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS, D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES, D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES
+            };
+            // Render targets can be multisampled which requires 4MB alignment
+            uint64_t heap_alignment = (category == HEAP_CATEGORY_RENDER_TARGET) ? D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+            CD3DX12_HEAP_DESC heap_desc(s_block_size, D3D12_HEAP_TYPE_DEFAULT, heap_alignment, s_heap_flags[category]);
+
+            // The allocations refer to their block by index, so a released block is recreated in its slot
+            block_idx = static_cast<size_t>(std::find_if(blocks.begin(), blocks.end(), [](const std::unique_ptr<Block>& block) { return !block->heap; }) - blocks.begin());
+            if (block_idx == blocks.size())
+                blocks.push_back(std::unique_ptr<Block>(new Block{ nullptr, BuddyAllocator(s_block_size, D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT) }));
+
+            ThrowIfFailed(device->CreateHeap(&heap_desc, IID_PPV_ARGS(&blocks[block_idx]->heap)));
+            blocks[block_idx]->heap->SetName(L"Resource Heap Block");
+            ++m_stats.num_heaps;
+            m_stats.heap_bytes += s_block_size;
+
+            offset = blocks[block_idx]->allocator.Allocate(allocation_info.SizeInBytes, allocation_info.Alignment);
+        }
+
+        ThrowIfFailed(device->CreatePlacedResource(blocks[block_idx]->heap.Get(), offset, &placed_desc, initial_state, clear_value, IID_PPV_ARGS(&resource)));
+        allocation = std::make_shared<HeapAllocation>(this, category, block_idx, offset);
+        ++m_stats.num_resources;
+        m_stats.allocated_bytes += allocation_info.SizeInBytes;
+    }
+
+    ++m_stats.num_created;
+    std::chrono::duration<double> create_time = std::chrono::high_resolution_clock::now() - create_start;
+    m_stats.creation_time += create_time.count();
+    return resource;
+}
+
+void HeapAllocator::Free(unsigned int category, size_t block_idx, uint64_t offset)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    BuddyAllocator& allocator = m_blocks[category][block_idx]->allocator;
+    uint64_t allocated_bytes = allocator.GetStats().allocated_bytes;
+    allocator.Free(offset);
+
+    --m_stats.num_resources;
+    m_stats.allocated_bytes -= allocated_bytes - allocator.GetStats().allocated_bytes;
+}
+
+void HeapAllocator::ReleaseEmptyBlocks()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& blocks : m_blocks) {
+        for (auto& block : blocks) {
+            if (block->heap && block->allocator.IsEmpty()) {
+                block->heap.Reset();
+                --m_stats.num_heaps;
+                m_stats.heap_bytes -= s_block_size;
+            }
+        }
+    }
+}
+
+float HeapAllocator::GetFragmentation() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    float fragmentation = 0.0f;
+    size_t num_blocks = 0;
+    for (const auto& blocks : m_blocks) {
+        for (const auto& block : blocks) {
+            if (!block->heap)
+                continue;
+            fragmentation += block->allocator.GetFragmentation();
+            ++num_blocks;
+        }
+    }
+    return num_blocks ? fragmentation / num_blocks : 0.0f;
+}
+
+void HeapAllocator::ReportStats(const wchar_t* name) const
+{
+    Stats stats;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        stats = m_stats;
+    }
+
+    wchar_t buffer[500];
+    swprintf_s(buffer, 500, L"%s: created %llu resources in %f ms, %llu placed in %llu heaps (%llu of %llu bytes, fragmentation %f), %llu committed\n", name,
+        stats.num_created, stats.creation_time * 1e3, stats.num_resources, stats.num_heaps, stats.allocated_bytes, stats.heap_bytes,
+        GetFragmentation(), stats.num_committed);
+    OutputDebugString(buffer);
+}
+
+HeapAllocator::HeapCategory HeapAllocator::GetHeapCategory(const D3D12_RESOURCE_DESC& resource_desc)
+{
+    if (resource_desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+        return HEAP_CATEGORY_BUFFER;
+    if (resource_desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+        return HEAP_CATEGORY_RENDER_TARGET;
+    return HEAP_CATEGORY_TEXTURE;
+}
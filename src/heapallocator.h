@@ -0,0 +1,97 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "buddyallocator.h"
+
+// Forward declaration
+class HeapAllocator;
+
+// Placed resource memory, returned to the heap when the last GpuResource referring to it is destroyed
+class HeapAllocation {
+private:
+    HeapAllocator* m_allocator;
+    unsigned int m_category;
+    size_t m_block_idx;
+    uint64_t m_offset;
+
+public:
+    HeapAllocation(HeapAllocator* allocator, unsigned int category, size_t block_idx, uint64_t offset) :
+        m_allocator(allocator), m_category(category), m_block_idx(block_idx), m_offset(offset) {}
+    ~HeapAllocation();
+
+    HeapAllocation(const HeapAllocation&) = delete;
+    HeapAllocation& operator=(const HeapAllocation&) = delete;
+};
+
+// Creates the default heap resources as placed resources in large ID3D12Heap blocks suballocated with a BuddyAllocator
+// Resource heap tier 1 does not allow buffers, textures and render targets in the same heap, so each has its own blocks
+class HeapAllocator {
+public:
+    enum HeapCategory : unsigned int {
+        HEAP_CATEGORY_BUFFER = 0,
+        HEAP_CATEGORY_TEXTURE,
+        HEAP_CATEGORY_RENDER_TARGET,
+        HEAP_CATEGORY_COUNT
+    };
+
+    struct Stats {
+        uint64_t num_resources; // placed resources alive
+        uint64_t num_created; // resources created since the last ResetStats()
+        uint64_t num_heaps; // ID3D12Heap blocks
+        uint64_t num_committed; // resources with an implicit heap, too large for a block or created while placed resources are disabled
+        uint64_t heap_bytes; // size of the blocks
+        uint64_t allocated_bytes; // placed resource sizes
+        double creation_time; // seconds spent creating resources since the last ResetStats()
+    };
+
+    static constexpr uint64_t s_block_size = 64 * 1024 * 1024;
+
+private:
+    struct Block {
+        Microsoft::WRL::ComPtr<ID3D12Heap> heap; // nullptr once released
+        BuddyAllocator allocator;
+    };
+
+    std::vector<std::unique_ptr<Block>> m_blocks[HEAP_CATEGORY_COUNT];
+    bool m_use_placed_resources;
+    Stats m_stats;
+
+    // Resources are created and freed by the asset loader threads as well
+    mutable std::mutex m_mutex;
+
+public:
+    HeapAllocator() : m_use_placed_resources(true), m_stats{} {}
+
+    // Create a resource in the default heap, allocation is empty for committed resources
+    Microsoft::WRL::ComPtr<ID3D12Resource> CreateResource(const D3D12_RESOURCE_DESC& resource_desc, D3D12_RESOURCE_STATES initial_state,
+        const D3D12_CLEAR_VALUE* clear_value, std::shared_ptr<HeapAllocation>& allocation);
+
+    // Release the heaps of blocks without resources, e.g. after their resources have been moved to other memory
+    // The slots of released blocks are reused by new blocks
+    void ReleaseEmptyBlocks();
+
+    // Committed resources can be used instead to compare the allocation counts and creation time
+    void SetUsePlacedResources(bool use_placed_resources) { m_use_placed_resources = use_placed_resources; }
+
+    const Stats& GetStats() const { return m_stats; }
+    void ResetStats() { std::lock_guard<std::mutex> lock(m_mutex); m_stats.num_created = 0; m_stats.creation_time = 0.0; }
+
+    // Average fragmentation of the blocks, see BuddyAllocator::GetFragmentation()
+    float GetFragmentation() const;
+
+    // Report the stats with OutputDebugString
+    void ReportStats(const wchar_t* name) const;
+
+private:
+    friend class HeapAllocation;
+    void Free(unsigned int category, size_t block_idx, uint64_t offset);
+
+    static HeapCategory GetHeapCategory(const D3D12_RESOURCE_DESC& resource_desc);
+};
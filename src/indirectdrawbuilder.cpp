@@ -0,0 +1,71 @@
+#include "indirectdrawbuilder.h"
+
+#include <cstring>
+#include <iterator>
+
+// The arguments of a command signature are packed in order, so the members have to follow each other without padding
+static_assert(offsetof(IndirectDrawBuilder::Command, vertex_buffer_view) == sizeof(uint32_t) * IndirectDrawBuilder::s_num_root_constants);
+static_assert(offsetof(IndirectDrawBuilder::Command, index_buffer_view) == offsetof(IndirectDrawBuilder::Command, vertex_buffer_view) + sizeof(D3D12_VERTEX_BUFFER_VIEW));
+static_assert(offsetof(IndirectDrawBuilder::Command, arguments) == offsetof(IndirectDrawBuilder::Command, index_buffer_view) + sizeof(D3D12_INDEX_BUFFER_VIEW));
+static_assert(sizeof(IndirectDrawBuilder::Command) % sizeof(uint32_t) == 0);
+
+void IndirectDrawBuilder::Add(unsigned int pipeline_idx, const Draw& draw, std::span<const MeshOptimizer::IndexRange> index_ranges)
+{
+    std::vector<Command>& commands = m_commands[pipeline_idx];
+    ForEachDrawCall(index_ranges, draw.index_count, draw.start_index, draw.num_instances, [&](const D3D12_DRAW_INDEXED_ARGUMENTS& arguments) {
+        Command command{ {}, draw.vertex_buffer_view, draw.index_buffer_view, arguments };
+        std::copy(std::begin(draw.root_constants), std::end(draw.root_constants), command.root_constants);
+        commands.push_back(command);
+    });
+}
+
+void IndirectDrawBuilder::Append(const IndirectDrawBuilder& other)
+{
+    if (other.m_commands.size() > m_commands.size())
+        m_commands.resize(other.m_commands.size());
+
+    for (size_t pipeline_idx = 0; pipeline_idx < other.m_commands.size(); ++pipeline_idx)
+        m_commands[pipeline_idx].insert(m_commands[pipeline_idx].end(), other.m_commands[pipeline_idx].begin(), other.m_commands[pipeline_idx].end());
+}
+
+void IndirectDrawBuilder::Clear()
+{
+    for (std::vector<Command>& commands : m_commands)
+        commands.clear();
+}
+
+size_t IndirectDrawBuilder::GetNumCommands() const
+{
+    size_t num_commands = 0;
+    for (const std::vector<Command>& commands : m_commands)
+        num_commands += commands.size();
+    return num_commands;
+}
+
+std::vector<IndirectDrawBuilder::Group> IndirectDrawBuilder::Write(uint8_t* buffer) const
+{
+    std::vector<Group> groups;
+    uint64_t offset = 0;
+    for (size_t pipeline_idx = 0; pipeline_idx < m_commands.size(); ++pipeline_idx) {
+        const std::vector<Command>& commands = m_commands[pipeline_idx];
+        if (commands.empty())
+            continue;
+
+        memcpy(buffer + offset, commands.data(), commands.size() * sizeof(Command));
+        groups.push_back({ static_cast<unsigned int>(pipeline_idx), offset, static_cast<uint32_t>(commands.size()) });
+        offset += commands.size() * sizeof(Command);
+    }
+    return groups;
+}
+
+std::vector<D3D12_INDIRECT_ARGUMENT_DESC> IndirectDrawBuilder::GetArgumentDescs(unsigned int constants_param_idx)
+{
+    std::vector<D3D12_INDIRECT_ARGUMENT_DESC> argument_descs(4);
+    argument_descs[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+    argument_descs[0].Constant = { constants_param_idx, 0, s_num_root_constants };
+    argument_descs[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_VERTEX_BUFFER_VIEW;
+    argument_descs[1].VertexBuffer.Slot = 0;
+    argument_descs[2].Type = D3D12_INDIRECT_ARGUMENT_TYPE_INDEX_BUFFER_VIEW;
+    argument_descs[3].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+    return argument_descs;
+}
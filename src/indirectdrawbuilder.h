@@ -0,0 +1,96 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "meshoptimizer.h"
+
+// Argument buffer of indirect draws built on the CPU, one command per draw call with the root arguments and buffers it sets
+// The commands are grouped by pipeline state, which an ExecuteIndirect cannot change
+// Only depends on the D3D12 headers and the index ranges of a mesh, so the commands can be compared with the draw calls of the direct path
+class IndirectDrawBuilder {
+public:
+    static constexpr unsigned int s_num_root_constants = 2;
+
+    // Layout of a command in the argument buffer, in the order of GetArgumentDescs()
+    struct Command {
+        uint32_t root_constants[s_num_root_constants]; // instance offset, which also selects the material, and texture index
+        D3D12_VERTEX_BUFFER_VIEW vertex_buffer_view;
+        D3D12_INDEX_BUFFER_VIEW index_buffer_view;
+        D3D12_DRAW_INDEXED_ARGUMENTS arguments;
+    };
+
+    // Draw of a range of the index buffer as the direct path records it, with the root constants and buffers of the command
+    struct Draw {
+        uint32_t root_constants[s_num_root_constants];
+        D3D12_VERTEX_BUFFER_VIEW vertex_buffer_view;
+        D3D12_INDEX_BUFFER_VIEW index_buffer_view;
+        uint32_t index_count;
+        uint32_t start_index;
+        uint32_t num_instances;
+    };
+
+    // Commands of one pipeline state, executed with one ExecuteIndirect
+    struct Group {
+        unsigned int pipeline_idx;
+        uint64_t offset; // in bytes from the start of the argument buffer
+        uint32_t num_commands;
+    };
+
+private:
+    // Indexed by pipeline state
+    std::vector<std::vector<Command>> m_commands;
+
+public:
+    IndirectDrawBuilder(unsigned int num_pipeline_states) : m_commands(num_pipeline_states) {}
+
+    void Add(unsigned int pipeline_idx, const Command& command) { m_commands[pipeline_idx].push_back(command); }
+
+    // Add a command per draw call of the draw, split at the index ranges of its mesh like IMesh::DrawIndexed()
+    void Add(unsigned int pipeline_idx, const Draw& draw, std::span<const MeshOptimizer::IndexRange> index_ranges);
+
+    // Add the commands of the other builder after the ones with the same pipeline state
+    void Append(const IndirectDrawBuilder& other);
+    void Clear();
+
+    size_t GetNumCommands() const;
+    uint64_t GetBufferSize() const { return GetNumCommands() * sizeof(Command); }
+
+    // Write the commands to the argument buffer of GetBufferSize() bytes, returns the non-empty groups in pipeline state order
+    std::vector<Group> Write(uint8_t* buffer) const;
+
+    // Arguments of the command signature with a stride of sizeof(Command): the root constants at their root parameter,
+    // the vertex and index buffer views and the draw
+    static std::vector<D3D12_INDIRECT_ARGUMENT_DESC> GetArgumentDescs(unsigned int constants_param_idx);
+
+    // Call function(arguments) for the part of the index buffer range in each index range, drawn with the base vertex of the range
+    // Without index ranges the range is drawn as a whole. The direct and the indirect path both split their draws with it
+    template <typename Function>
+    static void ForEachDrawCall(std::span<const MeshOptimizer::IndexRange> index_ranges, uint32_t index_count, uint32_t start_index,
+        uint32_t num_instances, Function&& function);
+};
+
+template <typename Function>
+void IndirectDrawBuilder::ForEachDrawCall(std::span<const MeshOptimizer::IndexRange> index_ranges, uint32_t index_count, uint32_t start_index,
+    uint32_t num_instances, Function&& function)
+{
+    if (index_ranges.empty()) {
+        function(D3D12_DRAW_INDEXED_ARGUMENTS{ index_count, num_instances, start_index, 0, 0 });
+        return;
+    }
+
+    // First range that contains start_index
+    auto range = std::upper_bound(index_ranges.begin(), index_ranges.end(), start_index,
+        [](uint32_t index, const MeshOptimizer::IndexRange& range) { return index < range.index_offset; }) - 1;
+    uint32_t end_index = start_index + index_count;
+    for (; range != index_ranges.end() && range->index_offset < end_index; ++range) {
+        uint32_t draw_start = std::max(start_index, range->index_offset);
+        uint32_t draw_end = std::min(end_index, range->index_offset + range->index_count);
+        function(D3D12_DRAW_INDEXED_ARGUMENTS{ draw_end - draw_start, num_instances, draw_start, static_cast<int>(range->base_vertex), 0 });
+    }
+}
@@ -0,0 +1,264 @@
+#include "jobsystem.h"
+
+#include <chrono>
+#include <cmath>
+
+unsigned int JobSystem::s_num_threads = 0;
+std::function<void()> JobSystem::s_thread_start;
+std::function<void()> JobSystem::s_thread_exit;
+std::unique_ptr<JobSystem> JobSystem::s_instance;
+std::once_flag JobSystem::s_instance_flag;
+
+namespace {
+    // Job system whose worker thread is the calling thread, threads outside of a pool use deque 0 of every job system
+    thread_local const JobSystem* t_job_system = nullptr;
+    thread_local unsigned int t_worker_idx = 0;
+    thread_local JobSystem::JobPriority t_priority = JobSystem::JOB_PRIORITY_HIGH;
+}
+
+JobSystem::JobSystem(unsigned int num_threads) :
+    m_num_queued(0), m_num_sleeping(0), m_stop(false)
+{
+    num_threads = std::max(1u, num_threads);
+    for (unsigned int i = 0; i < num_threads; ++i)
+        m_workers.push_back(std::make_unique<Worker>());
+
+    for (unsigned int i = 1; i < num_threads; ++i)
+        m_threads.emplace_back(&JobSystem::RunWorker, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    // Jobs which have been started but not waited for still run, the workers finish the jobs those start before they sleep
+    while (m_num_queued > 0) {
+        if (!TryRunJob(JOB_PRIORITY_LOW))
+            std::this_thread::yield();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (std::thread& thread : m_threads)
+        thread.join();
+}
+
+JobSystem* JobSystem::Get()
+{
+    std::call_once(s_instance_flag, []() { s_instance = std::make_unique<JobSystem>(GetNumThreads()); });
+    return s_instance.get();
+}
+
+unsigned int JobSystem::GetNumThreads()
+{
+    if (s_num_threads > 0)
+        return s_num_threads;
+
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+JobSystem::JobPriority JobSystem::GetCurrentPriority()
+{
+    return t_priority;
+}
+
+void JobSystem::Run(std::function<void()> function, Counter* counter, Counter* dependency, JobPriority priority)
+{
+    if (counter)
+        ++counter->m_value;
+
+    Job job{ std::move(function), counter, priority };
+    if (dependency) {
+        // Started by the last job of the dependency otherwise
+        std::lock_guard<std::mutex> lock(dependency->m_mutex);
+        if (dependency->m_value != 0) {
+            dependency->m_dependent_jobs.push_back(std::move(job));
+            return;
+        }
+    }
+    Push(std::move(job));
+}
+
+void JobSystem::Wait(Counter& counter, JobPriority help_priority)
+{
+    while (counter.m_value != 0) {
+        if (!TryRunJob(help_priority))
+            std::this_thread::yield();
+    }
+
+    // The last job releases the mutex after the value reached 0, the counter may be destroyed after this
+    std::lock_guard<std::mutex> lock(counter.m_mutex);
+    if (counter.m_error) {
+        std::exception_ptr error = counter.m_error;
+        counter.m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+JobSystem::Stats JobSystem::GetStats() const
+{
+    Stats stats{};
+    for (const std::unique_ptr<Worker>& worker : m_workers) {
+        stats.num_jobs += worker->num_jobs;
+        stats.num_stolen += worker->num_stolen;
+    }
+    return stats;
+}
+
+std::vector<JobSystem::BenchmarkResult> JobSystem::RunBenchmark(unsigned int max_threads)
+{
+    constexpr size_t num_jobs = 100000;
+    constexpr size_t num_elements = 1 << 22;
+    constexpr size_t grain_size = 1 << 12;
+
+    std::vector<float> data(num_elements);
+    std::vector<BenchmarkResult> results;
+    for (unsigned int num_threads = 1; num_threads <= max_threads; ++num_threads) {
+        JobSystem job_system(num_threads);
+        BenchmarkResult result{ num_threads, 0.0, 0.0 };
+
+        // Scheduling overhead of jobs which do nothing
+        std::atomic<size_t> num_done(0);
+        Counter counter;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < num_jobs; ++i)
+            job_system.Run([&num_done]() { num_done.fetch_add(1, std::memory_order_relaxed); }, &counter);
+        job_system.Wait(counter);
+        std::chrono::duration<double> jobs_time = std::chrono::high_resolution_clock::now() - start;
+        result.jobs_per_second = num_jobs / std::max(jobs_time.count(), 1e-9);
+
+        // Memory and arithmetic bound loop split in small chunks
+        start = std::chrono::high_resolution_clock::now();
+        job_system.ParallelFor(0, num_elements, grain_size, [&data](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i)
+                data[i] = std::sqrt(static_cast<float>(i)) * std::sin(static_cast<float>(i));
+        });
+        std::chrono::duration<double> parallel_for_time = std::chrono::high_resolution_clock::now() - start;
+        result.parallel_for_time = parallel_for_time.count();
+
+        results.push_back(result);
+    }
+    return results;
+}
+
+void JobSystem::RunWorker(unsigned int worker_idx)
+{
+    t_job_system = this;
+    t_worker_idx = worker_idx;
+    if (s_thread_start)
+        s_thread_start();
+
+    while (true) {
+        if (TryRunJob(JOB_PRIORITY_LOW))
+            continue;
+
+        // The queued count is incremented before the sleeping count is read by Push(), one of them sees the other
+        std::unique_lock<std::mutex> lock(m_sleep_mutex);
+        ++m_num_sleeping;
+        m_wake.wait(lock, [this]() { return m_stop || m_num_queued > 0; });
+        --m_num_sleeping;
+        if (m_stop)
+            break;
+    }
+
+    if (s_thread_exit)
+        s_thread_exit();
+}
+
+bool JobSystem::TryRunJob(JobPriority max_priority)
+{
+    unsigned int worker_idx = GetWorkerIndex();
+    unsigned int num_workers = GetNumWorkers();
+
+    for (unsigned int priority = 0; priority <= max_priority; ++priority) {
+        // Newest own job first, it is most likely still in the cache
+        {
+            Worker& worker = *m_workers[worker_idx];
+            std::unique_lock<std::mutex> lock(worker.mutex);
+            std::deque<Job>& jobs = worker.jobs[priority];
+            if (!jobs.empty()) {
+                Job job = std::move(jobs.back());
+                jobs.pop_back();
+                lock.unlock();
+                Execute(job, false);
+                return true;
+            }
+        }
+
+        // Oldest job of the other threads, which is the largest when jobs split their work
+        for (unsigned int i = 1; i < num_workers; ++i) {
+            Worker& victim = *m_workers[(worker_idx + i) % num_workers];
+            std::unique_lock<std::mutex> lock(victim.mutex);
+            std::deque<Job>& jobs = victim.jobs[priority];
+            if (!jobs.empty()) {
+                Job job = std::move(jobs.front());
+                jobs.pop_front();
+                lock.unlock();
+                Execute(job, true);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void JobSystem::Push(Job&& job)
+{
+    {
+        Worker& worker = *m_workers[GetWorkerIndex()];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.jobs[job.priority].push_back(std::move(job));
+    }
+
+    ++m_num_queued;
+    if (m_num_sleeping > 0) {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        m_wake.notify_one();
+    }
+}
+
+void JobSystem::Execute(Job& job, bool stolen)
+{
+    --m_num_queued;
+    Worker& worker = *m_workers[GetWorkerIndex()];
+    worker.num_jobs.fetch_add(1, std::memory_order_relaxed);
+    if (stolen)
+        worker.num_stolen.fetch_add(1, std::memory_order_relaxed);
+
+    JobPriority previous_priority = t_priority;
+    t_priority = job.priority;
+    std::exception_ptr error;
+    try {
+        job.function();
+    }
+    catch (...) {
+        error = std::current_exception();
+    }
+    t_priority = previous_priority;
+
+    if (job.counter)
+        Finish(*job.counter, error);
+}
+
+void JobSystem::Finish(Counter& counter, std::exception_ptr error)
+{
+    // The value changes under the mutex, so the dependent jobs are either added before it reaches 0 or started directly
+    std::vector<Job> dependent_jobs;
+    {
+        std::lock_guard<std::mutex> lock(counter.m_mutex);
+        if (error && !counter.m_error)
+            counter.m_error = error;
+        if (--counter.m_value == 0)
+            dependent_jobs.swap(counter.m_dependent_jobs);
+    }
+
+    for (Job& job : dependent_jobs)
+        Push(std::move(job));
+}
+
+unsigned int JobSystem::GetWorkerIndex() const
+{
+    return t_job_system == this ? t_worker_idx : 0;
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs jobs on a fixed set of worker threads. Each thread owns a deque, it takes its own jobs from the back and steals
+// the oldest jobs of the other threads from the front when it runs out. Threads outside of the pool share one deque
+// A thread waiting for a counter runs jobs in the meantime, so jobs can wait for the jobs they start
+// Only depends on the standard library
+class JobSystem {
+public:
+    // Waiting threads only help with jobs of their own priority or higher, so the main thread waiting for the jobs of
+    // a frame never runs a background job which takes longer than the frame
+    enum JobPriority : unsigned int {
+        JOB_PRIORITY_HIGH = 0,
+        JOB_PRIORITY_LOW,
+        JOB_PRIORITY_COUNT
+    };
+
+private:
+    struct Job;
+
+public:
+    // Number of unfinished jobs, jobs which depend on the counter are started once it reaches 0
+    // The first exception of the jobs is rethrown by Wait()
+    class Counter {
+    private:
+        friend class JobSystem;
+
+        std::atomic<size_t> m_value;
+        std::mutex m_mutex;
+        std::vector<Job> m_dependent_jobs;
+        std::exception_ptr m_error;
+
+    public:
+        Counter() : m_value(0) {}
+
+        Counter(const Counter&) = delete;
+        Counter& operator=(const Counter&) = delete;
+
+        bool IsDone() const { return m_value == 0; }
+    };
+
+    struct Stats {
+        uint64_t num_jobs;
+        uint64_t num_stolen; // jobs run by another thread than the one which started them
+    };
+
+    struct BenchmarkResult {
+        unsigned int num_threads;
+        double jobs_per_second; // empty jobs started from one thread
+        double parallel_for_time; // seconds for a fine grained parallel for
+    };
+
+private:
+    struct Job {
+        std::function<void()> function;
+        Counter* counter;
+        JobPriority priority;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::array<std::deque<Job>, JOB_PRIORITY_COUNT> jobs;
+        std::atomic<uint64_t> num_jobs{ 0 };
+        std::atomic<uint64_t> num_stolen{ 0 };
+    };
+
+    // Deque 0 is shared by the threads outside of the pool, the worker threads own the others
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread> m_threads;
+
+    // Idle workers sleep until a job is queued
+    std::atomic<size_t> m_num_queued;
+    std::atomic<size_t> m_num_sleeping;
+    std::mutex m_sleep_mutex;
+    std::condition_variable m_wake;
+    bool m_stop;
+
+    // Worker threads of the singleton including the calling thread, 0 uses every hardware thread
+    static unsigned int s_num_threads;
+
+    // Called on each worker thread when it starts and exits, e.g. to initialize COM
+    static std::function<void()> s_thread_start;
+    static std::function<void()> s_thread_exit;
+
+    static std::unique_ptr<JobSystem> s_instance;
+    static std::once_flag s_instance_flag;
+
+public:
+    // Starts num_threads - 1 worker threads, the threads waiting for jobs make up for the last one
+    JobSystem(unsigned int num_threads);
+    // Runs the queued jobs before the worker threads exit, jobs waiting for a dependency which never finishes are dropped
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Shared by the engine, created on first use with GetNumThreads() threads
+    static JobSystem* Get();
+
+    // To be called before the first Get()
+    static void SetNumThreads(unsigned int num_threads) { s_num_threads = num_threads; }
+    static unsigned int GetNumThreads();
+    static void SetThreadCallbacks(std::function<void()> start, std::function<void()> exit) { s_thread_start = start; s_thread_exit = exit; }
+
+    unsigned int GetNumWorkers() const { return static_cast<unsigned int>(m_workers.size()); }
+
+    // Priority of the job running on the calling thread, high outside of jobs
+    static JobPriority GetCurrentPriority();
+
+    // Start the job, counter is incremented until it has finished. The job waits for the dependency to reach 0
+    void Run(std::function<void()> function, Counter* counter, Counter* dependency = nullptr, JobPriority priority = GetCurrentPriority());
+
+    // Run jobs until the counter reaches 0, rethrows the first exception of its jobs
+    void Wait(Counter& counter) { Wait(counter, GetCurrentPriority()); }
+    void Wait(Counter& counter, JobPriority help_priority);
+
+    // Call function(chunk_begin, chunk_end) for chunks of grain_size of the range, the calling thread takes the first one
+    template <typename Function>
+    void ParallelFor(size_t begin, size_t end, size_t grain_size, Function&& function, JobPriority priority = GetCurrentPriority());
+
+    Stats GetStats() const;
+
+    // Job throughput and parallel for time with 1 to max_threads threads, each with its own job system
+    static std::vector<BenchmarkResult> RunBenchmark(unsigned int max_threads);
+
+private:
+    void RunWorker(unsigned int worker_idx);
+
+    // Take a job of at most the priority, own jobs first
+    bool TryRunJob(JobPriority max_priority);
+    void Push(Job&& job);
+    void Execute(Job& job, bool stolen);
+    void Finish(Counter& counter, std::exception_ptr error);
+
+    // Index of the deque of the calling thread
+    unsigned int GetWorkerIndex() const;
+};
+
+template <typename Function>
+void JobSystem::ParallelFor(size_t begin, size_t end, size_t grain_size, Function&& function, JobPriority priority)
+{
+    if (begin >= end)
+        return;
+
+    grain_size = std::max<size_t>(grain_size, 1);
+    size_t num_chunks = (end - begin + grain_size - 1) / grain_size;
+    if (num_chunks == 1) {
+        function(begin, end);
+        return;
+    }
+
+    Counter counter;
+    for (size_t chunk = 1; chunk < num_chunks; ++chunk) {
+        size_t chunk_begin = begin + chunk * grain_size;
+        size_t chunk_end = std::min(end, chunk_begin + grain_size);
+        Run([&function, chunk_begin, chunk_end]() { function(chunk_begin, chunk_end); }, &counter, nullptr, priority);
+    }
+
+    // The other chunks reference the function, they have to finish before an exception leaves
+    JobPriority help_priority = std::max(GetCurrentPriority(), priority);
+    try {
+        function(begin, begin + grain_size);
+    }
+    catch (...) {
+        try {
+            Wait(counter, help_priority);
+        }
+        catch (...) {
+        }
+        throw;
+    }
+    Wait(counter, help_priority);
+}
@@ -0,0 +1,85 @@
+#include "linearallocator.h"
+
+#include <d3dx12.h>
+
+#include <algorithm>
+
+#include "utility.h"
+
+
+LinearAllocator::LinearAllocator(unsigned int num_frames, uint64_t frame_capacity) :
+    m_buffer_WO(nullptr), m_frame_capacity(AlignUp(frame_capacity, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT)), m_frames(num_frames),
+    m_frame_idx(0), m_stats{}, m_reported_frame_bytes(0)
+{
+    m_buffer.Create(m_frame_capacity * num_frames);
+    m_buffer.GetResource()->SetName(L"Linear Allocator Buffer");
+
+    CD3DX12_RANGE read_range(0, 0);    // We do not intend to read from this resource on the CPU.
+    m_buffer.Map(0, &read_range, reinterpret_cast<void**>(&m_buffer_WO));
+}
+
+void LinearAllocator::BeginFrame(unsigned int frame_idx)
+{
+    // Report the previous frame when its usage changed or it did not fit
+    bool overflowed = !m_frames[m_frame_idx].overflow_buffers.empty();
+    if (m_stats.frame_bytes != m_reported_frame_bytes || overflowed) {
+        ReportStats(L"LinearAllocator::BeginFrame()");
+        m_reported_frame_bytes = m_stats.frame_bytes;
+    }
+
+    // The GPU is done with the frame, so its region and overflow buffers can be reused
+    m_frame_idx = frame_idx;
+    m_frames[m_frame_idx].offset = 0;
+    m_frames[m_frame_idx].overflow_buffers.clear();
+    m_stats.frame_bytes = 0;
+    m_stats.num_frame_allocations = 0;
+}
+
+LinearAllocator::Allocation LinearAllocator::Allocate(uint64_t size, uint64_t alignment)
+{
+    Frame& frame = m_frames[m_frame_idx];
+    ++m_stats.num_frame_allocations;
+
+    uint64_t offset = AlignUp(frame.offset, alignment);
+    if (frame.overflow_buffers.empty() && offset + size <= m_frame_capacity) {
+        m_stats.frame_bytes += offset + size - frame.offset;
+        m_stats.peak_frame_bytes = std::max(m_stats.peak_frame_bytes, m_stats.frame_bytes);
+        frame.offset = offset + size;
+
+        uint64_t buffer_offset = m_frame_idx * m_frame_capacity + offset;
+        return { m_buffer.GetResource()->GetGPUVirtualAddress() + buffer_offset, m_buffer_WO + buffer_offset, m_buffer.GetResource(), buffer_offset };
+    }
+
+    // Continue in the last overflow buffer of the frame, or add one as large as the frame region
+    if (frame.overflow_buffers.empty() || AlignUp(frame.overflow_buffers.back().offset, alignment) + size > frame.overflow_buffers.back().size) {
+        OverflowBuffer overflow{ UploadBuffer(), nullptr, std::max(m_frame_capacity, AlignUp(size, alignment)), 0 };
+        overflow.buffer.Create(overflow.size);
+        overflow.buffer.GetResource()->SetName(L"Linear Allocator Overflow Buffer");
+
+        CD3DX12_RANGE read_range(0, 0);    // We do not intend to read from this resource on the CPU.
+        overflow.buffer.Map(0, &read_range, reinterpret_cast<void**>(&overflow.buffer_WO));
+        frame.overflow_buffers.push_back(std::move(overflow));
+        ++m_stats.num_overflows;
+
+        wchar_t buffer[500];
+        swprintf_s(buffer, 500, L"LinearAllocator::Allocate(): frame region of %llu bytes is full, added overflow buffer %zu of %llu bytes\n",
+            m_frame_capacity, frame.overflow_buffers.size(), frame.overflow_buffers.back().size);
+        OutputDebugString(buffer);
+    }
+
+    OverflowBuffer& overflow = frame.overflow_buffers.back();
+    offset = AlignUp(overflow.offset, alignment);
+    m_stats.frame_bytes += offset + size - overflow.offset;
+    m_stats.peak_frame_bytes = std::max(m_stats.peak_frame_bytes, m_stats.frame_bytes);
+    overflow.offset = offset + size;
+    return { overflow.buffer.GetResource()->GetGPUVirtualAddress() + offset, overflow.buffer_WO + offset, overflow.buffer.GetResource(), offset };
+}
+
+void LinearAllocator::ReportStats(const wchar_t* name) const
+{
+    const Frame& frame = m_frames[m_frame_idx];
+    wchar_t buffer[500];
+    swprintf_s(buffer, 500, L"%s: frame used %llu of %llu bytes in %llu allocations with %zu overflow buffers, peak %llu bytes, %llu overflows in total\n", name,
+        m_stats.frame_bytes, m_frame_capacity, m_stats.num_frame_allocations, frame.overflow_buffers.size(), m_stats.peak_frame_bytes, m_stats.num_overflows);
+    OutputDebugString(buffer);
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "buffer.h"
+
+// Per frame linear allocator for dynamic constant data in one persistently mapped upload buffer
+// Every frame owns a fixed region which is reset by BeginFrame(), the caller needs to have waited for the fence of that frame
+// Allocations which do not fit go to overflow buffers released when the frame is reused
+class LinearAllocator {
+public:
+    struct Allocation {
+        D3D12_GPU_VIRTUAL_ADDRESS gpu_address;
+        uint8_t* cpu_address; // write only
+        // For commands which take the buffer and an offset instead of the address
+        ID3D12Resource* resource;
+        uint64_t offset;
+    };
+
+    struct Stats {
+        uint64_t frame_bytes; // bytes allocated in the current frame including alignment padding
+        uint64_t num_frame_allocations;
+        uint64_t peak_frame_bytes;
+        uint64_t num_overflows; // overflow buffers created since the start
+    };
+
+    static constexpr uint64_t s_default_frame_capacity = 4 * 1024 * 1024;
+
+private:
+    struct OverflowBuffer {
+        UploadBuffer buffer;
+        uint8_t* buffer_WO; //WRITE ONLY POINTER
+        uint64_t size;
+        uint64_t offset;
+    };
+
+    struct Frame {
+        uint64_t offset; // in the region of the frame
+        std::vector<OverflowBuffer> overflow_buffers;
+    };
+
+    UploadBuffer m_buffer;
+    uint8_t* m_buffer_WO; //WRITE ONLY POINTER
+    uint64_t m_frame_capacity;
+
+    std::vector<Frame> m_frames;
+    unsigned int m_frame_idx;
+
+    Stats m_stats;
+    uint64_t m_reported_frame_bytes;
+
+public:
+    LinearAllocator(unsigned int num_frames, uint64_t frame_capacity = s_default_frame_capacity);
+
+    LinearAllocator(const LinearAllocator&) = delete;
+    LinearAllocator& operator=(const LinearAllocator&) = delete;
+
+    // Start allocating from the region of the frame, the usage of the previous frame is reported when it changed
+    void BeginFrame(unsigned int frame_idx);
+
+    // Alignment defaults to what root and descriptor constant buffer views require
+    Allocation Allocate(uint64_t size, uint64_t alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+
+    // Copy the data to a new allocation and return its GPU address
+    template <typename T>
+    D3D12_GPU_VIRTUAL_ADDRESS Push(const T& data, uint64_t alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT)
+    {
+        Allocation allocation = Allocate(sizeof(T), alignment);
+        memcpy(allocation.cpu_address, &data, sizeof(T));
+        return allocation.gpu_address;
+    }
+
+    const Stats& GetStats() const { return m_stats; }
+
+    // Report the stats of the current frame with OutputDebugString
+    void ReportStats(const wchar_t* name) const;
+
+private:
+    static uint64_t AlignUp(uint64_t value, uint64_t alignment) { return (value + alignment - 1) & ~(alignment - 1); }
+};
@@ -1,14 +1,28 @@
 #include <Windows.h>
 #include <shellapi.h> // For CommandLineToArgvW
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
 #include "application.h"
 #include "utility.h"
+#include "objparser.h"
+#include "renderer.h"
+#include "heapallocator.h"
+#include "assetloader.h"
+#include "residencymanager.h"
+#include "jobsystem.h"
 
 // Use WARP adapter
 bool g_UseWarp = false;
 //
 uint32_t g_ClientWidth = 1280;
 uint32_t g_ClientHeight = 720;
+// OBJ file to run the ObjParser thread scaling benchmark on before startup
+std::wstring g_ObjBenchmarkFile;
+// Run the JobSystem throughput benchmark before startup
+bool g_JobBenchmark = false;
 
 
 void ParseCommandLineArguments()
@@ -30,6 +44,68 @@ void ParseCommandLineArguments()
         {
             g_UseWarp = true;
         }
+        if (::wcscmp(argv[i], L"--obj-threads") == 0)
+        {
+            ObjParser::SetNumThreads(::wcstol(argv[++i], nullptr, 10));
+        }
+        if (::wcscmp(argv[i], L"--obj-benchmark") == 0)
+        {
+            g_ObjBenchmarkFile = argv[++i];
+        }
+        if (::wcscmp(argv[i], L"--committed-resources") == 0)
+        {
+            // Compare against one committed resource per buffer/texture
+            Renderer::GetHeapAllocator()->SetUsePlacedResources(false);
+        }
+        if (::wcscmp(argv[i], L"--blocking-load") == 0)
+        {
+            // Load every asset before the first frame to compare the time to first frame
+            AssetLoader::SetBlockingLoad(true);
+        }
+        if (::wcscmp(argv[i], L"--frames") == 0)
+        {
+            // Frames in flight from 2 to 4, trades latency for throughput
+            Renderer::SetNumFrames(::wcstol(argv[++i], nullptr, 10));
+        }
+        if (::wcscmp(argv[i], L"--frame-latency") == 0)
+        {
+            // Presents queued by the swap chain, below the frames in flight so pass it after --frames, 0 uses one less than the frames in flight
+            Renderer::SetMaxFrameLatency(::wcstol(argv[++i], nullptr, 10));
+        }
+        if (::wcscmp(argv[i], L"--job-threads") == 0)
+        {
+            // Threads of the job system including the main thread, 0 uses every hardware thread
+            JobSystem::SetNumThreads(::wcstol(argv[++i], nullptr, 10));
+        }
+        if (::wcscmp(argv[i], L"--job-benchmark") == 0)
+        {
+            g_JobBenchmark = true;
+        }
+        if (::wcscmp(argv[i], L"--record-threads") == 0)
+        {
+            // Command lists the depth map and scene passes are recorded on, 0 uses one per job system thread
+            Renderer::SetNumRecordThreads(::wcstol(argv[++i], nullptr, 10));
+        }
+        if (::wcscmp(argv[i], L"--direct-draws") == 0)
+        {
+            // Record the draws of the scene pass instead of executing them from an argument buffer
+            Renderer::SetUseIndirectDraws(false);
+        }
+        if (::wcscmp(argv[i], L"--no-bundles") == 0)
+        {
+            // Record every draw of the depth map and scene passes each frame instead of replaying bundles
+            Renderer::SetUseBundles(false);
+        }
+        if (::wcscmp(argv[i], L"--record-benchmark") == 0)
+        {
+            // Report the recording time with 1 to every job system thread, without and with bundles, once the scene is loaded
+            Renderer::SetRecordBenchmark(true);
+        }
+        if (::wcscmp(argv[i], L"--memory-budget") == 0)
+        {
+            // Simulate a video memory budget in MB to exercise the texture eviction
+            ResidencyManager::SetSimulatedBudget(::wcstoull(argv[++i], nullptr, 10) * 1024 * 1024);
+        }
     }
 
     // Free memory allocated by CommandLineToArgvW
@@ -42,7 +118,22 @@ int CALLBACK wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
     ParseCommandLineArguments();
     
     // Initialize required for DirectXTex library https://github.com/microsoft/DirectXTex/wiki/DirectXTex
+    // The worker threads of the job system decode textures as well
     ThrowIfFailed(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+    JobSystem::SetThreadCallbacks([]() { ThrowIfFailed(CoInitializeEx(nullptr, COINIT_MULTITHREADED)); }, []() { CoUninitialize(); });
+
+    if (g_JobBenchmark) {
+        std::vector<JobSystem::BenchmarkResult> results = JobSystem::RunBenchmark(JobSystem::GetNumThreads());
+        for (const JobSystem::BenchmarkResult& result : results) {
+            wchar_t buffer[500];
+            swprintf_s(buffer, 500, L"JobSystem: %u threads, %f Mjobs/s, parallel for %f ms, %fx speedup\n", result.num_threads, result.jobs_per_second * 1e-6,
+                result.parallel_for_time * 1e3, results[0].parallel_for_time / std::max(result.parallel_for_time, 1e-9));
+            OutputDebugString(buffer);
+        }
+    }
+
+    if (!g_ObjBenchmarkFile.empty())
+        ObjParser::RunThreadScalingBenchmark(g_ObjBenchmarkFile);
 
     Application app(hInstance, L"DX12 Renderer", g_ClientWidth, g_ClientHeight);
     app.Show();
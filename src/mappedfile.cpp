@@ -0,0 +1,92 @@
+#include "mappedfile.h"
+
+#ifdef _WIN32
+
+#include "utility.h"
+
+MappedFile::MappedFile(const std::filesystem::path& file_path) :
+    m_file(INVALID_HANDLE_VALUE), m_mapping(NULL), m_data(nullptr), m_size(0)
+{
+    m_file = ::CreateFileW(file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (m_file == INVALID_HANDLE_VALUE)
+        throw std::exception("MappedFile::MappedFile(): Failed to open file");
+
+    LARGE_INTEGER file_size;
+    if (!::GetFileSizeEx(m_file, &file_size)) {
+        ::CloseHandle(m_file);
+        throw std::exception("MappedFile::MappedFile(): Failed to query file size");
+    }
+    m_size = static_cast<size_t>(file_size.QuadPart);
+
+    // Empty files cannot be mapped
+    if (m_size == 0)
+        return;
+
+    m_mapping = ::CreateFileMappingW(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!m_mapping) {
+        ::CloseHandle(m_file);
+        throw std::exception("MappedFile::MappedFile(): Failed to create file mapping");
+    }
+
+    m_data = static_cast<const uint8_t*>(::MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m_data) {
+        ::CloseHandle(m_mapping);
+        ::CloseHandle(m_file);
+        throw std::exception("MappedFile::MappedFile(): Failed to map view of file");
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data)
+        ::UnmapViewOfFile(m_data);
+    if (m_mapping)
+        ::CloseHandle(m_mapping);
+    if (m_file != INVALID_HANDLE_VALUE)
+        ::CloseHandle(m_file);
+}
+
+#else
+
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// POSIX version for the headless tests
+MappedFile::MappedFile(const std::filesystem::path& file_path) :
+    m_file(-1), m_data(nullptr), m_size(0)
+{
+    m_file = ::open(file_path.c_str(), O_RDONLY);
+    if (m_file < 0)
+        throw std::runtime_error("MappedFile::MappedFile(): Failed to open file");
+
+    struct stat file_stat;
+    if (::fstat(m_file, &file_stat) != 0) {
+        ::close(m_file);
+        throw std::runtime_error("MappedFile::MappedFile(): Failed to query file size");
+    }
+    m_size = static_cast<size_t>(file_stat.st_size);
+
+    // Empty files cannot be mapped
+    if (m_size == 0)
+        return;
+
+    void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+    if (data == MAP_FAILED) {
+        ::close(m_file);
+        throw std::runtime_error("MappedFile::MappedFile(): Failed to map file");
+    }
+    m_data = static_cast<const uint8_t*>(data);
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data)
+        ::munmap(const_cast<uint8_t*>(m_data), m_size);
+    if (m_file >= 0)
+        ::close(m_file);
+}
+
+#endif
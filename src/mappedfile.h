@@ -0,0 +1,31 @@
+#pragma once
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+#include <cstdint>
+#include <filesystem>
+
+// Read-only memory mapped view of a whole file
+class MappedFile {
+private:
+#ifdef _WIN32
+    HANDLE m_file;
+    HANDLE m_mapping;
+#else
+    int m_file;
+#endif
+    const uint8_t* m_data;
+    size_t m_size;
+
+public:
+    MappedFile(const std::filesystem::path& file_path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* GetData() const { return m_data; }
+    size_t GetSize() const { return m_size; }
+};
@@ -2,18 +2,22 @@
 
 #include <d3dx12.h>
 
-// for tinyobjloader
-#define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
 
 #include <filesystem>
-#include <set>
 #include <algorithm>
+#include <chrono>
 
 #include "utility.h"
 #include "renderer.h"
 #include "texture.h"
 #include "commandqueue.h"
+#include "vertexwelder.h"
+#include "meshcache.h"
+#include "objparser.h"
+#include "meshoptimizer.h"
+#include "meshsimplifier.h"
+#include "assetloader.h"
 
 
 // Declare the IMesh types to be used to avoid Linker errors https://isocpp.org/wiki/faq/templates#separate-template-fn-defn-from-decl
@@ -58,23 +62,107 @@ const std::vector<uint32_t> Skybox::indices{
 // Mesh
 template<IsVertex T>
 void IMesh<T>::Load(CommandQueue* command_queue) {
-    Microsoft::WRL::ComPtr<ID3D12Device2> device = Renderer::GetDevice();
     auto command_list = command_queue->GetCommandList();
 
-    m_vertex_buffer.Create(m_vertices.size());
-    m_vertex_buffer.Upload(command_list, m_vertices);
+    Upload(command_list);
+
+    auto fence_value = command_queue->ExecuteCommandList(std::move(command_list));
+    command_queue->WaitForFenceValue(fence_value);
+}
+
+template<IsVertex T>
+void IMesh<T>::Upload(CommandList& command_list) {
+    std::span<const T> vertices = GetVertices();
+    m_vertex_buffer.Create(vertices.size());
+    m_vertex_buffer.Upload(command_list, vertices);
     m_vertex_buffer_view = m_vertex_buffer.GetVertexBufferView();
 
-    m_index_buffer.Create(m_indices.size());
-    m_index_buffer.Upload(command_list, m_indices);
-    m_index_buffer_view = m_index_buffer.GetIndexBufferView();
+    UploadIndices(command_list);
+}
 
-    auto fence_value = command_queue->ExecuteCommandList(command_list);
-    command_queue->WaitForFenceValue(fence_value);
+template<IsVertex T>
+void IMesh<T>::UploadIndices(CommandList& command_list)
+{
+    std::span<const uint32_t> indices = GetIndices();
+    m_index_ranges.clear();
+    if (GetVertices().size() > 65536 && m_split_index_ranges) {
+        m_index_ranges = MeshOptimizer::SplitIndexRanges(indices);
+        // Splitting into many small draws costs more than the memory saved
+        if (m_index_ranges.size() * 64 > indices.size() / 3)
+            m_index_ranges.clear();
+
+        wchar_t buffer[500];
+        swprintf_s(buffer, 500, L"IMesh::UploadIndices(): %zu vertices split into %zu 16 bit index ranges\n", GetVertices().size(), m_index_ranges.size());
+        OutputDebugString(buffer);
+    }
+
+    if (GetVertices().size() > 65536 && m_index_ranges.empty()) {
+        m_index_buffer.Create(indices.size());
+        m_index_buffer.Upload(command_list, indices);
+        m_index_buffer_view = m_index_buffer.GetIndexBufferView();
+        return;
+    }
+
+    // Indices are stored relative to the base vertex of their range
+    std::vector<uint16_t> indices_16(indices.size());
+    if (m_index_ranges.empty()) {
+        std::transform(indices.begin(), indices.end(), indices_16.begin(), [](uint32_t index) { return static_cast<uint16_t>(index); });
+    }
+    else {
+        for (const MeshOptimizer::IndexRange& range : m_index_ranges) {
+            for (uint32_t i = range.index_offset; i < range.index_offset + range.index_count; ++i)
+                indices_16[i] = static_cast<uint16_t>(indices[i] - range.base_vertex);
+        }
+    }
+
+    m_index_buffer_16.Create(indices_16.size());
+    m_index_buffer_16.Upload(command_list, indices_16);
+    m_index_buffer_view = m_index_buffer_16.GetIndexBufferView();
+}
+
+template<IsVertex T>
+void IMesh<T>::DrawIndexed(CommandList& command_list, uint32_t index_count, uint32_t start_index, uint32_t num_instances) const
+{
+    IndirectDrawBuilder::ForEachDrawCall(m_index_ranges, index_count, start_index, num_instances, [&](const D3D12_DRAW_INDEXED_ARGUMENTS& arguments) {
+        command_list.DrawIndexedInstanced(arguments.IndexCountPerInstance, arguments.InstanceCount, arguments.StartIndexLocation, arguments.BaseVertexLocation);
+    });
+}
+
+void Mesh::Upload(CommandList& command_list)
+{
+    if (!m_compact_vertices) {
+        IMesh<Vertex>::Upload(command_list);
+        return;
+    }
+
+    std::span<const Vertex> vertices = GetVertices();
+    m_quantization = VertexCompressor::ComputeQuantization(vertices);
+    std::vector<CompactVertex> compact_vertices = VertexCompressor::Encode(vertices, m_quantization);
+
+    // Report the encoding error against the analytic position bound
+    VertexCompressor::Error error = VertexCompressor::MeasureError(vertices, compact_vertices, m_quantization);
+    wchar_t buffer[500];
+    swprintf_s(buffer, 500, L"Mesh::Upload(): compact vertices %zu -> %zu bytes, max error position %f (bound %f), normal %f rad, uv %f\n",
+        vertices.size_bytes(), compact_vertices.size() * sizeof(CompactVertex), error.position, VertexCompressor::GetPositionErrorBound(m_quantization),
+        error.normal, error.texture_coord);
+    OutputDebugString(buffer);
+
+    // The data is copied into upload memory while recording so the encoded vertices do not need to outlive the command list
+    m_compact_vertex_buffer.Create(compact_vertices.size());
+    m_compact_vertex_buffer.Upload(command_list, compact_vertices);
+    m_vertex_buffer_view = m_compact_vertex_buffer.GetVertexBufferView();
+
+    UploadIndices(command_list);
 }
 
+DirectX::XMMATRIX Mesh::GetVertexTransform() const
+{
+    if (!m_compact_vertices)
+        return DirectX::XMMatrixIdentity();
+    return VertexCompressor::GetDequantizeMatrix(m_quantization);
+}
 
-Mesh Mesh::ReadFile(std::string file_name, TextureLibrary* texture_library) {
+Mesh Mesh::ReadFile(std::string file_name, TextureLibrary* texture_library, const MeshImportOptions& options) {
     std::filesystem::path file_path(file_name);
     if (file_path.extension() != ".obj")
         throw std::exception("Only accepts .OBJ files");
@@ -83,22 +171,62 @@ Mesh Mesh::ReadFile(std::string file_name, TextureLibrary* texture_library) {
         throw std::exception("Obj File not found");
 
     std::string resource_path = file_path.parent_path().string() + "/";
+    auto load_start = std::chrono::high_resolution_clock::now();
+    wchar_t buffer[500];
+
+    // Use the cooked mesh cache if it is up to date, the mapped data is used as is
+    MeshCache::Data cache_data;
+    if (MeshCache::Read(file_path, options.GetFlags(), cache_data)) {
+        if (cache_data.material_textures.empty())
+            throw std::exception("No material applied to mesh");
+        Texture* diffuse_tex = texture_library->CreateTexture(CastToWString(resource_path + cache_data.material_textures[0]));
+
+        std::chrono::duration<double> load_time = std::chrono::high_resolution_clock::now() - load_start;
+        swprintf_s(buffer, 500, L"Mesh::ReadFile(): loaded %zu vertices from mesh cache in %f ms for %S\n", cache_data.vertices.size(), load_time.count() * 1e3, file_name.c_str());
+        OutputDebugString(buffer);
+
+        Mesh mesh(cache_data.file, cache_data.vertices, cache_data.indices, cache_data.meshlets, cache_data.lods, { diffuse_tex }, cache_data.min_bounds, cache_data.max_bounds);
+        mesh.m_compact_vertices = options.compact_vertices;
+        mesh.m_split_index_ranges = options.split_index_ranges;
+        return mesh;
+    }
 
-    tinyobj::ObjReaderConfig reader_config;
-    reader_config.mtl_search_path = resource_path; // Path to material files
+    // Triangulated OBJ files are parsed in parallel, anything else goes through tinyobjloader
+    auto parse_start = std::chrono::high_resolution_clock::now();
+    ObjParser::Result obj;
     tinyobj::ObjReader reader;
-    if (!reader.ParseFromFile(file_name, reader_config)) {
-        throw std::exception(reader.Error().c_str());
+    bool parallel_parse = ObjParser::Parse(file_path, obj);
+
+    // tinyobj storage
+    const tinyobj::attrib_t* attrib;
+    std::vector<const std::vector<tinyobj::index_t>*> shape_indices;
+    std::vector<tinyobj::material_t> materials;
+    if (parallel_parse) {
+        attrib = &obj.attrib;
+        shape_indices.push_back(&obj.indices);
+        ObjParser::LoadMaterials(obj, resource_path, materials);
     }
+    else {
+        tinyobj::ObjReaderConfig reader_config;
+        reader_config.mtl_search_path = resource_path; // Path to material files
+        if (!reader.ParseFromFile(file_name, reader_config)) {
+            throw std::exception(reader.Error().c_str());
+        }
 
-    //if (!reader.Warning().empty()) {
-    //    std::cout << "TinyObjReader: " << reader.Warning();
-    //}
+        //if (!reader.Warning().empty()) {
+        //    std::cout << "TinyObjReader: " << reader.Warning();
+        //}
 
-    // tinyobj storage
-    auto& attrib = reader.GetAttrib();
-    auto& shapes = reader.GetShapes();
-    auto& materials = reader.GetMaterials();
+        attrib = &reader.GetAttrib();
+        for (const tinyobj::shape_t& shape : reader.GetShapes())
+            shape_indices.push_back(&shape.mesh.indices);
+        materials = reader.GetMaterials();
+    }
+
+    std::chrono::duration<double> parse_time = std::chrono::high_resolution_clock::now() - parse_start;
+    swprintf_s(buffer, 500, L"Mesh::ReadFile(): %s parsed in %f ms (%u threads) for %S\n", parallel_parse ? L"ObjParser" : L"tinyobjloader",
+        parse_time.count() * 1e3, parallel_parse ? obj.num_threads : 1, file_name.c_str());
+    OutputDebugString(buffer);
 
     // TODO: default texture in case the diffuse texture does not exist in CreateTexture
     if (materials.empty())
@@ -106,48 +234,153 @@ Mesh Mesh::ReadFile(std::string file_name, TextureLibrary* texture_library) {
     // Create texture for materials (only using first material)
     Texture* diffuse_tex = texture_library->CreateTexture(CastToWString(resource_path + materials[0].diffuse_texname));
 
-    // Lesser compare function to create set of tinyobj::index_t
-    auto comp = [](const tinyobj::index_t& i1, const tinyobj::index_t& i2) {
-        return i1.vertex_index < i2.vertex_index || (i1.vertex_index == i2.vertex_index && i1.normal_index < i2.normal_index) || (i1.vertex_index == i2.vertex_index && i1.normal_index == i2.normal_index && i1.texcoord_index < i2.texcoord_index);
-    };
+    size_t num_corners = 0;
+    for (const std::vector<tinyobj::index_t>* indices : shape_indices)
+        num_corners += indices->size();
+
+    auto weld_start = std::chrono::high_resolution_clock::now();
+
+    // Weld the corners into unique vertices with a flat hash map
+    VertexWelder welder(num_corners);
 
-    uint32_t unique_idx = 0;
-    std::map<tinyobj::index_t, uint32_t, decltype(comp)> indices_map(comp);
-    
     // All vertices and indices of the different shapes are combined
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
-    for (size_t s = 0; s < shapes.size(); s++) {
+    indices.reserve(num_corners);
+    for (size_t s = 0; s < shape_indices.size(); s++) {
 
-        for (const tinyobj::index_t& idx : shapes[s].mesh.indices) {
+        for (const tinyobj::index_t& idx : *shape_indices[s]) {
             // Find the unique index in the map or insert
-            auto it = indices_map.find(idx);
-            if (it == indices_map.end()) {
-                indices_map.insert(std::make_pair(idx, unique_idx));
+            uint32_t unique_idx;
+            if (welder.Insert({ idx.vertex_index, idx.normal_index, idx.texcoord_index }, unique_idx)) {
+                // Neither parser guarantees the indices are within the attribute arrays
+                if (idx.vertex_index < 0 || 3 * size_t(idx.vertex_index) >= attrib->vertices.size() ||
+                    (idx.texcoord_index >= 0 && 2 * size_t(idx.texcoord_index) >= attrib->texcoords.size()) ||
+                    (idx.normal_index >= 0 && 3 * size_t(idx.normal_index) >= attrib->normals.size()))
+                    throw std::exception("Mesh::ReadFile(): Face index out of range");
 
                 // Create vertex
-                DirectX::XMFLOAT3 pos(attrib.vertices[3 * size_t(idx.vertex_index)], attrib.vertices[3 * size_t(idx.vertex_index) + 1], attrib.vertices[3 * size_t(idx.vertex_index) + 2]);
+                DirectX::XMFLOAT3 pos(attrib->vertices[3 * size_t(idx.vertex_index)], attrib->vertices[3 * size_t(idx.vertex_index) + 1], attrib->vertices[3 * size_t(idx.vertex_index) + 2]);
                 DirectX::XMFLOAT2 tex_coord{};
                 // Check if `texcoord_index` is zero or positive. negative = no texcoord data
                 if (idx.texcoord_index >= 0)
-                    tex_coord = DirectX::XMFLOAT2(attrib.texcoords[2 * size_t(idx.texcoord_index)], attrib.texcoords[2 * size_t(idx.texcoord_index) + 1]);
+                    tex_coord = DirectX::XMFLOAT2(attrib->texcoords[2 * size_t(idx.texcoord_index)], attrib->texcoords[2 * size_t(idx.texcoord_index) + 1]);
 
                 DirectX::XMFLOAT3 normal{};
                 if (idx.normal_index >= 0)
-                    normal = DirectX::XMFLOAT3(attrib.normals[3 * size_t(idx.normal_index)], attrib.normals[3 * size_t(idx.normal_index) + 1], attrib.normals[3 * size_t(idx.normal_index) + 2]);
+                    normal = DirectX::XMFLOAT3(attrib->normals[3 * size_t(idx.normal_index)], attrib->normals[3 * size_t(idx.normal_index) + 1], attrib->normals[3 * size_t(idx.normal_index) + 2]);
 
                 vertices.push_back(Vertex{ pos, tex_coord, normal });
-                indices.push_back(unique_idx);
-
-                ++unique_idx;
-            }
-            else {
-                indices.push_back(it->second);
             }
+            indices.push_back(unique_idx);
+        }
+    }
+
+    // Report welding throughput
+    std::chrono::duration<double> weld_time = std::chrono::high_resolution_clock::now() - weld_start;
+    swprintf_s(buffer, 500, L"Mesh::ReadFile(): welded %zu corners into %zu vertices in %f ms (%f Mcorners/s) for %S\n",
+        num_corners, vertices.size(), weld_time.count() * 1e3, num_corners / std::max(weld_time.count(), 1e-9) * 1e-6, file_name.c_str());
+    OutputDebugString(buffer);
+
+    // Reorder the OBJ face order for the post-transform vertex cache
+    if (options.optimize_vertex_cache) {
+        auto optimize_start = std::chrono::high_resolution_clock::now();
+        MeshOptimizer::VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size(), options.vertex_cache_size);
+        MeshOptimizer::OptimizeVertexCache(indices, vertices.size(), options.vertex_cache_size);
+        MeshOptimizer::VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size(), options.vertex_cache_size);
+        std::chrono::duration<double> optimize_time = std::chrono::high_resolution_clock::now() - optimize_start;
+
+        swprintf_s(buffer, 500, L"Mesh::ReadFile(): vertex cache (%u entries) ACMR %f -> %f, ATVR %f -> %f in %f ms for %S\n", options.vertex_cache_size,
+            before.acmr, after.acmr, before.atvr, after.atvr, optimize_time.count() * 1e3, file_name.c_str());
+        OutputDebugString(buffer);
+    }
+
+    // Simplified levels are appended to the index buffer and share the vertex buffer
+    std::vector<MeshLod> lods = { { 0, CastToUint(indices.size()), 0.0f } };
+    if (options.num_lods > 0 && !vertices.empty()) {
+        auto lod_start = std::chrono::high_resolution_clock::now();
+
+        // Target errors are relative to the mesh extent
+        DirectX::XMVECTOR min_pos = DirectX::XMLoadFloat3(&vertices[0].position);
+        DirectX::XMVECTOR max_pos = min_pos;
+        for (const Vertex& vert : vertices) {
+            min_pos = DirectX::XMVectorMin(min_pos, DirectX::XMLoadFloat3(&vert.position));
+            max_pos = DirectX::XMVectorMax(max_pos, DirectX::XMLoadFloat3(&vert.position));
+        }
+        DirectX::XMFLOAT3 extent;
+        DirectX::XMStoreFloat3(&extent, DirectX::XMVectorSubtract(max_pos, min_pos));
+        float mesh_extent = std::max(extent.x, std::max(extent.y, extent.z));
+
+        // Every level is simplified from level 0 so the error is measured against the full resolution mesh
+        size_t num_lod0_indices = indices.size();
+        for (unsigned int level = 1; level <= options.num_lods; ++level) {
+            size_t target_index_count = (num_lod0_indices >> level) / 3 * 3;
+            float target_error = 0.001f * static_cast<float>(1 << (2 * (level - 1))) * mesh_extent;
+
+            float lod_error;
+            std::vector<uint32_t> lod_indices = MeshSimplifier::Simplify(vertices, std::span<const uint32_t>(indices).first(num_lod0_indices),
+                target_index_count, target_error, lod_error);
+
+            // Stop when the simplification stalls on locked borders/seams or the error budget
+            if (lod_indices.empty() || lod_indices.size() > lods.back().index_count * 9 / 10)
+                break;
+
+            if (options.optimize_vertex_cache)
+                MeshOptimizer::OptimizeVertexCache(lod_indices, vertices.size(), options.vertex_cache_size);
+
+            lods.push_back({ CastToUint(indices.size()), CastToUint(lod_indices.size()), lod_error });
+            indices.insert(indices.end(), lod_indices.begin(), lod_indices.end());
+
+            swprintf_s(buffer, 500, L"Mesh::ReadFile(): lod %u has %zu triangles (%f%%), error %f (target %f) for %S\n", level, lod_indices.size() / 3,
+                100.0 * lod_indices.size() / num_lod0_indices, lod_error, target_error, file_name.c_str());
+            OutputDebugString(buffer);
         }
+
+        std::chrono::duration<double> lod_time = std::chrono::high_resolution_clock::now() - lod_start;
+        swprintf_s(buffer, 500, L"Mesh::ReadFile(): generated %zu lods in %f ms for %S\n", lods.size() - 1, lod_time.count() * 1e3, file_name.c_str());
+        OutputDebugString(buffer);
     }
 
-    return Mesh(vertices, indices, { diffuse_tex });
+    // Vertices are still in first seen OBJ order, renumber them to follow the index buffer
+    if (options.optimize_vertex_fetch) {
+        MeshOptimizer::VertexFetchStats before = MeshOptimizer::AnalyzeVertexFetch(indices, vertices.size(), sizeof(Vertex));
+        MeshOptimizer::OptimizeVertexFetch(vertices, indices);
+        MeshOptimizer::VertexFetchStats after = MeshOptimizer::AnalyzeVertexFetch(indices, vertices.size(), sizeof(Vertex));
+
+        swprintf_s(buffer, 500, L"Mesh::ReadFile(): vertex fetch %f -> %f bytes/triangle, overfetch %f -> %f for %S\n",
+            before.bytes_per_triangle, after.bytes_per_triangle, before.overfetch, after.overfetch, file_name.c_str());
+        OutputDebugString(buffer);
+    }
+
+    Mesh mesh(vertices, indices, { diffuse_tex }, lods);
+    mesh.m_compact_vertices = options.compact_vertices;
+    mesh.m_split_index_ranges = options.split_index_ranges;
+
+#if defined(_DEBUG)
+    if (!MeshletBuilder::Validate(mesh.m_meshlets, std::span<const uint32_t>(indices).first(lods[0].index_count)))
+        throw std::exception("Mesh::ReadFile(): Meshlets do not cover every triangle exactly once");
+#endif
+    swprintf_s(buffer, 500, L"Mesh::ReadFile(): built %zu meshlets (max %u vertices, %u triangles) for %S\n", mesh.m_meshlets.size(),
+        MeshletBuilder::s_max_vertices, MeshletBuilder::s_max_triangles, file_name.c_str());
+    OutputDebugString(buffer);
+
+    // Cook the mesh so the next startup can skip parsing the OBJ file
+    if (!MeshCache::Write(file_path, options.GetFlags(), vertices, indices, mesh.m_meshlets, mesh.m_lods, { materials[0].diffuse_texname }, mesh.m_min_bounds, mesh.m_max_bounds))
+        OutputDebugString(L"Mesh::ReadFile(): Failed to write mesh cache\n");
+
+    std::chrono::duration<double> load_time = std::chrono::high_resolution_clock::now() - load_start;
+    swprintf_s(buffer, 500, L"Mesh::ReadFile(): parsed %zu vertices from OBJ in %f ms for %S\n", vertices.size(), load_time.count() * 1e3, file_name.c_str());
+    OutputDebugString(buffer);
+
+    return mesh;
+}
+
+void Mesh::MarkUsed() const
+{
+    MarkBuffersUsed();
+    m_compact_vertex_buffer.MarkUsed();
+    for (Texture* texture : m_textures)
+        texture->MarkUsed();
 }
 
 D3D12_GPU_DESCRIPTOR_HANDLE Mesh::GetDiffuseTextureDescriptor(unsigned int frame_idx) const { return m_textures[0]->GetShaderGPUHandle(frame_idx); }
@@ -166,7 +399,7 @@ void Mesh::ComputeBounds()
     DirectX::XMVECTOR min_bounds = DirectX::XMVectorSet(max_fl, max_fl, max_fl, 1.0f);
     DirectX::XMVECTOR max_bounds = DirectX::XMVectorSet(min_fl, min_fl, min_fl, 1.0f);
 
-    for (const Vertex& vert : m_vertices) {
+    for (const Vertex& vert : GetVertices()) {
         DirectX::XMVECTOR pos = DirectX::XMLoadFloat3(&vert.position);
         pos = DirectX::XMVectorSetW(pos, 1.0f);
         min_bounds = DirectX::XMVectorMin(pos, min_bounds);
@@ -176,3 +409,41 @@ void Mesh::ComputeBounds()
     DirectX::XMStoreFloat4(&m_min_bounds, min_bounds);
     DirectX::XMStoreFloat4(&m_max_bounds, max_bounds);
 }
+
+
+// MeshLibrary
+Mesh* MeshLibrary::CreateMesh(const std::string& file_name, const MeshImportOptions& options)
+{
+    // Different spellings of the same path refer to the same mesh
+    auto key = std::make_pair(std::filesystem::path(file_name).lexically_normal().string(), options);
+    auto result = m_mesh_map.find(key);
+    if (result != m_mesh_map.end()) {
+        return result->second.mesh.get();
+    }
+
+    Entry entry{ std::make_unique<Mesh>(), options };
+    return m_mesh_map.insert(std::make_pair(key, std::move(entry))).first->second.mesh.get();
+}
+
+void MeshLibrary::Load(AssetLoader* asset_loader)
+{
+    for (const auto& [key, entry] : m_mesh_map)
+        asset_loader->LoadMesh(entry.mesh.get(), key.first, entry.options);
+}
+
+void MeshLibrary::ReportStats() const
+{
+    size_t index_bytes_32 = 0;
+    size_t index_bytes = 0;
+    unsigned int num_16bit_meshes = 0;
+    for (const auto& [name, entry] : m_mesh_map) {
+        index_bytes_32 += entry.mesh->GetNumIndices() * sizeof(uint32_t);
+        index_bytes += entry.mesh->GetIndexBufferSize();
+        num_16bit_meshes += entry.mesh->Uses16BitIndices() ? 1 : 0;
+    }
+
+    wchar_t buffer[500];
+    swprintf_s(buffer, 500, L"MeshLibrary::ReportStats(): %u of %zu meshes use 16 bit indices, index buffers %zu -> %zu bytes (%f%% saved)\n",
+        num_16bit_meshes, m_mesh_map.size(), index_bytes_32, index_bytes, index_bytes_32 ? 100.0 * (index_bytes_32 - index_bytes) / index_bytes_32 : 0.0);
+    OutputDebugString(buffer);
+}
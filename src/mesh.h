@@ -7,13 +7,26 @@
 #include <type_traits>
 #include <vector>
 #include <string>
+#include <span>
+#include <memory>
+#include <map>
+#include <compare>
+#include <utility>
 
 #include "buffer.h"
+#include "meshlet.h"
+#include "meshsimplifier.h"
+#include "meshoptimizer.h"
+#include "compactvertex.h"
+#include "indirectdrawbuilder.h"
 
 // Forward declaration
 class CommandQueue;
+class CommandList;
 class Texture;
 class TextureLibrary;
+class MappedFile;
+class AssetLoader;
 
 // Abstract class for Mesh
 template <IsVertex T>
@@ -21,6 +34,7 @@ class IMesh {
 protected:
     GpuBuffer<T> m_vertex_buffer;
     GpuBuffer<uint32_t> m_index_buffer;
+    GpuBuffer<uint16_t> m_index_buffer_16;
 
     D3D12_VERTEX_BUFFER_VIEW m_vertex_buffer_view;
     D3D12_INDEX_BUFFER_VIEW m_index_buffer_view;
@@ -28,21 +42,56 @@ protected:
     std::vector<T> m_vertices;
     std::vector<uint32_t> m_indices;
 
+    // Vertex and index data can instead be views into a memory mapped mesh cache
+    std::shared_ptr<MappedFile> m_mapped_file;
+    std::span<const T> m_mapped_vertices;
+    std::span<const uint32_t> m_mapped_indices;
+
+    // Meshes with more than 64k vertices can be split into ranges drawn with a base vertex to use 16 bit indices
+    bool m_split_index_ranges;
+    std::vector<MeshOptimizer::IndexRange> m_index_ranges; // empty if the index buffer is drawn without base vertex
+
+    // Create the 16 bit index buffer if the vertex count allows it, otherwise the 32 bit one
+    void UploadIndices(CommandList& command_list);
+
 public:
-    IMesh() : m_vertex_buffer_view{}, m_index_buffer_view{} {}
+    IMesh() : m_vertex_buffer_view{}, m_index_buffer_view{}, m_split_index_ranges(false) {}
 
     IMesh(const std::vector<T>& verts, const std::vector<uint32_t>& inds) :
-        m_vertices(verts), m_indices(inds), m_vertex_buffer_view{}, m_index_buffer_view{}
+        m_vertices(verts), m_indices(inds), m_vertex_buffer_view{}, m_index_buffer_view{}, m_split_index_ranges(false)
+    {
+    }
+
+    IMesh(std::shared_ptr<MappedFile> mapped_file, std::span<const T> verts, std::span<const uint32_t> inds) :
+        m_mapped_file(mapped_file), m_mapped_vertices(verts), m_mapped_indices(inds), m_vertex_buffer_view{}, m_index_buffer_view{}, m_split_index_ranges(false)
     {
     }
 
     const D3D12_VERTEX_BUFFER_VIEW& GetVertexBufferView() const { return m_vertex_buffer_view; }
     const D3D12_INDEX_BUFFER_VIEW& GetIndexBufferView() const { return m_index_buffer_view; }
 
-    // Load data from CPU -> GPU
+    // Load data from CPU -> GPU and wait for the copy
     void Load(CommandQueue* command_queue);
 
-    size_t GetNumIndices() const { return m_indices.size(); }
+    // Record the copies of the vertex and index data, the buffers can be used once the command list has been executed
+    virtual void Upload(CommandList& command_list);
+
+    std::span<const T> GetVertices() const { return m_mapped_file ? m_mapped_vertices : std::span<const T>(m_vertices); }
+    std::span<const uint32_t> GetIndices() const { return m_mapped_file ? m_mapped_indices : std::span<const uint32_t>(m_indices); }
+
+    size_t GetNumIndices() const { return GetIndices().size(); }
+
+    // Size of the uploaded index buffer in bytes
+    size_t GetIndexBufferSize() const { return m_index_buffer_view.SizeInBytes; }
+    bool Uses16BitIndices() const { return m_index_buffer_view.Format == DXGI_FORMAT_R16_UINT; }
+
+    // Draw a range of the index buffer, split at the index ranges with their base vertex
+    void DrawIndexed(CommandList& command_list, uint32_t index_count, uint32_t start_index = 0, uint32_t num_instances = 1) const;
+    // Index ranges the draws are split at, for IndirectDrawBuilder
+    std::span<const MeshOptimizer::IndexRange> GetIndexRanges() const { return m_index_ranges; }
+
+    // Record the use of the vertex and index buffers in the current frame for the residency manager
+    void MarkBuffersUsed() const { m_vertex_buffer.MarkUsed(); m_index_buffer.MarkUsed(); m_index_buffer_16.MarkUsed(); }
 };
 
 class ScreenQuad : public IMesh<ScreenVertex> {
@@ -73,20 +122,62 @@ struct MaterialParams {
     float roughness;
 };
 
+// Optional processing done by Mesh::ReadFile before the mesh is cached
+struct MeshImportOptions {
+    bool optimize_vertex_cache = true; // reorder the triangles for the post-transform vertex cache
+    unsigned int vertex_cache_size = 16;
+    bool optimize_vertex_fetch = true; // renumber the vertices in order of first use by the index buffer
+    unsigned int num_lods = 4; // simplified levels appended to the index buffer, each level halves the triangle count
+    bool compact_vertices = false; // upload 16 byte CompactVertex instead of Vertex, encoded at load so it is not part of the cache flags
+    bool split_index_ranges = true; // use 16 bit indices for meshes with more than 64k vertices by splitting the index buffer, done at load
+
+    // Options stored in the mesh cache, a cache created with different options is rebuilt
+    uint32_t GetFlags() const { return (optimize_vertex_cache ? 1u : 0u) | (optimize_vertex_fetch ? 2u : 0u) | (vertex_cache_size << 8) | (num_lods << 16); }
+
+    auto operator<=>(const MeshImportOptions&) const = default;
+};
+
 class Mesh : public IMesh<Vertex> {
 private:
     std::vector<Texture*> m_textures;
     MaterialParams m_mat_params;
 
+    // Clusters of the level 0 index buffer for culling
+    std::vector<Meshlet> m_meshlets;
+
+    // Levels of detail stored after each other in the index buffer
+    std::vector<MeshLod> m_lods;
+
     // Cache bounds of Mesh
     DirectX::XMFLOAT4 m_min_bounds; 
     DirectX::XMFLOAT4 m_max_bounds;
 
+    // Optional compressed vertex buffer that replaces m_vertex_buffer on the GPU
+    bool m_compact_vertices;
+    GpuBuffer<CompactVertex> m_compact_vertex_buffer;
+    VertexQuantization m_quantization;
+
 public:
-    Mesh(const std::vector<Vertex>& verts, const std::vector<uint32_t>& inds, const std::vector<Texture*>& textures) :
-        m_textures(textures), m_mat_params{0.0f, 0.25f}, IMesh<Vertex>(verts, inds)
+    // Empty mesh to be filled in by ReadFile() on the asset loader threads
+    Mesh() : m_mat_params{ 0.0f, 0.25f }, m_min_bounds{}, m_max_bounds{}, m_compact_vertices(false), m_quantization{} {}
+
+    // Without lods the whole index buffer is level 0
+    Mesh(const std::vector<Vertex>& verts, const std::vector<uint32_t>& inds, const std::vector<Texture*>& textures, const std::vector<MeshLod>& lods = {}) :
+        m_textures(textures), m_mat_params{0.0f, 0.25f}, m_lods(lods), m_compact_vertices(false), m_quantization{}, IMesh<Vertex>(verts, inds)
     {
+        if (m_lods.empty())
+            m_lods.push_back({ 0, static_cast<uint32_t>(m_indices.size()), 0.0f });
         ComputeBounds();
+        m_meshlets = MeshletBuilder::Build(m_vertices, std::span<const uint32_t>(m_indices).first(m_lods[0].index_count));
+    }
+
+    // Mesh loaded from a memory mapped mesh cache with precomputed bounds, meshlets and lods
+    Mesh(std::shared_ptr<MappedFile> mapped_file, std::span<const Vertex> verts, std::span<const uint32_t> inds, std::span<const Meshlet> meshlets,
+        std::span<const MeshLod> lods, const std::vector<Texture*>& textures, const DirectX::XMFLOAT4& min_bounds, const DirectX::XMFLOAT4& max_bounds) :
+        m_textures(textures), m_mat_params{ 0.0f, 0.25f }, m_meshlets(meshlets.begin(), meshlets.end()), m_lods(lods.begin(), lods.end()),
+        m_min_bounds(min_bounds), m_max_bounds(max_bounds), m_compact_vertices(false), m_quantization{},
+        IMesh<Vertex>(mapped_file, verts, inds)
+    {
     }
 
     std::vector<Texture*> GetTextures() { return m_textures; }//{ m_diffuse_tex }; }
@@ -94,12 +185,53 @@ public:
     std::vector<D3D12_GPU_DESCRIPTOR_HANDLE> GetTextureDescriptors(unsigned int frame_idx) const;
     const MaterialParams* GetMaterial() const { return &m_mat_params; }
 
+    // Record the use of the buffers and textures in the current frame for the residency manager
+    void MarkUsed() const;
+
+    // Encodes the compact vertices if enabled
+    virtual void Upload(CommandList& command_list) override;
+
+    bool UsesCompactVertices() const { return m_compact_vertices; }
+
+    // Object space transform of the vertex buffer positions, to be multiplied with the model matrix
+    DirectX::XMMATRIX GetVertexTransform() const;
+
+    const std::vector<Meshlet>& GetMeshlets() const { return m_meshlets; }
+    const std::vector<MeshLod>& GetLods() const { return m_lods; }
+
     void GetBounds(DirectX::XMFLOAT4& min_bounds, DirectX::XMFLOAT4& max_bounds) const { min_bounds = m_min_bounds; max_bounds = m_max_bounds; }
 
     // Using https://github.com/tinyobjloader/tinyobjloader
-    static Mesh ReadFile(std::string file_name, TextureLibrary* texture_library);
+    // A cooked .meshbin cache is written next to the OBJ file and used instead on later loads
+    static Mesh ReadFile(std::string file_name, TextureLibrary* texture_library, const MeshImportOptions& options = MeshImportOptions());
 
 private:
     void ComputeBounds();
 };
 
+
+// Loads each mesh file once, scene items refer to the loaded meshes by pointer
+class MeshLibrary {
+private:
+    struct Entry {
+        std::unique_ptr<Mesh> mesh;
+        MeshImportOptions options;
+    };
+    // Meshes are keyed by the normalized file name and all import options, so each variant of a file is its own mesh
+    std::map<std::pair<std::string, MeshImportOptions>, Entry> m_mesh_map;
+
+public:
+    // Returns the mesh of the file, the mesh stays empty until it has been loaded
+    // Files requested before with the same import options return the same mesh
+    Mesh* CreateMesh(const std::string& file_name, const MeshImportOptions& options = MeshImportOptions());
+
+    // Request all meshes from the asset loader
+    void Load(AssetLoader* asset_loader);
+
+    size_t GetNumMeshes() const { return m_mesh_map.size(); }
+
+    // Report the index memory saved by 16 bit index buffers, once all meshes have been uploaded
+    void ReportStats() const;
+
+    void Reset() { m_mesh_map.clear(); }
+};
@@ -0,0 +1,157 @@
+#include "meshcache.h"
+
+#include <cstring>
+#include <fstream>
+
+#include "mappedfile.h"
+
+
+std::filesystem::path MeshCache::GetCachePath(const std::filesystem::path& source_path)
+{
+    std::filesystem::path cache_path(source_path);
+    cache_path.replace_extension(".meshbin");
+    return cache_path;
+}
+
+void MeshCache::GetSourceStamp(const std::filesystem::path& source_path, uint64_t& size, int64_t& write_time)
+{
+    size = std::filesystem::file_size(source_path);
+    write_time = std::filesystem::last_write_time(source_path).time_since_epoch().count();
+}
+
+bool MeshCache::Read(const std::filesystem::path& source_path, uint32_t import_flags, Data& data)
+{
+    std::filesystem::path cache_path = GetCachePath(source_path);
+    if (!std::filesystem::exists(cache_path))
+        return false;
+
+    // A cache which can not be mapped, e.g. because it is locked by another process, is rebuilt like a stale one
+    std::shared_ptr<MappedFile> file;
+    try {
+        file = std::make_shared<MappedFile>(cache_path);
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+    if (file->GetSize() < sizeof(Header))
+        return false;
+
+    const uint8_t* file_data = file->GetData();
+    Header header;
+    memcpy(&header, file_data, sizeof(Header));
+
+    if (header.magic != s_magic || header.version != s_version || header.import_flags != import_flags)
+        return false;
+
+    // Check if the source file has been changed since the cache was written
+    uint64_t source_size;
+    int64_t source_write_time;
+    GetSourceStamp(source_path, source_size, source_write_time);
+    if (header.source_size != source_size || header.source_write_time != source_write_time)
+        return false;
+
+    size_t material_offset = AlignSize(sizeof(Header));
+    size_t vertex_offset = material_offset + header.material_refs_size;
+    size_t index_offset = AlignSize(vertex_offset + header.num_vertices * sizeof(Vertex));
+    size_t meshlet_offset = AlignSize(index_offset + header.num_indices * sizeof(uint32_t));
+    size_t lod_offset = AlignSize(meshlet_offset + header.num_meshlets * sizeof(Meshlet));
+    size_t end_offset = lod_offset + header.num_lods * sizeof(MeshLod);
+    if (end_offset > file->GetSize())
+        return false;
+
+    // Material refs stored as (length, characters)
+    data.material_textures.clear();
+    size_t offset = material_offset;
+    for (uint32_t i = 0; i < header.num_materials; ++i) {
+        uint32_t length;
+        if (offset + sizeof(uint32_t) > vertex_offset)
+            return false;
+        memcpy(&length, file_data + offset, sizeof(uint32_t));
+        offset += sizeof(uint32_t);
+
+        if (offset + length > vertex_offset)
+            return false;
+        data.material_textures.emplace_back(reinterpret_cast<const char*>(file_data + offset), length);
+        offset += length;
+    }
+
+    data.vertices = std::span<const Vertex>(reinterpret_cast<const Vertex*>(file_data + vertex_offset), header.num_vertices);
+    data.indices = std::span<const uint32_t>(reinterpret_cast<const uint32_t*>(file_data + index_offset), header.num_indices);
+    data.meshlets = std::span<const Meshlet>(reinterpret_cast<const Meshlet*>(file_data + meshlet_offset), header.num_meshlets);
+    data.lods = std::span<const MeshLod>(reinterpret_cast<const MeshLod*>(file_data + lod_offset), header.num_lods);
+    data.min_bounds = header.min_bounds;
+    data.max_bounds = header.max_bounds;
+    data.file = std::move(file);
+    return true;
+}
+
+bool MeshCache::Write(const std::filesystem::path& source_path, uint32_t import_flags, std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+    std::span<const Meshlet> meshlets, std::span<const MeshLod> lods, const std::vector<std::string>& material_textures, const DirectX::XMFLOAT4& min_bounds, const DirectX::XMFLOAT4& max_bounds)
+{
+    // Counts are stored as 32 bit values
+    if (vertices.size() > UINT32_MAX || indices.size() > UINT32_MAX || meshlets.size() > UINT32_MAX || lods.size() > UINT32_MAX || material_textures.size() > UINT32_MAX)
+        return false;
+
+    Header header{};
+    header.magic = s_magic;
+    header.version = s_version;
+    header.import_flags = import_flags;
+    GetSourceStamp(source_path, header.source_size, header.source_write_time);
+    header.num_vertices = static_cast<uint32_t>(vertices.size());
+    header.num_indices = static_cast<uint32_t>(indices.size());
+    header.num_meshlets = static_cast<uint32_t>(meshlets.size());
+    header.num_lods = static_cast<uint32_t>(lods.size());
+    header.num_materials = static_cast<uint32_t>(material_textures.size());
+    header.min_bounds = min_bounds;
+    header.max_bounds = max_bounds;
+
+    size_t material_refs_size = 0;
+    for (const std::string& texture : material_textures)
+        material_refs_size += sizeof(uint32_t) + texture.size();
+    header.material_refs_size = static_cast<uint32_t>(AlignSize(material_refs_size));
+
+    // Write to a temporary file first so a partially written cache is never picked up
+    std::filesystem::path cache_path = GetCachePath(source_path);
+    std::filesystem::path temp_path = cache_path;
+    temp_path += ".tmp";
+    bool written = false;
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+
+        const char padding[s_alignment] = {};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        out.write(padding, AlignSize(sizeof(Header)) - sizeof(Header));
+
+        for (const std::string& texture : material_textures) {
+            uint32_t length = static_cast<uint32_t>(texture.size());
+            out.write(reinterpret_cast<const char*>(&length), sizeof(uint32_t));
+            out.write(texture.data(), length);
+        }
+        out.write(padding, header.material_refs_size - material_refs_size);
+
+        size_t vertex_bytes = vertices.size_bytes();
+        out.write(reinterpret_cast<const char*>(vertices.data()), vertex_bytes);
+        out.write(padding, AlignSize(vertex_bytes) - vertex_bytes);
+        size_t index_bytes = indices.size_bytes();
+        out.write(reinterpret_cast<const char*>(indices.data()), index_bytes);
+        out.write(padding, AlignSize(index_bytes) - index_bytes);
+        size_t meshlet_bytes = meshlets.size_bytes();
+        out.write(reinterpret_cast<const char*>(meshlets.data()), meshlet_bytes);
+        out.write(padding, AlignSize(meshlet_bytes) - meshlet_bytes);
+        out.write(reinterpret_cast<const char*>(lods.data()), lods.size_bytes());
+
+        // Writes to a stream which failed to open are ignored, closing it then fails as well
+        out.close();
+        written = !out.fail();
+    }
+
+    // The temporary file is closed here, so it can be removed when it could not be written or replace the cache
+    std::error_code error;
+    if (written)
+        std::filesystem::rename(temp_path, cache_path, error);
+    if (!written || error) {
+        std::filesystem::remove(temp_path, error);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "vertex.h"
+#include "meshlet.h"
+#include "meshsimplifier.h"
+
+// Forward declaration
+class MappedFile;
+
+// Cooked binary mesh (.meshbin) stored next to the source OBJ file
+// Layout: Header | material refs | Vertex[] | uint32_t[] | Meshlet[] | MeshLod[], the arrays are 16 byte aligned so they can be used straight from the mapped file
+class MeshCache {
+public:
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        // Source file stamp to detect stale caches
+        uint64_t source_size;
+        int64_t source_write_time;
+        uint32_t num_vertices;
+        uint32_t num_indices;
+        uint32_t num_meshlets;
+        uint32_t num_lods;
+        uint32_t num_materials;
+        uint32_t material_refs_size; // in bytes including padding
+        uint32_t import_flags; // MeshImportOptions the mesh was processed with
+        DirectX::XMFLOAT4 min_bounds;
+        DirectX::XMFLOAT4 max_bounds;
+    };
+
+    // Views into the mapped cache file, valid as long as the file is kept alive
+    struct Data {
+        std::shared_ptr<MappedFile> file;
+        std::span<const Vertex> vertices;
+        std::span<const uint32_t> indices;
+        std::span<const Meshlet> meshlets;
+        std::span<const MeshLod> lods;
+        std::vector<std::string> material_textures; // diffuse texture file names relative to the source file
+        DirectX::XMFLOAT4 min_bounds;
+        DirectX::XMFLOAT4 max_bounds;
+    };
+
+    static constexpr uint32_t s_magic = 0x4E49424D; // "MBIN"
+    static constexpr uint32_t s_version = 5;
+    static constexpr size_t s_alignment = 16;
+
+    static std::filesystem::path GetCachePath(const std::filesystem::path& source_path);
+
+    // Returns false if the cache does not exist, is stale/corrupt or was created with other import flags, the cache then needs to be rebuilt
+    static bool Read(const std::filesystem::path& source_path, uint32_t import_flags, Data& data);
+
+    // Returns false if the cache could not be written (e.g. read-only resource directory)
+    static bool Write(const std::filesystem::path& source_path, uint32_t import_flags, std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+        std::span<const Meshlet> meshlets, std::span<const MeshLod> lods, const std::vector<std::string>& material_textures, const DirectX::XMFLOAT4& min_bounds, const DirectX::XMFLOAT4& max_bounds);
+
+private:
+    static void GetSourceStamp(const std::filesystem::path& source_path, uint64_t& size, int64_t& write_time);
+    static size_t AlignSize(size_t size) { return (size + (s_alignment - 1)) & ~(s_alignment - 1); }
+};
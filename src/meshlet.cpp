@@ -0,0 +1,181 @@
+#include "meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+std::vector<Meshlet> MeshletBuilder::Build(std::span<const Vertex> vertices, std::span<const uint32_t> indices, unsigned int max_vertices, unsigned int max_triangles)
+{
+    std::vector<Meshlet> meshlets;
+
+    // Marks the vertices that are already part of the current meshlet
+    constexpr uint32_t unused = UINT32_MAX;
+    std::vector<uint32_t> vertex_meshlet(vertices.size(), unused);
+    std::vector<uint32_t> meshlet_vertices;
+    meshlet_vertices.reserve(max_vertices);
+
+    uint32_t index_offset = 0;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        uint32_t meshlet_idx = static_cast<uint32_t>(meshlets.size());
+        unsigned int num_new_vertices = 0;
+        for (size_t c = 0; c < 3; ++c)
+            num_new_vertices += vertex_meshlet[indices[i + c]] != meshlet_idx;
+
+        // Close the current meshlet when the triangle does not fit anymore
+        uint32_t num_triangles = static_cast<uint32_t>(i - index_offset) / 3;
+        if (meshlet_vertices.size() + num_new_vertices > max_vertices || num_triangles + 1 > max_triangles) {
+            meshlets.push_back(ComputeBounds(vertices, indices, meshlet_vertices, index_offset, static_cast<uint32_t>(i) - index_offset));
+            meshlet_vertices.clear();
+            index_offset = static_cast<uint32_t>(i);
+            meshlet_idx++;
+        }
+
+        for (size_t c = 0; c < 3; ++c) {
+            uint32_t v = indices[i + c];
+            if (vertex_meshlet[v] != meshlet_idx) {
+                vertex_meshlet[v] = meshlet_idx;
+                meshlet_vertices.push_back(v);
+            }
+        }
+    }
+
+    uint32_t num_triangle_indices = static_cast<uint32_t>(indices.size() / 3 * 3);
+    if (num_triangle_indices > index_offset)
+        meshlets.push_back(ComputeBounds(vertices, indices, meshlet_vertices, index_offset, num_triangle_indices - index_offset));
+
+    return meshlets;
+}
+
+bool MeshletBuilder::Validate(std::span<const Meshlet> meshlets, std::span<const uint32_t> indices, unsigned int max_vertices, unsigned int max_triangles)
+{
+    size_t num_triangles = indices.size() / 3;
+    std::vector<uint32_t> triangle_count(num_triangles, 0);
+    std::vector<uint32_t> meshlet_vertices;
+    for (const Meshlet& meshlet : meshlets) {
+        if (meshlet.index_offset % 3 != 0 || meshlet.index_count % 3 != 0 || meshlet.index_count == 0)
+            return false;
+        if (meshlet.index_offset + meshlet.index_count > num_triangles * 3)
+            return false;
+        if (meshlet.index_count / 3 > max_triangles || meshlet.vertex_count > max_vertices)
+            return false;
+
+        for (uint32_t t = meshlet.index_offset / 3; t < (meshlet.index_offset + meshlet.index_count) / 3; ++t)
+            triangle_count[t]++;
+
+        meshlet_vertices.assign(indices.begin() + meshlet.index_offset, indices.begin() + meshlet.index_offset + meshlet.index_count);
+        std::sort(meshlet_vertices.begin(), meshlet_vertices.end());
+        size_t num_unique = std::unique(meshlet_vertices.begin(), meshlet_vertices.end()) - meshlet_vertices.begin();
+        if (num_unique != meshlet.vertex_count)
+            return false;
+    }
+
+    return std::all_of(triangle_count.begin(), triangle_count.end(), [](uint32_t count) { return count == 1; });
+}
+
+Meshlet MeshletBuilder::ComputeBounds(std::span<const Vertex> vertices, std::span<const uint32_t> indices, const std::vector<uint32_t>& meshlet_vertices,
+    uint32_t index_offset, uint32_t index_count)
+{
+    using namespace DirectX;
+
+    Meshlet meshlet{};
+    meshlet.index_offset = index_offset;
+    meshlet.index_count = index_count;
+    meshlet.vertex_count = static_cast<uint32_t>(meshlet_vertices.size());
+
+    // Bounding sphere around the center of the bounding box
+    XMVECTOR min_bounds = XMLoadFloat3(&vertices[meshlet_vertices[0]].position);
+    XMVECTOR max_bounds = min_bounds;
+    for (uint32_t v : meshlet_vertices) {
+        XMVECTOR position = XMLoadFloat3(&vertices[v].position);
+        min_bounds = XMVectorMin(min_bounds, position);
+        max_bounds = XMVectorMax(max_bounds, position);
+    }
+    XMVECTOR center = XMVectorScale(XMVectorAdd(min_bounds, max_bounds), 0.5f);
+    float radius = 0.0f;
+    for (uint32_t v : meshlet_vertices)
+        radius = std::max(radius, XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&vertices[v].position), center))));
+    XMStoreFloat3(&meshlet.center, center);
+    meshlet.radius = radius;
+
+    // Cone axis is the average of the front face normals (clockwise winding), the cutoff follows from the normal furthest away from it
+    std::vector<XMVECTOR> normals;
+    normals.reserve(index_count / 3);
+    XMVECTOR axis = XMVectorZero();
+    for (uint32_t i = index_offset; i < index_offset + index_count; i += 3) {
+        XMVECTOR a = XMLoadFloat3(&vertices[indices[i]].position);
+        XMVECTOR b = XMLoadFloat3(&vertices[indices[i + 1]].position);
+        XMVECTOR c = XMLoadFloat3(&vertices[indices[i + 2]].position);
+        XMVECTOR normal = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+        // Skip degenerate triangles
+        if (XMVectorGetX(XMVector3LengthSq(normal)) == 0.0f)
+            continue;
+        normal = XMVector3Normalize(normal);
+        normals.push_back(normal);
+        axis = XMVectorAdd(axis, normal);
+    }
+
+    meshlet.cone_axis = XMFLOAT3(0.0f, 0.0f, 0.0f);
+    meshlet.cone_cutoff = 1.0f;
+    if (normals.empty() || XMVectorGetX(XMVector3LengthSq(axis)) == 0.0f)
+        return meshlet;
+
+    axis = XMVector3Normalize(axis);
+    float min_dot = 1.0f;
+    for (const XMVECTOR& normal : normals)
+        min_dot = std::min(min_dot, XMVectorGetX(XMVector3Dot(normal, axis)));
+
+    // Cones wider than ~85 degrees hardly ever cull anything
+    XMStoreFloat3(&meshlet.cone_axis, axis);
+    if (min_dot > 0.1f)
+        meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+    return meshlet;
+}
+
+
+MeshletCuller::MeshletCuller(const DirectX::XMMATRIX& model, const DirectX::XMMATRIX& view_projection, const DirectX::XMFLOAT4& camera_position, bool uniform_scale) :
+    m_cone_culling(uniform_scale)
+{
+    using namespace DirectX;
+
+    // Frustum planes of the model view projection matrix are in object space (Gribb and Hartmann)
+    XMFLOAT4X4 mvp;
+    XMStoreFloat4x4(&mvp, XMMatrixMultiply(model, view_projection));
+    XMVECTOR column_x = XMVectorSet(mvp._11, mvp._21, mvp._31, mvp._41);
+    XMVECTOR column_y = XMVectorSet(mvp._12, mvp._22, mvp._32, mvp._42);
+    XMVECTOR column_z = XMVectorSet(mvp._13, mvp._23, mvp._33, mvp._43);
+    XMVECTOR column_w = XMVectorSet(mvp._14, mvp._24, mvp._34, mvp._44);
+
+    XMVECTOR planes[6] = {
+        XMVectorAdd(column_w, column_x),      // left
+        XMVectorSubtract(column_w, column_x), // right
+        XMVectorAdd(column_w, column_y),      // bottom
+        XMVectorSubtract(column_w, column_y), // top
+        column_z,                             // near (D3D depth range 0 to w)
+        XMVectorSubtract(column_w, column_z)  // far
+    };
+    for (int i = 0; i < 6; ++i)
+        XMStoreFloat4(&m_planes[i], XMPlaneNormalize(planes[i]));
+
+    XMVECTOR model_determinant;
+    XMMATRIX inverse_model = XMMatrixInverse(&model_determinant, model);
+    XMStoreFloat3(&m_camera_position, XMVector3Transform(XMLoadFloat4(&camera_position), inverse_model));
+}
+
+bool MeshletCuller::IsVisible(const Meshlet& meshlet) const
+{
+    using namespace DirectX;
+
+    XMVECTOR center = XMLoadFloat3(&meshlet.center);
+    for (int i = 0; i < 6; ++i) {
+        if (XMVectorGetX(XMPlaneDotCoord(XMLoadFloat4(&m_planes[i]), center)) < -meshlet.radius)
+            return false;
+    }
+
+    if (m_cone_culling && meshlet.cone_cutoff < 1.0f) {
+        XMVECTOR view = XMVectorSubtract(center, XMLoadFloat3(&m_camera_position));
+        float distance = XMVectorGetX(XMVector3Length(view));
+        if (XMVectorGetX(XMVector3Dot(view, XMLoadFloat3(&meshlet.cone_axis))) >= meshlet.cone_cutoff * distance + meshlet.radius)
+            return false;
+    }
+    return true;
+}
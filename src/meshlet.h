@@ -0,0 +1,57 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "vertex.h"
+
+// Cluster of consecutive triangles in the mesh index buffer, used to cull parts of a mesh
+struct Meshlet {
+    uint32_t index_offset; // first index in the index buffer of the mesh
+    uint32_t index_count;
+    uint32_t vertex_count; // number of unique vertices referenced
+
+    // Bounding sphere in object space
+    DirectX::XMFLOAT3 center;
+    float radius;
+
+    // Backface cone, the meshlet is backfacing if dot(center - camera, cone_axis) >= cone_cutoff * length(center - camera) + radius
+    DirectX::XMFLOAT3 cone_axis;
+    float cone_cutoff; // sine of the cone half angle, 1 if the normals are spread too much to cull
+};
+
+class MeshletBuilder {
+public:
+    static constexpr unsigned int s_max_vertices = 64;
+    static constexpr unsigned int s_max_triangles = 124;
+
+    // Split the index buffer into meshlets of consecutive triangles, the triangle order (e.g. from Tipsify) is kept
+    static std::vector<Meshlet> Build(std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+        unsigned int max_vertices = s_max_vertices, unsigned int max_triangles = s_max_triangles);
+
+    // Check that every triangle lands in exactly one meshlet and the limits are respected
+    static bool Validate(std::span<const Meshlet> meshlets, std::span<const uint32_t> indices,
+        unsigned int max_vertices = s_max_vertices, unsigned int max_triangles = s_max_triangles);
+
+private:
+    static Meshlet ComputeBounds(std::span<const Vertex> vertices, std::span<const uint32_t> indices, const std::vector<uint32_t>& meshlet_vertices,
+        uint32_t index_offset, uint32_t index_count);
+};
+
+// CPU reference for meshlet frustum and backface cone culling of a single scene item
+// The frustum and camera are transformed into object space so the meshlet bounds can be used as is
+class MeshletCuller {
+private:
+    DirectX::XMFLOAT4 m_planes[6];
+    DirectX::XMFLOAT3 m_camera_position;
+    bool m_cone_culling;
+
+public:
+    // Cone culling is only used with a uniform scale since non-uniform scaling does not preserve the normal cone
+    MeshletCuller(const DirectX::XMMATRIX& model, const DirectX::XMMATRIX& view_projection, const DirectX::XMFLOAT4& camera_position, bool uniform_scale);
+
+    bool IsVisible(const Meshlet& meshlet) const;
+};
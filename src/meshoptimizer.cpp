@@ -0,0 +1,206 @@
+#include "meshoptimizer.h"
+
+#include <algorithm>
+
+#include "vertex.h"
+
+
+// Declare the used vertex types to avoid Linker errors
+template void MeshOptimizer::OptimizeVertexFetch<Vertex>(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, size_t num_vertices, unsigned int cache_size)
+{
+    size_t num_triangles = indices.size() / 3;
+    if (num_triangles == 0)
+        return;
+
+    // Vertex -> triangle adjacency, live_count is the number of triangles of a vertex that are not emitted yet
+    std::vector<uint32_t> live_count(num_vertices, 0);
+    for (uint32_t index : indices)
+        live_count[index]++;
+
+    std::vector<uint32_t> adjacency_offsets(num_vertices + 1, 0);
+    for (size_t v = 0; v < num_vertices; ++v)
+        adjacency_offsets[v + 1] = adjacency_offsets[v] + live_count[v];
+
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill_offsets(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); ++i)
+        adjacency[fill_offsets[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+    // A vertex is in the cache if less than cache_size vertices were added after it
+    std::vector<uint32_t> cache_time(num_vertices, 0);
+    uint32_t time = cache_size + 1;
+
+    std::vector<bool> emitted(num_triangles, false);
+    std::vector<uint32_t> dead_end_stack;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+
+    size_t cursor = 0;
+    int64_t fanning_vertex = 0;
+    while (fanning_vertex >= 0) {
+        candidates.clear();
+
+        // Emit all remaining triangles around the fanning vertex
+        for (uint32_t a = adjacency_offsets[fanning_vertex]; a < adjacency_offsets[fanning_vertex + 1]; ++a) {
+            uint32_t triangle = adjacency[a];
+            if (emitted[triangle])
+                continue;
+
+            for (size_t c = 0; c < 3; ++c) {
+                uint32_t v = indices[3 * triangle + c];
+                output.push_back(v);
+                dead_end_stack.push_back(v);
+                candidates.push_back(v);
+                live_count[v]--;
+                if (time - cache_time[v] > cache_size)
+                    cache_time[v] = time++;
+            }
+            emitted[triangle] = true;
+        }
+
+        // Next fanning vertex is the oldest candidate that still stays in the cache while its triangles are emitted
+        fanning_vertex = -1;
+        uint32_t best_priority = 0;
+        for (uint32_t v : candidates) {
+            if (live_count[v] == 0)
+                continue;
+            uint32_t priority = 0;
+            if (time - cache_time[v] + 2 * live_count[v] <= cache_size)
+                priority = time - cache_time[v];
+            if (fanning_vertex < 0 || priority > best_priority) {
+                best_priority = priority;
+                fanning_vertex = v;
+            }
+        }
+
+        // Dead end, use a recently referenced vertex or else the next vertex in input order
+        while (fanning_vertex < 0 && !dead_end_stack.empty()) {
+            uint32_t v = dead_end_stack.back();
+            dead_end_stack.pop_back();
+            if (live_count[v] > 0)
+                fanning_vertex = v;
+        }
+        while (fanning_vertex < 0 && cursor < num_vertices) {
+            if (live_count[cursor] > 0)
+                fanning_vertex = static_cast<int64_t>(cursor);
+            ++cursor;
+        }
+    }
+
+    indices.swap(output);
+}
+
+MeshOptimizer::VertexCacheStats MeshOptimizer::AnalyzeVertexCache(std::span<const uint32_t> indices, size_t num_vertices, unsigned int cache_size)
+{
+    VertexCacheStats stats{};
+    if (indices.size() < 3)
+        return stats;
+
+    // FIFO cache, a vertex is still cached if less than cache_size misses happened after it was added
+    std::vector<uint32_t> cache_time(num_vertices, 0);
+    std::vector<bool> referenced(num_vertices, false);
+    uint32_t time = cache_size + 1;
+    size_t num_misses = 0;
+    size_t num_referenced = 0;
+    for (uint32_t v : indices) {
+        if (time - cache_time[v] > cache_size) {
+            cache_time[v] = time++;
+            num_misses++;
+        }
+        if (!referenced[v]) {
+            referenced[v] = true;
+            num_referenced++;
+        }
+    }
+
+    stats.acmr = static_cast<float>(num_misses) / static_cast<float>(indices.size() / 3);
+    stats.atvr = static_cast<float>(num_misses) / static_cast<float>(num_referenced);
+    return stats;
+}
+
+template <class T>
+void MeshOptimizer::OptimizeVertexFetch(std::vector<T>& vertices, std::vector<uint32_t>& indices)
+{
+    constexpr uint32_t unused = UINT32_MAX;
+    std::vector<uint32_t> remap(vertices.size(), unused);
+
+    // Number the vertices in order of first use
+    uint32_t next_vertex = 0;
+    for (uint32_t& index : indices) {
+        if (remap[index] == unused)
+            remap[index] = next_vertex++;
+        index = remap[index];
+    }
+
+    std::vector<T> remapped_vertices(vertices.size());
+    for (size_t v = 0; v < vertices.size(); ++v) {
+        if (remap[v] == unused)
+            remap[v] = next_vertex++;
+        remapped_vertices[remap[v]] = vertices[v];
+    }
+
+    vertices.swap(remapped_vertices);
+}
+
+MeshOptimizer::VertexFetchStats MeshOptimizer::AnalyzeVertexFetch(std::span<const uint32_t> indices, size_t num_vertices, size_t vertex_size,
+    size_t cache_line_size, size_t cache_size)
+{
+    VertexFetchStats stats{};
+    if (indices.size() < 3 || num_vertices == 0)
+        return stats;
+
+    // A line is still cached if less than num_cache_lines misses happened after it was fetched
+    size_t num_cache_lines = cache_size / cache_line_size;
+    size_t num_lines = (num_vertices * vertex_size + cache_line_size - 1) / cache_line_size;
+    std::vector<size_t> cache_time(num_lines, 0);
+    size_t time = num_cache_lines + 1;
+    size_t bytes_fetched = 0;
+    for (uint32_t v : indices) {
+        size_t first_line = v * vertex_size / cache_line_size;
+        size_t last_line = ((v + 1) * vertex_size - 1) / cache_line_size;
+        for (size_t line = first_line; line <= last_line; ++line) {
+            if (time - cache_time[line] > num_cache_lines) {
+                cache_time[line] = time++;
+                bytes_fetched += cache_line_size;
+            }
+        }
+    }
+
+    stats.bytes_per_triangle = static_cast<float>(bytes_fetched) / static_cast<float>(indices.size() / 3);
+    stats.overfetch = static_cast<float>(bytes_fetched) / static_cast<float>(num_vertices * vertex_size);
+    return stats;
+}
+
+std::vector<MeshOptimizer::IndexRange> MeshOptimizer::SplitIndexRanges(std::span<const uint32_t> indices, size_t max_vertices)
+{
+    std::vector<IndexRange> ranges;
+    uint32_t range_min = UINT32_MAX;
+    uint32_t range_max = 0;
+    uint32_t range_start = 0;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        uint32_t triangle_min = std::min(indices[i], std::min(indices[i + 1], indices[i + 2]));
+        uint32_t triangle_max = std::max(indices[i], std::max(indices[i + 1], indices[i + 2]));
+        if (triangle_max - triangle_min >= max_vertices)
+            return {};
+
+        // Start a new range when the triangle does not fit in the current one
+        uint32_t new_min = std::min(range_min, triangle_min);
+        uint32_t new_max = std::max(range_max, triangle_max);
+        if (i > range_start && new_max - new_min >= max_vertices) {
+            ranges.push_back({ range_start, static_cast<uint32_t>(i) - range_start, range_min });
+            range_start = static_cast<uint32_t>(i);
+            new_min = triangle_min;
+            new_max = triangle_max;
+        }
+        range_min = new_min;
+        range_max = new_max;
+    }
+
+    if (indices.size() > range_start)
+        ranges.push_back({ range_start, static_cast<uint32_t>(indices.size()) - range_start, range_min });
+    return ranges;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Index buffer optimizations run on the CPU before a mesh is uploaded
+class MeshOptimizer {
+public:
+    // Post-transform vertex cache statistics of a FIFO cache simulation
+    struct VertexCacheStats {
+        float acmr; // average cache miss ratio, vertex shader invocations per triangle (0.5 - 3.0)
+        float atvr; // average transform to vertex ratio, vertex shader invocations per referenced vertex (1.0 is optimal)
+    };
+
+    // Vertex buffer memory statistics of a simulated cache
+    struct VertexFetchStats {
+        float bytes_per_triangle; // bytes fetched from the vertex buffer per triangle
+        float overfetch; // bytes fetched / vertex buffer size (1.0 is optimal)
+    };
+
+    // Triangles of the index buffer whose vertices lie within 64k of base_vertex, drawn with the base vertex so 16 bit indices can be used
+    struct IndexRange {
+        uint32_t index_offset;
+        uint32_t index_count;
+        uint32_t base_vertex;
+    };
+
+    // Reorder the triangles for the post-transform vertex cache with Tipsify
+    // Sander et al. 2007, Fast Triangle Reordering for Vertex Locality and Reduced Overdraw
+    static void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t num_vertices, unsigned int cache_size = 16);
+
+    static VertexCacheStats AnalyzeVertexCache(std::span<const uint32_t> indices, size_t num_vertices, unsigned int cache_size = 16);
+
+    // Renumber the vertices in order of first use by the index buffer and remap the indices, run after OptimizeVertexCache
+    // Unreferenced vertices are moved to the end
+    template <class T>
+    static void OptimizeVertexFetch(std::vector<T>& vertices, std::vector<uint32_t>& indices);
+
+    // Simulates a fully associative FIFO cache of cache_size bytes with cache_line_size lines
+    static VertexFetchStats AnalyzeVertexFetch(std::span<const uint32_t> indices, size_t num_vertices, size_t vertex_size,
+        size_t cache_line_size = 64, size_t cache_size = 16 * 1024);
+
+    // Split the index buffer in file order into ranges spanning at most max_vertices vertices
+    // Returns no ranges if a single triangle spans more vertices
+    static std::vector<IndexRange> SplitIndexRanges(std::span<const uint32_t> indices, size_t max_vertices = 65536);
+};
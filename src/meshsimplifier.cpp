@@ -0,0 +1,370 @@
+#include "meshsimplifier.h"
+
+#include <DirectXMath.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+
+std::vector<uint32_t> MeshSimplifier::Simplify(std::span<const Vertex> vertices, std::span<const uint32_t> indices, size_t target_index_count,
+    float target_error, float& result_error)
+{
+    using namespace DirectX;
+
+    std::vector<uint32_t> result(indices.begin(), indices.begin() + indices.size() / 3 * 3);
+    result_error = 0.0f;
+    if (result.size() <= target_index_count)
+        return result;
+
+    std::vector<char> locked;
+    ComputeLockedVertices(vertices, result, locked);
+
+    // Vertex quadrics from the planes of the source triangles
+    std::vector<Quadric> quadrics(vertices.size(), Quadric{});
+    for (size_t i = 0; i < result.size(); i += 3) {
+        XMVECTOR a = XMLoadFloat3(&vertices[result[i]].position);
+        XMVECTOR b = XMLoadFloat3(&vertices[result[i + 1]].position);
+        XMVECTOR c = XMLoadFloat3(&vertices[result[i + 2]].position);
+        XMVECTOR normal = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+        float length = XMVectorGetX(XMVector3Length(normal));
+        if (length == 0.0f)
+            continue;
+
+        XMFLOAT3 n;
+        XMStoreFloat3(&n, XMVectorScale(normal, 1.0f / length));
+        XMFLOAT3 p;
+        XMStoreFloat3(&p, a);
+        double d = -(double(n.x) * p.x + double(n.y) * p.y + double(n.z) * p.z);
+        double area = 0.5 * length;
+
+        Quadric quadric{ n.x * n.x * area, n.y * n.y * area, n.z * n.z * area, d * d * area,
+            n.x * n.y * area, n.x * n.z * area, n.x * d * area,
+            n.y * n.z * area, n.y * d * area, n.z * d * area, area };
+        for (size_t c = 0; c < 3; ++c)
+            AddQuadric(quadrics[result[i + c]], quadric);
+    }
+
+    // The quadric cost only orders the collapses and stops them at the target error, the error of the result is measured
+    float max_error = target_error * target_error;
+    std::vector<uint32_t> adjacency_offsets;
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> collapse_target(vertices.size());
+    std::vector<char> touched(vertices.size());
+
+    // Vertex each source vertex has been collapsed into
+    std::vector<uint32_t> remap(vertices.size());
+    for (size_t v = 0; v < vertices.size(); ++v)
+        remap[v] = static_cast<uint32_t>(v);
+
+    // Each pass collapses the cheapest edges that do not share vertices, until the target is reached or nothing can be collapsed
+    while (result.size() > target_index_count) {
+        BuildAdjacency(vertices.size(), result, adjacency_offsets, adjacency);
+
+        // Candidate collapses along the triangle edges in both directions
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (size_t e = 0; e < 3; ++e) {
+                uint32_t v0 = result[i + e];
+                uint32_t v1 = result[i + (e + 1) % 3];
+                for (int direction = 0; direction < 2; ++direction) {
+                    uint32_t from = direction == 0 ? v0 : v1;
+                    uint32_t to = direction == 0 ? v1 : v0;
+                    if (locked[from])
+                        continue;
+
+                    Quadric quadric = quadrics[from];
+                    AddQuadric(quadric, quadrics[to]);
+                    float error = EvaluateQuadric(quadric, vertices[to].position);
+                    if (error <= max_error)
+                        collapses.push_back({ from, to, error });
+                }
+            }
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+        std::fill(touched.begin(), touched.end(), 0);
+        for (size_t v = 0; v < vertices.size(); ++v)
+            collapse_target[v] = static_cast<uint32_t>(v);
+
+        size_t num_triangles = result.size() / 3;
+        size_t target_triangles = target_index_count / 3;
+        size_t num_collapses = 0;
+        for (const Collapse& collapse : collapses) {
+            if (num_triangles <= target_triangles)
+                break;
+            if (touched[collapse.from] || touched[collapse.to])
+                continue;
+            if (FlipsTriangle(vertices, result, adjacency_offsets, adjacency, collapse.from, collapse.to))
+                continue;
+
+            // The triangles around the collapsed vertex change, so their vertices can not be used again in this pass
+            for (uint32_t a = adjacency_offsets[collapse.from]; a < adjacency_offsets[collapse.from + 1]; ++a) {
+                uint32_t triangle = adjacency[a];
+                bool has_to = false;
+                for (size_t c = 0; c < 3; ++c) {
+                    touched[result[3 * triangle + c]] = 1;
+                    has_to |= result[3 * triangle + c] == collapse.to;
+                }
+                if (has_to)
+                    num_triangles--;
+            }
+
+            collapse_target[collapse.from] = collapse.to;
+            AddQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+            num_collapses++;
+        }
+
+        if (num_collapses == 0)
+            break;
+
+        // A collapse target is not collapsed itself in the same pass
+        for (uint32_t& target : remap)
+            target = collapse_target[target];
+
+        // Remap the indices and remove the collapsed triangles
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            uint32_t a = collapse_target[result[i]];
+            uint32_t b = collapse_target[result[i + 1]];
+            uint32_t c = collapse_target[result[i + 2]];
+            if (a == b || b == c || c == a)
+                continue;
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+    }
+
+    result_error = MeasureError(vertices, std::span<const uint32_t>(indices).first(indices.size() / 3 * 3), result, remap);
+    return result;
+}
+
+float MeshSimplifier::MeasureError(std::span<const Vertex> vertices, std::span<const uint32_t> source_indices, std::span<const uint32_t> indices,
+    const std::vector<uint32_t>& remap)
+{
+    std::vector<uint32_t> adjacency_offsets;
+    std::vector<uint32_t> adjacency;
+    BuildAdjacency(vertices.size(), indices, adjacency_offsets, adjacency);
+
+    // The nearest point of the simplified surface can only be closer than the triangles searched, so every sample is an upper bound.
+    // Only samples which would raise the maximum search the rings of simplified triangles further out
+    float max_distance_sq = 0.0f;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> ring_vertices;
+    for (size_t i = 0; i < source_indices.size(); i += 3) {
+        const DirectX::XMFLOAT3& a = vertices[source_indices[i]].position;
+        const DirectX::XMFLOAT3& b = vertices[source_indices[i + 1]].position;
+        const DirectX::XMFLOAT3& c = vertices[source_indices[i + 2]].position;
+        const DirectX::XMFLOAT3 samples[4] = { a, b, c, DirectX::XMFLOAT3((a.x + b.x + c.x) / 3.0f, (a.y + b.y + c.y) / 3.0f, (a.z + b.z + c.z) / 3.0f) };
+
+        // Simplified triangles around the vertices the source triangle collapsed into
+        ring_vertices.clear();
+        for (size_t corner = 0; corner < 3; ++corner)
+            ring_vertices.push_back(remap[source_indices[i + corner]]);
+
+        float distances_sq[4] = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
+        for (uint32_t ring = 0; ring < s_max_error_rings; ++ring) {
+            candidates.clear();
+            for (uint32_t v : ring_vertices)
+                candidates.insert(candidates.end(), adjacency.begin() + adjacency_offsets[v], adjacency.begin() + adjacency_offsets[v + 1]);
+            std::sort(candidates.begin(), candidates.end());
+            candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+            // Parts which collapsed away entirely are measured against the points they collapsed into
+            if (candidates.empty()) {
+                for (size_t s = 0; s < 4; ++s) {
+                    for (uint32_t v : ring_vertices)
+                        distances_sq[s] = std::min(distances_sq[s], PointTriangleDistanceSq(samples[s], vertices[v].position, vertices[v].position, vertices[v].position));
+                }
+                break;
+            }
+
+            bool refine = false;
+            for (size_t s = 0; s < 4; ++s) {
+                if (distances_sq[s] <= max_distance_sq)
+                    continue;
+                for (uint32_t triangle : candidates) {
+                    distances_sq[s] = std::min(distances_sq[s], PointTriangleDistanceSq(samples[s], vertices[indices[3 * size_t(triangle)]].position,
+                        vertices[indices[3 * size_t(triangle) + 1]].position, vertices[indices[3 * size_t(triangle) + 2]].position));
+                }
+                refine |= distances_sq[s] > max_distance_sq;
+            }
+            if (!refine)
+                break;
+
+            ring_vertices.clear();
+            for (uint32_t triangle : candidates)
+                ring_vertices.insert(ring_vertices.end(), indices.begin() + 3 * size_t(triangle), indices.begin() + 3 * size_t(triangle) + 3);
+        }
+
+        for (float distance_sq : distances_sq)
+            max_distance_sq = std::max(max_distance_sq, distance_sq);
+    }
+    return std::sqrt(max_distance_sq);
+}
+
+void MeshSimplifier::BuildAdjacency(size_t num_vertices, std::span<const uint32_t> indices, std::vector<uint32_t>& offsets, std::vector<uint32_t>& adjacency)
+{
+    offsets.assign(num_vertices + 1, 0);
+    for (uint32_t index : indices)
+        offsets[index + 1]++;
+    for (size_t v = 0; v < num_vertices; ++v)
+        offsets[v + 1] += offsets[v];
+
+    adjacency.resize(indices.size());
+    std::vector<uint32_t> fill_offsets(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); ++i)
+        adjacency[fill_offsets[indices[i]]++] = static_cast<uint32_t>(i / 3);
+}
+
+float MeshSimplifier::PointTriangleDistanceSq(const DirectX::XMFLOAT3& point, const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b, const DirectX::XMFLOAT3& c)
+{
+    using namespace DirectX;
+
+    // Closest point by the Voronoi regions of the triangle (Ericson, Real-Time Collision Detection 5.1.5)
+    XMVECTOR p = XMLoadFloat3(&point);
+    XMVECTOR va = XMLoadFloat3(&a);
+    XMVECTOR vb = XMLoadFloat3(&b);
+    XMVECTOR vc = XMLoadFloat3(&c);
+    XMVECTOR ab = XMVectorSubtract(vb, va);
+    XMVECTOR ac = XMVectorSubtract(vc, va);
+    auto distance_sq = [&p](const XMVECTOR& closest) { return XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(p, closest))); };
+
+    XMVECTOR ap = XMVectorSubtract(p, va);
+    float d1 = XMVectorGetX(XMVector3Dot(ab, ap));
+    float d2 = XMVectorGetX(XMVector3Dot(ac, ap));
+    if (d1 <= 0.0f && d2 <= 0.0f)
+        return distance_sq(va);
+
+    XMVECTOR bp = XMVectorSubtract(p, vb);
+    float d3 = XMVectorGetX(XMVector3Dot(ab, bp));
+    float d4 = XMVectorGetX(XMVector3Dot(ac, bp));
+    if (d3 >= 0.0f && d4 <= d3)
+        return distance_sq(vb);
+
+    float vc_area = d1 * d4 - d3 * d2;
+    if (vc_area <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+        return distance_sq(XMVectorAdd(va, XMVectorScale(ab, d1 / (d1 - d3))));
+
+    XMVECTOR cp = XMVectorSubtract(p, vc);
+    float d5 = XMVectorGetX(XMVector3Dot(ab, cp));
+    float d6 = XMVectorGetX(XMVector3Dot(ac, cp));
+    if (d6 >= 0.0f && d5 <= d6)
+        return distance_sq(vc);
+
+    float vb_area = d5 * d2 - d1 * d6;
+    if (vb_area <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+        return distance_sq(XMVectorAdd(va, XMVectorScale(ac, d2 / (d2 - d6))));
+
+    float va_area = d3 * d6 - d5 * d4;
+    if (va_area <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+        return distance_sq(XMVectorAdd(vb, XMVectorScale(XMVectorSubtract(vc, vb), (d4 - d3) / ((d4 - d3) + (d5 - d6)))));
+
+    // Degenerate triangles end up in one of the regions above, so the denominator is not 0 here
+    float denominator = 1.0f / (va_area + vb_area + vc_area);
+    return distance_sq(XMVectorAdd(va, XMVectorAdd(XMVectorScale(ab, vb_area * denominator), XMVectorScale(ac, vc_area * denominator))));
+}
+
+void MeshSimplifier::ComputeLockedVertices(std::span<const Vertex> vertices, std::span<const uint32_t> indices, std::vector<char>& locked)
+{
+    locked.assign(vertices.size(), 0);
+
+    // Border edges are only used by a single triangle
+    std::vector<uint64_t> edges;
+    edges.reserve(indices.size());
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        for (size_t e = 0; e < 3; ++e) {
+            uint64_t v0 = indices[i + e];
+            uint64_t v1 = indices[i + (e + 1) % 3];
+            edges.push_back(v0 < v1 ? (v0 << 32) | v1 : (v1 << 32) | v0);
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0; i < edges.size();) {
+        size_t j = i + 1;
+        while (j < edges.size() && edges[j] == edges[i])
+            ++j;
+        if (j - i == 1) {
+            locked[edges[i] >> 32] = 1;
+            locked[edges[i] & UINT32_MAX] = 1;
+        }
+        i = j;
+    }
+
+    // Seams where the welding split a position into multiple vertices
+    std::vector<uint32_t> order(vertices.size());
+    for (size_t v = 0; v < vertices.size(); ++v)
+        order[v] = static_cast<uint32_t>(v);
+    auto position_less = [&vertices](uint32_t a, uint32_t b) {
+        return memcmp(&vertices[a].position, &vertices[b].position, sizeof(DirectX::XMFLOAT3)) < 0;
+    };
+    std::sort(order.begin(), order.end(), position_less);
+    for (size_t i = 0; i < order.size();) {
+        size_t j = i + 1;
+        while (j < order.size() && !position_less(order[i], order[j]))
+            ++j;
+        if (j - i > 1) {
+            for (size_t k = i; k < j; ++k)
+                locked[order[k]] = 1;
+        }
+        i = j;
+    }
+}
+
+void MeshSimplifier::AddQuadric(Quadric& quadric, const Quadric& other)
+{
+    quadric.a2 += other.a2;
+    quadric.b2 += other.b2;
+    quadric.c2 += other.c2;
+    quadric.d2 += other.d2;
+    quadric.ab += other.ab;
+    quadric.ac += other.ac;
+    quadric.ad += other.ad;
+    quadric.bc += other.bc;
+    quadric.bd += other.bd;
+    quadric.cd += other.cd;
+    quadric.weight += other.weight;
+}
+
+float MeshSimplifier::EvaluateQuadric(const Quadric& quadric, const DirectX::XMFLOAT3& position)
+{
+    double x = position.x, y = position.y, z = position.z;
+    double error = quadric.a2 * x * x + quadric.b2 * y * y + quadric.c2 * z * z + quadric.d2
+        + 2.0 * (quadric.ab * x * y + quadric.ac * x * z + quadric.bc * y * z + quadric.ad * x + quadric.bd * y + quadric.cd * z);
+
+    // Weighted mean of the squared plane distances
+    if (quadric.weight > 0.0)
+        error /= quadric.weight;
+    return static_cast<float>(std::max(error, 0.0));
+}
+
+bool MeshSimplifier::FlipsTriangle(std::span<const Vertex> vertices, std::span<const uint32_t> indices, const std::vector<uint32_t>& adjacency_offsets,
+    const std::vector<uint32_t>& adjacency, uint32_t from, uint32_t to)
+{
+    using namespace DirectX;
+
+    XMVECTOR to_position = XMLoadFloat3(&vertices[to].position);
+    for (uint32_t a = adjacency_offsets[from]; a < adjacency_offsets[from + 1]; ++a) {
+        const uint32_t* triangle = &indices[3 * size_t(adjacency[a])];
+        if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+            continue;
+
+        XMVECTOR positions[3];
+        XMVECTOR collapsed[3];
+        for (size_t c = 0; c < 3; ++c) {
+            positions[c] = XMLoadFloat3(&vertices[triangle[c]].position);
+            collapsed[c] = triangle[c] == from ? to_position : positions[c];
+        }
+
+        XMVECTOR normal = XMVector3Cross(XMVectorSubtract(positions[1], positions[0]), XMVectorSubtract(positions[2], positions[0]));
+        XMVECTOR collapsed_normal = XMVector3Cross(XMVectorSubtract(collapsed[1], collapsed[0]), XMVectorSubtract(collapsed[2], collapsed[0]));
+        if (XMVectorGetX(XMVector3Dot(normal, collapsed_normal)) <= 0.0f)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "vertex.h"
+
+// Level of detail range in the index buffer of a mesh, level 0 is the full resolution mesh
+struct MeshLod {
+    uint32_t index_offset;
+    uint32_t index_count;
+    float error; // object space simplification error
+};
+
+// Quadric edge collapse simplification (Garland and Heckbert 1997)
+// Vertices are collapsed onto existing vertices, so a simplified index buffer can share the vertex buffer of the source mesh
+class MeshSimplifier {
+private:
+    // Area weighted sum of the squared distances to the triangle planes around a vertex
+    struct Quadric {
+        double a2, b2, c2, d2;
+        double ab, ac, ad;
+        double bc, bd, cd;
+        double weight;
+    };
+
+    struct Collapse {
+        uint32_t from;
+        uint32_t to;
+        float error;
+    };
+
+public:
+    // Stops at target_index_count or when the quadric error of the next collapse, the weighted RMS distance to the planes of the
+    // source triangles it merges, would exceed target_error. Border vertices and seams (vertices sharing a position with
+    // different normals/uvs) are locked
+    // result_error is the measured object space distance from the source surface to the simplified one, see MeasureError()
+    static std::vector<uint32_t> Simplify(std::span<const Vertex> vertices, std::span<const uint32_t> indices, size_t target_index_count,
+        float target_error, float& result_error);
+
+    // Upper bound of the one-sided distance from the source triangles to the simplified triangles, sampled at the corners and
+    // centroids of the source triangles. Each sample is measured against the simplified triangles around the vertices the
+    // corners of its triangle were collapsed into (remap) and up to s_max_error_rings - 1 rings around them, the nearest point
+    // of the whole simplified surface is no further away
+    static float MeasureError(std::span<const Vertex> vertices, std::span<const uint32_t> source_indices, std::span<const uint32_t> indices,
+        const std::vector<uint32_t>& remap);
+
+    static float PointTriangleDistanceSq(const DirectX::XMFLOAT3& point, const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b, const DirectX::XMFLOAT3& c);
+
+private:
+    static constexpr uint32_t s_max_error_rings = 3;
+
+    // Vertex -> triangle adjacency in compressed rows
+    static void BuildAdjacency(size_t num_vertices, std::span<const uint32_t> indices, std::vector<uint32_t>& offsets, std::vector<uint32_t>& adjacency);
+    static void ComputeLockedVertices(std::span<const Vertex> vertices, std::span<const uint32_t> indices, std::vector<char>& locked);
+    static void AddQuadric(Quadric& quadric, const Quadric& other);
+    static float EvaluateQuadric(const Quadric& quadric, const DirectX::XMFLOAT3& position);
+    static bool FlipsTriangle(std::span<const Vertex> vertices, std::span<const uint32_t> indices, const std::vector<uint32_t>& adjacency_offsets,
+        const std::vector<uint32_t>& adjacency, uint32_t from, uint32_t to);
+};
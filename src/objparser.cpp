@@ -0,0 +1,334 @@
+#include "objparser.h"
+
+// The float parsing of tinyobjloader is used to get identical results, so its implementation is compiled here
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <thread>
+
+#include "utility.h"
+#include "mappedfile.h"
+#include "jobsystem.h"
+
+
+unsigned int ObjParser::s_num_threads = 0;
+
+unsigned int ObjParser::GetNumThreads()
+{
+    if (s_num_threads > 0)
+        return s_num_threads;
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+bool ObjParser::Parse(const std::filesystem::path& file_path, Result& result, unsigned int num_threads)
+{
+    MappedFile file(file_path);
+    const char* data = reinterpret_cast<const char*>(file.GetData());
+    size_t size = file.GetSize();
+
+    // Chunks of at least 1MB, small files are not worth the scheduling
+    if (num_threads == 0)
+        num_threads = GetNumThreads();
+    constexpr size_t min_chunk_size = 1 << 20;
+    size_t num_chunks = std::clamp<size_t>(size / min_chunk_size, 1, num_threads);
+
+    // Split at line boundaries
+    std::vector<Chunk> chunks(num_chunks);
+    const char* chunk_begin = data;
+    for (size_t i = 0; i < num_chunks; ++i) {
+        const char* chunk_end = data + size;
+        if (i + 1 < num_chunks) {
+            chunk_end = std::max(chunk_begin, data + size / num_chunks * (i + 1));
+            const char* newline = static_cast<const char*>(memchr(chunk_end, '\n', data + size - chunk_end));
+            chunk_end = newline ? newline + 1 : data + size;
+        }
+        chunks[i].begin = chunk_begin;
+        chunks[i].end = chunk_end;
+        chunk_begin = chunk_end;
+    }
+
+    // Parse the chunks in parallel, the calling thread takes the first chunk
+    JobSystem* job_system = JobSystem::Get();
+    job_system->ParallelFor(0, num_chunks, 1, [&chunks](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            ParseChunk(chunks[i]);
+    });
+
+    if (std::any_of(chunks.begin(), chunks.end(), [](const Chunk& chunk) { return !chunk.supported; }))
+        return false;
+
+    // Offsets of each chunk in the merged arrays
+    std::vector<size_t> vertex_offsets(num_chunks + 1, 0);
+    std::vector<size_t> normal_offsets(num_chunks + 1, 0);
+    std::vector<size_t> texcoord_offsets(num_chunks + 1, 0);
+    std::vector<size_t> index_offsets(num_chunks + 1, 0);
+    for (size_t i = 0; i < num_chunks; ++i) {
+        vertex_offsets[i + 1] = vertex_offsets[i] + chunks[i].vertices.size();
+        normal_offsets[i + 1] = normal_offsets[i] + chunks[i].normals.size();
+        texcoord_offsets[i + 1] = texcoord_offsets[i] + chunks[i].texcoords.size();
+        index_offsets[i + 1] = index_offsets[i] + chunks[i].indices.size();
+    }
+
+    result.num_threads = static_cast<unsigned int>(num_chunks);
+    result.attrib = tinyobj::attrib_t();
+    result.attrib.vertices.resize(vertex_offsets[num_chunks]);
+    result.attrib.normals.resize(normal_offsets[num_chunks]);
+    result.attrib.texcoords.resize(texcoord_offsets[num_chunks]);
+    result.indices.resize(index_offsets[num_chunks]);
+    result.material_libs.clear();
+    for (Chunk& chunk : chunks)
+        result.material_libs.insert(result.material_libs.end(), chunk.material_libs.begin(), chunk.material_libs.end());
+
+    // Copy into the merged arrays in file order and resolve the relative indices
+    int32_t num_vertices = static_cast<int32_t>(vertex_offsets[num_chunks] / 3);
+    int32_t num_normals = static_cast<int32_t>(normal_offsets[num_chunks] / 3);
+    int32_t num_texcoords = static_cast<int32_t>(texcoord_offsets[num_chunks] / 2);
+    std::vector<char> valid(num_chunks, 1);
+    auto merge_chunk = [&](size_t i) {
+        Chunk& chunk = chunks[i];
+        std::copy(chunk.vertices.begin(), chunk.vertices.end(), result.attrib.vertices.begin() + vertex_offsets[i]);
+        std::copy(chunk.normals.begin(), chunk.normals.end(), result.attrib.normals.begin() + normal_offsets[i]);
+        std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), result.attrib.texcoords.begin() + texcoord_offsets[i]);
+
+        tinyobj::index_t* indices = result.indices.data() + index_offsets[i];
+        std::copy(chunk.indices.begin(), chunk.indices.end(), indices);
+        for (const Fixup& fixup : chunk.fixups) {
+            tinyobj::index_t& idx = indices[fixup.corner];
+            if (fixup.components & s_fix_vertex)
+                idx.vertex_index += static_cast<int32_t>(vertex_offsets[i] / 3);
+            if (fixup.components & s_fix_normal)
+                idx.normal_index += static_cast<int32_t>(normal_offsets[i] / 3);
+            if (fixup.components & s_fix_texcoord)
+                idx.texcoord_index += static_cast<int32_t>(texcoord_offsets[i] / 2);
+            if (idx.vertex_index < 0 || ((fixup.components & s_fix_normal) && idx.normal_index < 0) || ((fixup.components & s_fix_texcoord) && idx.texcoord_index < 0))
+                valid[i] = 0;
+        }
+
+        // Absolute indices can point anywhere in the file, so they are only checked against the merged counts
+        for (size_t corner = 0; corner < chunk.indices.size(); ++corner) {
+            const tinyobj::index_t& idx = indices[corner];
+            if (idx.vertex_index >= num_vertices || idx.normal_index >= num_normals || idx.texcoord_index >= num_texcoords)
+                valid[i] = 0;
+        }
+    };
+
+    job_system->ParallelFor(0, num_chunks, 1, [&merge_chunk](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            merge_chunk(i);
+    });
+
+    return std::all_of(valid.begin(), valid.end(), [](char v) { return v != 0; });
+}
+
+void ObjParser::LoadMaterials(const Result& result, const std::string& mtl_search_path, std::vector<tinyobj::material_t>& materials)
+{
+    tinyobj::MaterialFileReader material_reader(mtl_search_path);
+    std::map<std::string, int> material_map;
+    std::string warning, error;
+
+    // Every mtllib record loads the first of its file names that can be read
+    for (const std::string& material_lib : result.material_libs) {
+        for (const std::string& file_name : SplitString(material_lib, " ")) {
+            if (file_name.empty())
+                continue;
+            if (material_reader(file_name, &materials, &material_map, &warning, &error))
+                break;
+        }
+    }
+}
+
+void ObjParser::RunThreadScalingBenchmark(const std::filesystem::path& file_path)
+{
+    wchar_t buffer[500];
+    double file_size_mb = std::filesystem::file_size(file_path) / (1024.0 * 1024.0);
+    unsigned int max_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    // tinyobjloader is the reference for both the output and the timings
+    auto reference_start = std::chrono::high_resolution_clock::now();
+    tinyobj::ObjReader reader;
+    if (!reader.ParseFromFile(file_path.string())) {
+        swprintf_s(buffer, 500, L"ObjParser: tinyobjloader failed to parse %s, benchmark skipped\n", file_path.c_str());
+        OutputDebugString(buffer);
+        return;
+    }
+    std::chrono::duration<double> reference_time = std::chrono::high_resolution_clock::now() - reference_start;
+
+    std::vector<tinyobj::index_t> reference_indices;
+    for (const tinyobj::shape_t& shape : reader.GetShapes())
+        reference_indices.insert(reference_indices.end(), shape.mesh.indices.begin(), shape.mesh.indices.end());
+
+    swprintf_s(buffer, 500, L"ObjParser: tinyobjloader %f ms, %f MB/s\n", reference_time.count() * 1e3, file_size_mb / std::max(reference_time.count(), 1e-9));
+    OutputDebugString(buffer);
+
+    // Compared by their bytes, so e.g. -0 and 0 differ
+    auto same_bytes = []<typename T>(const std::vector<T>& a, const std::vector<T>& b) {
+        return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+    };
+    const tinyobj::attrib_t& reference = reader.GetAttrib();
+
+    double single_thread_time = 0.0;
+    for (unsigned int num_threads = 1; num_threads <= max_threads; ++num_threads) {
+        Result result;
+        auto start = std::chrono::high_resolution_clock::now();
+        bool supported = Parse(file_path, result, num_threads);
+        std::chrono::duration<double> parse_time = std::chrono::high_resolution_clock::now() - start;
+
+        if (!supported) {
+            swprintf_s(buffer, 500, L"ObjParser: %s contains unsupported records, benchmark skipped\n", file_path.c_str());
+            OutputDebugString(buffer);
+            return;
+        }
+        if (num_threads == 1)
+            single_thread_time = parse_time.count();
+
+        // Output has to be identical to tinyobjloader for any number of threads
+        bool identical = same_bytes(result.attrib.vertices, reference.vertices) && same_bytes(result.attrib.normals, reference.normals) &&
+            same_bytes(result.attrib.texcoords, reference.texcoords) &&
+            std::equal(result.indices.begin(), result.indices.end(), reference_indices.begin(), reference_indices.end(),
+                [](const tinyobj::index_t& a, const tinyobj::index_t& b) {
+                    return a.vertex_index == b.vertex_index && a.normal_index == b.normal_index && a.texcoord_index == b.texcoord_index;
+                });
+
+        swprintf_s(buffer, 500, L"ObjParser: %u threads, %f ms, %f MB/s, %fx speedup, %fx faster than tinyobjloader%s\n", num_threads, parse_time.count() * 1e3,
+            file_size_mb / std::max(parse_time.count(), 1e-9), single_thread_time / std::max(parse_time.count(), 1e-9),
+            reference_time.count() / std::max(parse_time.count(), 1e-9), identical ? L"" : L", OUTPUT DIFFERS FROM TINYOBJLOADER");
+        OutputDebugString(buffer);
+    }
+}
+
+void ObjParser::ParseChunk(Chunk& chunk)
+{
+    const char* ptr = chunk.begin;
+    while (ptr < chunk.end && chunk.supported) {
+        const char* line_end = static_cast<const char*>(memchr(ptr, '\n', chunk.end - ptr));
+        if (!line_end)
+            line_end = chunk.end;
+
+        while (ptr < line_end && (*ptr == ' ' || *ptr == '\t'))
+            ++ptr;
+
+        // Record keyword up to the first whitespace
+        const char* keyword = ptr;
+        while (ptr < line_end && *ptr != ' ' && *ptr != '\t' && *ptr != '\r')
+            ++ptr;
+        size_t keyword_length = ptr - keyword;
+
+        if (keyword_length == 1 && keyword[0] == 'v') {
+            chunk.vertices.push_back(ParseFloat(ptr, line_end));
+            chunk.vertices.push_back(ParseFloat(ptr, line_end));
+            chunk.vertices.push_back(ParseFloat(ptr, line_end));
+        }
+        else if (keyword_length == 2 && keyword[0] == 'v' && keyword[1] == 'n') {
+            chunk.normals.push_back(ParseFloat(ptr, line_end));
+            chunk.normals.push_back(ParseFloat(ptr, line_end));
+            chunk.normals.push_back(ParseFloat(ptr, line_end));
+        }
+        else if (keyword_length == 2 && keyword[0] == 'v' && keyword[1] == 't') {
+            chunk.texcoords.push_back(ParseFloat(ptr, line_end));
+            chunk.texcoords.push_back(ParseFloat(ptr, line_end));
+        }
+        else if (keyword_length == 1 && keyword[0] == 'f') {
+            if (!ParseFace(ptr, line_end, chunk))
+                chunk.supported = false;
+        }
+        else if (keyword_length == 6 && memcmp(keyword, "mtllib", 6) == 0) {
+            std::string material_lib(ptr, line_end);
+            ltrim(material_lib);
+            rtrim(material_lib);
+            chunk.material_libs.push_back(material_lib);
+        }
+        // Comments, groups, smoothing groups, usemtl, lines and points do not change the triangle list
+
+        ptr = line_end + 1;
+    }
+}
+
+bool ObjParser::ParseFace(const char*& ptr, const char* end, Chunk& chunk)
+{
+    int32_t num_vertices = static_cast<int32_t>(chunk.vertices.size() / 3);
+    int32_t num_normals = static_cast<int32_t>(chunk.normals.size() / 3);
+    int32_t num_texcoords = static_cast<int32_t>(chunk.texcoords.size() / 2);
+
+    size_t num_corners = 0;
+    while (true) {
+        while (ptr < end && (*ptr == ' ' || *ptr == '\t' || *ptr == '\r'))
+            ++ptr;
+        if (ptr >= end)
+            break;
+
+        // v, v/vt, v//vn or v/vt/vn
+        int32_t vertex = 0, texcoord = 0, normal = 0;
+        if (!ParseIndex(ptr, end, vertex))
+            return false;
+        if (ptr < end && *ptr == '/') {
+            ++ptr;
+            if (ptr < end && *ptr != '/' && !ParseIndex(ptr, end, texcoord))
+                return false;
+            if (ptr < end && *ptr == '/') {
+                ++ptr;
+                if (!ParseIndex(ptr, end, normal))
+                    return false;
+            }
+        }
+
+        // 0 is not a valid OBJ index, tinyobjloader rejects it as well
+        if (vertex == 0)
+            return false;
+
+        // Positive indices are absolute, negative indices are relative to the vertices parsed so far
+        // Relative indices are resolved against this chunk and get the chunk offset added when merging
+        uint8_t components = 0;
+        tinyobj::index_t idx;
+        idx.vertex_index = vertex > 0 ? vertex - 1 : num_vertices + vertex;
+        idx.normal_index = normal > 0 ? normal - 1 : (normal < 0 ? num_normals + normal : -1);
+        idx.texcoord_index = texcoord > 0 ? texcoord - 1 : (texcoord < 0 ? num_texcoords + texcoord : -1);
+        if (vertex < 0)
+            components |= s_fix_vertex;
+        if (normal < 0)
+            components |= s_fix_normal;
+        if (texcoord < 0)
+            components |= s_fix_texcoord;
+        if (components)
+            chunk.fixups.push_back({ CastToUint(chunk.indices.size()), components });
+
+        chunk.indices.push_back(idx);
+        ++num_corners;
+    }
+
+    // Polygons need triangulation, which is left to tinyobjloader
+    if (num_corners != 3) {
+        chunk.indices.resize(chunk.indices.size() - num_corners);
+        return false;
+    }
+    return true;
+}
+
+bool ObjParser::ParseIndex(const char*& ptr, const char* end, int32_t& index)
+{
+    std::from_chars_result result = std::from_chars(ptr, end, index);
+    if (result.ec != std::errc())
+        return false;
+    ptr = result.ptr;
+    return true;
+}
+
+float ObjParser::ParseFloat(const char*& ptr, const char* end)
+{
+    while (ptr < end && (*ptr == ' ' || *ptr == '\t'))
+        ++ptr;
+    const char* token_end = ptr;
+    while (token_end < end && *token_end != ' ' && *token_end != '\t' && *token_end != '\r')
+        ++token_end;
+
+    // Same as tinyobj::parseReal(): missing or invalid components default to 0, the double result is narrowed to float
+    // tinyobjloader does not round correctly, std::from_chars would differ from it in the last bit for some inputs
+    double value = 0.0;
+    tinyobj::tryParseDouble(ptr, token_end, &value);
+    ptr = token_end;
+    return static_cast<float>(value);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "tiny_obj_loader.h"
+
+// Multi-threaded OBJ front end for triangulated meshes
+// The memory mapped file is split at line boundaries into one chunk per thread, chunks are parsed in parallel on the job system and merged in file order
+// Only v/vt/vn/f records with triangle faces are supported, Parse() returns false for anything else so tinyobjloader can be used instead
+class ObjParser {
+public:
+    struct Result {
+        tinyobj::attrib_t attrib; // only vertices, normals and texcoords are filled
+        std::vector<tinyobj::index_t> indices; // 3 corners per triangle, resolved to 0-based indices like tinyobjloader
+        std::vector<std::string> material_libs; // mtllib lines in file order, each line can list multiple file names
+        unsigned int num_threads; // threads actually used, small files use fewer
+    };
+
+private:
+    // Corner component that uses a negative (relative) index which spans into an earlier chunk
+    struct Fixup {
+        uint32_t corner;
+        uint8_t components; // bitmask of s_fix_vertex, s_fix_normal, s_fix_texcoord
+    };
+
+    struct Chunk {
+        const char* begin;
+        const char* end;
+        std::vector<float> vertices;
+        std::vector<float> normals;
+        std::vector<float> texcoords;
+        std::vector<tinyobj::index_t> indices;
+        std::vector<Fixup> fixups;
+        std::vector<std::string> material_libs;
+        bool supported = true;
+    };
+
+    static constexpr uint8_t s_fix_vertex = 1;
+    static constexpr uint8_t s_fix_normal = 2;
+    static constexpr uint8_t s_fix_texcoord = 4;
+
+    // Number of threads used by Parse() when 0 is passed, 0 = std::thread::hardware_concurrency()
+    static unsigned int s_num_threads;
+
+public:
+    static void SetNumThreads(unsigned int num_threads) { s_num_threads = num_threads; }
+    static unsigned int GetNumThreads();
+
+    // Returns false if the file contains records that are not supported (e.g. polygons), result is then incomplete
+    static bool Parse(const std::filesystem::path& file_path, Result& result, unsigned int num_threads = 0);
+
+    // Load the materials of the mtllib records like tinyobjloader does
+    static void LoadMaterials(const Result& result, const std::string& mtl_search_path, std::vector<tinyobj::material_t>& materials);
+
+    // Parses the file with 1 to N threads, checks the output against tinyobjloader and reports the timings with OutputDebugString
+    static void RunThreadScalingBenchmark(const std::filesystem::path& file_path);
+
+private:
+    static void ParseChunk(Chunk& chunk);
+    static bool ParseFace(const char*& ptr, const char* end, Chunk& chunk);
+    static bool ParseIndex(const char*& ptr, const char* end, int32_t& index);
+    static float ParseFloat(const char*& ptr, const char* end);
+};
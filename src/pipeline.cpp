@@ -3,6 +3,8 @@
 #include <d3dcompiler.h>
 #include <DirectXMath.h>
 
+#include <algorithm>
+
 #include "renderer.h"
 #include "scene.h"
 #include "utility.h"
@@ -12,6 +14,8 @@
 #include "descriptorheap.h"
 #include "gui.h"
 #include "light.h"
+#include "linearallocator.h"
+#include "jobsystem.h"
 
 #if _DEBUG
 const std::wstring IPipeline::s_compiled_shader_path = L"x64/Debug/";
@@ -83,13 +87,12 @@ void DepthMapPipeline::CreateRootSignature()
         D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS |
         D3D12_ROOT_SIGNATURE_FLAG_DENY_PIXEL_SHADER_ROOT_ACCESS;
 
-    CD3DX12_DESCRIPTOR_RANGE1 ranges[1]; // Perfomance TIP: Order from most frequent to least frequent.
-    ranges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 1, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC);    // 1 frequently changed constant buffer.
-
-    // A single 32-bit constant root parameter that is used by the vertex shader.
-    CD3DX12_ROOT_PARAMETER1 rootParameters[2];
-    rootParameters[0].InitAsConstants(sizeof(DirectX::XMMATRIX) / 4, 0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
-    rootParameters[1].InitAsDescriptorTable(1, &ranges[0], D3D12_SHADER_VISIBILITY_VERTEX);
+    // The model index constant selects the model matrix of the draw in the model buffer
+    // The model buffer and the scene constants are root views into the per frame linear allocator
+    CD3DX12_ROOT_PARAMETER1 rootParameters[3];
+    rootParameters[0].InitAsConstants(1, 0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+    rootParameters[1].InitAsConstantBufferView(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE, D3D12_SHADER_VISIBILITY_VERTEX);
+    rootParameters[2].InitAsShaderResourceView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE, D3D12_SHADER_VISIBILITY_VERTEX);
 
     CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDescription;
     rootSignatureDescription.Init_1_1(_countof(rootParameters), rootParameters, 0, nullptr, rootSignatureFlags);
@@ -139,12 +142,28 @@ void DepthMapPipeline::CreatePipelineState()
         sizeof(PipelineStateStream), &pipelineStateStream
     };
     ThrowIfFailed(device->CreatePipelineState(&pipelineStateStreamDesc, IID_PPV_ARGS(&m_pipeline_state)));
+
+    // Same pipeline state for the CompactVertex layout
+    Microsoft::WRL::ComPtr<ID3DBlob> compactVertexShaderBlob;
+    std::wstring compact_vs = s_compiled_shader_path + L"depthmap_compact_vs.cso";
+    ThrowIfFailed(D3DReadFileToBlob(compact_vs.c_str(), &compactVertexShaderBlob));
+
+    D3D12_INPUT_ELEMENT_DESC compactInputLayout[] = {
+        { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "TEXTURE_COORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    };
+    pipelineStateStream.InputLayout = { compactInputLayout, _countof(compactInputLayout) };
+    pipelineStateStream.VS = CD3DX12_SHADER_BYTECODE(compactVertexShaderBlob.Get());
+    ThrowIfFailed(device->CreatePipelineState(&pipelineStateStreamDesc, IID_PPV_ARGS(&m_compact_pipeline_state)));
 }
 
-void DepthMapPipeline::Init(FrameDescriptorHeap* descriptor_heap, Scene* scene)
+void DepthMapPipeline::Init(FrameDescriptorHeap* descriptor_heap, Scene* scene, Camera* camera, LinearAllocator* constant_allocator)
 {
     IPipeline::Init(descriptor_heap, SHADOWMAP_SIZE, SHADOWMAP_SIZE);
     SetScene(scene);
+    SetCamera(camera);
+    m_constant_allocator = constant_allocator;
 }
 
 void DepthMapPipeline::Clear(CommandList& command_list)
@@ -154,27 +173,90 @@ void DepthMapPipeline::Clear(CommandList& command_list)
     IPipeline::Clear(command_list);
 }
 
-void DepthMapPipeline::Render(unsigned int frame_idx, CommandList& command_list)
+void DepthMapPipeline::Prepare(unsigned int frame_idx, CommandList& command_list)
 {
+    // Write the model matrices of the resident items in one pass
+    const std::vector<Scene::Item>& items = m_scene->GetSceneItems();
+    m_draw_items.clear();
+    for (size_t i = 0; i < items.size(); ++i) {
+        // Items are drawn once their data has been loaded
+        if (items[i].resident)
+            m_draw_items.push_back(i);
+    }
+    if (m_draw_items.empty())
+        return;
+
+    LinearAllocator::Allocation models = m_constant_allocator->Allocate(m_draw_items.size() * sizeof(DirectX::XMMATRIX), 16);
+    DirectX::XMMATRIX* models_WO = reinterpret_cast<DirectX::XMMATRIX*>(models.cpu_address);
+    m_model_buffer_address = models.gpu_address;
+    JobSystem::Get()->ParallelFor(0, m_draw_items.size(), s_prepare_grain_size, [&](size_t begin, size_t end) {
+        for (size_t model_idx = begin; model_idx < end; ++model_idx) {
+            const Scene::Item& scene_item = items[m_draw_items[model_idx]];
+
+            // Compact vertex positions are dequantized by the model matrix
+            DirectX::XMMATRIX model = DirectX::XMMatrixMultiply(scene_item.mesh->GetVertexTransform(), scene_item.GetModelMatrix());
+            models_WO[model_idx] = DirectX::XMMatrixTranspose(model);
+            scene_item.mesh->MarkBuffersUsed();
+        }
+    });
+}
 
+void DepthMapPipeline::SetRootState(unsigned int frame_idx, CommandList& command_list)
+{
     // Set the rendertarget to the lights depthmap
     //SetRenderTargets({}, m_scene->GetDirectionalLightDepthMap()); // TODO: with pointlights need to do this for each light
 
     IPipeline::Render(frame_idx, command_list);
 
-    command_list.SetGraphicsRootDescriptorTable(1, m_scene->GetSceneConstantsHandle(frame_idx));
+    command_list.SetGraphicsRootConstantBufferView(1, m_scene->GetSceneConstantsAddress());
 
-    for (const auto& scene_item : m_scene->GetSceneItems()) {
-        command_list.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        command_list.SetVertexBuffer(scene_item.mesh.GetVertexBufferView());
-        command_list.SetIndexBuffer(scene_item.mesh.GetIndexBufferView());
+    // Inherited by the bundles, which only refer to the model matrices by index
+    if (!m_draw_items.empty())
+        command_list.SetGraphicsRootShaderResourceView(2, m_model_buffer_address);
+}
+
+void DepthMapPipeline::RecordDraws(unsigned int frame_idx, CommandList& command_list, size_t begin, size_t end)
+{
+    const std::vector<Scene::Item>& items = m_scene->GetSceneItems();
+    std::vector<Draw> draws;
+    draws.reserve(end - begin);
+    for (size_t model_idx = begin; model_idx < end; ++model_idx) {
+        const Scene::Item& scene_item = items[m_draw_items[model_idx]];
+
+        // Draw the level of detail seen by the camera so the shadows match the visible geometry
+        const MeshLod& lod = scene_item.SelectLod(*m_camera);
+        draws.push_back({ scene_item.mesh, scene_item.mesh->GetVertexBufferView(), scene_item.mesh->GetIndexBufferView(), static_cast<uint32_t>(model_idx),
+            lod.index_count, lod.index_offset, scene_item.mesh->UsesCompactVertices() ? 1u : 0u });
+    }
+
+    if (!m_use_bundles) {
+        RecordDrawList(command_list, draws, m_pipeline_state.Get());
+        return;
+    }
 
-        DirectX::XMMATRIX model = scene_item.GetModelMatrix();
-        model = DirectX::XMMatrixTranspose(model);
-        command_list.SetGraphicsRoot32BitConstants(0, sizeof(DirectX::XMMATRIX) / 4, &model, 0);
+    // Only the root arguments are inherited by the bundle, the root signature is set again to change them
+    m_bundle_cache.Execute(frame_idx, begin, draws, command_list, [&](CommandList& bundle) {
+        bundle.SetGraphicsRootSignature(m_root_signature.Get());
+        RecordDrawList(bundle, draws, nullptr);
+    });
+}
 
-        // Draw
-        command_list.DrawIndexedInstanced(CastToUint(scene_item.mesh.GetNumIndices()), 1);
+void DepthMapPipeline::RecordDrawList(CommandList& command_list, const std::vector<Draw>& draws, ID3D12PipelineState* current_pipeline_state) const
+{
+    for (const Draw& draw : draws) {
+        // Switch the input layout for compact vertex meshes
+        ID3D12PipelineState* pipeline_state = draw.compact_vertices ? m_compact_pipeline_state.Get() : m_pipeline_state.Get();
+        if (pipeline_state != current_pipeline_state) {
+            command_list.SetPipelineState(pipeline_state);
+            current_pipeline_state = pipeline_state;
+        }
+
+        command_list.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        command_list.SetVertexBuffer(draw.vertex_buffer_view);
+        command_list.SetIndexBuffer(draw.index_buffer_view);
+
+        command_list.SetGraphicsRoot32BitConstants(0, 1, &draw.model_idx, 0);
+        draw.mesh->DrawIndexed(command_list, draw.index_count, draw.index_offset);
     }
 }
 
@@ -192,20 +274,25 @@ void ScenePipeline::CreateRootSignature() {
         D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
         D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
 
-    CD3DX12_DESCRIPTOR_RANGE1 ranges[4]; // Perfomance TIP: Order from most frequent to least frequent.
-    ranges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC);    // textures
-    ranges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 2, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC);    // 1 frequently changed constant buffer.
-    ranges[2].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);                                                // shadowmap texture
-    ranges[3].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, 2, 0);                                            // 2 static samplers.
-
-    // A single 32-bit constant root parameter that is used by the vertex shader.
-    CD3DX12_ROOT_PARAMETER1 rootParameters[6];
-    rootParameters[0].InitAsConstants(sizeof(DirectX::XMMATRIX) / 4, 0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
-    rootParameters[1].InitAsConstants(sizeof(MaterialParams) / 4, 1, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+    // The textures are every descriptor of the frame indexed by a root constant, so indirect draws can select them
+    // The frame also holds other descriptors, which are left alone by the shader
+    CD3DX12_DESCRIPTOR_RANGE1 ranges[3]; // Perfomance TIP: Order from most frequent to least frequent.
+    ranges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, 1,
+        D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE | D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);   // textures
+    ranges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);                                                // shadowmap texture
+    ranges[2].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, 2, 0);                                            // 2 static samplers.
+
+    // The instance offset constant selects the instance transform in the vertex shader and the material in the pixel shader,
+    // the texture index constant is used by the pixel shader
+    // The instance and material buffers and the scene constants are root views into the per frame linear allocator
+    CD3DX12_ROOT_PARAMETER1 rootParameters[7];
+    rootParameters[0].InitAsConstants(IndirectDrawBuilder::s_num_root_constants, 0, 0, D3D12_SHADER_VISIBILITY_ALL);
+    rootParameters[1].InitAsShaderResourceView(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE, D3D12_SHADER_VISIBILITY_PIXEL);
     rootParameters[2].InitAsDescriptorTable(1, &ranges[0], D3D12_SHADER_VISIBILITY_PIXEL);
-    rootParameters[3].InitAsDescriptorTable(1, &ranges[1], D3D12_SHADER_VISIBILITY_ALL);
-    rootParameters[4].InitAsDescriptorTable(1, &ranges[2], D3D12_SHADER_VISIBILITY_PIXEL);
-    rootParameters[5].InitAsDescriptorTable(1, &ranges[3], D3D12_SHADER_VISIBILITY_PIXEL);
+    rootParameters[3].InitAsConstantBufferView(2, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE, D3D12_SHADER_VISIBILITY_ALL);
+    rootParameters[4].InitAsDescriptorTable(1, &ranges[1], D3D12_SHADER_VISIBILITY_PIXEL);
+    rootParameters[5].InitAsDescriptorTable(1, &ranges[2], D3D12_SHADER_VISIBILITY_PIXEL);
+    rootParameters[6].InitAsShaderResourceView(2, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE, D3D12_SHADER_VISIBILITY_VERTEX);
 
     CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDescription;
     rootSignatureDescription.Init_1_1(_countof(rootParameters), rootParameters, 0, nullptr, rootSignatureFlags);
@@ -260,48 +347,304 @@ void ScenePipeline::CreatePipelineState() {
         sizeof(PipelineStateStream), &pipelineStateStream
     };
     ThrowIfFailed(device->CreatePipelineState(&pipelineStateStreamDesc, IID_PPV_ARGS(&m_pipeline_state)));
+
+    // Same pipeline state for the CompactVertex layout
+    Microsoft::WRL::ComPtr<ID3DBlob> compactVertexShaderBlob;
+    std::wstring compact_vs = s_compiled_shader_path + L"vertex_compact.cso";
+    ThrowIfFailed(D3DReadFileToBlob(compact_vs.c_str(), &compactVertexShaderBlob));
+
+    D3D12_INPUT_ELEMENT_DESC compactInputLayout[] = {
+        { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "TEXTURE_COORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    };
+    pipelineStateStream.InputLayout = { compactInputLayout, _countof(compactInputLayout) };
+    pipelineStateStream.VS = CD3DX12_SHADER_BYTECODE(compactVertexShaderBlob.Get());
+    ThrowIfFailed(device->CreatePipelineState(&pipelineStateStreamDesc, IID_PPV_ARGS(&m_compact_pipeline_state)));
+}
+
+void ScenePipeline::CreateCommandSignature()
+{
+    Microsoft::WRL::ComPtr<ID3D12Device2> device = Renderer::GetDevice();
+
+    // Sets the root constants of each draw, so it needs the root signature
+    std::vector<D3D12_INDIRECT_ARGUMENT_DESC> argument_descs = IndirectDrawBuilder::GetArgumentDescs(0);
+    D3D12_COMMAND_SIGNATURE_DESC command_signature_desc = {};
+    command_signature_desc.ByteStride = sizeof(IndirectDrawBuilder::Command);
+    command_signature_desc.NumArgumentDescs = CastToUint(argument_descs.size());
+    command_signature_desc.pArgumentDescs = argument_descs.data();
+    ThrowIfFailed(device->CreateCommandSignature(&command_signature_desc, m_root_signature.Get(), IID_PPV_ARGS(&m_command_signature)));
 }
 
-void ScenePipeline::Init(FrameDescriptorHeap* descriptor_heap, unsigned int width, unsigned int height, Scene* scene, Camera* camera)
+void ScenePipeline::Init(FrameDescriptorHeap* descriptor_heap, unsigned int width, unsigned int height, Scene* scene, Camera* camera,
+    LinearAllocator* constant_allocator)
 {
     IPipeline::Init(descriptor_heap, width, height);
+    CreateCommandSignature();
 
     // Set scene and camera
     SetScene(scene);
     SetCamera(camera);
+
+    // The instance transforms and materials are written to the linear allocator every frame
+    m_constant_allocator = constant_allocator;
+    m_batches.reserve(m_scene->GetSceneItems().size());
 }
 
-void ScenePipeline::Render(unsigned int frame_idx, CommandList& command_list) {
-    IPipeline::Render(frame_idx, command_list);
+void ScenePipeline::BuildBatches()
+{
+    const std::vector<Scene::Item>& items = m_scene->GetSceneItems();
+    DirectX::XMMATRIX view_projection = DirectX::XMMatrixMultiply(m_camera->GetViewMatrix(), m_camera->GetProjectionMatrix());
+
+    // Frustum cull the resident items with the bounding sphere of their mesh, each job into its own list
+    JobSystem* job_system = JobSystem::Get();
+    std::vector<std::vector<Batch>> visible((items.size() + s_prepare_grain_size - 1) / s_prepare_grain_size);
+    job_system->ParallelFor(0, items.size(), s_prepare_grain_size, [&](size_t begin, size_t end) {
+        std::vector<Batch>& chunk_visible = visible[begin / s_prepare_grain_size];
+        for (size_t i = begin; i < end; ++i) {
+            if (!items[i].resident)
+                continue;
+
+            DirectX::XMFLOAT4 min_bounds, max_bounds;
+            items[i].mesh->GetBounds(min_bounds, max_bounds);
+            Meshlet bounds{};
+            bounds.center = DirectX::XMFLOAT3(0.5f * (min_bounds.x + max_bounds.x), 0.5f * (min_bounds.y + max_bounds.y), 0.5f * (min_bounds.z + max_bounds.z));
+            DirectX::XMVECTOR extent = DirectX::XMVectorSubtract(DirectX::XMLoadFloat4(&max_bounds), DirectX::XMLoadFloat4(&min_bounds));
+            bounds.radius = 0.5f * DirectX::XMVectorGetX(DirectX::XMVector3Length(extent));
+            bounds.cone_cutoff = 1.0f;
+
+            MeshletCuller culler(items[i].GetModelMatrix(), view_projection, m_camera->GetPosition(), false);
+            if (culler.IsVisible(bounds))
+                chunk_visible.push_back({ items[i].mesh, &items[i].SelectLod(*m_camera), i, 0, 1 });
+        }
+    });
+
+    // In item order, so the batches do not depend on which thread ran which job
+    m_batches.clear();
+    for (const std::vector<Batch>& chunk_visible : visible)
+        m_batches.insert(m_batches.end(), chunk_visible.begin(), chunk_visible.end());
+
+    // Items with the same mesh and level of detail end up next to each other
+    std::sort(m_batches.begin(), m_batches.end(), [](const Batch& a, const Batch& b) {
+        return a.mesh != b.mesh ? a.mesh < b.mesh : a.lod < b.lod;
+    });
+
+    if (m_batches.empty())
+        return;
+
+    // Write the instance transforms and materials in sorted order and merge the batches in place
+    // Draws only refer to them by their first instance, so the bundles do not depend on where the linear allocator puts them
+    LinearAllocator::Allocation instances = m_constant_allocator->Allocate(m_batches.size() * sizeof(DirectX::XMMATRIX), 16);
+    DirectX::XMMATRIX* instances_WO = reinterpret_cast<DirectX::XMMATRIX*>(instances.cpu_address);
+    m_instance_buffer_address = instances.gpu_address;
+    LinearAllocator::Allocation materials = m_constant_allocator->Allocate(m_batches.size() * sizeof(MaterialParams), 16);
+    MaterialParams* materials_WO = reinterpret_cast<MaterialParams*>(materials.cpu_address);
+    m_material_buffer_address = materials.gpu_address;
+    job_system->ParallelFor(0, m_batches.size(), s_prepare_grain_size, [&](size_t begin, size_t end) {
+        for (size_t instance = begin; instance < end; ++instance) {
+            const Scene::Item& item = items[m_batches[instance].item_idx];
+            DirectX::XMMATRIX model = DirectX::XMMatrixMultiply(item.mesh->GetVertexTransform(), item.GetModelMatrix());
+            instances_WO[instance] = DirectX::XMMatrixTranspose(model);
+            materials_WO[instance] = *item.mesh->GetMaterial();
+        }
+    });
+
+    size_t num_batches = 0;
+    for (size_t instance = 0; instance < m_batches.size(); ++instance) {
+        Batch* last = num_batches > 0 ? &m_batches[num_batches - 1] : nullptr;
+        if (last && last->mesh == m_batches[instance].mesh && last->lod == m_batches[instance].lod) {
+            ++last->num_instances;
+            continue;
+        }
+        m_batches[num_batches] = m_batches[instance];
+        m_batches[num_batches].first_instance = static_cast<uint32_t>(instance);
+        ++num_batches;
+    }
+    m_batches.resize(num_batches);
+
+    // The visible meshes and their textures are the ones the residency manager keeps at full detail
+    for (const Batch& batch : m_batches)
+        batch.mesh->MarkUsed();
+}
+
+void ScenePipeline::Prepare(unsigned int frame_idx, CommandList& command_list)
+{
+    // Report the draw call reduction from instancing of the last frame when it changes
+    unsigned int num_draws = m_num_frame_draws.exchange(0);
+    if (num_draws != m_num_draws) {
+        wchar_t buffer[500];
+        swprintf_s(buffer, 500, L"ScenePipeline::Prepare(): %zu items in %zu batches drawn with %u draw calls\n", m_scene->GetSceneItems().size(), m_batches.size(), num_draws);
+        OutputDebugString(buffer);
+        m_num_draws = num_draws;
+    }
 
     // Prepare to set in shader_pixel_resource state
     m_scene->GetDirectionalLightDepthMap()->UseShaderResource(command_list);
 
-    command_list.SetGraphicsRootDescriptorTable(3, m_scene->GetSceneConstantsHandle(frame_idx));
+    BuildBatches();
+
+    m_indirect_groups.clear();
+    if (m_use_indirect_draws)
+        BuildIndirectDraws(frame_idx);
+}
+
+void ScenePipeline::SetRootState(unsigned int frame_idx, CommandList& command_list)
+{
+    IPipeline::Render(frame_idx, command_list);
+
+    command_list.SetGraphicsRootDescriptorTable(2, m_descriptor_heap->GetGpuHandle(frame_idx));
+    command_list.SetGraphicsRootConstantBufferView(3, m_scene->GetSceneConstantsAddress());
     command_list.SetGraphicsRootDescriptorTable(4, m_scene->GetDirectionalLightHandle(frame_idx));
     command_list.SetGraphicsRootDescriptorTable(5, TextureLibrary::GetSamplerHeapGpuHandle());
 
-    for (const auto& scene_item : m_scene->GetSceneItems()) {
-        command_list.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        command_list.SetVertexBuffer(scene_item.mesh.GetVertexBufferView());
-        command_list.SetIndexBuffer(scene_item.mesh.GetIndexBufferView());
-        
-        DirectX::XMMATRIX model = scene_item.GetModelMatrix();
-        model = DirectX::XMMatrixTranspose(model);
-        command_list.SetGraphicsRoot32BitConstants(0, sizeof(DirectX::XMMATRIX) / 4, &model, 0);
-        command_list.SetGraphicsRoot32BitConstants(1, sizeof(MaterialParams) / 4, scene_item.mesh.GetMaterial(), 0);
-        command_list.SetGraphicsRootDescriptorTable(2, scene_item.mesh.GetDiffuseTextureDescriptor(frame_idx));
-
-        // Draw
-        command_list.DrawIndexedInstanced(CastToUint(scene_item.mesh.GetNumIndices()), 1);
+    // Inherited by the bundles, which only refer to the instances by the first instance of each draw
+    if (!m_batches.empty()) {
+        command_list.SetGraphicsRootShaderResourceView(1, m_material_buffer_address);
+        command_list.SetGraphicsRootShaderResourceView(6, m_instance_buffer_address);
+    }
+}
+
+void ScenePipeline::GatherDraws(unsigned int frame_idx, size_t begin, size_t end, std::vector<Draw>& draws)
+{
+    DirectX::XMMATRIX view_projection = DirectX::XMMatrixMultiply(m_camera->GetViewMatrix(), m_camera->GetProjectionMatrix());
+    const std::vector<Scene::Item>& items = m_scene->GetSceneItems();
+    D3D12_GPU_DESCRIPTOR_HANDLE frame_descriptors = m_descriptor_heap->GetGpuHandle(frame_idx);
+    size_t num_draws = draws.size();
+    for (size_t batch_idx = begin; batch_idx < end; ++batch_idx) {
+        const Batch& batch = m_batches[batch_idx];
+        uint32_t texture_idx = static_cast<uint32_t>((batch.mesh->GetDiffuseTextureDescriptor(frame_idx).ptr - frame_descriptors.ptr) / m_descriptor_heap->GetDescriptorSize());
+        uint32_t pipeline_idx = batch.mesh->UsesCompactVertices() ? PIPELINE_STATE_COMPACT : PIPELINE_STATE_DEFAULT;
+        Draw draw{ batch.mesh, batch.mesh->GetVertexBufferView(), batch.mesh->GetIndexBufferView(),
+            batch.first_instance, texture_idx, batch.num_instances, 0, 0, pipeline_idx };
+
+        // Instanced batches and simplified levels are drawn as a whole
+        const std::vector<Meshlet>& meshlets = batch.mesh->GetMeshlets();
+        if (batch.num_instances > 1 || batch.lod->index_offset != 0 || meshlets.empty()) {
+            draw.index_count = batch.lod->index_count;
+            draw.index_offset = batch.lod->index_offset;
+            draws.push_back(draw);
+            continue;
+        }
+
+        // Cull the meshlets of level 0 on the CPU and draw the consecutive visible meshlets together
+        const Scene::Item& scene_item = items[batch.item_idx];
+        bool uniform_scale = scene_item.scale.x == scene_item.scale.y && scene_item.scale.y == scene_item.scale.z;
+        MeshletCuller culler(scene_item.GetModelMatrix(), view_projection, m_camera->GetPosition(), uniform_scale);
+        uint32_t draw_start = 0;
+        uint32_t draw_count = 0;
+        for (const Meshlet& meshlet : meshlets) {
+            if (!culler.IsVisible(meshlet))
+                continue;
+
+            if (draw_count > 0 && draw_start + draw_count == meshlet.index_offset) {
+                draw_count += meshlet.index_count;
+                continue;
+            }
+
+            if (draw_count > 0) {
+                draw.index_count = draw_count;
+                draw.index_offset = draw_start;
+                draws.push_back(draw);
+            }
+            draw_start = meshlet.index_offset;
+            draw_count = meshlet.index_count;
+        }
+        if (draw_count > 0) {
+            draw.index_count = draw_count;
+            draw.index_offset = draw_start;
+            draws.push_back(draw);
+        }
     }
+
+    m_num_frame_draws += static_cast<unsigned int>(draws.size() - num_draws);
 }
 
+void ScenePipeline::BuildIndirectDraws(unsigned int frame_idx)
+{
+    // Each job converts the draws of its batches into its own builder, merged in batch order
+    std::vector<IndirectDrawBuilder> builders((m_batches.size() + s_prepare_grain_size - 1) / s_prepare_grain_size, IndirectDrawBuilder(PIPELINE_STATE_COUNT));
+    JobSystem::Get()->ParallelFor(0, m_batches.size(), s_prepare_grain_size, [&](size_t begin, size_t end) {
+        IndirectDrawBuilder& builder = builders[begin / s_prepare_grain_size];
+        std::vector<Draw> draws;
+        GatherDraws(frame_idx, begin, end, draws);
+
+        // The draws over several index ranges of a mesh take a command per range
+        for (const Draw& draw : draws) {
+            builder.Add(draw.pipeline_idx, { { draw.first_instance, draw.texture_idx }, draw.vertex_buffer_view, draw.index_buffer_view, draw.index_count,
+                draw.index_offset, draw.num_instances }, draw.mesh->GetIndexRanges());
+        }
+    });
+
+    m_indirect_builder.Clear();
+    for (const IndirectDrawBuilder& builder : builders)
+        m_indirect_builder.Append(builder);
+    if (m_indirect_builder.GetNumCommands() == 0)
+        return;
+
+    // The upload heap is in a state which includes the indirect argument state
+    LinearAllocator::Allocation arguments = m_constant_allocator->Allocate(m_indirect_builder.GetBufferSize());
+    m_indirect_groups = m_indirect_builder.Write(arguments.cpu_address);
+    m_indirect_buffer = arguments.resource;
+    m_indirect_buffer_offset = arguments.offset;
+}
+
+void ScenePipeline::RecordDraws(unsigned int frame_idx, CommandList& command_list, size_t begin, size_t end)
+{
+    if (m_use_indirect_draws) {
+        for (size_t group_idx = begin; group_idx < end; ++group_idx) {
+            const IndirectDrawBuilder::Group& group = m_indirect_groups[group_idx];
+            command_list.SetPipelineState(GetPipelineState(group.pipeline_idx));
+            command_list.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+            command_list.ExecuteIndirect(m_command_signature.Get(), group.num_commands, m_indirect_buffer, m_indirect_buffer_offset + group.offset);
+        }
+        return;
+    }
+
+    std::vector<Draw> draws;
+    draws.reserve(end - begin);
+    GatherDraws(frame_idx, begin, end, draws);
+
+    if (!m_use_bundles) {
+        RecordDrawList(command_list, draws, m_pipeline_state.Get());
+        return;
+    }
+
+    // Only the root arguments are inherited by the bundle, the root signature is set again to change them
+    m_bundle_cache.Execute(frame_idx, begin, draws, command_list, [&](CommandList& bundle) {
+        bundle.SetGraphicsRootSignature(m_root_signature.Get());
+        RecordDrawList(bundle, draws, nullptr);
+    });
+}
+
+void ScenePipeline::RecordDrawList(CommandList& command_list, const std::vector<Draw>& draws, ID3D12PipelineState* current_pipeline_state) const
+{
+    // The meshlet draws of a batch share its state
+    const Draw* batch_draw = nullptr;
+    for (const Draw& draw : draws) {
+        if (!batch_draw || draw.first_instance != batch_draw->first_instance) {
+            // Switch the input layout for compact vertex meshes
+            ID3D12PipelineState* pipeline_state = GetPipelineState(draw.pipeline_idx);
+            if (pipeline_state != current_pipeline_state) {
+                command_list.SetPipelineState(pipeline_state);
+                current_pipeline_state = pipeline_state;
+            }
+
+            command_list.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+            command_list.SetVertexBuffer(draw.vertex_buffer_view);
+            command_list.SetIndexBuffer(draw.index_buffer_view);
+
+            command_list.SetGraphicsRoot32BitConstants(0, IndirectDrawBuilder::s_num_root_constants, &draw.first_instance, 0);
+            batch_draw = &draw;
+        }
+
+        draw.mesh->DrawIndexed(command_list, draw.index_count, draw.index_offset, draw.num_instances);
+    }
+}
 
 // ImagePipeline
 
 ImagePipeline::ImagePipeline() : 
-    m_textures(Renderer::s_num_frames), m_texture_handles(Renderer::s_num_frames), m_img_options{2.2f, 1.0f}, IPipeline() {
+    m_textures(Renderer::GetNumFrames()), m_texture_handles(Renderer::GetNumFrames()), m_img_options{2.2f, 1.0f}, IPipeline() {
 }
 
 void ImagePipeline::CreateRootSignature() 
@@ -3,10 +3,13 @@
 #include <d3d12.h>
 #include <d3dx12.h>
 
+#include <atomic>
 #include <vector>
 
 #include "mesh.h"
 #include "rendertarget.h"
+#include "bundlecache.h"
+#include "indirectdrawbuilder.h"
 
 
 // Forward declarations
@@ -15,6 +18,7 @@ class Camera;
 class RenderTargetTexture;
 class IRenderTarget;
 class FrameDescriptorHeap;
+class LinearAllocator;
 
 class IPipeline {
 public:
@@ -78,9 +82,66 @@ public:
     virtual void Render(unsigned int frame_idx, CommandList& command_list);
 };
 
-class DepthMapPipeline : public IPipeline {
+// Pipeline whose draws can be split over command lists recorded by separate threads and executed in order
+// Prepare() records the barriers and writes the data of the frame on the calling thread, then each command list is set up
+// with SetRootState() and records a range of the draws. Disjoint ranges can be recorded concurrently
+// The draws of a range go to a bundle which is replayed in later frames as long as the range has the same draws
+class IParallelPipeline : public IPipeline {
+protected:
+    // Items per job when Prepare() processes the items on the job system
+    static constexpr size_t s_prepare_grain_size = 1024;
+
+    BundleCache m_bundle_cache;
+    bool m_use_bundles;
+
+public:
+    IParallelPipeline() : m_use_bundles(true), IPipeline() {}
+
+    // Record the draws directly into the command lists instead
+    void SetUseBundles(bool use_bundles) { m_use_bundles = use_bundles; }
+    BundleCache& GetBundleCache() { return m_bundle_cache; }
+
+    virtual void Prepare(unsigned int frame_idx, CommandList& command_list) = 0;
+
+    // Number of draws after Prepare(), the unit of the ranges
+    virtual size_t GetNumDraws() const = 0;
+
+    virtual void SetRootState(unsigned int frame_idx, CommandList& command_list) = 0;
+    virtual void RecordDraws(unsigned int frame_idx, CommandList& command_list, size_t begin, size_t end) = 0;
+
+    // Record everything on a single command list
+    virtual void Render(unsigned int frame_idx, CommandList& command_list) override
+    {
+        Prepare(frame_idx, command_list);
+        SetRootState(frame_idx, command_list);
+        RecordDraws(frame_idx, command_list, 0, GetNumDraws());
+    }
+};
+
+class DepthMapPipeline : public IParallelPipeline {
 private:
+    // Parameters of a draw call, the model matrix is read from the model buffer the command list binds
+    // The root constant is the index of the model matrix
+    struct Draw {
+        const Mesh* mesh;
+        D3D12_VERTEX_BUFFER_VIEW vertex_buffer_view;
+        D3D12_INDEX_BUFFER_VIEW index_buffer_view;
+        uint32_t model_idx;
+        uint32_t index_count;
+        uint32_t index_offset;
+        uint32_t compact_vertices; // 1 for meshes using the CompactVertex layout
+    };
+
     Scene* m_scene;
+    Camera* m_camera; // used for the level of detail selection
+    LinearAllocator* m_constant_allocator; // per object constant buffers
+
+    // Pipeline state for meshes using the CompactVertex layout
+    Microsoft::WRL::ComPtr<ID3D12PipelineState> m_compact_pipeline_state;
+
+    // Resident items drawn in the frame, each with its model matrix at the same index in the model buffer
+    std::vector<size_t> m_draw_items;
+    D3D12_GPU_VIRTUAL_ADDRESS m_model_buffer_address;
 
 private:
     // TODO: hide SetRenderTargets for this pipeline
@@ -89,42 +150,130 @@ private:
 
     virtual void CreateRootSignature() override;
     virtual void CreatePipelineState() override;
+
+    // Record the draws starting with the pipeline state, which is nullptr in a bundle
+    void RecordDrawList(CommandList& command_list, const std::vector<Draw>& draws, ID3D12PipelineState* current_pipeline_state) const;
 public:
-    DepthMapPipeline() : m_scene(nullptr), IPipeline() {
+    DepthMapPipeline() : m_scene(nullptr), m_camera(nullptr), m_constant_allocator(nullptr), m_model_buffer_address(0), IParallelPipeline() {
 
     }
 
-    void Init(FrameDescriptorHeap* descriptor_heap, Scene* scene);
+    // Bytes of the linear allocator per scene item in a frame
+    static constexpr uint64_t s_frame_bytes_per_item = sizeof(DirectX::XMMATRIX);
+
+    void Init(FrameDescriptorHeap* descriptor_heap, Scene* scene, Camera* camera, LinearAllocator* constant_allocator);
 
     // The lights are stored in the scene
     void SetScene(Scene* scene) { m_scene = scene; }
+    void SetCamera(Camera* camera) { m_camera = camera; }
     
     virtual void Clear(CommandList& command_list) override;// TODO: for adding pointlights clear needs to clear all depthmaps
-    virtual void Render(unsigned int frame_idx, CommandList& command_list) override;
+
+    virtual void Prepare(unsigned int frame_idx, CommandList& command_list) override;
+    virtual size_t GetNumDraws() const override { return m_draw_items.size(); }
+    virtual void SetRootState(unsigned int frame_idx, CommandList& command_list) override;
+    virtual void RecordDraws(unsigned int frame_idx, CommandList& command_list, size_t begin, size_t end) override;
 };
 
-class ScenePipeline : public IPipeline {
+class ScenePipeline : public IParallelPipeline {
 private:
+    // Scene items sharing the mesh and level of detail drawn with one instanced draw
+    struct Batch {
+        const Mesh* mesh;
+        const MeshLod* lod;
+        size_t item_idx; // first scene item of the batch
+        uint32_t first_instance;
+        uint32_t num_instances;
+    };
+
+    // Parameters of a draw call, the instance transforms and materials are read from the buffers the command list binds
+    // The root constants are the first instance and the index of the diffuse texture in the descriptors of the frame
+    struct Draw {
+        const Mesh* mesh;
+        D3D12_VERTEX_BUFFER_VIEW vertex_buffer_view;
+        D3D12_INDEX_BUFFER_VIEW index_buffer_view;
+        uint32_t first_instance;
+        uint32_t texture_idx;
+        uint32_t num_instances;
+        uint32_t index_count;
+        uint32_t index_offset;
+        uint32_t pipeline_idx; // PIPELINE_STATE_*
+    };
+
+    enum PipelineStateIdx : uint32_t {
+        PIPELINE_STATE_DEFAULT = 0,
+        PIPELINE_STATE_COMPACT, // meshes using the CompactVertex layout
+        PIPELINE_STATE_COUNT
+    };
+
     Scene* m_scene;
     Camera* m_camera;
+    LinearAllocator* m_constant_allocator; // instance and material data of the frame
+
+    // Pipeline state for meshes using the CompactVertex layout
+    Microsoft::WRL::ComPtr<ID3D12PipelineState> m_compact_pipeline_state;
+
+    // Model matrices and materials of the instances in batch order, read by the shaders as StructuredBuffer
+    D3D12_GPU_VIRTUAL_ADDRESS m_instance_buffer_address;
+    D3D12_GPU_VIRTUAL_ADDRESS m_material_buffer_address;
+    std::vector<Batch> m_batches;
+
+    // Draws of the frame in an argument buffer of the linear allocator, executed with one ExecuteIndirect per pipeline state
+    bool m_use_indirect_draws;
+    Microsoft::WRL::ComPtr<ID3D12CommandSignature> m_command_signature;
+    IndirectDrawBuilder m_indirect_builder;
+    std::vector<IndirectDrawBuilder::Group> m_indirect_groups;
+    ID3D12Resource* m_indirect_buffer;
+    uint64_t m_indirect_buffer_offset;
+
+    // Draw calls of the last frame, reported when changed, and of the current frame counted by the recording threads
+    unsigned int m_num_draws;
+    std::atomic<unsigned int> m_num_frame_draws;
 
 private:
     using IPipeline::Init;
 
     virtual void CreateRootSignature() override;
     virtual void CreatePipelineState() override;
+    void CreateCommandSignature();
+
+    ID3D12PipelineState* GetPipelineState(uint32_t pipeline_idx) const { return pipeline_idx == PIPELINE_STATE_COMPACT ? m_compact_pipeline_state.Get() : m_pipeline_state.Get(); }
+
+    // Group the scene items by mesh and level of detail and write the instance and material data
+    void BuildBatches();
+
+    // Cull the meshlets of the batches and append the draw calls of the remaining ones
+    void GatherDraws(unsigned int frame_idx, size_t begin, size_t end, std::vector<Draw>& draws);
+
+    // Write the draws of every batch to the argument buffer of the frame
+    void BuildIndirectDraws(unsigned int frame_idx);
+
+    // Record the draws starting with the pipeline state, which is nullptr in a bundle
+    void RecordDrawList(CommandList& command_list, const std::vector<Draw>& draws, ID3D12PipelineState* current_pipeline_state) const;
 
 public:
-    ScenePipeline() : m_scene(nullptr), m_camera(nullptr), IPipeline() {
+    ScenePipeline() : m_scene(nullptr), m_camera(nullptr), m_constant_allocator(nullptr), m_instance_buffer_address(0), m_material_buffer_address(0),
+        m_use_indirect_draws(true), m_indirect_builder(PIPELINE_STATE_COUNT), m_indirect_buffer(nullptr), m_indirect_buffer_offset(0), m_num_draws(0),
+        m_num_frame_draws(0), IParallelPipeline() {
 
     }
 
-    void Init(FrameDescriptorHeap* descriptor_heap, unsigned int width, unsigned int height, Scene* scene, Camera* camera);
+    // Bytes of the linear allocator per scene item in a frame, with one indirect draw per item
+    static constexpr uint64_t s_frame_bytes_per_item = sizeof(DirectX::XMMATRIX) + sizeof(MaterialParams) + sizeof(IndirectDrawBuilder::Command);
+
+    void Init(FrameDescriptorHeap* descriptor_heap, unsigned int width, unsigned int height, Scene* scene, Camera* camera, LinearAllocator* constant_allocator);
 
     void SetScene(Scene* scene) { m_scene = scene; }
     void SetCamera(Camera* camera) { m_camera = camera; }
 
-    virtual void Render(unsigned int frame_idx, CommandList& command_list) override;
+    // Execute the draws from an argument buffer instead of recording them, to be set before Prepare()
+    void SetUseIndirectDraws(bool use_indirect_draws) { m_use_indirect_draws = use_indirect_draws; }
+
+    virtual void Prepare(unsigned int frame_idx, CommandList& command_list) override;
+    // The indirect draws are split by pipeline state only, each ExecuteIndirect is a single call
+    virtual size_t GetNumDraws() const override { return m_use_indirect_draws ? m_indirect_groups.size() : m_batches.size(); }
+    virtual void SetRootState(unsigned int frame_idx, CommandList& command_list) override;
+    virtual void RecordDraws(unsigned int frame_idx, CommandList& command_list, size_t begin, size_t end) override;
 };
 
 
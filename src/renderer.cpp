@@ -4,11 +4,28 @@
 #include "utility.h"
 #include "dx12_api.h"
 #include "gui.h"
+#include "heapallocator.h"
+#include "residencymanager.h"
+#include "jobsystem.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iterator>
 
 /// Renderer
 
 bool Renderer::use_warp = false;
+Microsoft::WRL::ComPtr<IDXGIAdapter4> Renderer::ADAPTER = nullptr;
 Microsoft::WRL::ComPtr<ID3D12Device2> Renderer::DEVICE = nullptr;
+std::unique_ptr<HeapAllocator> Renderer::HEAP_ALLOCATOR = nullptr;
+std::unique_ptr<ResidencyManager> Renderer::RESIDENCY_MANAGER = nullptr;
+unsigned int Renderer::s_num_frames = 3;
+unsigned int Renderer::s_max_frame_latency = 0;
+unsigned int Renderer::s_num_record_threads = 0;
+bool Renderer::s_use_bundles = true;
+bool Renderer::s_use_indirect_draws = true;
+bool Renderer::s_record_benchmark = false;
 
 Renderer::Renderer(HWND hWnd, uint32_t width, uint32_t height, Scene* scene, GUI* gui,  bool use_warp) :
     m_hWnd(hWnd),
@@ -19,10 +36,24 @@ Renderer::Renderer(HWND hWnd, uint32_t width, uint32_t height, Scene* scene, GUI
     m_width(width),
     m_height(height),
     m_command_queue(D3D12_COMMAND_LIST_TYPE_DIRECT),
+    m_constant_allocator(s_num_frames, GetConstantFrameCapacity(scene)),
     m_rtv_descriptor_heap(D3D12_DESCRIPTOR_HEAP_TYPE_RTV, s_num_frames),
     m_dsv_descriptor_heap(D3D12_DESCRIPTOR_HEAP_TYPE_DSV, 1u),
     m_cbv_srv_descriptor_heap(s_num_frames, gui->GetNumResources()),
-    m_initialized(false)
+    m_initialized(false),
+    m_benchmark_threads(0),
+    m_benchmark_frame(0),
+    m_benchmark_time(0.0),
+    m_benchmark_reference_time(0.0),
+    m_benchmark_bundles(false),
+    m_benchmark_direct_time(0.0),
+    m_backbuffers(s_num_frames),
+    m_render_textures(s_num_frames, nullptr),
+    m_frame_input_times(s_num_frames),
+    m_num_frame_lists(0),
+    m_max_frame_lists(s_num_frames, 0),
+    m_barrier_stats{},
+    m_latency_stats{}
 {
     m_tearing_supported = directx::CheckTearingSupport();
 
@@ -32,6 +63,10 @@ Renderer::Renderer(HWND hWnd, uint32_t width, uint32_t height, Scene* scene, GUI
     m_swap_chain = directx::CreateSwapChain(hWnd, m_command_queue.GetD12CommandQueue(), width, height, s_num_frames);
     m_current_backbuffer_idx = m_swap_chain->GetCurrentBackBufferIndex();
 
+    // Frames are paced by the swap chain, a lower latency than the number of frames leaves the fences of the frames completed
+    ThrowIfFailed(m_swap_chain->SetMaximumFrameLatency(GetMaxFrameLatency()));
+    m_frame_latency_waitable = m_swap_chain->GetFrameLatencyWaitableObject();
+
     // Create the size dependent resources
     LoadSizeDependentResources(width, height);
 
@@ -51,6 +86,15 @@ Renderer::Renderer(HWND hWnd, uint32_t width, uint32_t height, Scene* scene, GUI
 
 Renderer::~Renderer() {
     m_command_queue.Flush();
+    ::CloseHandle(m_frame_latency_waitable);
+}
+
+uint64_t Renderer::GetConstantFrameCapacity(const Scene* scene)
+{
+    // Model matrices, materials and indirect draws of every item, the default capacity leaves room for the scene constants,
+    // the draws of the visible meshlet ranges and the gui. A frame which overflows creates new upload buffers every time
+    size_t num_items = scene->GetSceneItems().size();
+    return LinearAllocator::s_default_frame_capacity + num_items * (DepthMapPipeline::s_frame_bytes_per_item + ScenePipeline::s_frame_bytes_per_item);
 }
 
 void Renderer::BindGuiData()
@@ -62,12 +106,12 @@ void Renderer::BindGuiData()
 void Renderer::SetupPipelines()
 {
     // Initialize Pipelines
-    m_depthmap_pipeline.Init(&m_cbv_srv_descriptor_heap, m_scene);
-    m_scene_pipeline.Init(&m_cbv_srv_descriptor_heap, m_width, m_height, m_scene, &m_camera);
+    m_depthmap_pipeline.Init(&m_cbv_srv_descriptor_heap, m_scene, &m_camera, &m_constant_allocator);
+    m_scene_pipeline.Init(&m_cbv_srv_descriptor_heap, m_width, m_height, m_scene, &m_camera, &m_constant_allocator);
     m_img_pipeline.Init(&m_command_queue, &m_cbv_srv_descriptor_heap, m_width, m_height);
 
     // Set the input texture for the image pipeline
-    for (int i = 0; i < s_num_frames; ++i)
+    for (unsigned int i = 0; i < s_num_frames; ++i)
         m_img_pipeline.SetInputTexture(i, m_render_textures[i]);
 }
 
@@ -86,18 +130,40 @@ Microsoft::WRL::ComPtr<ID3D12Device2> Renderer::GetDevice()
 
         directx::EnableDebugLayer();
 
-        Microsoft::WRL::ComPtr<IDXGIAdapter4> dxgiAdapter4 = directx::GetAdapter(use_warp);
-        DEVICE = directx::CreateDevice(dxgiAdapter4);
+        ADAPTER = directx::GetAdapter(use_warp);
+        DEVICE = directx::CreateDevice(ADAPTER);
     }
     return DEVICE;
 }
 
+Microsoft::WRL::ComPtr<IDXGIAdapter4> Renderer::GetAdapter()
+{
+    GetDevice();
+    return ADAPTER;
+}
+
+HeapAllocator* Renderer::GetHeapAllocator()
+{
+    if (!HEAP_ALLOCATOR)
+        HEAP_ALLOCATOR = std::make_unique<HeapAllocator>();
+    return HEAP_ALLOCATOR.get();
+}
+
+ResidencyManager* Renderer::GetResidencyManager()
+{
+    if (!RESIDENCY_MANAGER)
+        RESIDENCY_MANAGER = std::make_unique<ResidencyManager>();
+    return RESIDENCY_MANAGER.get();
+}
+
 
 void Renderer::Bind(Scene* scene) 
 {
     m_scene = scene;
 
-    // Create the shader visible CBV/SRV/UAV descriptor heap
+    // Create the shader visible CBV/SRV/UAV descriptor heap, the frames in flight keep using the previous one
+    if (m_cbv_srv_descriptor_heap.GetDescriptorHeap())
+        m_command_queue.ReleaseDeferred(Microsoft::WRL::ComPtr<IUnknown>(m_cbv_srv_descriptor_heap.GetDescriptorHeap()));
     m_cbv_srv_descriptor_heap.Reset();
     m_cbv_srv_descriptor_heap.Allocate(m_scene->GetNumFrameDescriptors() + m_texture_library.GetNumTextures());
 
@@ -109,6 +175,24 @@ void Renderer::Bind(Scene* scene)
 
     // Bind the scene descriptors
     m_scene->Bind(&m_cbv_srv_descriptor_heap);
+
+    // The shadow map belongs to the scene
+    AllocateTransientResources();
+}
+
+void Renderer::AllocateTransientResources()
+{
+    // Within a frame all of them are alive in the scene pass, which samples the depth map and renders to the depth buffer and the
+    // render texture, so none of them can share memory with another one of the same frame. A render texture is only used by the
+    // scene and image passes of its own frame and the frames execute one after the other, so the render textures of the frames
+    // in flight share memory and the heap holds one of them instead of s_num_frames
+    m_transient_allocator.Clear();
+    m_transient_allocator.Declare(m_scene->GetDirectionalLightDepthMap(), RENDER_PASS_DEPTHMAP, RENDER_PASS_SCENE);
+    m_transient_allocator.Declare(&m_depth_buffer, RENDER_PASS_SCENE, RENDER_PASS_SCENE, TransientPacker::s_all_frames, true);
+    for (unsigned int i = 0; i < s_num_frames; ++i)
+        m_transient_allocator.Declare(m_render_textures[i], RENDER_PASS_SCENE, RENDER_PASS_IMAGE, i, true);
+
+    m_transient_allocator.Allocate(m_command_queue);
 }
 
 
@@ -119,25 +203,93 @@ void Renderer::Render()
     if (!m_scene)
         throw std::exception("Renderer::Render(): No scene is bound to the renderer");
 
+    // Wait until the swap chain can queue another present, the wait covers the time the GPU is behind
+    auto pacing_start = std::chrono::high_resolution_clock::now();
+    ::WaitForSingleObjectEx(m_frame_latency_waitable, 1000, TRUE);
+    std::chrono::duration<double> pacing_wait = std::chrono::high_resolution_clock::now() - pacing_start;
+    m_latency_stats.total_pacing_wait += pacing_wait.count();
+
+    // The resources of the frame are reused once its last frame has completed, which the pacing should already have waited for
     RenderBuffer& backbuffer = m_backbuffers[m_current_backbuffer_idx];
-    CommandList command_list = m_command_queue.GetCommandList();
+    if (!m_command_queue.IsFenceComplete(backbuffer.GetFenceValue())) {
+        ++m_latency_stats.num_fence_waits;
+        m_command_queue.WaitForFenceValue(backbuffer.GetFenceValue());
+    }
+
+    // The inputs of the frames whose present has completed have reached the screen
+    auto now = std::chrono::high_resolution_clock::now();
+    for (unsigned int i = 0; i < s_num_frames; ++i) {
+        if (m_frame_input_times[i] == std::chrono::high_resolution_clock::time_point() || !m_command_queue.IsFenceComplete(m_backbuffers[i].GetFenceValue()))
+            continue;
+
+        std::chrono::duration<double> input_latency = now - m_frame_input_times[i];
+        m_latency_stats.total_input_latency += input_latency.count();
+        m_latency_stats.max_input_latency = std::max(m_latency_stats.max_input_latency, input_latency.count());
+        ++m_latency_stats.num_inputs;
+        m_frame_input_times[i] = std::chrono::high_resolution_clock::time_point();
+    }
+    if (++m_latency_stats.num_frames == s_latency_report_frames) {
+        ReportLatencyStats(L"Renderer::Render()");
+        m_latency_stats = {};
+    }
+
+    m_num_frame_lists = 0;
+    CommandList command_list = AcquireCommandList();
+
+    // Upload stats are per frame
+    UploadAllocator* upload_allocator = m_command_queue.GetUploadAllocator();
+    if (upload_allocator->GetStats().num_allocations > 0)
+        upload_allocator->ReportStats(L"Renderer::Render()");
+    upload_allocator->ResetStats();
+
+    // As well as the objects reclaimed from the deferred release queue
+    DeferredReleaseQueue* release_queue = m_command_queue.GetReleaseQueue();
+    if (release_queue->GetStats().num_released > 0)
+        release_queue->ReportStats(L"Renderer::Render()");
+    release_queue->ResetStats();
 
     // Set descriptor heaps once here
     command_list.SetDescriptorHeaps({&m_cbv_srv_descriptor_heap, TextureLibrary::GetSamplerHeap()});
 
+    // The fence of this frame has completed, so its constant data can be overwritten
+    m_constant_allocator.BeginFrame(m_current_backbuffer_idx);
+
+    // Shrink or restore textures to stay within the memory budget
+    GetResidencyManager()->BeginFrame(m_current_backbuffer_idx, m_command_queue, command_list);
+
     //// Update the scene cbv
-    m_scene->Update(m_current_backbuffer_idx, m_camera);
+    m_scene->Update(m_current_backbuffer_idx, m_camera, m_constant_allocator);
+
+    // The command lists of the frame in execution order, the draws of the depth map and scene passes may be recorded
+    // on lists of their own by worker threads
+    std::vector<CommandList> command_lists;
+    unsigned int num_record_threads = m_benchmark_threads ? m_benchmark_threads : GetNumRecordThreads();
+    bool use_bundles = m_benchmark_threads ? m_benchmark_bundles : s_use_bundles;
+    m_depthmap_pipeline.SetUseBundles(use_bundles);
+    m_scene_pipeline.SetUseBundles(use_bundles);
+    m_scene_pipeline.SetUseIndirectDraws(s_use_indirect_draws);
+    auto record_start = std::chrono::high_resolution_clock::now();
 
     // Run depth map pipeline
+    m_transient_allocator.BeginPass(RENDER_PASS_DEPTHMAP, m_current_backbuffer_idx, command_list);
     m_depthmap_pipeline.Clear(command_list);
-    m_depthmap_pipeline.Render(m_current_backbuffer_idx, command_list);
+    RecordPass(m_depthmap_pipeline, command_list, command_lists, num_record_threads);
+    // The scene pass samples the depth map, its transition overlaps with the clears until the pass ends it
+    m_scene->GetDirectionalLightDepthMap()->BeginTransition(command_list, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 
     ////// Run Scene pipeline
+    m_transient_allocator.BeginPass(RENDER_PASS_SCENE, m_current_backbuffer_idx, command_list);
     m_scene_pipeline.SetRenderTargets({ m_render_textures[m_current_backbuffer_idx]}, &m_depth_buffer);
     m_scene_pipeline.Clear(command_list);
-    m_scene_pipeline.Render(m_current_backbuffer_idx, command_list);
+    RecordPass(m_scene_pipeline, command_list, command_lists, num_record_threads);
+    // Likewise the render texture for the image pass
+    m_render_textures[m_current_backbuffer_idx]->BeginTransition(command_list, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+    std::chrono::duration<double> record_time = std::chrono::high_resolution_clock::now() - record_start;
+    UpdateRecordBenchmark(record_time.count());
 
     //// Run image pipeline
+    m_transient_allocator.BeginPass(RENDER_PASS_IMAGE, m_current_backbuffer_idx, command_list);
     m_img_pipeline.SetRenderTargets({ &backbuffer }, nullptr);
     m_img_pipeline.Clear(command_list);
     m_img_pipeline.Render(m_current_backbuffer_idx, command_list);
@@ -149,29 +301,204 @@ void Renderer::Render()
     {
         backbuffer.Present(command_list);
 
-        m_command_queue.ExecuteCommandList(command_list);
+        command_lists.push_back(std::move(command_list));
+        m_command_queue.ExecuteCommandLists(command_lists);
+
+        // Allocators are only created while a frame records more command lists than it did before
+        CommandAllocatorPool* allocator_pool = m_command_queue.GetAllocatorPool();
+        if (m_num_frame_lists > m_max_frame_lists[m_current_backbuffer_idx]) {
+            m_max_frame_lists[m_current_backbuffer_idx] = m_num_frame_lists;
+        }
+        else if (allocator_pool->GetStats().num_created > 0) {
+            allocator_pool->ReportStats(L"Renderer::Render(): command allocators created after warm-up");
+            assert(false && "Command allocators created after warm-up");
+        }
+        allocator_pool->ResetStats();
+
+        // Report the barriers of the frame when they change
+        const CommandList::BarrierStats& barrier_stats = m_command_queue.GetBarrierStats();
+        if (barrier_stats.num_requested != m_barrier_stats.num_requested || barrier_stats.num_recorded != m_barrier_stats.num_recorded || barrier_stats.num_calls != m_barrier_stats.num_calls) {
+            wchar_t buffer[500];
+            swprintf_s(buffer, 500, L"Renderer::Render(): %llu barriers queued, %llu recorded with %llu ResourceBarrier calls\n",
+                barrier_stats.num_requested, barrier_stats.num_recorded, barrier_stats.num_calls);
+            OutputDebugString(buffer);
+            m_barrier_stats = barrier_stats;
+        }
+        m_command_queue.ResetBarrierStats();
 
         UINT sync_interval = m_vsync ? 1 : 0;
         UINT present_flags = m_tearing_supported && !m_vsync ? DXGI_PRESENT_ALLOW_TEARING : 0;
         ThrowIfFailed(m_swap_chain->Present(sync_interval, present_flags));
 
+        // The frame is done once the queue has passed the present, the value continues the fence values of the command lists
+        // so the deferred releases keyed on them stay in order
+        backbuffer.SetFenceValue(m_command_queue.Signal());
 
-        const uint64_t fence_value = m_backbuffers[m_current_backbuffer_idx].GetFenceValue();
-        m_command_queue.Signal(fence_value);
-        // update frameidx
+        // The frame shows the inputs since the last frame
+        m_frame_input_times[m_current_backbuffer_idx] = m_input_time;
+        m_input_time = std::chrono::high_resolution_clock::time_point();
+
+        // update frameidx, the next frame waits for its resources when it starts
         m_current_backbuffer_idx = m_swap_chain->GetCurrentBackBufferIndex();
+    }
+}
+
+
+CommandList Renderer::AcquireCommandList()
+{
+    // The lists are acquired in the order they are submitted, so the position is the recording context
+    return m_command_queue.GetCommandList(m_current_backbuffer_idx, m_num_frame_lists++);
+}
+
+void Renderer::OnInput()
+{
+    if (m_input_time == std::chrono::high_resolution_clock::time_point())
+        m_input_time = std::chrono::high_resolution_clock::now();
+}
+
+void Renderer::ReportLatencyStats(const wchar_t* name) const
+{
+    double average_latency = m_latency_stats.num_inputs ? m_latency_stats.total_input_latency / m_latency_stats.num_inputs : 0.0;
+    double average_pacing_wait = m_latency_stats.num_frames ? m_latency_stats.total_pacing_wait / m_latency_stats.num_frames : 0.0;
+
+    wchar_t buffer[500];
+    swprintf_s(buffer, 500, L"%s: %u frames in flight with a frame latency of %u, input to present %f ms (max %f ms) over %u inputs, "
+        L"waited %f ms per frame for the swap chain, %u of %u frames waited for their fence\n", name, s_num_frames, GetMaxFrameLatency(),
+        average_latency * 1e3, m_latency_stats.max_input_latency * 1e3, m_latency_stats.num_inputs, average_pacing_wait * 1e3,
+        m_latency_stats.num_fence_waits, m_latency_stats.num_frames);
+    OutputDebugString(buffer);
+}
+
+void Renderer::SetNumFrames(unsigned int num_frames)
+{
+    if (num_frames < s_min_frames || num_frames > s_max_frames)
+        throw std::exception("Renderer::SetNumFrames(): Number of frames in flight out of range");
+    if (s_max_frame_latency >= num_frames)
+        throw std::exception("Renderer::SetNumFrames(): Frame latency not below the number of frames in flight");
+
+    s_num_frames = num_frames;
+}
+
+void Renderer::SetMaxFrameLatency(unsigned int max_frame_latency)
+{
+    // A latency of the frames in flight or more never waits on the swap chain, the fences pace the frames instead
+    if (max_frame_latency >= s_num_frames)
+        throw std::exception("Renderer::SetMaxFrameLatency(): Frame latency out of range");
+
+    s_max_frame_latency = max_frame_latency;
+}
 
-        // Wait
-        m_command_queue.WaitForFenceValue(m_backbuffers[m_current_backbuffer_idx].GetFenceValue());
-        m_backbuffers[m_current_backbuffer_idx].SetFenceValue(fence_value + 1);
+unsigned int Renderer::GetMaxFrameLatency()
+{
+    if (s_max_frame_latency > 0)
+        return s_max_frame_latency;
+
+    return s_num_frames - 1;
+}
+
+void Renderer::RecordPass(IParallelPipeline& pipeline, CommandList& command_list, std::vector<CommandList>& command_lists, unsigned int num_threads)
+{
+    pipeline.Prepare(m_current_backbuffer_idx, command_list);
+
+    // Small passes are not worth the extra command lists
+    size_t num_draws = pipeline.GetNumDraws();
+    num_threads = static_cast<unsigned int>(std::min<size_t>(num_threads, num_draws / s_min_draws_per_thread));
+    if (num_threads <= 1) {
+        pipeline.SetRootState(m_current_backbuffer_idx, command_list);
+        pipeline.RecordDraws(m_current_backbuffer_idx, command_list, 0, num_draws);
+        return;
     }
+
+    // The command queue is only used by this thread, so the lists and their allocators are acquired here
+    // and each job records into its own
+    std::vector<CommandList> thread_lists;
+    thread_lists.reserve(num_threads);
+    for (unsigned int thread_idx = 0; thread_idx < num_threads; ++thread_idx) {
+        thread_lists.push_back(AcquireCommandList());
+        thread_lists.back().SetDescriptorHeaps({ &m_cbv_srv_descriptor_heap, TextureLibrary::GetSamplerHeap() });
+    }
+
+    // State does not carry over between command lists, every list sets up the pass before its range of draws
+    // The calling thread records the first range
+    JobSystem::Get()->ParallelFor(0, num_threads, 1, [&](size_t begin, size_t end) {
+        for (size_t thread_idx = begin; thread_idx < end; ++thread_idx) {
+            size_t draws_begin = num_draws * thread_idx / num_threads;
+            size_t draws_end = num_draws * (thread_idx + 1) / num_threads;
+            pipeline.SetRootState(m_current_backbuffer_idx, thread_lists[thread_idx]);
+            pipeline.RecordDraws(m_current_backbuffer_idx, thread_lists[thread_idx], draws_begin, draws_end);
+        }
+    });
+
+    // The prepared list runs before the draws, the rest of the frame continues on a new list
+    command_lists.push_back(std::move(command_list));
+    command_lists.insert(command_lists.end(), std::make_move_iterator(thread_lists.begin()), std::make_move_iterator(thread_lists.end()));
+    command_list = AcquireCommandList();
+    command_list.SetDescriptorHeaps({ &m_cbv_srv_descriptor_heap, TextureLibrary::GetSamplerHeap() });
+}
+
+void Renderer::UpdateRecordBenchmark(double record_time)
+{
+    // Start once every item is drawn, so each thread count records the same draws
+    if (m_benchmark_threads == 0) {
+        if (s_record_benchmark && m_scene->IsLoaded()) {
+            s_record_benchmark = false;
+            m_benchmark_threads = 1;
+            m_benchmark_frame = 0;
+            m_benchmark_time = 0.0;
+            m_benchmark_bundles = false;
+        }
+        return;
+    }
+
+    m_benchmark_time += record_time;
+    if (++m_benchmark_frame < s_benchmark_frames)
+        return;
+
+    double frame_time = m_benchmark_time / s_benchmark_frames;
+    m_benchmark_frame = 0;
+    m_benchmark_time = 0.0;
+
+    // Each thread count records the draws directly first, then replays the bundles
+    BundleCache& depthmap_bundles = m_depthmap_pipeline.GetBundleCache();
+    BundleCache& scene_bundles = m_scene_pipeline.GetBundleCache();
+    if (!m_benchmark_bundles) {
+        if (m_benchmark_threads == 1)
+            m_benchmark_reference_time = frame_time;
+        m_benchmark_direct_time = frame_time;
+        m_benchmark_bundles = true;
+        depthmap_bundles.ResetStats();
+        scene_bundles.ResetStats();
+        return;
+    }
+
+    // Bundles are only replayed while the camera does not change the draws
+    uint64_t num_replayed = depthmap_bundles.GetStats().num_replayed + scene_bundles.GetStats().num_replayed;
+    uint64_t num_recorded = depthmap_bundles.GetStats().num_recorded + scene_bundles.GetStats().num_recorded;
+    wchar_t buffer[500];
+    swprintf_s(buffer, 500, L"Renderer: recording %zu items with %u threads, %f ms, %fx speedup; with bundles %f ms, saved %f ms per frame, "
+        L"replayed %llu of %llu bundles\n", m_scene->GetSceneItems().size(), m_benchmark_threads, m_benchmark_direct_time * 1e3,
+        m_benchmark_reference_time / std::max(m_benchmark_direct_time, 1e-9), frame_time * 1e3, (m_benchmark_direct_time - frame_time) * 1e3,
+        num_replayed, num_replayed + num_recorded);
+    OutputDebugString(buffer);
+
+    unsigned int max_threads = JobSystem::Get()->GetNumWorkers();
+    m_benchmark_threads = m_benchmark_threads < max_threads ? m_benchmark_threads + 1 : 0;
+    m_benchmark_bundles = false;
+}
+
+unsigned int Renderer::GetNumRecordThreads()
+{
+    if (s_num_record_threads > 0)
+        return s_num_record_threads;
+
+    return JobSystem::Get()->GetNumWorkers();
 }
 
 
 void Renderer::LoadSizeDependentResources(unsigned int width, unsigned int height)
 {
     // Create the backbuffers (renderbuffers)
-    for (int i = 0; i < s_num_frames; ++i)
+    for (unsigned int i = 0; i < s_num_frames; ++i)
     {
         m_backbuffers[i].Create(m_swap_chain, i);
         if (!m_initialized)
@@ -188,7 +515,7 @@ void Renderer::LoadSizeDependentResources(unsigned int width, unsigned int heigh
     }
     
 
-    for (int i = 0; i < s_num_frames; ++i)
+    for (unsigned int i = 0; i < s_num_frames; ++i)
     {
         if (m_render_textures[i])
             m_render_textures[i]->Resize(width, height);
@@ -208,18 +535,15 @@ void Renderer::LoadSizeDependentResources(unsigned int width, unsigned int heigh
 void Renderer::Resize(uint32_t width, uint32_t height) 
 {
     // Flush the GPU queue to make sure the swap chain's back buffers
-        // are not being referenced by an in-flight command list.
-    //m_command_queue.Flush();
-    uint64_t fence_value = m_backbuffers[m_current_backbuffer_idx].GetFenceValue();
-    m_command_queue.Signal(fence_value);
-    m_command_queue.WaitForFenceValue(fence_value);
+    // are not being referenced by an in-flight command list.
+    // The swap chain requires this, the other resources replaced below are released through the deferred release queue
+    m_command_queue.Flush();
 
-    for (int i = 0; i < s_num_frames; ++i)
+    for (unsigned int i = 0; i < s_num_frames; ++i)
     {
         // Any references to the back buffers must be released
         // before the swap chain can be resized.
         m_backbuffers[i].Destroy();
-        m_backbuffers[i].SetFenceValue(fence_value + 1);
     }
 
     // Resize backbuffers (renderbuffers)
@@ -233,4 +557,7 @@ void Renderer::Resize(uint32_t width, uint32_t height)
     m_height = height;
     // Resize size dependent resources
     LoadSizeDependentResources(width, height);
+
+    // The resized render targets are created outside of the transient heap
+    AllocateTransientResources();
 }
@@ -5,7 +5,9 @@
 #include <dxgi1_6.h>
 #include <wrl.h>
 
-#include <array>
+#include <chrono>
+#include <memory>
+#include <vector>
 
 #include "commandqueue.h"
 #include "camera.h"
@@ -13,29 +15,80 @@
 #include "buffer.h"
 #include "descriptorheap.h"
 #include "pipeline.h"
+#include "linearallocator.h"
+#include "transientallocator.h"
 
 // Forward declaration
 class Scene;
 class GUI;
+class HeapAllocator;
+class ResidencyManager;
 
 class Renderer {
 public:
-    static constexpr unsigned int s_num_frames = 3;
+    // Range of the number of frames in flight, chosen at startup
+    static constexpr unsigned int s_min_frames = 2;
+    static constexpr unsigned int s_max_frames = 4;
+
+    // Frames between the reports of the input to present latency
+    static constexpr unsigned int s_latency_report_frames = 600;
+
+    struct LatencyStats {
+        unsigned int num_frames;
+        unsigned int num_inputs; // frames which were the first to include an input
+        double total_input_latency; // seconds from the input to the completion of the present of its frame
+        double max_input_latency;
+        double total_pacing_wait; // seconds waited for the frame latency waitable object
+        unsigned int num_fence_waits; // frames which still had to wait for the fence of their backbuffer
+    };
+
+    // Passes of a frame in order, for the lifetimes of the transient resources
+    enum RenderPass : unsigned int {
+        RENDER_PASS_DEPTHMAP = 0,
+        RENDER_PASS_SCENE,
+        RENDER_PASS_IMAGE
+    };
 
 private:
     // Making below a singleton
+    static Microsoft::WRL::ComPtr<IDXGIAdapter4> ADAPTER;
     static Microsoft::WRL::ComPtr<ID3D12Device2> DEVICE;
+    static std::unique_ptr<HeapAllocator> HEAP_ALLOCATOR;
+    static std::unique_ptr<ResidencyManager> RESIDENCY_MANAGER;
 
     // Use WARP adapter
     static bool use_warp;
 
+    // Number of backbuffers and of the per frame resources
+    static unsigned int s_num_frames;
+    // Presents queued before the frame latency waitable object blocks, 0 queues one less than the number of frames
+    static unsigned int s_max_frame_latency;
+
+    // Command lists the draws of the depth map and scene passes are split over, recorded by the job system
+    // 0 uses one per thread of the job system
+    static unsigned int s_num_record_threads;
+    // A pass is split over fewer threads so each records at least this many draws
+    static constexpr size_t s_min_draws_per_thread = 256;
+
+    // Replay the draws of the depth map and scene passes from bundles while they do not change
+    static bool s_use_bundles;
+    // Execute the draws of the scene pass from an argument buffer, bundles are then only used by the depth map pass
+    static bool s_use_indirect_draws;
+
+    // Time the recording with 1 to every thread of the job system once the scene is loaded, without and with bundles
+    static bool s_record_benchmark;
+    static constexpr unsigned int s_benchmark_frames = 100;
+
     Microsoft::WRL::ComPtr<IDXGISwapChain4> m_swap_chain;
     DescriptorHeap m_rtv_descriptor_heap;
     unsigned int m_current_backbuffer_idx;
-    std::array<RenderBuffer, s_num_frames> m_backbuffers;
+    std::vector<RenderBuffer> m_backbuffers;
+
+    // Signaled when the swap chain can queue another present, paces the frames instead of the fences
+    HANDLE m_frame_latency_waitable;
 
     // Render textures
-    std::array<RenderTargetTexture*, s_num_frames> m_render_textures;
+    std::vector<RenderTargetTexture*> m_render_textures;
 
     // Depth buffer
     DepthBuffer m_depth_buffer;
@@ -48,6 +101,12 @@ private:
     // direct queue
     CommandQueue m_command_queue;
 
+    // Dynamic constant data of the frames, recycled once the fence of the frame has completed
+    LinearAllocator m_constant_allocator;
+
+    // Shared memory of the render textures, the depth buffer and the shadow map
+    TransientAllocator m_transient_allocator;
+
     DepthMapPipeline m_depthmap_pipeline;
     ScenePipeline m_scene_pipeline;
     ImagePipeline m_img_pipeline;
@@ -70,6 +129,30 @@ private:
 
     uint32_t m_width, m_height;
 
+    // Command lists acquired by the current frame, and the most each frame has recorded for the allocator warm-up
+    unsigned int m_num_frame_lists;
+    std::vector<unsigned int> m_max_frame_lists;
+
+    // Barriers of the last frame, reported when they change
+    CommandList::BarrierStats m_barrier_stats;
+
+    // Oldest input which no frame has included yet, and the input of each backbuffer until its present has completed
+    std::chrono::high_resolution_clock::time_point m_input_time;
+    std::vector<std::chrono::high_resolution_clock::time_point> m_frame_input_times;
+    LatencyStats m_latency_stats;
+
+    // Recording thread scaling benchmark, the thread count being measured or 0 when not running
+    unsigned int m_benchmark_threads;
+    unsigned int m_benchmark_frame;
+    double m_benchmark_time;
+    double m_benchmark_reference_time;
+    // Whether the thread count is being measured with bundles, after the time without them
+    bool m_benchmark_bundles;
+    double m_benchmark_direct_time;
+
+    // Frame region of the linear allocator for the data the pipelines write per scene item
+    static uint64_t GetConstantFrameCapacity(const Scene* scene);
+
 public:
     Renderer(HWND hWnd, uint32_t width, uint32_t height, Scene* scene, GUI* gui, bool use_warp = false);
     ~Renderer();
@@ -77,6 +160,28 @@ public:
     // Singleton device
     static Microsoft::WRL::ComPtr<ID3D12Device2> GetDevice();
 
+    // Adapter of the device, for the video memory budget
+    static Microsoft::WRL::ComPtr<IDXGIAdapter4> GetAdapter();
+
+    // Singleton allocator for the default heap resources
+    static HeapAllocator* GetHeapAllocator();
+
+    // Singleton accounting of the GPU memory budget
+    static ResidencyManager* GetResidencyManager();
+
+    // To be called before the renderer and the resources are created
+    static void SetNumFrames(unsigned int num_frames);
+    static unsigned int GetNumFrames() { return s_num_frames; }
+    // Below the number of frames in flight, 0 uses one less than the frames in flight
+    static void SetMaxFrameLatency(unsigned int max_frame_latency);
+    static unsigned int GetMaxFrameLatency();
+
+    static void SetNumRecordThreads(unsigned int num_threads) { s_num_record_threads = num_threads; }
+    static unsigned int GetNumRecordThreads();
+    static void SetUseBundles(bool use_bundles) { s_use_bundles = use_bundles; }
+    static void SetUseIndirectDraws(bool use_indirect_draws) { s_use_indirect_draws = use_indirect_draws; }
+    static void SetRecordBenchmark(bool record_benchmark) { s_record_benchmark = record_benchmark; }
+
     // bind once for the shader visible descriptorheap 
     void Bind(Scene* scene); // be able to bind to new scene
 
@@ -86,9 +191,28 @@ public:
     void Resize(uint32_t width, uint32_t height);
     void ToggleVsync() { m_vsync = !m_vsync; }
 
+    // An input changed what the next frame shows, for the input to present latency
+    void OnInput();
+
+    // Report the input to present latency and the frame pacing since the last report with OutputDebugString
+    void ReportLatencyStats(const wchar_t* name) const;
+
 private:
     void BindGuiData();
     void SetupPipelines();
+
+    // Declare the lifetimes of the render targets and place them in the transient heap
+    void AllocateTransientResources();
+
+    // Command list of the next recording context of the frame, with an allocator from the pool of the frame and context
+    CommandList AcquireCommandList();
+
+    // Record the pass on the command list, or split its draws over command lists recorded by jobs
+    // The worker lists and the command list are appended to command_lists in order and replaced by a new one
+    void RecordPass(IParallelPipeline& pipeline, CommandList& command_list, std::vector<CommandList>& command_lists, unsigned int num_threads);
+
+    // Time the recording of the passes for the benchmark and move on to bundles or the next thread count
+    void UpdateRecordBenchmark(double record_time);
 };
 
 
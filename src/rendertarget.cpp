@@ -3,6 +3,7 @@
 #include "utility.h"
 #include "renderer.h"
 #include "commandlist.h"
+#include "heapallocator.h"
 
 // Interface RenderTarget DepthStencil variables
 float IRenderTarget::s_clear_value[4] = { 0.4f, 0.6f, 0.9f, 1.0f };
@@ -41,7 +42,7 @@ void IDepthStencilTarget::ResourceChanged(ID3D12Resource* resource)
 // RenderBuffer
 void RenderBuffer::Create(const Microsoft::WRL::ComPtr<IDXGISwapChain4>& swap_chain, unsigned int frame_idx) 
 {
-    if (frame_idx > Renderer::s_num_frames)
+    if (frame_idx >= Renderer::GetNumFrames())
         throw std::exception("RenderBuffer::Create(): Out of frame index range");
 
     Microsoft::WRL::ComPtr<ID3D12Device2> device = Renderer::GetDevice();
@@ -50,6 +51,7 @@ void RenderBuffer::Create(const Microsoft::WRL::ComPtr<IDXGISwapChain4>& swap_ch
     // Set to default resource state
     m_resource_state = D3D12_RESOURCE_STATE_PRESENT;
     m_resource->SetName(L"Render Buffer");
+    TrackResidency(ResidencyPolicy::RESOURCE_CATEGORY_RENDER_TARGET);
 
     // Specifically due to how render buffer needs to be resized
     if (m_rtv_handle.ptr) // Check if it was already bound
@@ -74,23 +76,27 @@ void DepthBuffer::Create(DXGI_FORMAT format, uint32_t width, uint32_t height)
     optimized_clear_value.Format = format;
     optimized_clear_value.DepthStencil = IDepthStencilTarget::s_clear_value;
 
-    Microsoft::WRL::ComPtr<ID3D12Device2> device = Renderer::GetDevice();
-    auto heap_props = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
     auto resource_desc = CD3DX12_RESOURCE_DESC::Tex2D(format, width, height, 1, 0, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
-
-    ThrowIfFailed(device->CreateCommittedResource(
-        &heap_props,
-        D3D12_HEAP_FLAG_NONE,
-        &resource_desc,
-        D3D12_RESOURCE_STATE_DEPTH_WRITE,
-        &optimized_clear_value,
-        IID_PPV_ARGS(&m_resource)
-    ));
+    m_resource = Renderer::GetHeapAllocator()->CreateResource(resource_desc, D3D12_RESOURCE_STATE_DEPTH_WRITE, &optimized_clear_value, m_allocation);
 
     // Update resource state
     m_resource_state = D3D12_RESOURCE_STATE_DEPTH_WRITE;
     m_format = format;
     m_resource->SetName(L"Depth Stencil Buffer");
+    TrackResidency(ResidencyPolicy::RESOURCE_CATEGORY_RENDER_TARGET);
+}
+
+GpuResource DepthBuffer::PlaceResource(ID3D12Heap* heap, uint64_t offset)
+{
+    D3D12_CLEAR_VALUE optimized_clear_value = {};
+    optimized_clear_value.Format = m_format;
+    optimized_clear_value.DepthStencil = IDepthStencilTarget::s_clear_value;
+
+    GpuResource previous = CreatePlacedResource(heap, offset, &optimized_clear_value);
+    IDepthStencilTarget::ResourceChanged(m_resource.Get());
+
+    m_resource->SetName(L"Transient Depth Stencil Buffer");
+    return previous;
 }
 
 void DepthBuffer::ClearDepthStencil(CommandList& command_list) 
@@ -124,4 +124,6 @@ public:
         Create(m_format, width, height);
         IDepthStencilTarget::ResourceChanged(m_resource.Get());
     }
+
+    virtual GpuResource PlaceResource(ID3D12Heap* heap, uint64_t offset) override;
 };
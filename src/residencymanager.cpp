@@ -0,0 +1,136 @@
+#include "residencymanager.h"
+
+#include <algorithm>
+
+#include "utility.h"
+#include "renderer.h"
+#include "texture.h"
+#include "commandqueue.h"
+
+uint64_t ResidencyManager::s_simulated_budget = 0;
+
+
+ResidencyHandle::~ResidencyHandle()
+{
+    m_manager->Untrack(m_id);
+}
+
+void ResidencyHandle::MarkUsed()
+{
+    m_manager->MarkUsed(m_id);
+}
+
+void ResidencyHandle::SetSize(uint64_t size)
+{
+    m_manager->SetSize(m_id, size);
+}
+
+
+std::shared_ptr<ResidencyHandle> ResidencyManager::Track(ResidencyPolicy::ResourceCategory category, uint64_t size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t id = m_policy.Add(category, size, m_frame);
+    return std::make_shared<ResidencyHandle>(this, id);
+}
+
+void ResidencyManager::SetEvictable(Texture* texture)
+{
+    unsigned int max_evicted_mips = texture->GetMaxEvictedMips();
+    if (max_evicted_mips == 0 || !texture->GetResidencyHandle())
+        return;
+
+    uint64_t id = texture->GetResidencyHandle()->GetId();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_textures[id] = texture;
+    m_policy.SetEvictable(id, max_evicted_mips);
+}
+
+void ResidencyManager::BeginFrame(unsigned int frame_idx, CommandQueue& command_queue, CommandList& command_list)
+{
+    // The budget of the adapter changes with the other applications using the GPU
+    DXGI_QUERY_VIDEO_MEMORY_INFO memory_info{};
+    ThrowIfFailed(Renderer::GetAdapter()->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &memory_info));
+
+    std::vector<std::pair<Texture*, unsigned int>> changes;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_frame;
+        m_memory_info = memory_info;
+        m_budget = s_simulated_budget ? s_simulated_budget : memory_info.Budget;
+
+        // Rebind the descriptors of this frame to the recreated textures, the previous resource is released once every frame has been rebound
+        std::erase_if(m_retired_textures, [frame_idx, &command_queue](RetiredTexture& retired) {
+            if (retired.texture)
+                retired.texture->RebindShaderResourceView(frame_idx);
+            if (retired.num_frames_left > 0 && --retired.num_frames_left > 0)
+                return false;
+
+            command_queue.ReleaseDeferred(std::move(retired.resource));
+            return true;
+        });
+
+        for (const ResidencyPolicy::Action& action : m_policy.Evaluate(m_budget))
+            changes.push_back({ m_textures[action.id], action.num_evicted_mips });
+    }
+
+    // Recreating a texture sets its new size through its handle, so it is done without the lock
+    for (auto& [texture, num_evicted_mips] : changes) {
+        GpuResource previous = texture->SetEvictedMips(num_evicted_mips, frame_idx, command_list);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_retired_textures.push_back({ texture, std::move(previous), Renderer::GetNumFrames() - 1 });
+    }
+
+    if (!changes.empty())
+        ReportStats(L"ResidencyManager::BeginFrame()");
+}
+
+void ResidencyManager::ReportStats(const wchar_t* name) const
+{
+    ResidencyPolicy::Stats stats;
+    uint64_t budget, budgeted_bytes;
+    DXGI_QUERY_VIDEO_MEMORY_INFO memory_info;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        stats = m_policy.GetStats();
+        budget = m_budget;
+        budgeted_bytes = m_policy.GetBudgetedBytes();
+        memory_info = m_memory_info;
+    }
+
+    wchar_t buffer[500];
+    swprintf_s(buffer, 500, L"%s: %llu of %llu budget bytes used by %llu resources (textures %llu, meshes %llu, render targets %llu, upload %llu bytes), "
+        L"%llu mip levels dropped, %llu evictions and %llu restores in total, adapter usage %llu of %llu bytes\n", name,
+        budgeted_bytes, budget, stats.num_resources, stats.category_bytes[ResidencyPolicy::RESOURCE_CATEGORY_TEXTURE],
+        stats.category_bytes[ResidencyPolicy::RESOURCE_CATEGORY_MESH], stats.category_bytes[ResidencyPolicy::RESOURCE_CATEGORY_RENDER_TARGET],
+        stats.category_bytes[ResidencyPolicy::RESOURCE_CATEGORY_UPLOAD], stats.num_evicted_mips, stats.num_evictions, stats.num_restores,
+        memory_info.CurrentUsage, memory_info.Budget);
+    OutputDebugString(buffer);
+}
+
+void ResidencyManager::Untrack(uint64_t id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_policy.Remove(id);
+
+    // The previous resources of a destroyed texture are still released after the frames, without rebinding
+    auto texture = m_textures.find(id);
+    if (texture != m_textures.end()) {
+        for (RetiredTexture& retired : m_retired_textures) {
+            if (retired.texture == texture->second)
+                retired.texture = nullptr;
+        }
+        m_textures.erase(texture);
+    }
+}
+
+void ResidencyManager::MarkUsed(uint64_t id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_policy.MarkUsed(id, m_frame);
+}
+
+void ResidencyManager::SetSize(uint64_t id, uint64_t size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_policy.SetSize(id, size);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <d3d12.h>
+#include <dxgi1_6.h>
+#include <wrl.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "buffer.h"
+#include "residencypolicy.h"
+
+// Forward declaration
+class ResidencyManager;
+class Texture;
+class CommandList;
+class CommandQueue;
+
+// Entry of a resource in the residency manager, removed when the last GpuResource referring to it is destroyed
+class ResidencyHandle {
+private:
+    ResidencyManager* m_manager;
+    uint64_t m_id;
+
+public:
+    ResidencyHandle(ResidencyManager* manager, uint64_t id) : m_manager(manager), m_id(id) {}
+    ~ResidencyHandle();
+
+    ResidencyHandle(const ResidencyHandle&) = delete;
+    ResidencyHandle& operator=(const ResidencyHandle&) = delete;
+
+    void MarkUsed();
+    void SetSize(uint64_t size);
+
+    uint64_t GetId() const { return m_id; }
+};
+
+// Accounts the size and last use of every GPU resource and compares them against the video memory budget of the adapter
+// Under pressure the least recently used textures are recreated without their top mip levels, which are uploaded again
+// from the decoded image once there is room. Render targets, meshes and upload buffers are only accounted
+class ResidencyManager {
+private:
+    // Resource replaced by a texture with a different number of mip levels, the descriptors of the other frames
+    // still refer to it until they are rebound at the start of their frame. It is then handed to the deferred release
+    // queue, which keeps it until the frames recorded with the previous descriptors have completed
+    struct RetiredTexture {
+        Texture* texture; // nullptr once the texture has been destroyed
+        GpuResource resource;
+        unsigned int num_frames_left;
+    };
+
+    ResidencyPolicy m_policy;
+
+    // Textures which can drop mip levels by policy id
+    std::unordered_map<uint64_t, Texture*> m_textures;
+    std::vector<RetiredTexture> m_retired_textures;
+
+    uint64_t m_frame;
+    uint64_t m_budget; // of the last frame
+    DXGI_QUERY_VIDEO_MEMORY_INFO m_memory_info;
+
+    // Resources are created and destroyed by the asset loader threads as well
+    mutable std::mutex m_mutex;
+
+    // Budget used instead of the one of the adapter, 0 if not set
+    static uint64_t s_simulated_budget;
+
+public:
+    ResidencyManager() : m_frame(0), m_budget(0), m_memory_info{} {}
+
+    ResidencyManager(const ResidencyManager&) = delete;
+    ResidencyManager& operator=(const ResidencyManager&) = delete;
+
+    // Add a resource to the accounting, the entry is removed with the returned handle
+    std::shared_ptr<ResidencyHandle> Track(ResidencyPolicy::ResourceCategory category, uint64_t size);
+
+    // Let the policy drop mip levels of the texture, once it has been uploaded
+    void SetEvictable(Texture* texture);
+
+    // Query the budget and recreate the textures chosen by the policy, the uploads are recorded in the command list of the frame
+    // The caller needs to have waited for the fence of the frame, the replaced resources are released on the command queue
+    void BeginFrame(unsigned int frame_idx, CommandQueue& command_queue, CommandList& command_list);
+
+    // Report the budget and the bytes per category with OutputDebugString
+    void ReportStats(const wchar_t* name) const;
+
+    // Pretend the adapter has a budget of the given size to test the policy, 0 uses the adapter budget
+    static void SetSimulatedBudget(uint64_t budget) { s_simulated_budget = budget; }
+
+private:
+    friend class ResidencyHandle;
+    void Untrack(uint64_t id);
+    void MarkUsed(uint64_t id);
+    void SetSize(uint64_t id, uint64_t size);
+};
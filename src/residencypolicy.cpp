@@ -0,0 +1,136 @@
+#include "residencypolicy.h"
+
+#include <algorithm>
+
+
+uint64_t ResidencyPolicy::Add(ResourceCategory category, uint64_t size, uint64_t frame)
+{
+    uint64_t id = m_next_id++;
+    m_entries[id] = { category, size, frame, 0, 0 };
+    m_stats.category_bytes[category] += size;
+    ++m_stats.num_resources;
+    return id;
+}
+
+void ResidencyPolicy::Remove(uint64_t id)
+{
+    auto it = m_entries.find(id);
+    if (it == m_entries.end())
+        return;
+
+    m_stats.category_bytes[it->second.category] -= it->second.size;
+    m_stats.num_evicted_mips -= it->second.num_evicted_mips;
+    --m_stats.num_resources;
+    m_entries.erase(it);
+}
+
+void ResidencyPolicy::MarkUsed(uint64_t id, uint64_t frame)
+{
+    auto it = m_entries.find(id);
+    if (it != m_entries.end())
+        it->second.last_used_frame = frame;
+}
+
+void ResidencyPolicy::SetSize(uint64_t id, uint64_t size)
+{
+    auto it = m_entries.find(id);
+    if (it == m_entries.end())
+        return;
+
+    m_stats.category_bytes[it->second.category] += size;
+    m_stats.category_bytes[it->second.category] -= it->second.size;
+    it->second.size = size;
+}
+
+void ResidencyPolicy::SetEvictable(uint64_t id, unsigned int max_evicted_mips)
+{
+    auto it = m_entries.find(id);
+    if (it != m_entries.end())
+        it->second.max_evicted_mips = max_evicted_mips;
+}
+
+uint64_t ResidencyPolicy::GetBudgetedBytes() const
+{
+    return m_stats.category_bytes[RESOURCE_CATEGORY_TEXTURE] + m_stats.category_bytes[RESOURCE_CATEGORY_MESH] +
+        m_stats.category_bytes[RESOURCE_CATEGORY_RENDER_TARGET];
+}
+
+std::vector<ResidencyPolicy::Action> ResidencyPolicy::Evaluate(uint64_t budget)
+{
+    std::vector<Action> actions;
+    uint64_t total = GetBudgetedBytes();
+
+    // Dropping the top level of a full mip chain leaves about a quarter of the texture, the actual size is set after the action
+    struct Candidate {
+        uint64_t id;
+        Entry* entry;
+        uint64_t size; // estimated
+    };
+    std::vector<Candidate> candidates;
+
+    if (total > budget * s_evict_threshold) {
+        for (auto& [id, entry] : m_entries) {
+            if (entry.num_evicted_mips < entry.max_evicted_mips)
+                candidates.push_back({ id, &entry, entry.size });
+        }
+
+        // Least recently used first, the larger of the same age first
+        std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+            return a.entry->last_used_frame != b.entry->last_used_frame ? a.entry->last_used_frame < b.entry->last_used_frame : a.size > b.size;
+        });
+
+        uint64_t target = static_cast<uint64_t>(budget * s_evict_target);
+        bool evicted = true;
+        while (total > target && evicted) {
+            evicted = false;
+            for (Candidate& candidate : candidates) {
+                if (total <= target)
+                    break;
+                if (candidate.entry->num_evicted_mips == candidate.entry->max_evicted_mips)
+                    continue;
+
+                uint64_t freed = candidate.size - candidate.size / 4;
+                total -= std::min(freed, total);
+                candidate.size /= 4;
+                ++candidate.entry->num_evicted_mips;
+                ++m_stats.num_evicted_mips;
+                ++m_stats.num_evictions;
+                evicted = true;
+            }
+        }
+
+        for (const Candidate& candidate : candidates) {
+            if (candidate.size != candidate.entry->size)
+                actions.push_back({ candidate.id, candidate.entry->num_evicted_mips });
+        }
+    }
+    else if (total < budget * s_restore_limit) {
+        for (auto& [id, entry] : m_entries) {
+            if (entry.num_evicted_mips > 0)
+                candidates.push_back({ id, &entry, entry.size });
+        }
+
+        // Most recently used first
+        std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+            return a.entry->last_used_frame > b.entry->last_used_frame;
+        });
+
+        // A level at a time so the resources are not restored beyond the limit at once
+        uint64_t limit = static_cast<uint64_t>(budget * s_restore_limit);
+        uint64_t restored_bytes = 0;
+        for (const Candidate& candidate : candidates) {
+            uint64_t restored_size = candidate.size * 4;
+            if (total + restored_size - candidate.size > limit || restored_bytes + restored_size > s_max_restore_bytes_per_frame)
+                continue;
+
+            total += restored_size - candidate.size;
+            restored_bytes += restored_size;
+            --candidate.entry->num_evicted_mips;
+            --m_stats.num_evicted_mips;
+            ++m_stats.num_restores;
+            actions.push_back({ candidate.id, candidate.entry->num_evicted_mips });
+        }
+    }
+
+    return actions;
+}
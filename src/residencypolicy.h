@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Decides which textures drop or restore mip levels to keep the tracked resources within a GPU memory budget
+// Budget and resources are plain byte counts stamped with frame numbers, ResidencyManager applies the returned actions
+class ResidencyPolicy {
+public:
+    enum ResourceCategory : unsigned int {
+        RESOURCE_CATEGORY_TEXTURE = 0,
+        RESOURCE_CATEGORY_MESH,
+        RESOURCE_CATEGORY_RENDER_TARGET,
+        RESOURCE_CATEGORY_UPLOAD,
+        RESOURCE_CATEGORY_COUNT
+    };
+
+    struct Entry {
+        ResourceCategory category;
+        uint64_t size;
+        uint64_t last_used_frame;
+        unsigned int num_evicted_mips; // mip levels dropped from the top of the chain
+        unsigned int max_evicted_mips; // 0 if the resource cannot be shrunk
+    };
+
+    // New number of dropped mip levels of a resource
+    struct Action {
+        uint64_t id;
+        unsigned int num_evicted_mips;
+    };
+
+    struct Stats {
+        uint64_t category_bytes[RESOURCE_CATEGORY_COUNT];
+        uint64_t num_resources;
+        uint64_t num_evicted_mips; // mip levels currently dropped over all resources
+        uint64_t num_evictions; // mip levels dropped since the start
+        uint64_t num_restores; // mip levels restored since the start
+    };
+
+    // Evict once the budget is used above the threshold, down to the target, and restore while staying below the restore limit
+    static constexpr double s_evict_threshold = 0.95;
+    static constexpr double s_evict_target = 0.85;
+    static constexpr double s_restore_limit = 0.80;
+
+    // Restored mip levels are uploaded in the frame, so the bytes restored per frame are limited
+    static constexpr uint64_t s_max_restore_bytes_per_frame = 32 * 1024 * 1024;
+
+private:
+    std::unordered_map<uint64_t, Entry> m_entries;
+    uint64_t m_next_id;
+    Stats m_stats;
+
+public:
+    ResidencyPolicy() : m_next_id(1), m_stats{} {}
+
+    // Returns the id of the new entry, used in the current frame
+    uint64_t Add(ResourceCategory category, uint64_t size, uint64_t frame);
+    void Remove(uint64_t id);
+
+    void MarkUsed(uint64_t id, uint64_t frame);
+    void SetSize(uint64_t id, uint64_t size);
+
+    // Allow the resource to drop up to max_evicted_mips mip levels
+    void SetEvictable(uint64_t id, unsigned int max_evicted_mips);
+
+    // Bytes counted against the budget, upload buffers live in system memory and are only reported
+    uint64_t GetBudgetedBytes() const;
+
+    // Least recently used resources drop a mip level per pass until the target is reached, most recently used ones are
+    // restored a level at a time when there is room. The entries are updated, the caller applies the actions and sets the new sizes
+    std::vector<Action> Evaluate(uint64_t budget);
+
+    const Stats& GetStats() const { return m_stats; }
+};
@@ -1,5 +1,9 @@
 #include "scene.h"
 
+#include <chrono>
+#include <algorithm>
+#include <atomic>
+
 #include "tinyxml2/tinyxml2.h"
 
 
@@ -8,44 +12,132 @@
 #include "camera.h"
 #include "descriptorheap.h"
 #include "utility.h"
+#include "heapallocator.h"
+#include "linearallocator.h"
+#include "residencymanager.h"
+#include "jobsystem.h"
 
 Scene::Scene() :
-	m_command_queue(CommandQueue(D3D12_COMMAND_LIST_TYPE_COPY)), m_directional_light(&m_texture_library)
+	m_scene_consts{}, m_scene_constants_address(0), m_asset_loader(&m_texture_library), m_num_resident_items(0), m_first_frame(true), m_directional_light(&m_texture_library)
 {
 }
 
 Scene::~Scene() 
 {
-	m_command_queue.Flush();
+}
+
+const MeshLod& Scene::Item::SelectLod(const Camera& camera, float max_pixel_error) const
+{
+    const std::vector<MeshLod>& lods = mesh->GetLods();
+
+    // Distance from the camera to the bounding sphere of the item
+    DirectX::XMFLOAT4 min_bounds, max_bounds;
+    mesh->GetBounds(min_bounds, max_bounds);
+    DirectX::XMVECTOR min_vec = DirectX::XMLoadFloat4(&min_bounds);
+    DirectX::XMVECTOR max_vec = DirectX::XMLoadFloat4(&max_bounds);
+    DirectX::XMVECTOR center = DirectX::XMVectorScale(DirectX::XMVectorAdd(min_vec, max_vec), 0.5f);
+    float max_scale = std::max(scale.x, std::max(scale.y, scale.z));
+    float radius = 0.5f * DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(max_vec, min_vec))) * max_scale;
+
+    DirectX::XMFLOAT4 camera_position = camera.GetPosition();
+    DirectX::XMVECTOR world_center = DirectX::XMVector3Transform(center, GetModelMatrix());
+    float distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(world_center, DirectX::XMLoadFloat4(&camera_position)))) - radius;
+    distance = std::max(distance, camera.GetNear());
+
+    float pixels_per_unit = camera.GetPixelsPerUnit(distance);
+    size_t selected = 0;
+    for (size_t i = 1; i < lods.size(); ++i) {
+        if (lods[i].error * max_scale * pixels_per_unit <= max_pixel_error)
+            selected = i;
+    }
+    return lods[selected];
 }
 
 void Scene::LoadResources() {
-    // Load all textures needs to be done after all descriptors have been allocated
-    m_texture_library.Load();
+    m_load_start = std::chrono::high_resolution_clock::now();
+
+    // Each mesh uses a single texture, which is only known once the mesh has been decoded
+    m_texture_library.ReserveTextures(m_mesh_library.GetNumMeshes());
+    m_texture_library.AllocateDescriptors();
 
-    // load mesh data from cpu to gpu
-    for (auto& item : m_items) {
-        item.mesh.Load(&m_command_queue);
+    // Read, decode and upload the meshes and their textures in the background
+    m_mesh_library.Load(&m_asset_loader);
+    m_asset_loader.Start();
+
+    // Optionally finish loading before the first frame
+    if (AssetLoader::IsBlockingLoad()) {
+        m_asset_loader.Wait();
+        UpdateResidency();
     }
+}
 
-    CreateSceneBuffer();
+void Scene::UpdateResidency()
+{
+    std::vector<Mesh*> meshes;
+    std::vector<Texture*> textures;
+    m_asset_loader.CollectResident(meshes, textures);
+    if (meshes.empty() && textures.empty())
+        return;
+
+    m_resident_meshes.insert(meshes.begin(), meshes.end());
+    for (Texture* texture : textures) {
+        m_texture_library.BindLoadedTexture(texture);
+        m_resident_textures.insert(texture);
+    }
+
+    // An item can be drawn once its mesh and all textures of the mesh are resident
+    std::atomic<size_t> num_resident_items(0);
+    JobSystem::Get()->ParallelFor(0, m_items.size(), s_update_grain_size, [&](size_t begin, size_t end) {
+        size_t num_resident = 0;
+        for (size_t i = begin; i < end; ++i) {
+            Item& item = m_items[i];
+            if (!item.resident && m_resident_meshes.contains(item.mesh)) {
+                std::vector<Texture*> mesh_textures = item.mesh->GetTextures();
+                item.resident = std::all_of(mesh_textures.begin(), mesh_textures.end(), [this](const Texture* texture) { return m_resident_textures.contains(texture); });
+            }
+            num_resident += item.resident ? 1 : 0;
+        }
+        num_resident_items += num_resident;
+    });
+    m_num_resident_items = num_resident_items;
+
+    if (m_asset_loader.IsDone()) {
+        std::chrono::duration<double> load_time = std::chrono::high_resolution_clock::now() - m_load_start;
+        wchar_t buffer[500];
+        swprintf_s(buffer, 500, L"Scene::UpdateResidency(): all %zu items resident after %f ms\n", m_items.size(), load_time.count() * 1e3);
+        OutputDebugString(buffer);
+
+        m_asset_loader.ReportStats(L"Scene::UpdateResidency()");
+        m_mesh_library.ReportStats();
+        Renderer::GetHeapAllocator()->ReportStats(L"Scene::UpdateResidency()");
+        Renderer::GetResidencyManager()->ReportStats(L"Scene::UpdateResidency()");
+    }
 }
 
-void Scene::Update(unsigned int frame_idx, const Camera& camera) 
+void Scene::Update(unsigned int frame_idx, const Camera& camera, LinearAllocator& constant_allocator) 
 {
+    UpdateResidency();
+    if (m_first_frame) {
+        m_first_frame = false;
+        std::chrono::duration<double> first_frame_time = std::chrono::high_resolution_clock::now() - m_load_start;
+        wchar_t buffer[500];
+        swprintf_s(buffer, 500, L"Scene::Update(): first frame after %f ms with %zu of %zu items resident\n", first_frame_time.count() * 1e3, m_num_resident_items, m_items.size());
+        OutputDebugString(buffer);
+    }
+
     //update scene constant buffer // needs to be transposed since row major directxmath and col major hlsl
-    m_scene_consts[frame_idx].view = DirectX::XMMatrixTranspose(camera.GetViewMatrix());
-    m_scene_consts[frame_idx].projection = DirectX::XMMatrixTranspose(camera.GetProjectionMatrix());
-    m_scene_consts[frame_idx].camera_position = camera.GetPosition();
+    m_scene_consts.view = DirectX::XMMatrixTranspose(camera.GetViewMatrix());
+    m_scene_consts.projection = DirectX::XMMatrixTranspose(camera.GetProjectionMatrix());
+    m_scene_consts.camera_position = camera.GetPosition();
 
     // update lights
     DirectX::XMFLOAT3 min_bounds, max_bounds;
-    ComputeBoundingBox(min_bounds, max_bounds);
-    m_directional_light.Update(min_bounds, max_bounds);
-    m_scene_consts[frame_idx].directional_light = m_directional_light.GetLightData();
+    if (ComputeBoundingBox(min_bounds, max_bounds))
+        m_directional_light.Update(min_bounds, max_bounds);
+    m_scene_consts.directional_light = m_directional_light.GetLightData();
 
-    // copy our ConstantBuffer instance to the mapped constant buffer resource
-    memcpy(m_scene_consts_buffer_WO[frame_idx], &m_scene_consts[frame_idx], sizeof(SceneConstantBuffer));
+    // copy our ConstantBuffer instance to the region of the frame in the linear allocator
+    m_scene_constants_address = constant_allocator.Push(m_scene_consts);
 }
 
 void Scene::Bind(FrameDescriptorHeap* descriptor_heap) 
@@ -56,61 +148,71 @@ void Scene::Bind(FrameDescriptorHeap* descriptor_heap)
     if (descriptor_heap->GetHeapType() != D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV)
         throw std::exception("Scene::Bind(): Incorrect descriptor heap type");
 
-    for (int i = 0; i < Renderer::s_num_frames; ++i)
-    {
-        // Bind all textures for each frame
+    // Bind all textures for each frame
+    for (unsigned int i = 0; i < Renderer::GetNumFrames(); ++i)
         m_texture_library.Bind(descriptor_heap, i);
-
-        // Describe and create the scene constant buffer view (CBV) and cache the GPU descriptor handle
-        descriptor_heap->Bind(&m_scene_constant_buffers[i], i);
-    }
 }
 
-void Scene::ComputeBoundingBox(DirectX::XMFLOAT3& min_bounds, DirectX::XMFLOAT3& max_bounds) 
+bool Scene::ComputeBoundingBox(DirectX::XMFLOAT3& min_bounds, DirectX::XMFLOAT3& max_bounds) 
 {
     constexpr float min_fl = std::numeric_limits<float>::min();
     constexpr float max_fl = std::numeric_limits<float>::max();
-    DirectX::XMVECTOR scene_min_bounds = DirectX::XMVectorSet(max_fl, max_fl, max_fl, 1.0f);
-    DirectX::XMVECTOR scene_max_bounds = DirectX::XMVectorSet(min_fl, min_fl, min_fl, 1.0f);
-
-    for (const auto& item : m_items) {
-        DirectX::XMFLOAT4 minb;
-        DirectX::XMFLOAT4 maxb;
-        item.mesh.GetBounds(minb, maxb);
 
-        // scale rotate translate
-        DirectX::XMMATRIX model = item.GetModelMatrix();
-        DirectX::XMVECTOR transformed_min_bounds = DirectX::XMVector4Transform(DirectX::XMLoadFloat4(&minb), model);
-        DirectX::XMVECTOR transformed_max_bounds = DirectX::XMVector4Transform(DirectX::XMLoadFloat4(&maxb), model);
+    // Bounds of each job, combined afterwards
+    struct Bounds {
+        DirectX::XMFLOAT4 min_bounds;
+        DirectX::XMFLOAT4 max_bounds;
+        bool any_resident;
+    };
+    std::vector<Bounds> chunk_bounds((m_items.size() + s_update_grain_size - 1) / s_update_grain_size,
+        { DirectX::XMFLOAT4(max_fl, max_fl, max_fl, 1.0f), DirectX::XMFLOAT4(min_fl, min_fl, min_fl, 1.0f), false });
+
+    JobSystem::Get()->ParallelFor(0, m_items.size(), s_update_grain_size, [&](size_t begin, size_t end) {
+        Bounds& bounds = chunk_bounds[begin / s_update_grain_size];
+        DirectX::XMVECTOR scene_min_bounds = DirectX::XMLoadFloat4(&bounds.min_bounds);
+        DirectX::XMVECTOR scene_max_bounds = DirectX::XMLoadFloat4(&bounds.max_bounds);
+        for (size_t i = begin; i < end; ++i) {
+            const Item& item = m_items[i];
+            if (!item.resident)
+                continue;
+            bounds.any_resident = true;
+
+            DirectX::XMFLOAT4 minb;
+            DirectX::XMFLOAT4 maxb;
+            item.mesh->GetBounds(minb, maxb);
+
+            // scale rotate translate
+            DirectX::XMMATRIX model = item.GetModelMatrix();
+            DirectX::XMVECTOR transformed_min_bounds = DirectX::XMVector4Transform(DirectX::XMLoadFloat4(&minb), model);
+            DirectX::XMVECTOR transformed_max_bounds = DirectX::XMVector4Transform(DirectX::XMLoadFloat4(&maxb), model);
+
+            // find min/max bounds
+            scene_min_bounds = DirectX::XMVectorMin(transformed_min_bounds, scene_min_bounds);
+            scene_max_bounds = DirectX::XMVectorMax(transformed_max_bounds, scene_max_bounds);
+        }
+        DirectX::XMStoreFloat4(&bounds.min_bounds, scene_min_bounds);
+        DirectX::XMStoreFloat4(&bounds.max_bounds, scene_max_bounds);
+    });
 
-        // find min/max bounds
-        scene_min_bounds = DirectX::XMVectorMin(transformed_min_bounds, scene_min_bounds);
-        scene_max_bounds = DirectX::XMVectorMax(transformed_max_bounds, scene_max_bounds);
+    DirectX::XMVECTOR scene_min_bounds = DirectX::XMVectorSet(max_fl, max_fl, max_fl, 1.0f);
+    DirectX::XMVECTOR scene_max_bounds = DirectX::XMVectorSet(min_fl, min_fl, min_fl, 1.0f);
+    bool any_resident = false;
+    for (const Bounds& bounds : chunk_bounds) {
+        if (!bounds.any_resident)
+            continue;
+        any_resident = true;
+        scene_min_bounds = DirectX::XMVectorMin(DirectX::XMLoadFloat4(&bounds.min_bounds), scene_min_bounds);
+        scene_max_bounds = DirectX::XMVectorMax(DirectX::XMLoadFloat4(&bounds.max_bounds), scene_max_bounds);
     }
 
     DirectX::XMStoreFloat3(&min_bounds, scene_min_bounds);
     DirectX::XMStoreFloat3(&max_bounds, scene_max_bounds);
+    return any_resident;
 }
 
-void Scene::CreateSceneBuffer() 
-{
-    Microsoft::WRL::ComPtr<ID3D12Device2> device = Renderer::GetDevice();
-
-    // create a resource heap, descriptor heap, and pointer to cbv for each frame
-    unsigned int constant_buffer_size = (sizeof(SceneConstantBuffer) + (D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1)) & ~(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1); // must be a multiple 256 bytes
-    for (int i = 0; i < Renderer::s_num_frames; ++i)
-    {
-        // create cbv
-        m_scene_constant_buffers[i].Create(constant_buffer_size);
-
-        CD3DX12_RANGE read_range(0, 0);    // We do not intend to read from this resource on the CPU. (End is less than or equal to begin)
-        m_scene_constant_buffers[i].Map(0, &read_range, reinterpret_cast<void**>(&m_scene_consts_buffer_WO[i]));
-    }
-}
-
-
 void Scene::ReadXmlFile(const std::string& xml_file)
 {
+    auto read_start = std::chrono::high_resolution_clock::now();
     tinyxml2::XMLDocument doc;
     doc.LoadFile(xml_file.c_str());
     tinyxml2::XMLElement* scene = doc.FirstChildElement("scene");
@@ -139,7 +241,12 @@ void Scene::ReadXmlFile(const std::string& xml_file)
     while (item) {
         // Create mesh
         std::string mesh_str = item->FirstChildElement("mesh")->FirstChild()->Value();
-        Mesh mesh = Mesh::ReadFile(mesh_str, &m_texture_library);
+        // Optional quantized vertex format, <compact>true</compact>
+        MeshImportOptions import_options;
+        tinyxml2::XMLElement* compact = item->FirstChildElement("compact");
+        if (compact)
+            compact->QueryBoolText(&import_options.compact_vertices);
+        Mesh* mesh = m_mesh_library.CreateMesh(mesh_str, import_options);
 
         // Parse position, rotation and scale
         std::string pos_str = item->FirstChildElement("position")->FirstChild()->Value();
@@ -160,12 +267,36 @@ void Scene::ReadXmlFile(const std::string& xml_file)
             throw std::exception("Incorrect number of scaling elements parsed in XML");
         DirectX::XMFLOAT4 scale(std::stof(scale_split[0]), std::stof(scale_split[1]), std::stof(scale_split[2]), 1.0f);
 
-        // Create scene item
-        Item scene_item(mesh, position, rotation, scale);
-        m_items.push_back(scene_item);
+        // Optional grid of copies on the xz plane starting at the position, <grid>columns, rows, spacing</grid>
+        unsigned int columns = 1;
+        unsigned int rows = 1;
+        float spacing = 0.0f;
+        tinyxml2::XMLElement* grid = item->FirstChildElement("grid");
+        if (grid) {
+            std::vector<std::string> grid_split = SplitString(grid->FirstChild()->Value(), ",");
+            if (grid_split.size() != 3)
+                throw std::exception("Incorrect number of grid elements parsed in XML");
+            columns = std::stoul(grid_split[0]);
+            rows = std::stoul(grid_split[1]);
+            spacing = std::stof(grid_split[2]);
+        }
+
+        // Create scene items
+        for (unsigned int row = 0; row < rows; ++row) {
+            for (unsigned int column = 0; column < columns; ++column) {
+                DirectX::XMFLOAT4 item_position(position.x + column * spacing, position.y, position.z + row * spacing, 1.0f);
+                Item scene_item(mesh, item_position, rotation, scale);
+                m_items.push_back(scene_item);
+            }
+        }
 
         // Go to next item element
         item = item->NextSiblingElement();
     }
 
+    std::chrono::duration<double> read_time = std::chrono::high_resolution_clock::now() - read_start;
+    wchar_t buffer[500];
+    swprintf_s(buffer, 500, L"Scene::ReadXmlFile(): read %zu items using %zu meshes in %f ms\n", m_items.size(), m_mesh_library.GetNumMeshes(), read_time.count() * 1e3);
+    OutputDebugString(buffer);
+
 }
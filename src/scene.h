@@ -4,31 +4,36 @@
 
 #include <vector>
 #include <array>
+#include <chrono>
+#include <unordered_set>
 
 #include "commandqueue.h"
 #include "texture.h"
 #include "renderer.h"
 #include "light.h"
+#include "mesh.h"
+#include "assetloader.h"
 
 
 // Forward declaration
-class Mesh;
 class Camera;
 class UploadBuffer;
 class FrameDescriptorHeap;
+class LinearAllocator;
 
 // Scene stores the per frame resources/descriptors cached
 class Scene {
 public:
     struct Item {
-        Mesh mesh;
+        Mesh* mesh; // owned by the mesh library, shared by the items using the same file
         DirectX::XMFLOAT4 position;
         DirectX::XMFLOAT4 rotation; // quaternion
         DirectX::XMFLOAT4 scale;
+        bool resident; // the mesh and its textures have been copied to the GPU, the item is skipped until then
 
-        Item(const Mesh& mesh, const DirectX::XMFLOAT4& position = DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f), const DirectX::XMVECTOR& rotation = DirectX::XMQuaternionIdentity(), 
+        Item(Mesh* mesh, const DirectX::XMFLOAT4& position = DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f), const DirectX::XMVECTOR& rotation = DirectX::XMQuaternionIdentity(), 
             const DirectX::XMFLOAT4& scale = DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f)) :
-            mesh(mesh), position(position), scale(scale) 
+            mesh(mesh), position(position), scale(scale), resident(false) 
         {
             DirectX::XMStoreFloat4(&this->rotation, rotation);
         }
@@ -37,9 +42,15 @@ public:
             DirectX::XMVECTOR object_space_origin = DirectX::XMVectorSet(0, 0, 0, 1);
             return DirectX::XMMatrixAffineTransformation(DirectX::XMLoadFloat4(&scale), object_space_origin, DirectX::XMLoadFloat4(&rotation), DirectX::XMLoadFloat4(&position));
         }
+
+        // Coarsest level of detail whose simplification error projects to at most max_pixel_error pixels
+        const MeshLod& SelectLod(const Camera& camera, float max_pixel_error = 1.0f) const;
     };
 
 private:
+    // Items per job when the items are processed on the job system
+    static constexpr size_t s_update_grain_size = 1024;
+
     struct SceneConstantBuffer { // TODO: aligning for XMMATRIX instead of XMFLOAT4x4? https://learn.microsoft.com/en-us/cpp/cpp/align-cpp?view=msvc-170&redirectedfrom=MSDN
         DirectX::XMMATRIX view;
         DirectX::XMMATRIX projection;
@@ -48,52 +59,64 @@ private:
     };
 
     // note: DirectX matrices are row-major / HLSL matrices are column-major (needs to be transposed) https://sakibsaikia.github.io/graphics/2017/07/06/Matrix-Operations-In-Shaders.html
-    SceneConstantBuffer m_scene_consts[Renderer::s_num_frames];
-    SceneConstantBuffer* m_scene_consts_buffer_WO[Renderer::s_num_frames]; //WRITE ONLY POINTER
-    // resource to store the scene constant buffer
-    UploadBuffer m_scene_constant_buffers[Renderer::s_num_frames];
-
-	// Commandqueue for copying
-	CommandQueue m_command_queue;
+    SceneConstantBuffer m_scene_consts;
+    // copy of the scene constants in the linear allocator of the current frame
+    D3D12_GPU_VIRTUAL_ADDRESS m_scene_constants_address;
 
     // Store scene items
     std::vector<Item> m_items;
 
+    // Meshes referenced by the scene items
+    MeshLibrary m_mesh_library;
+
     // Texturemanager allocates the non-shader visible heap descriptors, texture can then be bound afterwards to copy the descriptor to shader visible heap
     TextureLibrary m_texture_library;
 
+    // Loads the meshes and textures in the background, declared after the libraries so its threads are stopped first
+    AssetLoader m_asset_loader;
+    std::unordered_set<const Mesh*> m_resident_meshes;
+    std::unordered_set<const Texture*> m_resident_textures;
+    size_t m_num_resident_items;
+
+    // Time to the first frame and until every item is resident
+    std::chrono::high_resolution_clock::time_point m_load_start;
+    bool m_first_frame;
+
     // Lights
     DirectionalLight m_directional_light;
-    D3D12_GPU_DESCRIPTOR_HANDLE m_dir_light_handles[Renderer::s_num_frames];
     //std::vector<PointLight> m_point_lights;
 
 public:
 	Scene();
 	~Scene();
 
-    // Load the resources in the scene from CPU to GPU
+    // Start loading the resources in the scene from CPU to GPU, the items become resident while rendering
     void LoadResources();
 
-    // Update the scene constant buffer for the current frame index
-    void Update(unsigned int frame_idx, const Camera& camera);
+    // Write the scene constants of the current frame to the linear allocator
+    void Update(unsigned int frame_idx, const Camera& camera, LinearAllocator& constant_allocator);
 
-    // Bind the scene constant buffer to a shader visible descriptor heap
+    // Bind the textures to a shader visible descriptor heap
     void Bind(FrameDescriptorHeap* descriptor_heap);
 
-    D3D12_GPU_DESCRIPTOR_HANDLE GetSceneConstantsHandle(unsigned int frame_idx) const { return m_scene_constant_buffers[frame_idx].GetBufferGPUHandle(); }
+    D3D12_GPU_VIRTUAL_ADDRESS GetSceneConstantsAddress() const { return m_scene_constants_address; }
     D3D12_GPU_DESCRIPTOR_HANDLE GetDirectionalLightHandle(unsigned int frame_idx) { return m_directional_light.GetDepthMap()->GetShaderGPUHandle(frame_idx); }
 
     const std::vector<Item>& GetSceneItems() const { return m_items; }
+    // Every item is resident
+    bool IsLoaded() const { return m_num_resident_items == m_items.size(); }
     DepthMapTexture* GetDirectionalLightDepthMap() { return m_directional_light.GetDepthMap(); }
 
-    void ComputeBoundingBox(DirectX::XMFLOAT3& min_bounds, DirectX::XMFLOAT3& max_bounds);
+    // Bounds of the resident items, returns false if there are none
+    bool ComputeBoundingBox(DirectX::XMFLOAT3& min_bounds, DirectX::XMFLOAT3& max_bounds);
 
-    // get number of descriptors per frame ( + 1 from constant scene buffer)
-    unsigned int GetNumFrameDescriptors() const { return m_texture_library.GetNumTextures() + 1; }
+    // get number of descriptors per frame, the scene constants are bound as root constant buffer view
+    unsigned int GetNumFrameDescriptors() const { return m_texture_library.GetNumTextures(); }
 
     void ReadXmlFile(const std::string& xml_file);
 
-    void Flush() { m_command_queue.Flush(); m_texture_library.Flush(); }
+    void Flush() { m_texture_library.Flush(); }
 private:
-    void CreateSceneBuffer();
+    // Bind the assets whose copies have completed and mark the items using them resident
+    void UpdateResidency();
 };
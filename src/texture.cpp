@@ -1,9 +1,12 @@
 #include "texture.h"
 
 #include <filesystem>
+#include <algorithm>
 
 #include "utility.h"
 #include "renderer.h"
+#include "heapallocator.h"
+#include "residencymanager.h"
 
 
 // ITexture
@@ -25,22 +28,15 @@ void ITexture::Create(D3D12_RESOURCE_DIMENSION dimension, DXGI_FORMAT format, ui
     }
 
 
-    Microsoft::WRL::ComPtr<ID3D12Device2> device = Renderer::GetDevice();
-    auto heap_props = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-
+    // Create a placed resource for the GPU resource in a default heap.
     m_use_clear_value = use_clear_value;
-    if (use_clear_value) {
+    if (use_clear_value)
         m_clear_value = clear_value;
-        // Create a committed resource for the GPU resource in a default heap.
-        ThrowIfFailed(device->CreateCommittedResource(&heap_props, D3D12_HEAP_FLAG_NONE, &m_resource_desc, m_resource_state, &clear_value,
-            IID_PPV_ARGS(&m_resource)));
-    }
-    else {
-        // Create a committed resource for the GPU resource in a default heap.
-        ThrowIfFailed(device->CreateCommittedResource(&heap_props, D3D12_HEAP_FLAG_NONE, &m_resource_desc, m_resource_state, nullptr,
-            IID_PPV_ARGS(&m_resource)));
-    }
+    m_resource = Renderer::GetHeapAllocator()->CreateResource(m_resource_desc, m_resource_state, use_clear_value ? &clear_value : nullptr, m_allocation);
     m_flags = flags;
+
+    bool render_target = flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
+    TrackResidency(render_target ? ResidencyPolicy::RESOURCE_CATEGORY_RENDER_TARGET : ResidencyPolicy::RESOURCE_CATEGORY_TEXTURE);
     
 }
 
@@ -67,9 +63,10 @@ void Texture::Upload(CommandList& command_list)
 
     Microsoft::WRL::ComPtr<ID3D12Device2> device = Renderer::GetDevice();
 
-    std::vector<D3D12_SUBRESOURCE_DATA> subresources(m_image.GetImageCount());
-    const DirectX::Image* images = m_image.GetImages();
-    for (int i = 0; i < m_image.GetImageCount(); ++i)
+    // The images of evicted mip levels are skipped, only textures with a single 2D image per level can be evicted
+    std::vector<D3D12_SUBRESOURCE_DATA> subresources(m_image.GetImageCount() - m_num_evicted_mips);
+    const DirectX::Image* images = m_image.GetImages() + m_num_evicted_mips;
+    for (int i = 0; i < subresources.size(); ++i)
     {
         auto& subresource = subresources[i];
         subresource.RowPitch = images[i].rowPitch;
@@ -83,26 +80,71 @@ void Texture::Upload(CommandList& command_list)
     command_list.UploadBufferData(required_size, m_resource.Get(), subresources.size(), subresources.data());
 }
 
-void Texture::Read(const std::wstring& file_name)
+void Texture::Decode(std::span<const uint8_t> file_data)
 {
-    std::filesystem::path file_path(file_name);
+    std::filesystem::path file_path(m_file_name);
 
-    if (!std::filesystem::exists(file_path))
-        throw std::exception("Texture::Read(): File not found");
+    if (file_data.empty())
+        throw std::exception("Texture::Decode(): No file data to decode");
 
     if (file_path.extension() == ".dds")
-        ThrowIfFailed(DirectX::LoadFromDDSFile(file_name.c_str(), DirectX::DDS_FLAGS_FORCE_RGB, &m_metadata, m_image));
+        ThrowIfFailed(DirectX::LoadFromDDSMemory(file_data.data(), file_data.size(), DirectX::DDS_FLAGS_FORCE_RGB, &m_metadata, m_image));
     else if (file_path.extension() == ".hdr")
-        ThrowIfFailed(DirectX::LoadFromHDRFile(file_name.c_str(), &m_metadata, m_image));
+        ThrowIfFailed(DirectX::LoadFromHDRMemory(file_data.data(), file_data.size(), &m_metadata, m_image));
     else if (file_path.extension() == ".tga")
-        ThrowIfFailed(DirectX::LoadFromTGAFile(file_name.c_str(), &m_metadata, m_image));
+        ThrowIfFailed(DirectX::LoadFromTGAMemory(file_data.data(), file_data.size(), &m_metadata, m_image));
     else
-        ThrowIfFailed(DirectX::LoadFromWICFile(file_name.c_str(), DirectX::WIC_FLAGS_FORCE_RGB, &m_metadata, m_image));
+        ThrowIfFailed(DirectX::LoadFromWICMemory(file_data.data(), file_data.size(), DirectX::WIC_FLAGS_FORCE_RGB, &m_metadata, m_image));
+
+    // Generate the mip chain of images without one, so the residency manager can drop the top levels under memory pressure
+    if (m_metadata.mipLevels == 1 && m_metadata.dimension == DirectX::TEX_DIMENSION_TEXTURE2D && m_metadata.arraySize == 1 &&
+        !DirectX::IsCompressed(m_metadata.format) && std::max(m_metadata.width, m_metadata.height) > s_min_evicted_size) {
+        DirectX::ScratchImage mip_chain;
+        ThrowIfFailed(DirectX::GenerateMipMaps(*m_image.GetImage(0, 0, 0), DirectX::TEX_FILTER_DEFAULT, 0, mip_chain));
+        m_image = std::move(mip_chain);
+        m_metadata = m_image.GetMetadata();
+    }
 
     Create(static_cast<D3D12_RESOURCE_DIMENSION>(m_metadata.dimension), m_metadata.format, m_metadata.width, m_metadata.height, m_metadata.depth, m_metadata.mipLevels, {});
 
 }
 
+unsigned int Texture::GetMaxEvictedMips() const
+{
+    if (m_metadata.dimension != DirectX::TEX_DIMENSION_TEXTURE2D || m_metadata.arraySize != 1 || m_metadata.IsCubemap())
+        return 0;
+
+    // Block compressed levels need to stay a multiple of the block size
+    unsigned int max_evicted_mips = 0;
+    for (unsigned int mip = 1; mip < m_metadata.mipLevels; ++mip) {
+        size_t width = m_metadata.width >> mip;
+        size_t height = m_metadata.height >> mip;
+        if (std::max(width, height) < s_min_evicted_size)
+            break;
+        if (DirectX::IsCompressed(m_metadata.format) && (width % 4 != 0 || height % 4 != 0))
+            break;
+        max_evicted_mips = mip;
+    }
+    return max_evicted_mips;
+}
+
+GpuResource Texture::SetEvictedMips(unsigned int num_evicted_mips, unsigned int frame_idx, CommandList& command_list)
+{
+    if (num_evicted_mips > GetMaxEvictedMips())
+        throw std::exception("Texture::SetEvictedMips(): Too many mip levels evicted");
+
+    // The residency entry is kept, Create() updates its size
+    GpuResource previous = ReleaseResource();
+    m_num_evicted_mips = num_evicted_mips;
+    Create(D3D12_RESOURCE_DIMENSION_TEXTURE2D, m_metadata.format, CastToUint(std::max<size_t>(m_metadata.width >> num_evicted_mips, 1)),
+        CastToUint(std::max<size_t>(m_metadata.height >> num_evicted_mips, 1)), 1, CastToUint(m_metadata.mipLevels - num_evicted_mips));
+
+    Upload(command_list);
+    UseShaderResource(command_list);
+    IShaderResource::ResourceChanged(m_resource.Get(), frame_idx);
+    return previous;
+}
+
 
 // RenderTargetTexture
 
@@ -126,6 +168,15 @@ void RenderTargetTexture::Create(D3D12_RESOURCE_DIMENSION dimension, DXGI_FORMAT
     
 }
 
+GpuResource RenderTargetTexture::PlaceResource(ID3D12Heap* heap, uint64_t offset)
+{
+    GpuResource previous = ITexture::PlaceResource(heap, offset);
+    IRenderTarget::ResourceChanged(m_resource.Get());
+
+    m_resource->SetName(L"Transient Render Target Texture");
+    return previous;
+}
+
 void RenderTargetTexture::ClearRenderTarget(CommandList& command_list)
 {
     // Clearing the buffer means set state to rendertarget
@@ -151,6 +202,23 @@ void DepthMapTexture::Create(D3D12_RESOURCE_DIMENSION dimension, DXGI_FORMAT for
     m_resource->SetName(L"Depth Stencil Texture");
 }
 
+GpuResource DepthMapTexture::PlaceResource(ID3D12Heap* heap, uint64_t offset)
+{
+    GpuResource previous = CreatePlacedResource(heap, offset, &m_clear_value);
+
+    // The typeless format needs the view descriptions of the depth map
+    D3D12_CPU_DESCRIPTOR_HANDLE srv_handle = GetShaderCPUHandle();
+    CreateShaderResourceView(srv_handle);
+    for (unsigned int frame_idx = 0; frame_idx < Renderer::GetNumFrames(); ++frame_idx)
+        RebindShaderResourceView(frame_idx);
+
+    D3D12_CPU_DESCRIPTOR_HANDLE dsv_handle = GetDepthStencilHandle();
+    CreateDepthStencilView(dsv_handle);
+
+    m_resource->SetName(L"Transient Depth Stencil Texture");
+    return previous;
+}
+
 void DepthMapTexture::ClearDepthStencil(CommandList& command_list)
 {
     // Clearing the buffer means set state to rendertarget
@@ -169,7 +237,8 @@ TextureLibrary::TextureLibrary() :
     m_srv_heap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV),
     m_rtv_heap(D3D12_DESCRIPTOR_HEAP_TYPE_RTV),
     m_dsv_heap(D3D12_DESCRIPTOR_HEAP_TYPE_DSV),
-    m_frame_descriptor_heap(nullptr)
+    m_frame_descriptor_heap(nullptr),
+    m_num_reserved_textures(0)
 {
 }
 
@@ -177,13 +246,13 @@ void TextureLibrary::AllocateDescriptors()
 {
     Microsoft::WRL::ComPtr<ID3D12Device2> device = Renderer::GetDevice();
 
-    m_srv_heap.Allocate(m_srv_texture_map.size() + m_rtv_textures.size() + m_dsv_textures.size());
+    m_srv_heap.Allocate(CastToUint(GetNumTextures()));
     m_rtv_heap.Allocate(m_rtv_textures.size());
     m_dsv_heap.Allocate(m_dsv_textures.size());
 
-    // Set the Shader Resource View 
-    for (const auto& [name, texture] : m_srv_texture_map) {
-        m_srv_heap.Bind(texture.get());
+    // Set the Shader Resource View of the textures which have already been loaded, the others are bound by BindLoadedTexture()
+    for (Texture* texture : m_loaded_textures) {
+        m_srv_heap.Bind(texture);
     }
 
     for (auto& texture : m_rtv_textures) {
@@ -200,7 +269,7 @@ void TextureLibrary::AllocateDescriptors()
 void TextureLibrary::Bind(FrameDescriptorHeap* descriptor_heap)
 {
     m_frame_descriptor_heap = descriptor_heap;
-    for (unsigned int frame_idx = 0; frame_idx < Renderer::s_num_frames; ++frame_idx) {
+    for (unsigned int frame_idx = 0; frame_idx < Renderer::GetNumFrames(); ++frame_idx) {
         Bind(descriptor_heap, frame_idx);
     }
 }
@@ -210,9 +279,12 @@ void TextureLibrary::Bind(FrameDescriptorHeap* descriptor_heap, unsigned int fra
     if (descriptor_heap->GetHeapType() != D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV || !descriptor_heap->IsShaderVisible())
         throw std::exception("TextureLibrary::Bind(): Frame descriptor heap is not of correct type or visible to shader");
 
-    // Binding all textures with ShaderResourceView
-    for (auto& [name, texture] : m_srv_texture_map) {
-        descriptor_heap->Bind(texture.get(), frame_idx);
+    // Textures loaded later are bound to the same heap
+    m_frame_descriptor_heap = descriptor_heap;
+
+    // Binding all loaded textures with ShaderResourceView
+    for (Texture* texture : m_loaded_textures) {
+        descriptor_heap->Bind(texture, frame_idx);
     }
 
     for (auto& texture : m_rtv_textures) {
@@ -226,16 +298,14 @@ void TextureLibrary::Bind(FrameDescriptorHeap* descriptor_heap, unsigned int fra
 
 Texture* TextureLibrary::CreateTexture(std::wstring file_name)
 {
+    std::lock_guard<std::mutex> lock(m_texture_map_mutex);
     auto result = m_srv_texture_map.find(file_name);
     if (result != m_srv_texture_map.end()) {
         return result->second.get();
     }
     
-    std::unique_ptr<Texture> texture = std::make_unique<Texture>();
-    texture->Read(file_name);
-    m_srv_texture_map.insert(std::make_pair(file_name, std::move(texture)));
-
-    return m_srv_texture_map[file_name].get();
+    std::unique_ptr<Texture> texture = std::make_unique<Texture>(file_name);
+    return m_srv_texture_map.insert(std::make_pair(file_name, std::move(texture))).first->second.get();
 }
 
 RenderTargetTexture* TextureLibrary::CreateRenderTargetTexture(DXGI_FORMAT format, uint32_t width, uint32_t height)
@@ -255,20 +325,25 @@ DepthMapTexture* TextureLibrary::CreateDepthTexture(DXGI_FORMAT format, uint32_t
 }
 
 
-void TextureLibrary::Load() 
+void TextureLibrary::BindLoadedTexture(Texture* texture)
 {
-    // Allocate the descriptors before loading
-    AllocateDescriptors();
-    // load textures
-    Microsoft::WRL::ComPtr<ID3D12Device2> device = Renderer::GetDevice();
-    auto command_list = m_command_queue.GetCommandList();
+    m_srv_heap.Bind(texture);
+    m_loaded_textures.push_back(texture);
+
+    // The texture can drop mip levels once it has been uploaded
+    Renderer::GetResidencyManager()->SetEvictable(texture);
 
-    for (const auto& [name, texture] : m_srv_texture_map) {
-        texture->Upload(command_list);
+    // The new descriptors are written behind the ones in use by the frames in flight
+    if (m_frame_descriptor_heap) {
+        for (unsigned int frame_idx = 0; frame_idx < Renderer::GetNumFrames(); ++frame_idx)
+            m_frame_descriptor_heap->Bind(texture, frame_idx);
     }
+}
 
-    auto fence_value = m_command_queue.ExecuteCommandList(command_list);
-    m_command_queue.WaitForFenceValue(fence_value);
+size_t TextureLibrary::GetNumTextures() const
+{
+    std::lock_guard<std::mutex> lock(m_texture_map_mutex);
+    return std::max(m_srv_texture_map.size(), m_num_reserved_textures) + m_rtv_textures.size() + m_dsv_textures.size();
 }
 
 
@@ -276,9 +351,14 @@ void TextureLibrary::Reset() {
     m_command_queue.Flush();
 
     // Clear and reset everything
-    m_srv_texture_map.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_texture_map_mutex);
+        m_srv_texture_map.clear();
+    }
     m_rtv_textures.clear();
     m_dsv_textures.clear();
+    m_loaded_textures.clear();
+    m_num_reserved_textures = 0;
 
     m_srv_heap.Reset();
     m_rtv_heap.Reset();
@@ -7,6 +7,8 @@
 #include <vector>
 #include <map>
 #include <string>
+#include <span>
+#include <mutex>
 
 #include "buffer.h"
 #include "rendertarget.h"
@@ -38,6 +40,13 @@ public:
         IShaderResource::ResourceChanged(m_resource.Get());
     }
 
+    virtual GpuResource PlaceResource(ID3D12Heap* heap, uint64_t offset) override
+    {
+        GpuResource previous = CreatePlacedResource(heap, offset, m_use_clear_value ? &m_clear_value : nullptr);
+        IShaderResource::ResourceChanged(m_resource.Get());
+        return previous;
+    }
+
     // Change resource state to pixel shader resource
     void UseShaderResource(CommandList& command_list) {  TransitionResourceState(command_list, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE); }
 };
@@ -45,18 +54,39 @@ public:
 
 // Normal Texture class which reads from files
 class Texture : public ITexture {
+public:
+    // Mip levels are only dropped while the largest side stays at least this size
+    static constexpr size_t s_min_evicted_size = 64;
+
 private:
+    std::wstring m_file_name;
     DirectX::ScratchImage m_image;
     DirectX::TexMetadata m_metadata;
 
+    // Top mip levels left out of the resource to save memory, uploaded again from m_image when restored
+    unsigned int m_num_evicted_mips;
+
 private:
     ITexture::Create;
 
 public:
+    Texture(const std::wstring& file_name = L"") : m_file_name(file_name), m_metadata{}, m_num_evicted_mips(0) {}
+
     void Create(D3D12_RESOURCE_DIMENSION dimension, DXGI_FORMAT format, uint32_t width, uint32_t height, uint32_t depth, uint32_t mip_levels, D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE);
     void Upload(CommandList& command_list);
 
-    void Read(const std::wstring& file_name);
+    // Decode the contents of the file with DirectXTex and create the resource, the format is chosen by the file extension
+    void Decode(std::span<const uint8_t> file_data);
+
+    const std::wstring& GetFileName() const { return m_file_name; }
+
+    // Number of top mip levels the residency manager may drop, 0 if the texture cannot be shrunk
+    unsigned int GetMaxEvictedMips() const;
+    unsigned int GetNumEvictedMips() const { return m_num_evicted_mips; }
+
+    // Recreate the resource without the top mip levels and record the upload of the others, the view of the frame is updated
+    // Returns the previous resource, which needs to be kept alive until the frames in flight no longer use it
+    GpuResource SetEvictedMips(unsigned int num_evicted_mips, unsigned int frame_idx, CommandList& command_list);
 };
 
 // Render target texture
@@ -67,6 +97,7 @@ private:
 public:
     void Create(D3D12_RESOURCE_DIMENSION dimension, DXGI_FORMAT format, uint32_t width, uint32_t height, uint32_t depth, uint32_t mip_levels, D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE);
     virtual void Resize(unsigned int width, unsigned int height) override { ITexture::Resize(width, height); IRenderTarget::ResourceChanged(m_resource.Get()); }
+    virtual GpuResource PlaceResource(ID3D12Heap* heap, uint64_t offset) override;
 
     virtual void ClearRenderTarget(CommandList& command_list) override;
     void CreateRenderTargetView(const D3D12_CPU_DESCRIPTOR_HANDLE& handle, D3D12_RENDER_TARGET_VIEW_DESC* desc = nullptr) { IRenderTarget::CreateRenderTargetView(m_resource.Get(), handle, desc); }
@@ -81,6 +112,7 @@ private:
 public:
     void Create(D3D12_RESOURCE_DIMENSION dimension, DXGI_FORMAT format, uint32_t width, uint32_t height, uint32_t depth, uint32_t mip_levels, D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE);
     virtual void Resize(unsigned int width, unsigned int height) override { ITexture::Resize(width, height); IDepthStencilTarget::ResourceChanged(m_resource.Get()); }
+    virtual GpuResource PlaceResource(ID3D12Heap* heap, uint64_t offset) override;
 
 public:
     virtual void ClearDepthStencil(CommandList& command_list) override;
@@ -166,6 +198,15 @@ private:
     std::vector<std::unique_ptr<RenderTargetTexture>> m_rtv_textures; // might be changed later to have name/id associated
     std::vector<std::unique_ptr<DepthMapTexture>> m_dsv_textures;
 
+    // Textures are created by the asset loader threads, the file is read and uploaded later
+    mutable std::mutex m_texture_map_mutex;
+
+    // Textures whose upload has completed in the order they were bound to the descriptor heaps
+    std::vector<Texture*> m_loaded_textures;
+
+    // Descriptors kept free for textures which are created after the descriptor heaps have been allocated
+    size_t m_num_reserved_textures;
+
     // Commandqueue for copying
     CommandQueue m_command_queue;
 
@@ -182,14 +223,18 @@ public:
     void Bind(FrameDescriptorHeap* descriptor_heap);
     void Bind(FrameDescriptorHeap* descriptor_heap, unsigned int frame_idx);
 
+    // Returns the texture of the file without reading it, thread safe
     Texture* CreateTexture(std::wstring file_name);
     RenderTargetTexture* CreateRenderTargetTexture(DXGI_FORMAT format, uint32_t width, uint32_t height);
     DepthMapTexture* CreateDepthTexture(DXGI_FORMAT format, uint32_t width, uint32_t height);
 
-    // Loading all textures to GPU at once
-    void Load();
+    // Reserve descriptors for textures which will be created while loading, needs to be called before AllocateDescriptors()
+    void ReserveTextures(size_t num_textures) { m_num_reserved_textures = num_textures; }
+
+    // Bind a texture whose upload has completed to the descriptor heaps so it can be used by the shaders
+    void BindLoadedTexture(Texture* texture);
 
-    size_t GetNumTextures() const { return m_srv_texture_map.size() + m_rtv_textures.size() + m_dsv_textures.size(); }
+    size_t GetNumTextures() const;
 
     void Flush() { m_command_queue.Flush(); }
 
@@ -0,0 +1,113 @@
+#include "transientallocator.h"
+
+#include <d3dx12.h>
+
+#include <algorithm>
+
+#include "utility.h"
+#include "renderer.h"
+#include "buffer.h"
+#include "commandlist.h"
+#include "commandqueue.h"
+#include "heapallocator.h"
+#include "residencymanager.h"
+
+
+void TransientAllocator::Declare(GpuResource* resource, unsigned int first_pass, unsigned int last_pass, unsigned int frame, bool screen_sized)
+{
+    if (first_pass > last_pass)
+        throw std::exception("TransientAllocator::Declare(): First pass is after the last pass");
+
+    m_declarations.push_back({ resource, first_pass, last_pass, frame, screen_sized, false });
+}
+
+void TransientAllocator::Allocate(CommandQueue& command_queue)
+{
+    if (m_declarations.empty())
+        return;
+
+    Microsoft::WRL::ComPtr<ID3D12Device2> device = Renderer::GetDevice();
+    TransientPacker::Result result = Pack(0, 0);
+
+    // Render targets and depth stencils only, which is allowed by every resource heap tier
+    uint64_t heap_size = (result.heap_size + D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT - 1) & ~(D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT - 1);
+    CD3DX12_HEAP_DESC heap_desc(heap_size, D3D12_HEAP_TYPE_DEFAULT, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES);
+    Microsoft::WRL::ComPtr<ID3D12Heap> heap;
+    ThrowIfFailed(device->CreateHeap(&heap_desc, IID_PPV_ARGS(&heap)));
+    heap->SetName(L"Transient Resource Heap");
+
+    m_stats = { m_declarations.size(), 0, heap_size, result.separate_size };
+    for (size_t i = 0; i < m_declarations.size(); ++i) {
+        command_queue.ReleaseDeferred(m_declarations[i].resource->PlaceResource(heap.Get(), result.offsets[i]));
+        m_declarations[i].aliased = result.aliased[i];
+        m_stats.num_aliased += result.aliased[i] ? 1 : 0;
+    }
+
+    // Every resource has been moved out of the previous heap
+    if (m_heap)
+        command_queue.ReleaseDeferred(Microsoft::WRL::ComPtr<IUnknown>(m_heap));
+    m_heap = heap;
+
+    if (m_residency)
+        m_residency->SetSize(heap_size);
+    else
+        m_residency = Renderer::GetResidencyManager()->Track(ResidencyPolicy::RESOURCE_CATEGORY_RENDER_TARGET, heap_size);
+
+    // The render target blocks the resources were created in are empty once the previous resources have been released
+    command_queue.ReleaseDeferred(std::function<void()>([]() { Renderer::GetHeapAllocator()->ReleaseEmptyBlocks(); }));
+
+    ReportStats(L"TransientAllocator::Allocate()");
+}
+
+void TransientAllocator::BeginPass(unsigned int pass, unsigned int frame_idx, CommandList& command_list)
+{
+    for (const Declaration& declaration : m_declarations) {
+        if (declaration.first_pass != pass || !declaration.aliased)
+            continue;
+        if (declaration.frame != TransientPacker::s_all_frames && declaration.frame != frame_idx)
+            continue;
+
+        // The resource which used the memory last is not tracked, so any resource in the heap is waited on
+        command_list.AliasingBarrier(nullptr, declaration.resource->GetResource());
+    }
+}
+
+TransientAllocator::Stats TransientAllocator::Estimate(uint32_t width, uint32_t height) const
+{
+    TransientPacker::Result result = Pack(width, height);
+
+    Stats stats{ m_declarations.size(), 0, result.heap_size, result.separate_size };
+    for (bool aliased : result.aliased)
+        stats.num_aliased += aliased ? 1 : 0;
+    return stats;
+}
+
+void TransientAllocator::ReportStats(const wchar_t* name) const
+{
+    Stats estimate = Estimate(s_estimate_width, s_estimate_height);
+
+    wchar_t buffer[500];
+    swprintf_s(buffer, 500, L"%s: %llu transient resources (%llu aliased) in a heap of %llu bytes instead of %llu bytes, saved %llu bytes; "
+        L"at %ux%u %llu bytes instead of %llu bytes, saved %llu bytes\n", name,
+        m_stats.num_resources, m_stats.num_aliased, m_stats.heap_bytes, m_stats.separate_bytes, m_stats.separate_bytes - std::min(m_stats.heap_bytes, m_stats.separate_bytes),
+        s_estimate_width, s_estimate_height, estimate.heap_bytes, estimate.separate_bytes, estimate.separate_bytes - std::min(estimate.heap_bytes, estimate.separate_bytes));
+    OutputDebugString(buffer);
+}
+
+TransientPacker::Result TransientAllocator::Pack(uint32_t width, uint32_t height) const
+{
+    Microsoft::WRL::ComPtr<ID3D12Device2> device = Renderer::GetDevice();
+
+    TransientPacker packer;
+    for (const Declaration& declaration : m_declarations) {
+        D3D12_RESOURCE_DESC resource_desc = declaration.resource->GetResource()->GetDesc();
+        if (width && declaration.screen_sized) {
+            resource_desc.Width = width;
+            resource_desc.Height = height;
+        }
+
+        D3D12_RESOURCE_ALLOCATION_INFO allocation_info = device->GetResourceAllocationInfo(0, 1, &resource_desc);
+        packer.Add({ allocation_info.SizeInBytes, allocation_info.Alignment, declaration.first_pass, declaration.last_pass, declaration.frame });
+    }
+    return packer.Pack();
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "transientpacker.h"
+
+// Forward declaration
+class GpuResource;
+class ResidencyHandle;
+class CommandList;
+class CommandQueue;
+
+// Places render targets which are only used in some passes of a frame in one heap, where the ones which are never
+// alive at the same time share memory. The resources are created as usual first and moved into the heap by Allocate()
+class TransientAllocator {
+public:
+    struct Stats {
+        uint64_t num_resources;
+        uint64_t num_aliased; // resources sharing memory with another resource
+        uint64_t heap_bytes;
+        uint64_t separate_bytes; // the resources placed one after the other without aliasing
+    };
+
+    // Resolution the memory savings are estimated at in the report
+    static constexpr uint32_t s_estimate_width = 3840;
+    static constexpr uint32_t s_estimate_height = 2160;
+
+private:
+    struct Declaration {
+        GpuResource* resource;
+        unsigned int first_pass;
+        unsigned int last_pass;
+        unsigned int frame;
+        bool screen_sized;
+        bool aliased;
+    };
+
+    std::vector<Declaration> m_declarations;
+
+    Microsoft::WRL::ComPtr<ID3D12Heap> m_heap;
+
+    // The heap is accounted as a single render target, the placed resources are not
+    std::shared_ptr<ResidencyHandle> m_residency;
+
+    Stats m_stats;
+
+public:
+    TransientAllocator() : m_stats{} {}
+
+    // Declare a resource used from its first to its last pass of a frame, in one frame or in every frame
+    // Resources which follow the size of the window are screen sized, to estimate the memory at other resolutions
+    void Declare(GpuResource* resource, unsigned int first_pass, unsigned int last_pass, unsigned int frame = TransientPacker::s_all_frames, bool screen_sized = false);
+    void Clear() { m_declarations.clear(); }
+
+    // Pack the declared resources with their current size and move them into a new heap, the previous resources and heap
+    // are released on the command queue. The views are rewritten, so the frames in flight must not use them anymore,
+    // e.g. because they use the previous shader visible descriptor heap or the queue has been flushed
+    void Allocate(CommandQueue& command_queue);
+
+    // Record the aliasing barriers of the resources of the frame which start in the pass and share memory
+    // The contents of those resources are undefined, so they have to be cleared before they are used
+    void BeginPass(unsigned int pass, unsigned int frame_idx, CommandList& command_list);
+
+    const Stats& GetStats() const { return m_stats; }
+
+    // Pack the declared resources as if the window had the given size, nothing is created
+    Stats Estimate(uint32_t width, uint32_t height) const;
+
+    // Report the heap size and the memory saved by aliasing, at the current size and the estimate resolution, with OutputDebugString
+    void ReportStats(const wchar_t* name) const;
+
+private:
+    // A width of 0 packs the resources with their current size
+    TransientPacker::Result Pack(uint32_t width, uint32_t height) const;
+};
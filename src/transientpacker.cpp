@@ -0,0 +1,75 @@
+#include "transientpacker.h"
+
+#include <algorithm>
+#include <numeric>
+
+
+size_t TransientPacker::Add(const Resource& resource)
+{
+    m_resources.push_back(resource);
+    return m_resources.size() - 1;
+}
+
+bool TransientPacker::Overlaps(const Resource& a, const Resource& b)
+{
+    bool same_frame = a.frame == b.frame || a.frame == s_all_frames || b.frame == s_all_frames;
+    return same_frame && a.first_pass <= b.last_pass && b.first_pass <= a.last_pass;
+}
+
+TransientPacker::Result TransientPacker::Pack() const
+{
+    Result result{ std::vector<uint64_t>(m_resources.size(), 0), std::vector<bool>(m_resources.size(), false), 0, 0 };
+
+    for (const Resource& resource : m_resources) {
+        uint64_t alignment = std::max<uint64_t>(resource.alignment, 1);
+        result.separate_size = (result.separate_size + alignment - 1) / alignment * alignment + resource.size;
+    }
+
+    // Largest first, the order of adding breaks ties so the result does not depend on the sort implementation
+    std::vector<size_t> order(m_resources.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) { return m_resources[a].size > m_resources[b].size; });
+
+    struct Range {
+        uint64_t begin;
+        uint64_t end;
+    };
+    std::vector<size_t> placed;
+    std::vector<Range> occupied;
+
+    for (size_t idx : order) {
+        const Resource& resource = m_resources[idx];
+        uint64_t alignment = std::max<uint64_t>(resource.alignment, 1);
+
+        // Memory of the placed resources which are alive at the same time, by offset
+        occupied.clear();
+        for (size_t other : placed) {
+            if (Overlaps(resource, m_resources[other]))
+                occupied.push_back({ result.offsets[other], result.offsets[other] + m_resources[other].size });
+        }
+        std::sort(occupied.begin(), occupied.end(), [](const Range& a, const Range& b) { return a.begin < b.begin; });
+
+        // First gap which fits the aligned resource
+        uint64_t offset = 0;
+        for (const Range& range : occupied) {
+            if (offset + resource.size <= range.begin)
+                break;
+            offset = std::max(offset, (range.end + alignment - 1) / alignment * alignment);
+        }
+
+        result.offsets[idx] = offset;
+        result.heap_size = std::max(result.heap_size, offset + resource.size);
+
+        // Placed resources whose memory intersects need an aliasing barrier when the other one was used last
+        for (size_t other : placed) {
+            uint64_t other_offset = result.offsets[other];
+            if (offset < other_offset + m_resources[other].size && other_offset < offset + resource.size) {
+                result.aliased[idx] = true;
+                result.aliased[other] = true;
+            }
+        }
+        placed.push_back(idx);
+    }
+
+    return result;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Assigns heap offsets to transient resources so resources which are never alive at the same time share memory
+// A resource lives from its first to its last pass of a frame. Frames are executed one after the other on the queue,
+// so resources of different frames in flight do not overlap, unless one of them is used by every frame
+// Works on the size, alignment and pass range of each resource, TransientAllocator places the resources at the offsets
+class TransientPacker {
+public:
+    static constexpr unsigned int s_all_frames = UINT32_MAX;
+
+    struct Resource {
+        uint64_t size;
+        uint64_t alignment;
+        unsigned int first_pass;
+        unsigned int last_pass; // inclusive
+        unsigned int frame; // s_all_frames if the resource is shared by the frames
+    };
+
+    struct Result {
+        std::vector<uint64_t> offsets; // in the order the resources were added
+        std::vector<bool> aliased; // the memory of the resource is shared with another resource
+        uint64_t heap_size;
+        uint64_t separate_size; // heap size without aliasing, every resource aligned after the previous one
+    };
+
+private:
+    std::vector<Resource> m_resources;
+
+public:
+    // Returns the index of the resource in the result
+    size_t Add(const Resource& resource);
+    void Clear() { m_resources.clear(); }
+
+    size_t GetNumResources() const { return m_resources.size(); }
+
+    // Lifetimes overlap within a frame and the resources can be alive in the same frame
+    static bool Overlaps(const Resource& a, const Resource& b);
+
+    // Greedy interval coloring, the largest resources are placed first at the lowest aligned offset
+    // which does not intersect the memory of an already placed resource with an overlapping lifetime
+    Result Pack() const;
+};
@@ -0,0 +1,116 @@
+#include "uploadallocator.h"
+
+#include <d3dx12.h>
+
+#include <algorithm>
+
+#include "utility.h"
+#include "dx12_api.h"
+
+
+UploadAllocator::UploadAllocator(Microsoft::WRL::ComPtr<ID3D12Fence> fence, uint64_t capacity) :
+    m_fence(fence), m_fence_event(directx::CreateEventHandle()), m_buffer_WO(nullptr), m_capacity(0), m_generation(0),
+    m_head(0), m_tail(0), m_first_block_id(0), m_stats{}
+{
+    CreateBuffer(capacity);
+}
+
+UploadAllocator::~UploadAllocator()
+{
+    ::CloseHandle(m_fence_event);
+}
+
+void UploadAllocator::CreateBuffer(uint64_t capacity)
+{
+    // Keep the current buffer alive for the blocks which have not been released yet
+    if (m_buffer.GetResource() && !m_blocks.empty())
+        m_retired_buffers.push_back({ m_buffer, m_generation });
+
+    m_buffer.Create(capacity);
+    m_buffer.GetResource()->SetName(L"Upload Ring Buffer");
+
+    CD3DX12_RANGE read_range(0, 0);    // We do not intend to read from this resource on the CPU.
+    m_buffer.Map(0, &read_range, reinterpret_cast<void**>(&m_buffer_WO));
+
+    m_capacity = capacity;
+    ++m_generation;
+    m_head = 0;
+    m_tail = 0;
+}
+
+UploadAllocator::Allocation UploadAllocator::Allocate(uint64_t size, uint64_t alignment)
+{
+    while (true) {
+        // Skip to the start of the buffer if the allocation does not fit before the end
+        uint64_t offset = AlignUp(m_head % m_capacity, alignment);
+        uint64_t start = (offset + size > m_capacity) ? m_head + (m_capacity - m_head % m_capacity) : m_head - m_head % m_capacity + offset;
+        uint64_t end = start + size;
+
+        if (end - m_tail <= m_capacity) {
+            m_head = end;
+            m_blocks.push_back({ end, 0, m_generation });
+
+            m_stats.bytes_uploaded += size;
+            ++m_stats.num_allocations;
+            m_stats.peak_usage = std::max(m_stats.peak_usage, m_head - m_tail);
+
+            uint64_t buffer_offset = start % m_capacity;
+            return { m_buffer.GetResource(), buffer_offset, m_buffer_WO + buffer_offset, m_first_block_id + m_blocks.size() - 1 };
+        }
+
+        if (ReleaseBlocks(false))
+            continue;
+
+        // Wait for the GPU if the oldest allocation has been submitted, otherwise the ring is too small
+        if (size + alignment <= m_capacity && ReleaseBlocks(true)) {
+            ++m_stats.num_wrap_stalls;
+            continue;
+        }
+
+        CreateBuffer(std::max(m_capacity * 2, AlignUp(size + alignment, 64 * 1024)));
+        ++m_stats.num_grows;
+    }
+}
+
+void UploadAllocator::Submit(const std::vector<uint64_t>& block_ids, uint64_t fence_value)
+{
+    for (uint64_t block_id : block_ids) {
+        if (block_id < m_first_block_id)
+            throw std::exception("UploadAllocator::Submit(): Block has already been released");
+        m_blocks[block_id - m_first_block_id].fence_value = fence_value;
+    }
+}
+
+bool UploadAllocator::ReleaseBlocks(bool wait)
+{
+    if (m_blocks.empty() || m_blocks.front().fence_value == 0)
+        return false;
+
+    if (wait && m_fence->GetCompletedValue() < m_blocks.front().fence_value) {
+        ThrowIfFailed(m_fence->SetEventOnCompletion(m_blocks.front().fence_value, m_fence_event));
+        ::WaitForSingleObject(m_fence_event, DWORD_MAX);
+    }
+
+    bool released = false;
+    uint64_t completed_value = m_fence->GetCompletedValue();
+    while (!m_blocks.empty() && m_blocks.front().fence_value != 0 && m_blocks.front().fence_value <= completed_value) {
+        if (m_blocks.front().generation == m_generation)
+            m_tail = m_blocks.front().end;
+        m_blocks.pop_front();
+        ++m_first_block_id;
+        released = true;
+    }
+
+    // Free the retired buffers without remaining blocks
+    unsigned int oldest_generation = m_blocks.empty() ? m_generation : m_blocks.front().generation;
+    std::erase_if(m_retired_buffers, [oldest_generation](const RetiredBuffer& retired) { return retired.generation < oldest_generation; });
+    return released;
+}
+
+void UploadAllocator::ReportStats(const wchar_t* name) const
+{
+    wchar_t buffer[500];
+    swprintf_s(buffer, 500, L"%s: uploaded %llu bytes in %llu allocations, peak usage %llu of %llu bytes, %u wrap stalls, %u grows\n", name,
+        m_stats.bytes_uploaded, m_stats.num_allocations, m_stats.peak_usage, m_capacity, m_stats.num_wrap_stalls, m_stats.num_grows);
+    OutputDebugString(buffer);
+}
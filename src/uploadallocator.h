@@ -0,0 +1,92 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "buffer.h"
+
+// Persistently mapped ring buffer for upload memory of a command queue
+// Allocations are released in order once the fence value of the command list they were recorded in has completed,
+// the ring waits for the oldest submitted allocation when it is full and grows when nothing can be waited for
+class UploadAllocator {
+public:
+    struct Allocation {
+        ID3D12Resource* resource;
+        uint64_t offset; // offset in the resource
+        uint8_t* cpu_address; // write only
+        uint64_t block_id; // to be passed to Submit() with the fence value of the command list
+    };
+
+    struct Stats {
+        uint64_t bytes_uploaded;
+        uint64_t num_allocations;
+        uint64_t peak_usage; // bytes in use including alignment padding
+        unsigned int num_wrap_stalls; // waits on the GPU because the ring was full
+        unsigned int num_grows;
+    };
+
+    static constexpr uint64_t s_default_capacity = 8 * 1024 * 1024;
+
+private:
+    // Allocation in ring order, the space up to end is released when the fence completes
+    struct Block {
+        uint64_t end; // head position after the allocation
+        uint64_t fence_value; // 0 while the command list has not been executed
+        unsigned int generation; // ring buffer the allocation was made in
+    };
+
+    // Ring buffers replaced by a larger one, kept alive until their blocks have been released
+    struct RetiredBuffer {
+        UploadBuffer buffer;
+        unsigned int generation;
+    };
+
+    Microsoft::WRL::ComPtr<ID3D12Fence> m_fence;
+    HANDLE m_fence_event;
+
+    UploadBuffer m_buffer;
+    uint8_t* m_buffer_WO; //WRITE ONLY POINTER
+    uint64_t m_capacity;
+    unsigned int m_generation;
+
+    // Positions grow monotonically, the offset in the buffer is position % capacity
+    uint64_t m_head;
+    uint64_t m_tail;
+
+    std::deque<Block> m_blocks;
+    uint64_t m_first_block_id; // id of m_blocks.front()
+    std::vector<RetiredBuffer> m_retired_buffers;
+
+    Stats m_stats;
+
+public:
+    // The fence is the one signaled by the command queue with the values passed to Submit()
+    UploadAllocator(Microsoft::WRL::ComPtr<ID3D12Fence> fence, uint64_t capacity = s_default_capacity);
+    ~UploadAllocator();
+
+    UploadAllocator(const UploadAllocator&) = delete;
+    UploadAllocator& operator=(const UploadAllocator&) = delete;
+
+    Allocation Allocate(uint64_t size, uint64_t alignment);
+
+    // The allocations are in use by the GPU until fence_value has been reached
+    void Submit(const std::vector<uint64_t>& block_ids, uint64_t fence_value);
+
+    const Stats& GetStats() const { return m_stats; }
+    void ResetStats() { m_stats = {}; }
+
+    // Report the stats since the last ResetStats() with OutputDebugString
+    void ReportStats(const wchar_t* name) const;
+
+private:
+    void CreateBuffer(uint64_t capacity);
+
+    // Release the blocks whose fence has completed, waits for the oldest submitted block if wait is set
+    bool ReleaseBlocks(bool wait);
+
+    static uint64_t AlignUp(uint64_t value, uint64_t alignment) { return (value + alignment - 1) & ~(alignment - 1); }
+};
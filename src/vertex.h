@@ -0,0 +1,29 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <type_traits>
+
+// Define vertex, apart from buffer.h so the mesh processing does not depend on D3D12
+struct ScreenVertex
+{
+    DirectX::XMFLOAT2 position;
+    DirectX::XMFLOAT2 texture_coord;
+};
+
+
+struct Vertex
+{
+    DirectX::XMFLOAT3 position;
+    DirectX::XMFLOAT2 texture_coord;
+    DirectX::XMFLOAT3 normal;
+};
+
+// Concept to ensure vertex type struct is used for Meshes
+template<class T>
+concept IsVertex = std::is_class_v<Vertex> || std::is_class_v<ScreenVertex>;
+
+// Index buffers support 16 and 32 bit indices
+template<class T>
+concept IsIndex = std::is_same_v<T, uint16_t> || std::is_same_v<T, uint32_t>;
@@ -0,0 +1,68 @@
+#include "vertexwelder.h"
+
+#include <algorithm>
+#include <bit>
+
+
+VertexWelder::VertexWelder(size_t num_corners) :
+    m_num_unique(0)
+{
+    // Closed meshes share each vertex between ~6 corners, fewer along seams. Start with room for two thirds of the corners,
+    // which stays below the load factor up to one unique vertex per two corners
+    size_t capacity = std::bit_ceil(std::max<size_t>(64, num_corners / 3 * 2));
+    m_slots.resize(capacity, Slot{ {}, s_empty_slot });
+    m_mask = capacity - 1;
+}
+
+bool VertexWelder::Insert(const Key& key, uint32_t& unique_idx)
+{
+    // Keep the load factor below 3/4 to keep the probe sequences short
+    if ((static_cast<size_t>(m_num_unique) + 1) * 4 > m_slots.size() * 3)
+        Grow();
+
+    size_t slot_idx = Hash(key) & m_mask;
+    while (true) {
+        Slot& slot = m_slots[slot_idx];
+        if (slot.unique_idx == s_empty_slot) {
+            slot.key = key;
+            slot.unique_idx = m_num_unique++;
+            unique_idx = slot.unique_idx;
+            return true;
+        }
+
+        if (slot.key == key) {
+            unique_idx = slot.unique_idx;
+            return false;
+        }
+
+        slot_idx = (slot_idx + 1) & m_mask;
+    }
+}
+
+size_t VertexWelder::Hash(const Key& key)
+{
+    // Mix the three indices with large odd multipliers and fold the high bits down
+    uint64_t hash = static_cast<uint32_t>(key.vertex_index) * 0x9E3779B97F4A7C15ull;
+    hash ^= static_cast<uint32_t>(key.normal_index) * 0xC2B2AE3D27D4EB4Full;
+    hash ^= static_cast<uint32_t>(key.texcoord_index) * 0x165667B19E3779F9ull;
+    hash ^= hash >> 32;
+    return static_cast<size_t>(hash);
+}
+
+void VertexWelder::Grow()
+{
+    std::vector<Slot> old_slots(m_slots.size() * 2, Slot{ {}, s_empty_slot });
+    old_slots.swap(m_slots);
+    m_mask = m_slots.size() - 1;
+
+    // Reinsert the occupied slots, unique indices stay the same
+    for (const Slot& old_slot : old_slots) {
+        if (old_slot.unique_idx == s_empty_slot)
+            continue;
+
+        size_t slot_idx = Hash(old_slot.key) & m_mask;
+        while (m_slots[slot_idx].unique_idx != s_empty_slot)
+            slot_idx = (slot_idx + 1) & m_mask;
+        m_slots[slot_idx] = old_slot;
+    }
+}
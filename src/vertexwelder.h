@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Welds OBJ corners (position/normal/texcoord index triples) into unique vertex indices
+// Uses a flat open addressing hash table with linear probing instead of a node based std::map
+class VertexWelder {
+public:
+    struct Key {
+        int32_t vertex_index;
+        int32_t normal_index;
+        int32_t texcoord_index;
+
+        bool operator==(const Key& other) const {
+            return vertex_index == other.vertex_index && normal_index == other.normal_index && texcoord_index == other.texcoord_index;
+        }
+    };
+
+private:
+    struct Slot {
+        Key key;
+        uint32_t unique_idx; // s_empty_slot if unused
+    };
+
+    static constexpr uint32_t s_empty_slot = UINT32_MAX;
+
+    std::vector<Slot> m_slots;
+    size_t m_mask;
+    uint32_t m_num_unique;
+
+public:
+    // Number of corners is used as a hint to size the table
+    VertexWelder(size_t num_corners = 0);
+
+    // Find the welded index of the corner or assign the next unique index
+    // Returns true if the corner was not seen before (a new vertex needs to be created)
+    bool Insert(const Key& key, uint32_t& unique_idx);
+
+    uint32_t GetNumUnique() const { return m_num_unique; }
+
+private:
+    static size_t Hash(const Key& key);
+    void Grow();
+};
@@ -0,0 +1,134 @@
+// Placed resource suballocation of a synthetic 5,000 asset scene with BuddyAllocator in 64MB blocks like HeapAllocator,
+// against one heap per resource as with CreateCommittedResource
+// Usage: buddyallocator_benchmark [num_assets], defaults to 5000 assets
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "buddyallocator.h"
+
+namespace {
+
+constexpr uint64_t s_kb = 1024;
+constexpr uint64_t s_mb = 1024 * 1024;
+
+// Same block and placement sizes as HeapAllocator
+constexpr uint64_t s_block_size = 64 * s_mb;
+constexpr uint64_t s_small_alignment = 4 * s_kb;
+constexpr uint64_t s_default_alignment = 64 * s_kb;
+
+// Committed resources are at least 64KB
+constexpr uint64_t s_committed_alignment = 64 * s_kb;
+
+struct Asset {
+    uint64_t size;
+    uint64_t alignment;
+};
+
+// Small mesh buffers and mip chains of 256..2048 textures, larger resources do not fit a block and are committed by HeapAllocator
+std::vector<Asset> CreateAssets(size_t num_assets, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    std::vector<Asset> assets(num_assets);
+    for (Asset& asset : assets) {
+        if (random() % 2 == 0) {
+            asset.size = 1 + random() % (random() % 10 == 0 ? 4 * s_mb : 256 * s_kb);
+            asset.alignment = asset.size <= s_default_alignment ? s_small_alignment : s_default_alignment;
+        } else {
+            uint64_t dimension = 256ull << (random() % 4);
+            asset.size = dimension * dimension * 4 * 4 / 3;
+            asset.alignment = s_default_alignment;
+        }
+    }
+    return assets;
+}
+
+struct Allocation {
+    size_t block_idx;
+    uint64_t offset;
+};
+
+class BlockAllocator {
+public:
+    Allocation Allocate(const Asset& asset)
+    {
+        for (size_t block_idx = 0; block_idx < m_blocks.size(); ++block_idx) {
+            uint64_t offset = m_blocks[block_idx]->Allocate(asset.size, asset.alignment);
+            if (offset != BuddyAllocator::s_invalid_offset)
+                return { block_idx, offset };
+        }
+        m_blocks.push_back(std::make_unique<BuddyAllocator>(s_block_size, s_small_alignment));
+        return { m_blocks.size() - 1, m_blocks.back()->Allocate(asset.size, asset.alignment) };
+    }
+
+    void Free(const Allocation& allocation) { m_blocks[allocation.block_idx]->Free(allocation.offset); }
+
+    size_t GetNumBlocks() const { return m_blocks.size(); }
+
+    float GetFragmentation() const
+    {
+        float fragmentation = 0.0f;
+        for (const auto& block : m_blocks)
+            fragmentation += block->GetFragmentation();
+        return m_blocks.empty() ? 0.0f : fragmentation / m_blocks.size();
+    }
+
+    uint64_t GetAllocatedBytes() const
+    {
+        uint64_t allocated_bytes = 0;
+        for (const auto& block : m_blocks)
+            allocated_bytes += block->GetStats().allocated_bytes;
+        return allocated_bytes;
+    }
+
+private:
+    std::vector<std::unique_ptr<BuddyAllocator>> m_blocks;
+};
+
+}
+
+int main(int argc, char** argv)
+{
+    size_t num_assets = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5000;
+    std::vector<Asset> assets = CreateAssets(num_assets, 1);
+
+    uint64_t committed_bytes = 0;
+    for (const Asset& asset : assets)
+        committed_bytes += (asset.size + s_committed_alignment - 1) / s_committed_alignment * s_committed_alignment;
+
+    // Scene load
+    BlockAllocator allocator;
+    std::vector<Allocation> allocations(assets.size());
+    auto load_start = std::chrono::high_resolution_clock::now();
+    for (size_t asset_idx = 0; asset_idx < assets.size(); ++asset_idx)
+        allocations[asset_idx] = allocator.Allocate(assets[asset_idx]);
+    std::chrono::duration<double> load_time = std::chrono::high_resolution_clock::now() - load_start;
+
+    uint64_t allocated_bytes = allocator.GetAllocatedBytes();
+    uint64_t heap_bytes = allocator.GetNumBlocks() * s_block_size;
+    std::printf("BuddyAllocator: %zu assets, %.1f MB requested\n", assets.size(), allocated_bytes / double(s_mb));
+    std::printf("  committed  %6zu heaps, %8.1f MB\n", assets.size(), committed_bytes / double(s_mb));
+    std::printf("  placed     %6zu heaps, %8.1f MB, %.1f%% used, fragmentation %.3f, %.3f ms (%.2f us/allocation)\n", allocator.GetNumBlocks(),
+        heap_bytes / double(s_mb), 100.0 * allocated_bytes / heap_bytes, allocator.GetFragmentation(), load_time.count() * 1e3,
+        load_time.count() * 1e6 / assets.size());
+
+    // Streaming churn, a random asset is evicted and another one loaded in its place
+    std::mt19937 random(2);
+    std::vector<Asset> streamed = CreateAssets(assets.size(), 3);
+    size_t num_churn = assets.size() * 20;
+    auto churn_start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < num_churn; ++i) {
+        size_t asset_idx = random() % assets.size();
+        allocator.Free(allocations[asset_idx]);
+        allocations[asset_idx] = allocator.Allocate(streamed[i % streamed.size()]);
+    }
+    std::chrono::duration<double> churn_time = std::chrono::high_resolution_clock::now() - churn_start;
+
+    std::printf("  churn      %6zu heaps, %zu free/allocate pairs, %.1f Mpairs/s, fragmentation %.3f\n", allocator.GetNumBlocks(), num_churn,
+        num_churn / churn_time.count() * 1e-6, allocator.GetFragmentation());
+    return 0;
+}
@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <stdexcept>
+
+#include "buddyallocator.h"
+
+namespace {
+
+constexpr uint64_t s_kb = 1024;
+constexpr uint64_t s_mb = 1024 * 1024;
+
+}
+
+TEST(BuddyAllocatorTest, InvalidSizes)
+{
+    EXPECT_THROW(BuddyAllocator(3 * s_mb, 64 * s_kb), std::invalid_argument);
+    EXPECT_THROW(BuddyAllocator(64 * s_mb, 48 * s_kb), std::invalid_argument);
+    EXPECT_THROW(BuddyAllocator(64 * s_kb, 64 * s_mb), std::invalid_argument);
+    EXPECT_THROW(BuddyAllocator(0, 0), std::invalid_argument);
+}
+
+TEST(BuddyAllocatorTest, SplitAndMerge)
+{
+    BuddyAllocator allocator(1 * s_mb, 64 * s_kb);
+
+    // The first allocation splits the block down to the smallest order, the next ones take the free buddies
+    uint64_t a = allocator.Allocate(64 * s_kb);
+    uint64_t b = allocator.Allocate(64 * s_kb);
+    uint64_t c = allocator.Allocate(128 * s_kb);
+    uint64_t d = allocator.Allocate(256 * s_kb);
+    EXPECT_EQ(a, 0u);
+    EXPECT_EQ(b, 64 * s_kb);
+    EXPECT_EQ(c, 128 * s_kb);
+    EXPECT_EQ(d, 256 * s_kb);
+    EXPECT_EQ(allocator.GetStats().largest_free_block, 512 * s_kb);
+
+    // Freeing a block with a used buddy does not merge
+    allocator.Free(a);
+    EXPECT_EQ(allocator.GetStats().largest_free_block, 512 * s_kb);
+    EXPECT_EQ(allocator.Allocate(64 * s_kb), a);
+
+    // Freeing everything merges back to one block of the whole size
+    allocator.Free(a);
+    allocator.Free(c);
+    allocator.Free(b);
+    allocator.Free(d);
+    EXPECT_TRUE(allocator.IsEmpty());
+    EXPECT_EQ(allocator.GetStats().largest_free_block, 1 * s_mb);
+    EXPECT_EQ(allocator.GetStats().free_bytes, 1 * s_mb);
+    EXPECT_EQ(allocator.Allocate(1 * s_mb), 0u);
+}
+
+TEST(BuddyAllocatorTest, SizesRoundUpToPowersOfTwo)
+{
+    BuddyAllocator allocator(1 * s_mb, 64 * s_kb);
+    uint64_t a = allocator.Allocate(1);
+    uint64_t b = allocator.Allocate(65 * s_kb);
+    ASSERT_NE(a, BuddyAllocator::s_invalid_offset);
+    ASSERT_NE(b, BuddyAllocator::s_invalid_offset);
+
+    const BuddyAllocator::Stats& stats = allocator.GetStats();
+    EXPECT_EQ(stats.num_allocations, 2u);
+    EXPECT_EQ(stats.allocated_bytes, 1 + 65 * s_kb);
+    EXPECT_EQ(stats.used_bytes, 64 * s_kb + 128 * s_kb);
+    EXPECT_EQ(stats.free_bytes, 1 * s_mb - stats.used_bytes);
+}
+
+TEST(BuddyAllocatorTest, Alignment)
+{
+    BuddyAllocator allocator(64 * s_mb, 64 * s_kb);
+
+    // Small resources at 64KB and MSAA render targets at 4MB alignment, like the placed resources of HeapAllocator
+    std::mt19937 random(1);
+    for (int i = 0; i < 200; ++i) {
+        uint64_t alignment = (random() % 4 == 0) ? 4 * s_mb : 64 * s_kb;
+        uint64_t size = 1 + random() % (512 * s_kb);
+        uint64_t offset = allocator.Allocate(size, alignment);
+        if (offset == BuddyAllocator::s_invalid_offset)
+            break;
+        EXPECT_EQ(offset % alignment, 0u) << "size " << size << " alignment " << alignment;
+    }
+
+    BuddyAllocator empty(64 * s_mb, 64 * s_kb);
+    EXPECT_EQ(empty.Allocate(64 * s_kb, 128 * s_mb), BuddyAllocator::s_invalid_offset);
+}
+
+TEST(BuddyAllocatorTest, Exhaustion)
+{
+    BuddyAllocator allocator(1 * s_mb, 64 * s_kb);
+    EXPECT_EQ(allocator.Allocate(0), BuddyAllocator::s_invalid_offset);
+    EXPECT_EQ(allocator.Allocate(2 * s_mb), BuddyAllocator::s_invalid_offset);
+
+    std::vector<uint64_t> offsets;
+    for (int i = 0; i < 16; ++i) {
+        offsets.push_back(allocator.Allocate(64 * s_kb));
+        ASSERT_NE(offsets.back(), BuddyAllocator::s_invalid_offset);
+    }
+    EXPECT_EQ(allocator.Allocate(1), BuddyAllocator::s_invalid_offset);
+    EXPECT_EQ(allocator.GetStats().free_bytes, 0u);
+    EXPECT_EQ(allocator.GetStats().largest_free_block, 0u);
+    EXPECT_EQ(allocator.GetFragmentation(), 0.0f);
+
+    // A failed allocation leaves the allocator unchanged
+    EXPECT_EQ(allocator.GetStats().num_allocations, 16u);
+    allocator.Free(offsets[5]);
+    EXPECT_EQ(allocator.Allocate(64 * s_kb), offsets[5]);
+
+    EXPECT_THROW(allocator.Free(offsets[5] + 1), std::invalid_argument);
+    allocator.Free(offsets[5]);
+    EXPECT_THROW(allocator.Free(offsets[5]), std::invalid_argument);
+}
+
+TEST(BuddyAllocatorTest, Fragmentation)
+{
+    BuddyAllocator allocator(1 * s_mb, 64 * s_kb);
+    EXPECT_EQ(allocator.GetFragmentation(), 0.0f);
+
+    std::vector<uint64_t> offsets;
+    for (int i = 0; i < 16; ++i)
+        offsets.push_back(allocator.Allocate(64 * s_kb));
+
+    // Every other block free, the free memory can not be merged
+    for (size_t i = 0; i < offsets.size(); i += 2)
+        allocator.Free(offsets[i]);
+    EXPECT_EQ(allocator.GetStats().free_bytes, 512 * s_kb);
+    EXPECT_EQ(allocator.GetStats().largest_free_block, 64 * s_kb);
+    EXPECT_FLOAT_EQ(allocator.GetFragmentation(), 1.0f - 1.0f / 8.0f);
+    EXPECT_EQ(allocator.Allocate(128 * s_kb), BuddyAllocator::s_invalid_offset);
+
+    // Freeing the rest merges everything again
+    for (size_t i = 1; i < offsets.size(); i += 2)
+        allocator.Free(offsets[i]);
+    EXPECT_EQ(allocator.GetFragmentation(), 0.0f);
+    EXPECT_EQ(allocator.GetStats().largest_free_block, 1 * s_mb);
+}
+
+// Random allocations and frees never overlap and the stats match the live allocations
+TEST(BuddyAllocatorTest, RandomNoOverlap)
+{
+    BuddyAllocator allocator(16 * s_mb, 4 * s_kb);
+    std::mt19937 random(7);
+    std::map<uint64_t, uint64_t> live; // offset -> size
+
+    for (int step = 0; step < 20000; ++step) {
+        if (live.empty() || random() % 3 != 0) {
+            uint64_t size = 1 + random() % (random() % 8 == 0 ? 2 * s_mb : 32 * s_kb);
+            uint64_t offset = allocator.Allocate(size);
+            if (offset == BuddyAllocator::s_invalid_offset) {
+                EXPECT_LT(allocator.GetStats().largest_free_block, std::max(size, 4 * s_kb));
+                continue;
+            }
+            ASSERT_LE(offset + size, allocator.GetSize());
+
+            auto next = live.lower_bound(offset);
+            if (next != live.end()) {
+                ASSERT_LE(offset + size, next->first);
+            }
+            if (next != live.begin()) {
+                ASSERT_LE(std::prev(next)->first + std::prev(next)->second, offset);
+            }
+            live[offset] = size;
+        } else {
+            auto it = live.begin();
+            std::advance(it, random() % live.size());
+            allocator.Free(it->first);
+            live.erase(it);
+        }
+
+        ASSERT_EQ(allocator.GetStats().num_allocations, live.size());
+        ASSERT_EQ(allocator.GetStats().free_bytes + allocator.GetStats().used_bytes, allocator.GetSize());
+    }
+
+    for (const auto& [offset, size] : live)
+        allocator.Free(offset);
+    EXPECT_TRUE(allocator.IsEmpty());
+    EXPECT_EQ(allocator.GetStats().largest_free_block, allocator.GetSize());
+}
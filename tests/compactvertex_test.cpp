@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+
+#include "compactvertex.h"
+
+namespace {
+
+// Octahedral 2x16 bit snorm normals, half a step of 1/32767 on the octahedron stays below 1e-4 radians on the sphere
+constexpr float s_max_normal_error = 1e-4f;
+
+std::vector<Vertex> CreateRandomVertices(size_t count, const DirectX::XMFLOAT3& min_pos, const DirectX::XMFLOAT3& max_pos, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::normal_distribution<float> gaussian;
+
+    std::vector<Vertex> vertices(count);
+    for (Vertex& vertex : vertices) {
+        vertex.position = DirectX::XMFLOAT3(min_pos.x + unit(random) * (max_pos.x - min_pos.x), min_pos.y + unit(random) * (max_pos.y - min_pos.y),
+            min_pos.z + unit(random) * (max_pos.z - min_pos.z));
+        vertex.texture_coord = DirectX::XMFLOAT2(unit(random), unit(random));
+        DirectX::XMStoreFloat3(&vertex.normal, DirectX::XMVector3Normalize(DirectX::XMVectorSet(gaussian(random), gaussian(random), gaussian(random), 0.0f)));
+    }
+    return vertices;
+}
+
+}
+
+TEST(CompactVertexTest, Layout)
+{
+    EXPECT_EQ(sizeof(CompactVertex), 16u);
+}
+
+TEST(CompactVertexTest, ErrorWithinBounds)
+{
+    for (uint32_t seed = 0; seed < 4; ++seed) {
+        std::vector<Vertex> vertices = CreateRandomVertices(20000, { -120.0f, 3.0f, -0.5f }, { 80.0f, 40.0f, 0.5f }, seed);
+        VertexQuantization quantization = VertexCompressor::ComputeQuantization(vertices);
+        std::vector<CompactVertex> compact_vertices = VertexCompressor::Encode(vertices, quantization);
+        VertexCompressor::Error error = VertexCompressor::MeasureError(vertices, compact_vertices, quantization);
+
+        EXPECT_LE(error.position, VertexCompressor::GetPositionErrorBound(quantization)) << "seed " << seed;
+        EXPECT_LE(error.normal, s_max_normal_error) << "seed " << seed;
+
+        // Half floats keep 11 significant bits, the texture coordinates are in [0, 1]
+        EXPECT_LE(error.texture_coord, std::ldexp(1.0f, -12)) << "seed " << seed;
+    }
+}
+
+// Vertices on the bounds map to the ends of the unorm range
+TEST(CompactVertexTest, QuantizationCoversTheBounds)
+{
+    std::vector<Vertex> vertices = CreateRandomVertices(100, { -2.0f, -1.0f, 5.0f }, { 6.0f, 1.0f, 6.0f }, 11);
+    vertices[0].position = DirectX::XMFLOAT3(-2.0f, -1.0f, 5.0f);
+    vertices[1].position = DirectX::XMFLOAT3(6.0f, 1.0f, 6.0f);
+    VertexQuantization quantization = VertexCompressor::ComputeQuantization(vertices);
+
+    EXPECT_FLOAT_EQ(quantization.offset.x, -2.0f);
+    EXPECT_FLOAT_EQ(quantization.offset.y, -1.0f);
+    EXPECT_FLOAT_EQ(quantization.offset.z, 5.0f);
+    EXPECT_FLOAT_EQ(quantization.scale, 8.0f);
+
+    CompactVertex min_vertex = VertexCompressor::Encode(vertices[0], quantization);
+    CompactVertex max_vertex = VertexCompressor::Encode(vertices[1], quantization);
+    EXPECT_EQ(min_vertex.position[0], 0);
+    EXPECT_EQ(min_vertex.position[1], 0);
+    EXPECT_EQ(min_vertex.position[2], 0);
+    EXPECT_EQ(max_vertex.position[0], 65535);
+    EXPECT_EQ(VertexCompressor::Decode(max_vertex, quantization).position.x, 6.0f);
+}
+
+TEST(CompactVertexTest, DegenerateBounds)
+{
+    std::vector<Vertex> vertices(3, Vertex{ { 1.0f, 2.0f, 3.0f }, { 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } });
+    VertexQuantization quantization = VertexCompressor::ComputeQuantization(vertices);
+    EXPECT_EQ(quantization.scale, 1.0f);
+
+    VertexCompressor::Error error = VertexCompressor::MeasureError(vertices, VertexCompressor::Encode(vertices, quantization), quantization);
+    EXPECT_EQ(error.position, 0.0f);
+
+    quantization = VertexCompressor::ComputeQuantization({});
+    EXPECT_EQ(quantization.scale, 1.0f);
+}
+
+// The folded lower hemisphere, the axes and the diagonals of the octahedron
+TEST(CompactVertexTest, OctahedralNormals)
+{
+    std::vector<Vertex> vertices;
+    for (int x = -1; x <= 1; ++x) {
+        for (int y = -1; y <= 1; ++y) {
+            for (int z = -1; z <= 1; ++z) {
+                if (x == 0 && y == 0 && z == 0)
+                    continue;
+                Vertex vertex{ { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f }, {} };
+                DirectX::XMStoreFloat3(&vertex.normal, DirectX::XMVector3Normalize(DirectX::XMVectorSet(float(x), float(y), float(z), 0.0f)));
+                vertices.push_back(vertex);
+            }
+        }
+    }
+    VertexQuantization quantization = VertexCompressor::ComputeQuantization(vertices);
+    VertexCompressor::Error error = VertexCompressor::MeasureError(vertices, VertexCompressor::Encode(vertices, quantization), quantization);
+    EXPECT_LE(error.normal, s_max_normal_error);
+
+    // Missing normals are not measured
+    vertices.push_back(Vertex{ { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } });
+    EXPECT_EQ(VertexCompressor::MeasureError(vertices, VertexCompressor::Encode(vertices, quantization), quantization).normal, error.normal);
+}
+
+// The vertex shader decodes through the dequantize matrix folded into the model matrix
+TEST(CompactVertexTest, DequantizeMatrixMatchesDecode)
+{
+    std::vector<Vertex> vertices = CreateRandomVertices(1000, { -3.0f, -7.0f, 2.0f }, { 9.0f, 1.0f, 4.0f }, 5);
+    VertexQuantization quantization = VertexCompressor::ComputeQuantization(vertices);
+    DirectX::XMMATRIX dequantize = VertexCompressor::GetDequantizeMatrix(quantization);
+
+    for (const Vertex& vertex : vertices) {
+        CompactVertex compact = VertexCompressor::Encode(vertex, quantization);
+        Vertex decoded = VertexCompressor::Decode(compact, quantization);
+        DirectX::XMFLOAT3 transformed;
+        DirectX::XMStoreFloat3(&transformed, DirectX::XMVector3Transform(DirectX::XMVectorSet(compact.position[0] / 65535.0f,
+            compact.position[1] / 65535.0f, compact.position[2] / 65535.0f, 1.0f), dequantize));
+        EXPECT_NEAR(transformed.x, decoded.position.x, 1e-5f);
+        EXPECT_NEAR(transformed.y, decoded.position.y, 1e-5f);
+        EXPECT_NEAR(transformed.z, decoded.position.z, 1e-5f);
+    }
+}
@@ -0,0 +1,237 @@
+#pragma once
+
+// Linux stand-in for the part of DirectXMath used by the platform independent sources, plain scalar code
+// Same conventions as DirectXMath: row vectors, points are transformed by v * M, left handed projections
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace DirectX {
+
+struct XMFLOAT2 {
+    float x, y;
+    XMFLOAT2() = default;
+    constexpr XMFLOAT2(float _x, float _y) : x(_x), y(_y) {}
+};
+
+struct XMFLOAT3 {
+    float x, y, z;
+    XMFLOAT3() = default;
+    constexpr XMFLOAT3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+};
+
+struct XMFLOAT4 {
+    float x, y, z, w;
+    XMFLOAT4() = default;
+    constexpr XMFLOAT4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+};
+
+struct XMFLOAT4X4 {
+    union {
+        struct {
+            float _11, _12, _13, _14;
+            float _21, _22, _23, _24;
+            float _31, _32, _33, _34;
+            float _41, _42, _43, _44;
+        };
+        float m[4][4];
+    };
+};
+
+struct alignas(16) XMVECTOR {
+    float f[4];
+};
+
+struct alignas(16) XMMATRIX {
+    XMVECTOR r[4];
+};
+
+// Vector
+
+inline XMVECTOR XMVectorSet(float x, float y, float z, float w) { return { { x, y, z, w } }; }
+inline XMVECTOR XMVectorReplicate(float value) { return { { value, value, value, value } }; }
+inline XMVECTOR XMVectorZero() { return { { 0.0f, 0.0f, 0.0f, 0.0f } }; }
+inline float XMVectorGetX(const XMVECTOR& v) { return v.f[0]; }
+inline float XMVectorGetY(const XMVECTOR& v) { return v.f[1]; }
+inline float XMVectorGetZ(const XMVECTOR& v) { return v.f[2]; }
+inline float XMVectorGetW(const XMVECTOR& v) { return v.f[3]; }
+
+inline XMVECTOR XMLoadFloat3(const XMFLOAT3* source) { return { { source->x, source->y, source->z, 0.0f } }; }
+inline XMVECTOR XMLoadFloat4(const XMFLOAT4* source) { return { { source->x, source->y, source->z, source->w } }; }
+inline void XMStoreFloat3(XMFLOAT3* destination, const XMVECTOR& v) { *destination = XMFLOAT3(v.f[0], v.f[1], v.f[2]); }
+inline void XMStoreFloat4(XMFLOAT4* destination, const XMVECTOR& v) { *destination = XMFLOAT4(v.f[0], v.f[1], v.f[2], v.f[3]); }
+
+template <typename Op>
+inline XMVECTOR XMVectorComponentwise(const XMVECTOR& a, const XMVECTOR& b, Op op)
+{
+    return { { op(a.f[0], b.f[0]), op(a.f[1], b.f[1]), op(a.f[2], b.f[2]), op(a.f[3], b.f[3]) } };
+}
+
+inline XMVECTOR XMVectorAdd(const XMVECTOR& a, const XMVECTOR& b) { return XMVectorComponentwise(a, b, [](float x, float y) { return x + y; }); }
+inline XMVECTOR XMVectorSubtract(const XMVECTOR& a, const XMVECTOR& b) { return XMVectorComponentwise(a, b, [](float x, float y) { return x - y; }); }
+inline XMVECTOR XMVectorMultiply(const XMVECTOR& a, const XMVECTOR& b) { return XMVectorComponentwise(a, b, [](float x, float y) { return x * y; }); }
+inline XMVECTOR XMVectorMin(const XMVECTOR& a, const XMVECTOR& b) { return XMVectorComponentwise(a, b, [](float x, float y) { return std::min(x, y); }); }
+inline XMVECTOR XMVectorMax(const XMVECTOR& a, const XMVECTOR& b) { return XMVectorComponentwise(a, b, [](float x, float y) { return std::max(x, y); }); }
+inline XMVECTOR XMVectorScale(const XMVECTOR& v, float scale) { return XMVectorMultiply(v, XMVectorReplicate(scale)); }
+
+inline XMVECTOR XMVector3Dot(const XMVECTOR& a, const XMVECTOR& b) { return XMVectorReplicate(a.f[0] * b.f[0] + a.f[1] * b.f[1] + a.f[2] * b.f[2]); }
+inline XMVECTOR XMVector4Dot(const XMVECTOR& a, const XMVECTOR& b) { return XMVectorReplicate(a.f[0] * b.f[0] + a.f[1] * b.f[1] + a.f[2] * b.f[2] + a.f[3] * b.f[3]); }
+inline XMVECTOR XMVector3LengthSq(const XMVECTOR& v) { return XMVector3Dot(v, v); }
+inline XMVECTOR XMVector3Length(const XMVECTOR& v) { return XMVectorReplicate(std::sqrt(XMVectorGetX(XMVector3LengthSq(v)))); }
+
+inline XMVECTOR XMVector3Cross(const XMVECTOR& a, const XMVECTOR& b)
+{
+    return XMVectorSet(a.f[1] * b.f[2] - a.f[2] * b.f[1], a.f[2] * b.f[0] - a.f[0] * b.f[2], a.f[0] * b.f[1] - a.f[1] * b.f[0], 0.0f);
+}
+
+inline XMVECTOR XMVector3Normalize(const XMVECTOR& v)
+{
+    float length = XMVectorGetX(XMVector3Length(v));
+    return length > 0.0f ? XMVectorScale(v, 1.0f / length) : XMVectorZero();
+}
+
+inline XMVECTOR XMVector3AngleBetweenNormals(const XMVECTOR& a, const XMVECTOR& b)
+{
+    return XMVectorReplicate(std::acos(std::clamp(XMVectorGetX(XMVector3Dot(a, b)), -1.0f, 1.0f)));
+}
+
+// Transforms the point (x, y, z, 1) without dividing by w
+inline XMVECTOR XMVector3Transform(const XMVECTOR& v, const XMMATRIX& m)
+{
+    XMVECTOR result = m.r[3];
+    for (int i = 0; i < 3; ++i)
+        result = XMVectorAdd(result, XMVectorScale(m.r[i], v.f[i]));
+    return result;
+}
+
+inline XMVECTOR XMVector4Transform(const XMVECTOR& v, const XMMATRIX& m)
+{
+    XMVECTOR result = XMVectorZero();
+    for (int i = 0; i < 4; ++i)
+        result = XMVectorAdd(result, XMVectorScale(m.r[i], v.f[i]));
+    return result;
+}
+
+// Plane
+
+inline XMVECTOR XMPlaneDotCoord(const XMVECTOR& plane, const XMVECTOR& v) { return XMVectorReplicate(XMVectorGetX(XMVector3Dot(plane, v)) + plane.f[3]); }
+
+inline XMVECTOR XMPlaneNormalize(const XMVECTOR& plane)
+{
+    float length = XMVectorGetX(XMVector3Length(plane));
+    return length > 0.0f ? XMVectorScale(plane, 1.0f / length) : XMVectorZero();
+}
+
+// Matrix
+
+inline XMMATRIX XMMatrixSet(float m00, float m01, float m02, float m03, float m10, float m11, float m12, float m13,
+    float m20, float m21, float m22, float m23, float m30, float m31, float m32, float m33)
+{
+    return { { XMVectorSet(m00, m01, m02, m03), XMVectorSet(m10, m11, m12, m13), XMVectorSet(m20, m21, m22, m23), XMVectorSet(m30, m31, m32, m33) } };
+}
+
+inline XMMATRIX XMMatrixIdentity() { return XMMatrixSet(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1); }
+inline XMMATRIX XMMatrixScaling(float x, float y, float z) { return XMMatrixSet(x, 0, 0, 0, 0, y, 0, 0, 0, 0, z, 0, 0, 0, 0, 1); }
+inline XMMATRIX XMMatrixTranslation(float x, float y, float z) { return XMMatrixSet(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, x, y, z, 1); }
+
+inline XMMATRIX XMMatrixMultiply(const XMMATRIX& a, const XMMATRIX& b)
+{
+    XMMATRIX result;
+    for (int i = 0; i < 4; ++i)
+        result.r[i] = XMVector4Transform(a.r[i], b);
+    return result;
+}
+
+inline XMMATRIX XMMatrixTranspose(const XMMATRIX& m)
+{
+    XMMATRIX result;
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            result.r[i].f[j] = m.r[j].f[i];
+    return result;
+}
+
+// Inverse by cofactors, the determinant is returned replicated like DirectXMath does
+inline XMMATRIX XMMatrixInverse(XMVECTOR* determinant, const XMMATRIX& m)
+{
+    float a[4][4];
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            a[i][j] = m.r[i].f[j];
+
+    auto minor3 = [&a](int row, int column) {
+        float s[3][3];
+        for (int i = 0, si = 0; i < 4; ++i) {
+            if (i == row)
+                continue;
+            for (int j = 0, sj = 0; j < 4; ++j) {
+                if (j == column)
+                    continue;
+                s[si][sj++] = a[i][j];
+            }
+            ++si;
+        }
+        return s[0][0] * (s[1][1] * s[2][2] - s[1][2] * s[2][1]) - s[0][1] * (s[1][0] * s[2][2] - s[1][2] * s[2][0]) + s[0][2] * (s[1][0] * s[2][1] - s[1][1] * s[2][0]);
+    };
+
+    float cofactors[4][4];
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            cofactors[i][j] = ((i + j) % 2 ? -1.0f : 1.0f) * minor3(i, j);
+
+    float det = 0.0f;
+    for (int j = 0; j < 4; ++j)
+        det += a[0][j] * cofactors[0][j];
+    if (determinant)
+        *determinant = XMVectorReplicate(det);
+
+    XMMATRIX result;
+    float inverse_det = det != 0.0f ? 1.0f / det : 0.0f;
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            result.r[i].f[j] = cofactors[j][i] * inverse_det;
+    return result;
+}
+
+inline XMMATRIX XMMatrixLookAtLH(const XMVECTOR& eye, const XMVECTOR& focus, const XMVECTOR& up)
+{
+    XMVECTOR z = XMVector3Normalize(XMVectorSubtract(focus, eye));
+    XMVECTOR x = XMVector3Normalize(XMVector3Cross(up, z));
+    XMVECTOR y = XMVector3Cross(z, x);
+    return XMMatrixSet(
+        x.f[0], y.f[0], z.f[0], 0.0f,
+        x.f[1], y.f[1], z.f[1], 0.0f,
+        x.f[2], y.f[2], z.f[2], 0.0f,
+        -XMVectorGetX(XMVector3Dot(x, eye)), -XMVectorGetX(XMVector3Dot(y, eye)), -XMVectorGetX(XMVector3Dot(z, eye)), 1.0f);
+}
+
+inline XMMATRIX XMMatrixPerspectiveFovLH(float fov_y, float aspect_ratio, float near_z, float far_z)
+{
+    float y_scale = 1.0f / std::tan(0.5f * fov_y);
+    float x_scale = y_scale / aspect_ratio;
+    float range = far_z / (far_z - near_z);
+    return XMMatrixSet(
+        x_scale, 0.0f, 0.0f, 0.0f,
+        0.0f, y_scale, 0.0f, 0.0f,
+        0.0f, 0.0f, range, 1.0f,
+        0.0f, 0.0f, -range * near_z, 0.0f);
+}
+
+inline void XMStoreFloat4x4(XMFLOAT4X4* destination, const XMMATRIX& m)
+{
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            destination->m[i][j] = m.r[i].f[j];
+}
+
+inline XMMATRIX XMLoadFloat4x4(const XMFLOAT4X4* source)
+{
+    XMMATRIX result;
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            result.r[i].f[j] = source->m[i][j];
+    return result;
+}
+
+}
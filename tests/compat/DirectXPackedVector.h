@@ -0,0 +1,76 @@
+#pragma once
+
+// Linux stand-in for the half precision conversions of DirectXPackedVector, IEEE 754 binary16 rounded to nearest even
+
+#include <cstdint>
+#include <cstring>
+
+namespace DirectX {
+namespace PackedVector {
+
+using HALF = uint16_t;
+
+inline HALF XMConvertFloatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t magnitude = bits & 0x7FFFFFFF;
+
+    // NaN stays NaN, infinity and overflow become infinity
+    if (magnitude > 0x7F800000)
+        return static_cast<HALF>(sign | 0x7E00);
+    if (magnitude >= 0x477FF000)
+        return static_cast<HALF>(sign | 0x7C00);
+
+    // Denormals and zero, the implicit bit is shifted into the mantissa
+    if (magnitude < 0x38800000) {
+        if (magnitude < 0x33000000)
+            return static_cast<HALF>(sign);
+        uint32_t shift = 126 - (magnitude >> 23);
+        uint32_t mantissa = (magnitude & 0x007FFFFF) | 0x00800000;
+        uint32_t half = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1)))
+            half++;
+        return static_cast<HALF>(sign | half);
+    }
+
+    uint32_t half = ((magnitude - 0x38000000) >> 13);
+    uint32_t remainder = magnitude & 0x1FFF;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+        half++;
+    return static_cast<HALF>(sign | half);
+}
+
+inline float XMConvertHalfToFloat(HALF value)
+{
+    uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1F;
+    uint32_t mantissa = value & 0x3FF;
+
+    uint32_t bits;
+    if (exponent == 0x1F) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else if (mantissa != 0) {
+        // Normalize the denormal
+        exponent = 113;
+        while (!(mantissa & 0x400)) {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+    } else {
+        bits = sign;
+    }
+
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+// Linux stand-in for the plain data types of d3d12.h used by the platform independent sources
+// Same layout and enum values as the Windows SDK, so the structures can be compared by their bytes
+
+#include <cstdint>
+
+typedef uint64_t D3D12_GPU_VIRTUAL_ADDRESS;
+typedef uint32_t UINT;
+typedef int32_t INT;
+
+enum DXGI_FORMAT {
+    DXGI_FORMAT_UNKNOWN = 0,
+    DXGI_FORMAT_R32_UINT = 42,
+    DXGI_FORMAT_R16_UINT = 57,
+};
+
+struct D3D12_VERTEX_BUFFER_VIEW {
+    D3D12_GPU_VIRTUAL_ADDRESS BufferLocation;
+    UINT SizeInBytes;
+    UINT StrideInBytes;
+};
+
+struct D3D12_INDEX_BUFFER_VIEW {
+    D3D12_GPU_VIRTUAL_ADDRESS BufferLocation;
+    UINT SizeInBytes;
+    DXGI_FORMAT Format;
+};
+
+struct D3D12_DRAW_INDEXED_ARGUMENTS {
+    UINT IndexCountPerInstance;
+    UINT InstanceCount;
+    UINT StartIndexLocation;
+    INT BaseVertexLocation;
+    UINT StartInstanceLocation;
+};
+
+enum D3D12_INDIRECT_ARGUMENT_TYPE {
+    D3D12_INDIRECT_ARGUMENT_TYPE_DRAW = 0,
+    D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED = 1,
+    D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH = 2,
+    D3D12_INDIRECT_ARGUMENT_TYPE_VERTEX_BUFFER_VIEW = 3,
+    D3D12_INDIRECT_ARGUMENT_TYPE_INDEX_BUFFER_VIEW = 4,
+    D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT = 5,
+    D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT_BUFFER_VIEW = 6,
+    D3D12_INDIRECT_ARGUMENT_TYPE_SHADER_RESOURCE_VIEW = 7,
+    D3D12_INDIRECT_ARGUMENT_TYPE_UNORDERED_ACCESS_VIEW = 8,
+};
+
+struct D3D12_INDIRECT_ARGUMENT_DESC {
+    D3D12_INDIRECT_ARGUMENT_TYPE Type;
+    union {
+        struct {
+            UINT Slot;
+        } VertexBuffer;
+        struct {
+            UINT RootParameterIndex;
+            UINT DestOffsetIn32BitValues;
+            UINT Num32BitValuesToSet;
+        } Constant;
+        struct {
+            UINT RootParameterIndex;
+        } ConstantBufferView;
+        struct {
+            UINT RootParameterIndex;
+        } ShaderResourceView;
+        struct {
+            UINT RootParameterIndex;
+        } UnorderedAccessView;
+    };
+};
@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+
+#include "indirectdrawbuilder.h"
+
+namespace {
+
+constexpr unsigned int s_num_pipeline_states = 2;
+
+// Index buffer of a grid with more than 64k vertices, split into ranges and stored relative to their base vertex like IMesh::UploadIndices()
+struct TestMesh {
+    std::vector<uint32_t> indices;
+    std::vector<MeshOptimizer::IndexRange> index_ranges;
+    std::vector<uint16_t> indices_16;
+};
+
+TestMesh CreateGrid(uint32_t width, uint32_t height)
+{
+    TestMesh mesh;
+    for (uint32_t y = 0; y + 1 < height; ++y) {
+        for (uint32_t x = 0; x + 1 < width; ++x) {
+            uint32_t v = y * width + x;
+            mesh.indices.insert(mesh.indices.end(), { v, v + width, v + 1, v + 1, v + width, v + width + 1 });
+        }
+    }
+
+    mesh.index_ranges = MeshOptimizer::SplitIndexRanges(mesh.indices);
+    mesh.indices_16.resize(mesh.indices.size());
+    for (const MeshOptimizer::IndexRange& range : mesh.index_ranges) {
+        for (uint32_t i = range.index_offset; i < range.index_offset + range.index_count; ++i)
+            mesh.indices_16[i] = static_cast<uint16_t>(mesh.indices[i] - range.base_vertex);
+    }
+    return mesh;
+}
+
+IndirectDrawBuilder::Draw CreateDraw(uint32_t draw_idx, uint32_t index_count, uint32_t start_index, uint32_t num_instances)
+{
+    return { { draw_idx * 7, draw_idx }, { 0x10000 + draw_idx * 0x100, 1024, 16 }, { 0x20000 + draw_idx * 0x100, 2048, DXGI_FORMAT_R16_UINT },
+        index_count, start_index, num_instances };
+}
+
+// The commands of a draw set its root constants and buffers, and together fetch the vertices the direct path draws from the
+// 32 bit index buffer, in the same order
+void ExpectSameVertices(const TestMesh& mesh, const IndirectDrawBuilder::Draw& draw, std::span<const IndirectDrawBuilder::Command> commands)
+{
+    std::vector<uint32_t> vertices;
+    for (const IndirectDrawBuilder::Command& command : commands) {
+        EXPECT_EQ(std::memcmp(command.root_constants, draw.root_constants, sizeof(draw.root_constants)), 0);
+        EXPECT_EQ(command.vertex_buffer_view.BufferLocation, draw.vertex_buffer_view.BufferLocation);
+        EXPECT_EQ(command.index_buffer_view.BufferLocation, draw.index_buffer_view.BufferLocation);
+        EXPECT_EQ(command.arguments.InstanceCount, draw.num_instances);
+        EXPECT_EQ(command.arguments.StartInstanceLocation, 0u);
+        EXPECT_EQ(command.arguments.IndexCountPerInstance % 3, 0u);
+
+        const D3D12_DRAW_INDEXED_ARGUMENTS& arguments = command.arguments;
+        for (uint32_t i = arguments.StartIndexLocation; i < arguments.StartIndexLocation + arguments.IndexCountPerInstance; ++i) {
+            int64_t vertex = int64_t(mesh.index_ranges.empty() ? mesh.indices[i] : mesh.indices_16[i]) + arguments.BaseVertexLocation;
+            vertices.push_back(static_cast<uint32_t>(vertex));
+        }
+    }
+
+    std::span<const uint32_t> expected(mesh.indices.data() + draw.start_index, draw.index_count);
+    ASSERT_EQ(vertices.size(), expected.size());
+    EXPECT_TRUE(std::equal(vertices.begin(), vertices.end(), expected.begin()));
+}
+
+// Commands of the pipeline state in the argument buffer
+std::vector<IndirectDrawBuilder::Command> ReadCommands(const IndirectDrawBuilder& builder, unsigned int pipeline_idx)
+{
+    std::vector<uint8_t> buffer(builder.GetBufferSize());
+    std::vector<IndirectDrawBuilder::Command> commands;
+    for (const IndirectDrawBuilder::Group& group : builder.Write(buffer.data())) {
+        if (group.pipeline_idx != pipeline_idx)
+            continue;
+        commands.resize(group.num_commands);
+        std::memcpy(commands.data(), buffer.data() + group.offset, group.num_commands * sizeof(IndirectDrawBuilder::Command));
+    }
+    return commands;
+}
+
+}
+
+// Every 32 bit index fits a 16 bit index relative to the base vertex of its range
+TEST(IndirectDrawBuilderTest, GridIsSplit)
+{
+    TestMesh mesh = CreateGrid(400, 300);
+    ASSERT_GT(mesh.index_ranges.size(), 1u);
+    for (const MeshOptimizer::IndexRange& range : mesh.index_ranges) {
+        for (uint32_t i = range.index_offset; i < range.index_offset + range.index_count; ++i)
+            ASSERT_LT(mesh.indices[i] - range.base_vertex, 65536u);
+    }
+}
+
+TEST(IndirectDrawBuilderTest, CommandsMatchTheDirectDraws)
+{
+    TestMesh mesh = CreateGrid(400, 300);
+    uint32_t num_triangles = static_cast<uint32_t>(mesh.indices.size() / 3);
+
+    // The whole mesh, draws ending and starting at a range boundary, one inside a range and random meshlet-like ranges
+    std::vector<std::pair<uint32_t, uint32_t>> ranges = { { 0, num_triangles }, { 0, mesh.index_ranges[0].index_count / 3 },
+        { mesh.index_ranges[1].index_offset / 3, 1 }, { mesh.index_ranges[1].index_offset / 3 - 1, 2 }, { 10, 20 } };
+    std::mt19937 random(3);
+    for (int i = 0; i < 200; ++i) {
+        uint32_t first = random() % num_triangles;
+        ranges.push_back({ first, 1 + random() % std::min<uint32_t>(num_triangles - first, 50000) });
+    }
+
+    for (size_t draw_idx = 0; draw_idx < ranges.size(); ++draw_idx) {
+        IndirectDrawBuilder builder(s_num_pipeline_states);
+        IndirectDrawBuilder::Draw draw = CreateDraw(static_cast<uint32_t>(draw_idx), ranges[draw_idx].second * 3, ranges[draw_idx].first * 3, 1 + draw_idx % 3);
+        builder.Add(1, draw, mesh.index_ranges);
+        std::vector<IndirectDrawBuilder::Command> commands = ReadCommands(builder, 1);
+        ASSERT_EQ(commands.size(), builder.GetNumCommands());
+        SCOPED_TRACE("draw " + std::to_string(draw_idx));
+        ExpectSameVertices(mesh, draw, commands);
+
+        // The direct path records the same draw calls
+        std::vector<D3D12_DRAW_INDEXED_ARGUMENTS> direct;
+        IndirectDrawBuilder::ForEachDrawCall(mesh.index_ranges, draw.index_count, draw.start_index, draw.num_instances,
+            [&direct](const D3D12_DRAW_INDEXED_ARGUMENTS& arguments) { direct.push_back(arguments); });
+        ASSERT_EQ(direct.size(), commands.size());
+        for (size_t i = 0; i < direct.size(); ++i)
+            EXPECT_EQ(std::memcmp(&direct[i], &commands[i].arguments, sizeof(D3D12_DRAW_INDEXED_ARGUMENTS)), 0);
+    }
+}
+
+// Meshes drawn with 32 bit indices take one command per draw
+TEST(IndirectDrawBuilderTest, UnsplitMesh)
+{
+    TestMesh mesh = CreateGrid(100, 100);
+    mesh.index_ranges.clear();
+
+    IndirectDrawBuilder builder(s_num_pipeline_states);
+    IndirectDrawBuilder::Draw draw = CreateDraw(3, 600, 1200, 4);
+    builder.Add(0, draw, mesh.index_ranges);
+    std::vector<IndirectDrawBuilder::Command> commands = ReadCommands(builder, 0);
+    ASSERT_EQ(commands.size(), 1u);
+    EXPECT_EQ(commands[0].arguments.BaseVertexLocation, 0);
+    ExpectSameVertices(mesh, draw, commands);
+}
+
+// The commands are grouped by pipeline state, merged builders keep their order within a group
+TEST(IndirectDrawBuilderTest, GroupsByPipelineState)
+{
+    TestMesh mesh = CreateGrid(10, 10);
+    mesh.index_ranges.clear();
+
+    IndirectDrawBuilder first(s_num_pipeline_states);
+    IndirectDrawBuilder second(s_num_pipeline_states);
+    for (uint32_t draw_idx = 0; draw_idx < 10; ++draw_idx)
+        (draw_idx < 5 ? first : second).Add(draw_idx % 2, CreateDraw(draw_idx, 6, draw_idx * 6, 1), mesh.index_ranges);
+
+    IndirectDrawBuilder builder(s_num_pipeline_states);
+    builder.Append(first);
+    builder.Append(second);
+    EXPECT_EQ(builder.GetNumCommands(), 10u);
+    EXPECT_EQ(builder.GetBufferSize(), 10 * sizeof(IndirectDrawBuilder::Command));
+
+    std::vector<uint8_t> buffer(builder.GetBufferSize());
+    std::vector<IndirectDrawBuilder::Group> groups = builder.Write(buffer.data());
+    ASSERT_EQ(groups.size(), 2u);
+    EXPECT_EQ(groups[0].pipeline_idx, 0u);
+    EXPECT_EQ(groups[0].offset, 0u);
+    EXPECT_EQ(groups[0].num_commands, 5u);
+    EXPECT_EQ(groups[1].pipeline_idx, 1u);
+    EXPECT_EQ(groups[1].offset, 5 * sizeof(IndirectDrawBuilder::Command));
+
+    for (unsigned int pipeline_idx = 0; pipeline_idx < s_num_pipeline_states; ++pipeline_idx) {
+        std::vector<IndirectDrawBuilder::Command> commands = ReadCommands(builder, pipeline_idx);
+        for (size_t i = 0; i < commands.size(); ++i)
+            EXPECT_EQ(commands[i].root_constants[1], i * 2 + pipeline_idx);
+    }
+
+    builder.Clear();
+    EXPECT_EQ(builder.GetNumCommands(), 0u);
+    EXPECT_TRUE(builder.Write(buffer.data()).empty());
+}
+
+// The arguments of the command signature are packed in the order of the members of Command
+TEST(IndirectDrawBuilderTest, ArgumentLayout)
+{
+    std::vector<D3D12_INDIRECT_ARGUMENT_DESC> argument_descs = IndirectDrawBuilder::GetArgumentDescs(0);
+    ASSERT_EQ(argument_descs.size(), 4u);
+    EXPECT_EQ(argument_descs[0].Type, D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT);
+    EXPECT_EQ(argument_descs[0].Constant.Num32BitValuesToSet, IndirectDrawBuilder::s_num_root_constants);
+    EXPECT_EQ(argument_descs[1].Type, D3D12_INDIRECT_ARGUMENT_TYPE_VERTEX_BUFFER_VIEW);
+    EXPECT_EQ(argument_descs[2].Type, D3D12_INDIRECT_ARGUMENT_TYPE_INDEX_BUFFER_VIEW);
+    EXPECT_EQ(argument_descs[3].Type, D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED);
+
+    size_t argument_bytes = IndirectDrawBuilder::s_num_root_constants * sizeof(uint32_t) + sizeof(D3D12_VERTEX_BUFFER_VIEW) +
+        sizeof(D3D12_INDEX_BUFFER_VIEW) + sizeof(D3D12_DRAW_INDEXED_ARGUMENTS);
+    EXPECT_EQ(offsetof(IndirectDrawBuilder::Command, arguments) + sizeof(D3D12_DRAW_INDEXED_ARGUMENTS), argument_bytes);
+}
@@ -0,0 +1,23 @@
+// Job throughput and parallel for scaling of JobSystem::RunBenchmark() with 1 to num_threads threads
+// Usage: jobsystem_benchmark [num_threads], defaults to every hardware thread
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "jobsystem.h"
+
+int main(int argc, char** argv)
+{
+    unsigned int max_threads = argc > 1 ? static_cast<unsigned int>(std::strtoul(argv[1], nullptr, 10)) : JobSystem::GetNumThreads();
+    std::vector<JobSystem::BenchmarkResult> results = JobSystem::RunBenchmark(max_threads);
+    if (results.empty())
+        return 1;
+
+    std::printf("JobSystem: 100k empty jobs started from one thread, 4M element parallel for in 4k chunks\n");
+    for (const JobSystem::BenchmarkResult& result : results) {
+        std::printf("  %2u threads %8.2f Mjobs/s, parallel for %7.2f ms, %.2fx speedup\n", result.num_threads, result.jobs_per_second * 1e-6,
+            result.parallel_for_time * 1e3, results[0].parallel_for_time / result.parallel_for_time);
+    }
+    return 0;
+}
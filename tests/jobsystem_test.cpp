@@ -0,0 +1,261 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "jobsystem.h"
+
+TEST(JobSystemTest, RunsEveryJob)
+{
+    for (unsigned int num_threads : { 1u, 2u, 4u }) {
+        JobSystem job_system(num_threads);
+        EXPECT_EQ(job_system.GetNumWorkers(), num_threads);
+
+        std::atomic<int> sum(0);
+        JobSystem::Counter counter;
+        for (int i = 1; i <= 1000; ++i)
+            job_system.Run([&sum, i]() { sum += i; }, &counter);
+        job_system.Wait(counter);
+
+        EXPECT_TRUE(counter.IsDone());
+        EXPECT_EQ(sum, 500500);
+        EXPECT_EQ(job_system.GetStats().num_jobs, 1000u);
+    }
+}
+
+TEST(JobSystemTest, Dependencies)
+{
+    JobSystem job_system(4);
+
+    // Three stages, each job of a stage checks that the whole previous stage has finished
+    constexpr int num_jobs = 64;
+    std::atomic<int> stage_done[3] = { 0, 0, 0 };
+    std::atomic<int> num_errors(0);
+    JobSystem::Counter stages[3];
+    for (int stage = 0; stage < 3; ++stage) {
+        for (int i = 0; i < num_jobs; ++i) {
+            job_system.Run([&, stage]() {
+                if (stage > 0 && stage_done[stage - 1] != num_jobs)
+                    ++num_errors;
+                std::this_thread::sleep_for(std::chrono::microseconds(10));
+                ++stage_done[stage];
+            }, &stages[stage], stage > 0 ? &stages[stage - 1] : nullptr);
+        }
+    }
+
+    job_system.Wait(stages[2]);
+    EXPECT_EQ(num_errors, 0);
+    EXPECT_EQ(stage_done[2], num_jobs);
+    EXPECT_TRUE(stages[0].IsDone());
+    EXPECT_TRUE(stages[1].IsDone());
+}
+
+TEST(JobSystemTest, FinishedDependencyStartsDirectly)
+{
+    JobSystem job_system(1);
+    JobSystem::Counter dependency;
+    JobSystem::Counter counter;
+    bool ran = false;
+    job_system.Run([&ran]() { ran = true; }, &counter, &dependency);
+    job_system.Wait(counter);
+    EXPECT_TRUE(ran);
+}
+
+// Jobs waiting for the jobs they start help instead of blocking, so even a single thread makes progress
+TEST(JobSystemTest, NestedWait)
+{
+    for (unsigned int num_threads : { 1u, 3u }) {
+        JobSystem job_system(num_threads);
+        std::atomic<int> num_leaves(0);
+        JobSystem::Counter counter;
+        for (int i = 0; i < 8; ++i) {
+            job_system.Run([&job_system, &num_leaves]() {
+                JobSystem::Counter children;
+                for (int j = 0; j < 8; ++j)
+                    job_system.Run([&num_leaves]() { ++num_leaves; }, &children);
+                job_system.Wait(children);
+            }, &counter);
+        }
+        job_system.Wait(counter);
+        EXPECT_EQ(num_leaves, 64);
+    }
+}
+
+TEST(JobSystemTest, ExceptionsAreRethrownByWait)
+{
+    JobSystem job_system(2);
+    JobSystem::Counter counter;
+    std::atomic<int> num_done(0);
+    for (int i = 0; i < 16; ++i) {
+        job_system.Run([&num_done, i]() {
+            ++num_done;
+            if (i == 5)
+                throw std::runtime_error("job failed");
+        }, &counter);
+    }
+    EXPECT_THROW(job_system.Wait(counter), std::runtime_error);
+    EXPECT_EQ(num_done, 16);
+
+    // The error is reported once, the counter can be used again
+    job_system.Run([]() {}, &counter);
+    EXPECT_NO_THROW(job_system.Wait(counter));
+}
+
+TEST(JobSystemTest, Priorities)
+{
+    // Without worker threads only the waiting thread runs jobs, it helps with high priority jobs only
+    JobSystem job_system(1);
+    EXPECT_EQ(JobSystem::GetCurrentPriority(), JobSystem::JOB_PRIORITY_HIGH);
+
+    JobSystem::Counter low;
+    JobSystem::Counter high;
+    std::atomic<bool> low_ran(false);
+    JobSystem::JobPriority low_priority = JobSystem::JOB_PRIORITY_HIGH;
+    JobSystem::JobPriority child_priority = JobSystem::JOB_PRIORITY_HIGH;
+    job_system.Run([&]() {
+        low_ran = true;
+        low_priority = JobSystem::GetCurrentPriority();
+
+        // Jobs started by a job inherit its priority
+        JobSystem::Counter child;
+        job_system.Run([&child_priority]() { child_priority = JobSystem::GetCurrentPriority(); }, &child);
+        job_system.Wait(child);
+    }, &low, nullptr, JobSystem::JOB_PRIORITY_LOW);
+    job_system.Run([]() {}, &high, nullptr, JobSystem::JOB_PRIORITY_HIGH);
+
+    job_system.Wait(high);
+    EXPECT_FALSE(low_ran);
+    EXPECT_FALSE(low.IsDone());
+
+    job_system.Wait(low, JobSystem::JOB_PRIORITY_LOW);
+    EXPECT_TRUE(low_ran);
+    EXPECT_EQ(low_priority, JobSystem::JOB_PRIORITY_LOW);
+    EXPECT_EQ(child_priority, JobSystem::JOB_PRIORITY_LOW);
+    EXPECT_EQ(JobSystem::GetCurrentPriority(), JobSystem::JOB_PRIORITY_HIGH);
+}
+
+// High priority jobs are taken before the low priority ones queued earlier
+TEST(JobSystemTest, HighPriorityFirst)
+{
+    JobSystem job_system(1);
+    std::vector<JobSystem::JobPriority> order;
+    JobSystem::Counter counter;
+    for (JobSystem::JobPriority priority : { JobSystem::JOB_PRIORITY_LOW, JobSystem::JOB_PRIORITY_HIGH }) {
+        for (int i = 0; i < 4; ++i)
+            job_system.Run([&order, priority]() { order.push_back(priority); }, &counter, nullptr, priority);
+    }
+    job_system.Wait(counter, JobSystem::JOB_PRIORITY_LOW);
+
+    ASSERT_EQ(order.size(), 8u);
+    for (size_t i = 0; i < order.size(); ++i)
+        EXPECT_EQ(order[i], i < 4 ? JobSystem::JOB_PRIORITY_HIGH : JobSystem::JOB_PRIORITY_LOW) << "job " << i;
+}
+
+TEST(JobSystemTest, ParallelForCoversTheRange)
+{
+    JobSystem job_system(4);
+    struct Case {
+        size_t begin;
+        size_t end;
+        size_t grain_size;
+    };
+    for (const Case& test : { Case{ 0, 0, 16 }, Case{ 5, 3, 16 }, Case{ 0, 1, 16 }, Case{ 0, 1000, 1 }, Case{ 3, 1003, 7 },
+        Case{ 0, 100, 100 }, Case{ 0, 101, 100 }, Case{ 10, 20, 0 }, Case{ 0, 100000, 1024 } }) {
+        std::vector<std::atomic<int>> visits(test.end > test.begin ? test.end : 0);
+        std::atomic<size_t> num_chunks(0);
+        std::atomic<bool> chunk_too_large(false);
+        job_system.ParallelFor(test.begin, test.end, test.grain_size, [&](size_t chunk_begin, size_t chunk_end) {
+            if (chunk_end - chunk_begin > std::max<size_t>(test.grain_size, 1))
+                chunk_too_large = true;
+            for (size_t i = chunk_begin; i < chunk_end; ++i)
+                ++visits[i];
+            ++num_chunks;
+        });
+
+        EXPECT_FALSE(chunk_too_large);
+        for (size_t i = 0; i < visits.size(); ++i)
+            ASSERT_EQ(visits[i], i >= test.begin ? 1 : 0) << "index " << i << " of " << test.begin << ".." << test.end;
+        size_t grain_size = std::max<size_t>(test.grain_size, 1);
+        EXPECT_EQ(num_chunks, test.end > test.begin ? (test.end - test.begin + grain_size - 1) / grain_size : 0);
+    }
+}
+
+TEST(JobSystemTest, ParallelForException)
+{
+    JobSystem job_system(3);
+    std::atomic<size_t> num_visited(0);
+    EXPECT_THROW(job_system.ParallelFor(0, 1000, 10, [&num_visited](size_t begin, size_t end) {
+        num_visited += end - begin;
+        if (begin == 500)
+            throw std::runtime_error("chunk failed");
+    }), std::runtime_error);
+
+    // The other chunks still ran before the exception left ParallelFor
+    EXPECT_EQ(num_visited, 1000u);
+}
+
+TEST(JobSystemTest, Stealing)
+{
+    JobSystem job_system(4);
+    JobSystem::Counter counter;
+    for (int i = 0; i < 64; ++i)
+        job_system.Run([]() { std::this_thread::sleep_for(std::chrono::microseconds(200)); }, &counter);
+    job_system.Wait(counter);
+
+    // The jobs are queued on the calling thread, the workers have to steal them
+    EXPECT_GT(job_system.GetStats().num_stolen, 0u);
+}
+
+// Jobs started but not waited for run before the job system is destroyed
+TEST(JobSystemTest, ShutdownRunsQueuedJobs)
+{
+    for (unsigned int num_threads : { 1u, 4u }) {
+        std::atomic<int> num_done(0);
+        {
+            JobSystem job_system(num_threads);
+            for (int i = 0; i < 200; ++i) {
+                job_system.Run([&job_system, &num_done]() {
+                    job_system.Run([&num_done]() { ++num_done; }, nullptr);
+                    ++num_done;
+                }, nullptr);
+            }
+        }
+        EXPECT_EQ(num_done, 400) << num_threads << " threads";
+    }
+}
+
+TEST(JobSystemTest, ShutdownIdle)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 20; ++i) {
+        JobSystem job_system(8);
+        if (i % 2) {
+            JobSystem::Counter counter;
+            job_system.Run([]() {}, &counter);
+            job_system.Wait(counter);
+        }
+    }
+
+    // Sleeping workers are woken up instead of timing out
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+}
+
+TEST(JobSystemTest, ThreadCallbacks)
+{
+    std::atomic<int> num_started(0);
+    std::atomic<int> num_exited(0);
+    JobSystem::SetThreadCallbacks([&num_started]() { ++num_started; }, [&num_exited]() { ++num_exited; });
+    {
+        JobSystem job_system(3);
+        JobSystem::Counter counter;
+        job_system.Run([]() {}, &counter);
+        job_system.Wait(counter);
+    }
+    JobSystem::SetThreadCallbacks(nullptr, nullptr);
+
+    EXPECT_EQ(num_started, 2);
+    EXPECT_EQ(num_exited, 2);
+}
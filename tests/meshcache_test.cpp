@@ -0,0 +1,189 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "meshcache.h"
+
+namespace {
+
+class MeshCacheTest : public ::testing::Test {
+protected:
+    std::filesystem::path m_directory;
+    std::filesystem::path m_source_path;
+
+    std::vector<Vertex> m_vertices;
+    std::vector<uint32_t> m_indices;
+    std::vector<Meshlet> m_meshlets;
+    std::vector<MeshLod> m_lods;
+    std::vector<std::string> m_materials;
+    DirectX::XMFLOAT4 m_min_bounds{ -1.0f, -2.0f, -3.0f, 1.0f };
+    DirectX::XMFLOAT4 m_max_bounds{ 4.0f, 5.0f, 6.0f, 1.0f };
+
+    void SetUp() override
+    {
+        m_directory = std::filesystem::temp_directory_path() / (std::string("meshcache_test_") + ::testing::UnitTest::GetInstance()->current_test_info()->name());
+        std::filesystem::create_directories(m_directory);
+        m_source_path = m_directory / "mesh.obj";
+        WriteSource("v 0 0 0\n");
+
+        for (uint32_t i = 0; i < 37; ++i) {
+            float f = static_cast<float>(i);
+            m_vertices.push_back(Vertex{ { f, f * 0.5f, -f }, { f / 37.0f, 1.0f - f / 37.0f }, { 0.0f, 1.0f, 0.0f } });
+        }
+        for (uint32_t i = 0; i + 2 < 37; ++i) {
+            m_indices.insert(m_indices.end(), { i, i + 1, i + 2 });
+        }
+        m_meshlets.push_back(Meshlet{ 0, 60, 22, { 1.0f, 2.0f, 3.0f }, 4.0f, { 0.0f, 0.0f, 1.0f }, 0.5f });
+        m_meshlets.push_back(Meshlet{ 60, static_cast<uint32_t>(m_indices.size()) - 60, 17, { -1.0f, 0.0f, 2.0f }, 3.0f, { 0.0f, 1.0f, 0.0f }, 1.0f });
+        m_lods.push_back(MeshLod{ 0, static_cast<uint32_t>(m_indices.size()), 0.0f });
+        m_lods.push_back(MeshLod{ 0, 30, 0.25f });
+        m_materials = { "diffuse.png", "", "textures/rock with spaces.dds" };
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(m_directory);
+    }
+
+    void WriteSource(const std::string& contents)
+    {
+        std::ofstream out(m_source_path, std::ios::binary | std::ios::trunc);
+        out << contents;
+    }
+
+    bool Write(uint32_t import_flags = 0)
+    {
+        return MeshCache::Write(m_source_path, import_flags, m_vertices, m_indices, m_meshlets, m_lods, m_materials, m_min_bounds, m_max_bounds);
+    }
+};
+
+template <typename T>
+bool SameBytes(std::span<const T> a, const std::vector<T>& b)
+{
+    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size_bytes()) == 0;
+}
+
+}
+
+TEST_F(MeshCacheTest, RoundTrip)
+{
+    ASSERT_TRUE(Write(3));
+    EXPECT_EQ(MeshCache::GetCachePath(m_source_path), m_directory / "mesh.meshbin");
+
+    MeshCache::Data data;
+    ASSERT_TRUE(MeshCache::Read(m_source_path, 3, data));
+    EXPECT_TRUE(SameBytes(data.vertices, m_vertices));
+    EXPECT_TRUE(SameBytes(data.indices, m_indices));
+    EXPECT_TRUE(SameBytes(data.meshlets, m_meshlets));
+    EXPECT_TRUE(SameBytes(data.lods, m_lods));
+    EXPECT_EQ(data.material_textures, m_materials);
+    EXPECT_EQ(std::memcmp(&data.min_bounds, &m_min_bounds, sizeof(DirectX::XMFLOAT4)), 0);
+    EXPECT_EQ(std::memcmp(&data.max_bounds, &m_max_bounds, sizeof(DirectX::XMFLOAT4)), 0);
+
+    // The arrays are used straight from the mapped file
+    EXPECT_NE(data.file, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(data.vertices.data()) % MeshCache::s_alignment, 0u);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(data.indices.data()) % MeshCache::s_alignment, 0u);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(data.meshlets.data()) % MeshCache::s_alignment, 0u);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(data.lods.data()) % MeshCache::s_alignment, 0u);
+}
+
+TEST_F(MeshCacheTest, RoundTripEmptyArrays)
+{
+    m_meshlets.clear();
+    m_lods.clear();
+    m_materials.clear();
+    ASSERT_TRUE(Write());
+
+    MeshCache::Data data;
+    ASSERT_TRUE(MeshCache::Read(m_source_path, 0, data));
+    EXPECT_TRUE(SameBytes(data.vertices, m_vertices));
+    EXPECT_TRUE(SameBytes(data.indices, m_indices));
+    EXPECT_TRUE(data.meshlets.empty());
+    EXPECT_TRUE(data.lods.empty());
+    EXPECT_TRUE(data.material_textures.empty());
+}
+
+TEST_F(MeshCacheTest, MissingCache)
+{
+    MeshCache::Data data;
+    EXPECT_FALSE(MeshCache::Read(m_source_path, 0, data));
+}
+
+TEST_F(MeshCacheTest, OtherImportFlags)
+{
+    ASSERT_TRUE(Write(1));
+    MeshCache::Data data;
+    EXPECT_FALSE(MeshCache::Read(m_source_path, 2, data));
+}
+
+TEST_F(MeshCacheTest, StaleSource)
+{
+    ASSERT_TRUE(Write());
+
+    // Same size, newer write time
+    WriteSource("v 1 1 1\n");
+    std::filesystem::last_write_time(m_source_path, std::filesystem::last_write_time(m_source_path) + std::chrono::seconds(10));
+    MeshCache::Data data;
+    EXPECT_FALSE(MeshCache::Read(m_source_path, 0, data));
+
+    // Other size
+    ASSERT_TRUE(Write());
+    WriteSource("v 1 1 1\nv 2 2 2\n");
+    EXPECT_FALSE(MeshCache::Read(m_source_path, 0, data));
+
+    // Rebuilt
+    ASSERT_TRUE(Write());
+    EXPECT_TRUE(MeshCache::Read(m_source_path, 0, data));
+}
+
+TEST_F(MeshCacheTest, TruncatedCache)
+{
+    ASSERT_TRUE(Write());
+    std::filesystem::path cache_path = MeshCache::GetCachePath(m_source_path);
+    uintmax_t size = std::filesystem::file_size(cache_path);
+
+    MeshCache::Data data;
+    std::filesystem::resize_file(cache_path, size - 1);
+    EXPECT_FALSE(MeshCache::Read(m_source_path, 0, data));
+    std::filesystem::resize_file(cache_path, sizeof(MeshCache::Header) - 1);
+    EXPECT_FALSE(MeshCache::Read(m_source_path, 0, data));
+}
+
+TEST_F(MeshCacheTest, CorruptHeader)
+{
+    ASSERT_TRUE(Write());
+    std::filesystem::path cache_path = MeshCache::GetCachePath(m_source_path);
+    {
+        std::fstream file(cache_path, std::ios::binary | std::ios::in | std::ios::out);
+        uint32_t version = MeshCache::s_version + 1;
+        file.seekp(offsetof(MeshCache::Header, version));
+        file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    }
+
+    MeshCache::Data data;
+    EXPECT_FALSE(MeshCache::Read(m_source_path, 0, data));
+}
+
+TEST_F(MeshCacheTest, UnmappableCache)
+{
+    // A directory exists under the cache name but can not be mapped
+    std::filesystem::create_directory(MeshCache::GetCachePath(m_source_path));
+    MeshCache::Data data;
+    EXPECT_FALSE(MeshCache::Read(m_source_path, 0, data));
+}
+
+TEST_F(MeshCacheTest, FailedWriteRemovesTemporaryFile)
+{
+    // The written cache can not replace a directory which is in the way
+    std::filesystem::path cache_path = MeshCache::GetCachePath(m_source_path);
+    std::filesystem::create_directories(cache_path / "blocked");
+    EXPECT_FALSE(Write());
+
+    std::filesystem::path temp_path = cache_path;
+    temp_path += ".tmp";
+    EXPECT_FALSE(std::filesystem::exists(temp_path));
+}
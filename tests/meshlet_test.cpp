@@ -0,0 +1,247 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+
+#include "meshlet.h"
+
+namespace {
+
+struct TestMesh {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+// Unit sphere with outward facing cross(b - a, c - a) like the clockwise front faces of the scene meshes
+TestMesh CreateSphere(uint32_t num_rings, uint32_t num_segments)
+{
+    constexpr float pi = 3.14159265f;
+    TestMesh mesh;
+    for (uint32_t ring = 0; ring <= num_rings; ++ring) {
+        float theta = pi * ring / num_rings;
+        for (uint32_t segment = 0; segment <= num_segments; ++segment) {
+            float phi = 2.0f * pi * segment / num_segments;
+            DirectX::XMFLOAT3 position(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            mesh.vertices.push_back(Vertex{ position, { 0.0f, 0.0f }, position });
+        }
+    }
+
+    auto add_triangle = [&mesh](uint32_t a, uint32_t b, uint32_t c) {
+        using namespace DirectX;
+        XMVECTOR pa = XMLoadFloat3(&mesh.vertices[a].position);
+        XMVECTOR normal = XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&mesh.vertices[b].position), pa), XMVectorSubtract(XMLoadFloat3(&mesh.vertices[c].position), pa));
+        if (XMVectorGetX(XMVector3LengthSq(normal)) == 0.0f)
+            return;
+        if (XMVectorGetX(XMVector3Dot(normal, pa)) < 0.0f)
+            std::swap(b, c);
+        mesh.indices.insert(mesh.indices.end(), { a, b, c });
+    };
+
+    for (uint32_t ring = 0; ring < num_rings; ++ring) {
+        for (uint32_t segment = 0; segment < num_segments; ++segment) {
+            uint32_t v00 = ring * (num_segments + 1) + segment;
+            uint32_t v01 = v00 + 1;
+            uint32_t v10 = v00 + num_segments + 1;
+            uint32_t v11 = v10 + 1;
+            add_triangle(v00, v01, v10);
+            add_triangle(v01, v11, v10);
+        }
+    }
+    return mesh;
+}
+
+// Triangles of random vertices, without any locality for the vertex limit
+TestMesh CreateRandomTriangles(uint32_t num_vertices, uint32_t num_triangles, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+    std::uniform_int_distribution<uint32_t> vertex(0, num_vertices - 1);
+
+    TestMesh mesh;
+    for (uint32_t i = 0; i < num_vertices; ++i)
+        mesh.vertices.push_back(Vertex{ { position(random), position(random), position(random) }, { 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } });
+    for (uint32_t i = 0; i < num_triangles * 3; ++i)
+        mesh.indices.push_back(vertex(random));
+    return mesh;
+}
+
+// Independent of MeshletBuilder::Validate: count how often every triangle is covered and check the limits
+void ExpectExactCoverage(const std::vector<Meshlet>& meshlets, const std::vector<uint32_t>& indices, unsigned int max_vertices, unsigned int max_triangles)
+{
+    std::vector<uint32_t> coverage(indices.size() / 3, 0);
+    for (const Meshlet& meshlet : meshlets) {
+        ASSERT_EQ(meshlet.index_offset % 3, 0u);
+        ASSERT_EQ(meshlet.index_count % 3, 0u);
+        ASSERT_GT(meshlet.index_count, 0u);
+        ASSERT_LE(meshlet.index_offset + meshlet.index_count, coverage.size() * 3);
+        EXPECT_LE(meshlet.index_count / 3, max_triangles);
+        EXPECT_LE(meshlet.vertex_count, max_vertices);
+        for (uint32_t triangle = meshlet.index_offset / 3; triangle < (meshlet.index_offset + meshlet.index_count) / 3; ++triangle)
+            ++coverage[triangle];
+    }
+    for (size_t triangle = 0; triangle < coverage.size(); ++triangle)
+        ASSERT_EQ(coverage[triangle], 1u) << "triangle " << triangle;
+
+    EXPECT_TRUE(MeshletBuilder::Validate(meshlets, indices, max_vertices, max_triangles));
+}
+
+}
+
+TEST(MeshletBuilderTest, EveryTriangleInExactlyOneMeshlet)
+{
+    TestMesh sphere = CreateSphere(64, 96);
+    std::vector<Meshlet> meshlets = MeshletBuilder::Build(sphere.vertices, sphere.indices);
+    EXPECT_GT(meshlets.size(), 1u);
+    ExpectExactCoverage(meshlets, sphere.indices, MeshletBuilder::s_max_vertices, MeshletBuilder::s_max_triangles);
+}
+
+TEST(MeshletBuilderTest, VertexLimitWithoutLocality)
+{
+    TestMesh mesh = CreateRandomTriangles(5000, 20000, 1);
+    std::vector<Meshlet> meshlets = MeshletBuilder::Build(mesh.vertices, mesh.indices);
+    ExpectExactCoverage(meshlets, mesh.indices, MeshletBuilder::s_max_vertices, MeshletBuilder::s_max_triangles);
+
+    // Random triangles rarely share vertices, so the vertex limit closes the meshlets
+    for (const Meshlet& meshlet : meshlets)
+        EXPECT_LT(meshlet.index_count / 3, MeshletBuilder::s_max_triangles);
+}
+
+TEST(MeshletBuilderTest, SmallLimits)
+{
+    TestMesh sphere = CreateSphere(16, 16);
+    for (unsigned int max_vertices : { 3u, 4u, 7u, 16u }) {
+        for (unsigned int max_triangles : { 1u, 2u, 5u, 31u }) {
+            std::vector<Meshlet> meshlets = MeshletBuilder::Build(sphere.vertices, sphere.indices, max_vertices, max_triangles);
+            ExpectExactCoverage(meshlets, sphere.indices, max_vertices, max_triangles);
+        }
+    }
+}
+
+TEST(MeshletBuilderTest, EmptyAndIncompleteIndexBuffers)
+{
+    TestMesh sphere = CreateSphere(4, 4);
+    EXPECT_TRUE(MeshletBuilder::Build(sphere.vertices, std::vector<uint32_t>()).empty());
+
+    // Trailing indices which do not form a triangle are not part of any meshlet
+    std::vector<uint32_t> indices = sphere.indices;
+    indices.push_back(0);
+    indices.push_back(1);
+    std::vector<Meshlet> meshlets = MeshletBuilder::Build(sphere.vertices, indices);
+    ExpectExactCoverage(meshlets, indices, MeshletBuilder::s_max_vertices, MeshletBuilder::s_max_triangles);
+}
+
+TEST(MeshletBuilderTest, ValidateRejectsBadMeshlets)
+{
+    TestMesh sphere = CreateSphere(16, 16);
+    std::vector<Meshlet> meshlets = MeshletBuilder::Build(sphere.vertices, sphere.indices);
+    ASSERT_GT(meshlets.size(), 2u);
+
+    std::vector<Meshlet> missing(meshlets.begin() + 1, meshlets.end());
+    EXPECT_FALSE(MeshletBuilder::Validate(missing, sphere.indices));
+
+    std::vector<Meshlet> duplicate = meshlets;
+    duplicate.push_back(meshlets[1]);
+    EXPECT_FALSE(MeshletBuilder::Validate(duplicate, sphere.indices));
+
+    std::vector<Meshlet> wrong_vertex_count = meshlets;
+    wrong_vertex_count[0].vertex_count += 1;
+    EXPECT_FALSE(MeshletBuilder::Validate(wrong_vertex_count, sphere.indices));
+}
+
+TEST(MeshletBuilderTest, BoundsContainTheMeshlet)
+{
+    using namespace DirectX;
+    TestMesh sphere = CreateSphere(32, 48);
+    std::vector<Meshlet> meshlets = MeshletBuilder::Build(sphere.vertices, sphere.indices);
+
+    for (const Meshlet& meshlet : meshlets) {
+        XMVECTOR center = XMLoadFloat3(&meshlet.center);
+        XMVECTOR axis = XMLoadFloat3(&meshlet.cone_axis);
+        float min_axis_dot = std::sqrt(std::max(0.0f, 1.0f - meshlet.cone_cutoff * meshlet.cone_cutoff));
+        for (uint32_t i = meshlet.index_offset; i < meshlet.index_offset + meshlet.index_count; i += 3) {
+            XMVECTOR a = XMLoadFloat3(&sphere.vertices[sphere.indices[i]].position);
+            XMVECTOR b = XMLoadFloat3(&sphere.vertices[sphere.indices[i + 1]].position);
+            XMVECTOR c = XMLoadFloat3(&sphere.vertices[sphere.indices[i + 2]].position);
+            for (const XMVECTOR& position : { a, b, c })
+                EXPECT_LE(XMVectorGetX(XMVector3Length(XMVectorSubtract(position, center))), meshlet.radius * 1.0001f);
+
+            // Every face normal lies within the cone
+            if (meshlet.cone_cutoff < 1.0f) {
+                XMVECTOR normal = XMVector3Normalize(XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a)));
+                EXPECT_GE(XMVectorGetX(XMVector3Dot(normal, axis)), min_axis_dot - 1e-4f);
+            }
+        }
+    }
+}
+
+// The CPU culling reference is conservative: every triangle of a culled meshlet is either backfacing or outside the frustum
+TEST(MeshletCullerTest, CulledMeshletsHaveNoVisibleTriangles)
+{
+    using namespace DirectX;
+    TestMesh sphere = CreateSphere(48, 64);
+    std::vector<Meshlet> meshlets = MeshletBuilder::Build(sphere.vertices, sphere.indices);
+
+    XMMATRIX projection = XMMatrixPerspectiveFovLH(0.8f, 1.5f, 0.1f, 100.0f);
+    const XMFLOAT4 camera_positions[] = { { 0.0f, 0.0f, -4.0f, 1.0f }, { 3.0f, 2.0f, 1.0f, 1.0f }, { 0.5f, -6.0f, 0.2f, 1.0f } };
+    const XMFLOAT3 targets[] = { { 0.0f, 0.0f, 0.0f }, { 1.5f, 0.0f, 0.0f } };
+    const XMMATRIX models[] = { XMMatrixIdentity(), XMMatrixMultiply(XMMatrixScaling(1.5f, 1.5f, 1.5f), XMMatrixTranslation(0.3f, -0.2f, 0.5f)) };
+
+    size_t num_culled = 0;
+    for (const XMFLOAT4& camera_position : camera_positions) {
+        for (const XMFLOAT3& target : targets) {
+            XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat4(&camera_position), XMLoadFloat3(&target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+            XMMATRIX view_projection = XMMatrixMultiply(view, projection);
+            for (const XMMATRIX& model : models) {
+                MeshletCuller culler(model, view_projection, camera_position, true);
+                XMMATRIX mvp = XMMatrixMultiply(model, view_projection);
+                for (const Meshlet& meshlet : meshlets) {
+                    if (culler.IsVisible(meshlet))
+                        continue;
+                    ++num_culled;
+
+                    for (uint32_t i = meshlet.index_offset; i < meshlet.index_offset + meshlet.index_count; i += 3) {
+                        XMVECTOR world[3];
+                        XMVECTOR clip[3];
+                        for (int c = 0; c < 3; ++c) {
+                            world[c] = XMVector3Transform(XMLoadFloat3(&sphere.vertices[sphere.indices[i + c]].position), model);
+                            clip[c] = XMVector3Transform(XMLoadFloat3(&sphere.vertices[sphere.indices[i + c]].position), mvp);
+                        }
+
+                        XMVECTOR normal = XMVector3Cross(XMVectorSubtract(world[1], world[0]), XMVectorSubtract(world[2], world[0]));
+                        bool backfacing = XMVectorGetX(XMVector3Dot(normal, XMVectorSubtract(world[0], XMLoadFloat4(&camera_position)))) >= -1e-5f;
+
+                        auto all_outside = [&clip](auto outside) { return outside(clip[0]) && outside(clip[1]) && outside(clip[2]); };
+                        bool outside_frustum =
+                            all_outside([](const XMVECTOR& v) { return v.f[0] < -v.f[3]; }) || all_outside([](const XMVECTOR& v) { return v.f[0] > v.f[3]; }) ||
+                            all_outside([](const XMVECTOR& v) { return v.f[1] < -v.f[3]; }) || all_outside([](const XMVECTOR& v) { return v.f[1] > v.f[3]; }) ||
+                            all_outside([](const XMVECTOR& v) { return v.f[2] < 0.0f; }) || all_outside([](const XMVECTOR& v) { return v.f[2] > v.f[3]; });
+                        EXPECT_TRUE(backfacing || outside_frustum) << "visible triangle " << i / 3 << " in a culled meshlet";
+                    }
+                }
+            }
+        }
+    }
+
+    // The views look at the sphere from outside, so about half of it is backfacing
+    EXPECT_GT(num_culled, 0u);
+}
+
+TEST(MeshletCullerTest, VisibleInFrontCulledBehind)
+{
+    using namespace DirectX;
+    TestMesh sphere = CreateSphere(16, 16);
+    std::vector<Meshlet> meshlets = MeshletBuilder::Build(sphere.vertices, sphere.indices);
+
+    XMFLOAT4 camera_position(0.0f, 0.0f, -5.0f, 1.0f);
+    XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat4(&camera_position), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    XMMATRIX view_projection = XMMatrixMultiply(view, XMMatrixPerspectiveFovLH(0.8f, 1.0f, 0.1f, 100.0f));
+
+    // Without cone culling everything in the frustum is kept
+    MeshletCuller in_front(XMMatrixIdentity(), view_projection, camera_position, false);
+    for (const Meshlet& meshlet : meshlets)
+        EXPECT_TRUE(in_front.IsVisible(meshlet));
+
+    MeshletCuller behind(XMMatrixTranslation(0.0f, 0.0f, -20.0f), view_projection, camera_position, false);
+    for (const Meshlet& meshlet : meshlets)
+        EXPECT_FALSE(behind.IsVisible(meshlet));
+}
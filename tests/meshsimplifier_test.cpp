@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+
+#include "meshsimplifier.h"
+
+namespace {
+
+struct TestMesh {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+// Grid over [0, 1]^2 displaced along y by height(x, z), the border of the grid is locked by the simplifier
+template <typename Height>
+TestMesh CreateHeightField(uint32_t resolution, Height height)
+{
+    TestMesh mesh;
+    for (uint32_t row = 0; row <= resolution; ++row) {
+        for (uint32_t column = 0; column <= resolution; ++column) {
+            float x = static_cast<float>(column) / resolution;
+            float z = static_cast<float>(row) / resolution;
+            mesh.vertices.push_back(Vertex{ { x, height(x, z), z }, { x, z }, { 0.0f, 1.0f, 0.0f } });
+        }
+    }
+    for (uint32_t row = 0; row < resolution; ++row) {
+        for (uint32_t column = 0; column < resolution; ++column) {
+            uint32_t v00 = row * (resolution + 1) + column;
+            uint32_t v01 = v00 + 1;
+            uint32_t v10 = v00 + resolution + 1;
+            uint32_t v11 = v10 + 1;
+            mesh.indices.insert(mesh.indices.end(), { v00, v10, v01, v01, v10, v11 });
+        }
+    }
+    return mesh;
+}
+
+float DistanceToTriangles(const DirectX::XMFLOAT3& point, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+{
+    float distance_sq = FLT_MAX;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        distance_sq = std::min(distance_sq, MeshSimplifier::PointTriangleDistanceSq(point, vertices[indices[i]].position,
+            vertices[indices[i + 1]].position, vertices[indices[i + 2]].position));
+    }
+    return std::sqrt(distance_sq);
+}
+
+// Brute force one-sided distance from the source triangles to the simplified ones, densely sampled
+float MeasureDenseDistance(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& source_indices, const std::vector<uint32_t>& indices)
+{
+    constexpr uint32_t steps = 4;
+    float max_distance = 0.0f;
+    for (size_t i = 0; i < source_indices.size(); i += 3) {
+        const DirectX::XMFLOAT3& a = vertices[source_indices[i]].position;
+        const DirectX::XMFLOAT3& b = vertices[source_indices[i + 1]].position;
+        const DirectX::XMFLOAT3& c = vertices[source_indices[i + 2]].position;
+        for (uint32_t u = 0; u <= steps; ++u) {
+            for (uint32_t v = 0; u + v <= steps; ++v) {
+                float wb = static_cast<float>(u) / steps;
+                float wc = static_cast<float>(v) / steps;
+                float wa = 1.0f - wb - wc;
+                DirectX::XMFLOAT3 point(wa * a.x + wb * b.x + wc * c.x, wa * a.y + wb * b.y + wc * c.y, wa * a.z + wb * b.z + wc * c.z);
+                max_distance = std::max(max_distance, DistanceToTriangles(point, vertices, indices));
+            }
+        }
+    }
+    return max_distance;
+}
+
+}
+
+TEST(MeshSimplifierTest, PointTriangleDistance)
+{
+    DirectX::XMFLOAT3 a(0.0f, 0.0f, 0.0f);
+    DirectX::XMFLOAT3 b(1.0f, 0.0f, 0.0f);
+    DirectX::XMFLOAT3 c(0.0f, 1.0f, 0.0f);
+
+    // Face, edge and vertex regions
+    EXPECT_FLOAT_EQ(MeshSimplifier::PointTriangleDistanceSq({ 0.25f, 0.25f, 2.0f }, a, b, c), 4.0f);
+    EXPECT_FLOAT_EQ(MeshSimplifier::PointTriangleDistanceSq({ 0.5f, -1.0f, 0.0f }, a, b, c), 1.0f);
+    EXPECT_FLOAT_EQ(MeshSimplifier::PointTriangleDistanceSq({ 1.0f, 1.0f, 0.0f }, a, b, c), 0.5f);
+    EXPECT_FLOAT_EQ(MeshSimplifier::PointTriangleDistanceSq({ -1.0f, -1.0f, 1.0f }, a, b, c), 3.0f);
+    EXPECT_FLOAT_EQ(MeshSimplifier::PointTriangleDistanceSq({ 3.0f, 0.0f, 0.0f }, a, b, c), 4.0f);
+
+    // Degenerate triangles measure the distance to the point or segment
+    EXPECT_FLOAT_EQ(MeshSimplifier::PointTriangleDistanceSq({ 0.0f, 2.0f, 0.0f }, a, a, a), 4.0f);
+    EXPECT_FLOAT_EQ(MeshSimplifier::PointTriangleDistanceSq({ 0.5f, 2.0f, 0.0f }, a, b, b), 4.0f);
+}
+
+TEST(MeshSimplifierTest, FlatGridReducesWithoutError)
+{
+    TestMesh mesh = CreateHeightField(32, [](float, float) { return 0.0f; });
+    float error = -1.0f;
+    std::vector<uint32_t> result = MeshSimplifier::Simplify(mesh.vertices, mesh.indices, mesh.indices.size() / 8, 0.01f, error);
+
+    ASSERT_EQ(result.size() % 3, 0u);
+    EXPECT_LT(result.size(), mesh.indices.size() / 2);
+    EXPECT_NEAR(error, 0.0f, 1e-6f);
+}
+
+TEST(MeshSimplifierTest, TargetAlreadyReached)
+{
+    TestMesh mesh = CreateHeightField(4, [](float x, float z) { return x * z; });
+    float error = -1.0f;
+    std::vector<uint32_t> result = MeshSimplifier::Simplify(mesh.vertices, mesh.indices, mesh.indices.size(), 1.0f, error);
+
+    EXPECT_EQ(result, mesh.indices);
+    EXPECT_EQ(error, 0.0f);
+}
+
+// The reported error is what Scene::Item::SelectLod projects to the screen, it must bound the distance of the source surface
+TEST(MeshSimplifierTest, ErrorBoundsTheDistanceToTheSource)
+{
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> noise(-0.002f, 0.002f);
+    TestMesh mesh = CreateHeightField(48, [](float x, float z) { return 0.05f * std::sin(6.0f * x) * std::cos(5.0f * z); });
+    for (Vertex& vertex : mesh.vertices)
+        vertex.position.y += noise(random);
+
+    float previous_error = 0.0f;
+    size_t previous_size = mesh.indices.size();
+    for (float target_error : { 0.001f, 0.004f, 0.016f, 0.064f }) {
+        float error = -1.0f;
+        std::vector<uint32_t> result = MeshSimplifier::Simplify(mesh.vertices, mesh.indices, 0, target_error, error);
+        ASSERT_FALSE(result.empty());
+
+        // Every source vertex and densely sampled surface point lies within the reported error
+        float vertex_distance = 0.0f;
+        for (uint32_t index : mesh.indices)
+            vertex_distance = std::max(vertex_distance, DistanceToTriangles(mesh.vertices[index].position, mesh.vertices, result));
+        EXPECT_LE(vertex_distance, error * 1.0001f) << "target " << target_error;
+        EXPECT_LE(MeasureDenseDistance(mesh.vertices, mesh.indices, result), error * 1.0001f) << "target " << target_error;
+
+        // A larger error budget removes more triangles at a larger error
+        EXPECT_LE(result.size(), previous_size);
+        EXPECT_GE(error, previous_error);
+        previous_size = result.size();
+        previous_error = error;
+    }
+    EXPECT_LT(previous_size, mesh.indices.size() / 10);
+}
@@ -0,0 +1,207 @@
+#include <gtest/gtest.h>
+
+#include <map>
+
+#include "residencypolicy.h"
+
+namespace {
+
+constexpr uint64_t s_mb = 1024 * 1024;
+
+// Applies the actions of the policy like ResidencyManager does, dropping a mip level leaves a quarter of the mip chain
+class SimulatedResources {
+public:
+    ResidencyPolicy policy;
+
+    uint64_t AddTexture(uint64_t full_size, unsigned int num_mips, uint64_t frame)
+    {
+        uint64_t id = policy.Add(ResidencyPolicy::RESOURCE_CATEGORY_TEXTURE, full_size, frame);
+        policy.SetEvictable(id, num_mips - 1);
+        m_full_sizes[id] = full_size;
+        return id;
+    }
+
+    std::vector<ResidencyPolicy::Action> Evaluate(uint64_t budget)
+    {
+        std::vector<ResidencyPolicy::Action> actions = policy.Evaluate(budget);
+        for (const ResidencyPolicy::Action& action : actions) {
+            m_evicted_mips[action.id] = action.num_evicted_mips;
+            policy.SetSize(action.id, m_full_sizes[action.id] >> (2 * action.num_evicted_mips));
+        }
+        return actions;
+    }
+
+    unsigned int GetEvictedMips(uint64_t id) const
+    {
+        auto it = m_evicted_mips.find(id);
+        return it == m_evicted_mips.end() ? 0 : it->second;
+    }
+
+    uint64_t GetRestoredBytes(const std::vector<ResidencyPolicy::Action>& actions) const
+    {
+        uint64_t restored_bytes = 0;
+        for (const ResidencyPolicy::Action& action : actions)
+            restored_bytes += m_full_sizes.at(action.id) >> (2 * action.num_evicted_mips);
+        return restored_bytes;
+    }
+
+private:
+    std::map<uint64_t, uint64_t> m_full_sizes;
+    std::map<uint64_t, unsigned int> m_evicted_mips;
+};
+
+}
+
+TEST(ResidencyPolicyTest, CategoriesAndStats)
+{
+    ResidencyPolicy policy;
+    uint64_t texture = policy.Add(ResidencyPolicy::RESOURCE_CATEGORY_TEXTURE, 64 * s_mb, 0);
+    policy.Add(ResidencyPolicy::RESOURCE_CATEGORY_MESH, 32 * s_mb, 0);
+    policy.Add(ResidencyPolicy::RESOURCE_CATEGORY_RENDER_TARGET, 16 * s_mb, 0);
+    uint64_t upload = policy.Add(ResidencyPolicy::RESOURCE_CATEGORY_UPLOAD, 8 * s_mb, 0);
+
+    // Upload buffers live in system memory and do not count against the budget
+    EXPECT_EQ(policy.GetBudgetedBytes(), 112 * s_mb);
+    EXPECT_EQ(policy.GetStats().num_resources, 4u);
+    EXPECT_EQ(policy.GetStats().category_bytes[ResidencyPolicy::RESOURCE_CATEGORY_UPLOAD], 8 * s_mb);
+
+    policy.SetSize(texture, 16 * s_mb);
+    policy.Remove(upload);
+    policy.Remove(upload);
+    EXPECT_EQ(policy.GetBudgetedBytes(), 64 * s_mb);
+    EXPECT_EQ(policy.GetStats().num_resources, 3u);
+}
+
+TEST(ResidencyPolicyTest, NoActionsBetweenRestoreLimitAndThreshold)
+{
+    SimulatedResources resources;
+    for (int i = 0; i < 9; ++i)
+        resources.AddTexture(10 * s_mb, 8, 0);
+
+    // 90% of the budget
+    EXPECT_TRUE(resources.Evaluate(100 * s_mb).empty());
+}
+
+TEST(ResidencyPolicyTest, EvictsLeastRecentlyUsedAboveThreshold)
+{
+    SimulatedResources resources;
+    std::vector<uint64_t> textures;
+    for (uint64_t frame = 0; frame < 10; ++frame)
+        textures.push_back(resources.AddTexture(10 * s_mb, 8, frame));
+
+    // 100MB of 104MB is above 95%, the target is 85% so dropping a level of the two oldest textures is enough
+    uint64_t budget = 104 * s_mb;
+    std::vector<ResidencyPolicy::Action> actions = resources.Evaluate(budget);
+    ASSERT_EQ(actions.size(), 2u);
+    EXPECT_EQ(resources.GetEvictedMips(textures[0]), 1u);
+    EXPECT_EQ(resources.GetEvictedMips(textures[1]), 1u);
+    for (size_t i = 2; i < textures.size(); ++i)
+        EXPECT_EQ(resources.GetEvictedMips(textures[i]), 0u);
+
+    EXPECT_LE(resources.policy.GetBudgetedBytes(), budget * ResidencyPolicy::s_evict_target);
+    EXPECT_GT(resources.policy.GetBudgetedBytes(), budget * ResidencyPolicy::s_restore_limit);
+    EXPECT_EQ(resources.policy.GetStats().num_evicted_mips, 2u);
+    EXPECT_EQ(resources.policy.GetStats().num_evictions, 2u);
+}
+
+TEST(ResidencyPolicyTest, EvictsDownToTheTarget)
+{
+    SimulatedResources resources;
+    for (uint64_t frame = 0; frame < 20; ++frame)
+        resources.AddTexture(16 * s_mb, 6, frame);
+
+    // 320MB into 160MB needs several passes over the textures
+    uint64_t budget = 160 * s_mb;
+    resources.Evaluate(budget);
+    EXPECT_LE(resources.policy.GetBudgetedBytes(), budget * ResidencyPolicy::s_evict_target);
+    EXPECT_TRUE(resources.Evaluate(budget).empty());
+}
+
+// Meshes, render targets and textures at their smallest level can not be evicted, the policy gives up instead of looping
+TEST(ResidencyPolicyTest, StopsWhenNothingIsEvictable)
+{
+    SimulatedResources resources;
+    resources.policy.Add(ResidencyPolicy::RESOURCE_CATEGORY_MESH, 60 * s_mb, 0);
+    resources.policy.Add(ResidencyPolicy::RESOURCE_CATEGORY_RENDER_TARGET, 40 * s_mb, 0);
+    uint64_t texture = resources.AddTexture(16 * s_mb, 2, 0);
+
+    std::vector<ResidencyPolicy::Action> actions = resources.Evaluate(100 * s_mb);
+    ASSERT_EQ(actions.size(), 1u);
+    EXPECT_EQ(actions[0].id, texture);
+    EXPECT_EQ(actions[0].num_evicted_mips, 1u);
+    EXPECT_TRUE(resources.Evaluate(100 * s_mb).empty());
+    EXPECT_GT(resources.policy.GetBudgetedBytes(), 100 * s_mb * ResidencyPolicy::s_evict_target);
+}
+
+TEST(ResidencyPolicyTest, RestoresMostRecentlyUsedBelowLimit)
+{
+    SimulatedResources resources;
+    std::vector<uint64_t> textures;
+    for (uint64_t frame = 0; frame < 10; ++frame)
+        textures.push_back(resources.AddTexture(8 * s_mb, 8, frame));
+
+    // Squeeze, then raise the budget so only part of the evicted levels fit below the restore limit
+    resources.Evaluate(40 * s_mb);
+    ASSERT_GT(resources.policy.GetStats().num_evicted_mips, 0u);
+    resources.policy.MarkUsed(textures[0], 100);
+
+    uint64_t budget = 80 * s_mb;
+    std::vector<ResidencyPolicy::Action> actions = resources.Evaluate(budget);
+    ASSERT_FALSE(actions.empty());
+    EXPECT_EQ(actions[0].id, textures[0]);
+    EXPECT_LE(resources.policy.GetBudgetedBytes(), budget * ResidencyPolicy::s_restore_limit);
+    EXPECT_EQ(resources.policy.GetStats().num_restores, actions.size());
+}
+
+TEST(ResidencyPolicyTest, RestoredBytesPerFrameAreCapped)
+{
+    SimulatedResources resources;
+    std::vector<uint64_t> textures;
+    for (uint64_t frame = 0; frame < 16; ++frame)
+        textures.push_back(resources.AddTexture(16 * s_mb, 4, frame));
+
+    resources.Evaluate(64 * s_mb);
+    uint64_t num_evicted_mips = resources.policy.GetStats().num_evicted_mips;
+    ASSERT_GT(num_evicted_mips, 0u);
+
+    // Plenty of room, the levels come back over several frames
+    unsigned int num_frames = 0;
+    while (resources.policy.GetStats().num_evicted_mips > 0) {
+        std::vector<ResidencyPolicy::Action> actions = resources.Evaluate(1024 * s_mb);
+        ASSERT_FALSE(actions.empty());
+        EXPECT_LE(resources.GetRestoredBytes(actions), ResidencyPolicy::s_max_restore_bytes_per_frame);
+        ASSERT_LT(++num_frames, 100u);
+    }
+    EXPECT_GT(num_frames, 1u);
+    EXPECT_EQ(resources.policy.GetBudgetedBytes(), 16 * 16 * s_mb);
+    EXPECT_EQ(resources.policy.GetStats().num_restores, num_evicted_mips);
+}
+
+// A scene that streams in textures over a budget settles instead of evicting and restoring the same levels every frame
+TEST(ResidencyPolicyTest, NoOscillation)
+{
+    SimulatedResources resources;
+    std::vector<uint64_t> textures;
+    uint64_t budget = 256 * s_mb;
+
+    uint64_t num_actions_after_load = 0;
+    for (uint64_t frame = 0; frame < 300; ++frame) {
+        if (frame < 40)
+            textures.push_back(resources.AddTexture(4 * s_mb << (frame % 3), 6, frame));
+
+        // Half of the textures are visible
+        for (size_t i = 0; i < textures.size(); i += 2)
+            resources.policy.MarkUsed(textures[i], frame);
+
+        std::vector<ResidencyPolicy::Action> actions = resources.Evaluate(budget);
+        if (frame >= 60)
+            num_actions_after_load += actions.size();
+
+        uint64_t used = resources.policy.GetBudgetedBytes();
+        if (frame >= 40) {
+            EXPECT_LE(used, budget * ResidencyPolicy::s_evict_threshold) << "frame " << frame;
+        }
+    }
+    EXPECT_EQ(num_actions_after_load, 0u);
+    EXPECT_GT(resources.policy.GetStats().num_evicted_mips, 0u);
+}
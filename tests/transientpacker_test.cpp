@@ -0,0 +1,174 @@
+#include <gtest/gtest.h>
+
+#include "transientpacker.h"
+
+namespace {
+
+constexpr uint64_t s_kb = 1024;
+constexpr uint64_t s_mb = 1024 * 1024;
+
+// Render target placement alignment
+constexpr uint64_t s_alignment = 64 * s_kb;
+
+// The memory of a and b intersects
+bool Intersects(const TransientPacker::Result& result, const std::vector<TransientPacker::Resource>& resources, size_t a, size_t b)
+{
+    return result.offsets[a] < result.offsets[b] + resources[b].size && result.offsets[b] < result.offsets[a] + resources[a].size;
+}
+
+// Resources alive at the same time never share memory, and every offset is aligned
+void ExpectValidPacking(const TransientPacker::Result& result, const std::vector<TransientPacker::Resource>& resources)
+{
+    ASSERT_EQ(result.offsets.size(), resources.size());
+    for (size_t a = 0; a < resources.size(); ++a) {
+        EXPECT_EQ(result.offsets[a] % resources[a].alignment, 0u) << "resource " << a;
+        EXPECT_LE(result.offsets[a] + resources[a].size, result.heap_size) << "resource " << a;
+        for (size_t b = a + 1; b < resources.size(); ++b) {
+            if (TransientPacker::Overlaps(resources[a], resources[b])) {
+                EXPECT_FALSE(Intersects(result, resources, a, b)) << "resources " << a << " and " << b;
+            }
+        }
+    }
+}
+
+TransientPacker::Result Pack(const std::vector<TransientPacker::Resource>& resources)
+{
+    TransientPacker packer;
+    for (const TransientPacker::Resource& resource : resources)
+        packer.Add(resource);
+    return packer.Pack();
+}
+
+}
+
+TEST(TransientPackerTest, Overlaps)
+{
+    TransientPacker::Resource a{ s_mb, s_alignment, 0, 1, 0 };
+    TransientPacker::Resource b{ s_mb, s_alignment, 1, 2, 0 };
+    TransientPacker::Resource c{ s_mb, s_alignment, 2, 2, 0 };
+    EXPECT_TRUE(TransientPacker::Overlaps(a, b));
+    EXPECT_FALSE(TransientPacker::Overlaps(a, c));
+
+    // Resources of different frames are never alive at the same time, unless one is used by every frame
+    TransientPacker::Resource other_frame{ s_mb, s_alignment, 0, 1, 1 };
+    TransientPacker::Resource all_frames{ s_mb, s_alignment, 1, 1, TransientPacker::s_all_frames };
+    EXPECT_FALSE(TransientPacker::Overlaps(a, other_frame));
+    EXPECT_TRUE(TransientPacker::Overlaps(a, all_frames));
+    EXPECT_TRUE(TransientPacker::Overlaps(other_frame, all_frames));
+    EXPECT_FALSE(TransientPacker::Overlaps(c, all_frames));
+}
+
+TEST(TransientPackerTest, Empty)
+{
+    TransientPacker::Result result = TransientPacker().Pack();
+    EXPECT_EQ(result.heap_size, 0u);
+    EXPECT_EQ(result.separate_size, 0u);
+}
+
+TEST(TransientPackerTest, DisjointLifetimesShareMemory)
+{
+    std::vector<TransientPacker::Resource> resources = {
+        { 8 * s_mb, s_alignment, 0, 1, 0 },
+        { 4 * s_mb, s_alignment, 2, 3, 0 },
+        { 6 * s_mb, s_alignment, 4, 4, 0 },
+    };
+    TransientPacker::Result result = Pack(resources);
+    ExpectValidPacking(result, resources);
+
+    EXPECT_EQ(result.heap_size, 8 * s_mb);
+    EXPECT_EQ(result.separate_size, 18 * s_mb);
+    for (size_t i = 0; i < resources.size(); ++i) {
+        EXPECT_EQ(result.offsets[i], 0u);
+        EXPECT_TRUE(result.aliased[i]);
+    }
+}
+
+TEST(TransientPackerTest, OverlappingLifetimesDoNotShareMemory)
+{
+    std::vector<TransientPacker::Resource> resources = {
+        { 3 * s_mb + 1, s_alignment, 0, 2, 0 },
+        { 2 * s_mb, s_alignment, 1, 1, 0 },
+        { 1 * s_mb, s_alignment, 1, 3, 0 },
+    };
+    TransientPacker::Result result = Pack(resources);
+    ExpectValidPacking(result, resources);
+
+    EXPECT_EQ(result.heap_size, result.separate_size);
+    for (size_t i = 0; i < resources.size(); ++i)
+        EXPECT_FALSE(result.aliased[i]);
+
+    // The odd size pushes the next resource to the next aligned offset
+    EXPECT_EQ(result.offsets[1], 3 * s_mb + s_alignment);
+}
+
+// The second resource fits into the gap left by a resource it does not overlap with
+TEST(TransientPackerTest, FirstFitGap)
+{
+    std::vector<TransientPacker::Resource> resources = {
+        { 8 * s_mb, s_alignment, 0, 3, 0 },
+        { 4 * s_mb, s_alignment, 0, 1, 0 },
+        { 4 * s_mb, s_alignment, 2, 3, 0 },
+    };
+    TransientPacker::Result result = Pack(resources);
+    ExpectValidPacking(result, resources);
+
+    EXPECT_EQ(result.heap_size, 12 * s_mb);
+    EXPECT_EQ(result.offsets[1], result.offsets[2]);
+    EXPECT_FALSE(result.aliased[0]);
+    EXPECT_TRUE(result.aliased[1]);
+    EXPECT_TRUE(result.aliased[2]);
+}
+
+// The declarations of Renderer::AllocateTransientResources(), everything is alive in the scene pass so only the render
+// textures of the frames in flight share memory
+TEST(TransientPackerTest, RendererPasses)
+{
+    constexpr unsigned int depthmap_pass = 0;
+    constexpr unsigned int scene_pass = 1;
+    constexpr unsigned int image_pass = 2;
+    constexpr unsigned int num_frames = 3;
+
+    // 4K R8G8B8A8 render textures and D32 depth buffer, 4096^2 D32 shadow map
+    uint64_t render_texture_size = 3840ull * 2160 * 4;
+    uint64_t depth_buffer_size = 3840ull * 2160 * 4;
+    uint64_t depth_map_size = 4096ull * 4096 * 4;
+
+    std::vector<TransientPacker::Resource> resources = {
+        { depth_map_size, s_alignment, depthmap_pass, scene_pass, TransientPacker::s_all_frames },
+        { depth_buffer_size, s_alignment, scene_pass, scene_pass, TransientPacker::s_all_frames },
+    };
+    for (unsigned int frame = 0; frame < num_frames; ++frame)
+        resources.push_back({ render_texture_size, s_alignment, scene_pass, image_pass, frame });
+
+    TransientPacker::Result result = Pack(resources);
+    ExpectValidPacking(result, resources);
+
+    EXPECT_FALSE(result.aliased[0]);
+    EXPECT_FALSE(result.aliased[1]);
+    for (unsigned int frame = 0; frame < num_frames; ++frame) {
+        EXPECT_TRUE(result.aliased[2 + frame]);
+        EXPECT_EQ(result.offsets[2 + frame], result.offsets[2]);
+    }
+    uint64_t depth_end = (depth_map_size + depth_buffer_size + s_alignment - 1) / s_alignment * s_alignment;
+    EXPECT_EQ(result.heap_size, depth_end + render_texture_size);
+}
+
+// Random lifetimes, checked against the overlap rule
+TEST(TransientPackerTest, RandomLifetimes)
+{
+    uint32_t state = 12345;
+    auto next = [&state]() { state = state * 1664525u + 1013904223u; return state >> 8; };
+
+    for (int run = 0; run < 50; ++run) {
+        std::vector<TransientPacker::Resource> resources;
+        for (int i = 0; i < 24; ++i) {
+            unsigned int first_pass = next() % 8;
+            unsigned int last_pass = first_pass + next() % 3;
+            unsigned int frame = next() % 4 == 0 ? TransientPacker::s_all_frames : next() % 3;
+            resources.push_back({ (1 + next() % 64) * 37 * s_kb, next() % 2 ? s_alignment : 4 * s_mb, first_pass, last_pass, frame });
+        }
+        TransientPacker::Result result = Pack(resources);
+        ExpectValidPacking(result, resources);
+        EXPECT_LE(result.heap_size, result.separate_size);
+    }
+}
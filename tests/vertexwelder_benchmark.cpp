@@ -0,0 +1,78 @@
+// Welding throughput of VertexWelder against the std::map dedup it replaced, on a synthetic grid mesh
+// Usage: vertexwelder_benchmark [num_triangles], defaults to 10M triangles
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include "vertexwelder.h"
+
+namespace {
+
+// Corners of a grid of quads with a position, normal and texcoord per grid vertex, as exported by most tools
+std::vector<VertexWelder::Key> CreateGridCorners(size_t num_triangles)
+{
+    size_t grid_size = 1;
+    while (grid_size * grid_size * 2 < num_triangles)
+        ++grid_size;
+
+    std::vector<VertexWelder::Key> corners;
+    corners.reserve(num_triangles * 3);
+    auto add_corner = [&corners, grid_size](size_t x, size_t y) {
+        int32_t idx = static_cast<int32_t>(y * (grid_size + 1) + x);
+        corners.push_back({ idx, idx, idx });
+    };
+
+    for (size_t y = 0; y < grid_size && corners.size() < num_triangles * 3; ++y) {
+        for (size_t x = 0; x < grid_size && corners.size() < num_triangles * 3; ++x) {
+            add_corner(x, y); add_corner(x + 1, y); add_corner(x, y + 1);
+            add_corner(x + 1, y); add_corner(x + 1, y + 1); add_corner(x, y + 1);
+        }
+    }
+    corners.resize(num_triangles * 3);
+    return corners;
+}
+
+struct KeyLess {
+    bool operator()(const VertexWelder::Key& a, const VertexWelder::Key& b) const {
+        return std::tie(a.vertex_index, a.normal_index, a.texcoord_index) < std::tie(b.vertex_index, b.normal_index, b.texcoord_index);
+    }
+};
+
+}
+
+int main(int argc, char** argv)
+{
+    size_t num_triangles = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10'000'000;
+    std::vector<VertexWelder::Key> corners = CreateGridCorners(num_triangles);
+    std::vector<uint32_t> welded_indices(corners.size());
+    std::vector<uint32_t> reference_indices(corners.size());
+
+    auto weld_start = std::chrono::high_resolution_clock::now();
+    VertexWelder welder(corners.size());
+    for (size_t corner_idx = 0; corner_idx < corners.size(); ++corner_idx)
+        welder.Insert(corners[corner_idx], welded_indices[corner_idx]);
+    std::chrono::duration<double> weld_time = std::chrono::high_resolution_clock::now() - weld_start;
+
+    // Unique indices in first-seen order, like Mesh::ReadFile did before
+    auto map_start = std::chrono::high_resolution_clock::now();
+    std::map<VertexWelder::Key, uint32_t, KeyLess> unique_map;
+    for (size_t corner_idx = 0; corner_idx < corners.size(); ++corner_idx) {
+        auto [it, inserted] = unique_map.try_emplace(corners[corner_idx], static_cast<uint32_t>(unique_map.size()));
+        reference_indices[corner_idx] = it->second;
+    }
+    std::chrono::duration<double> map_time = std::chrono::high_resolution_clock::now() - map_start;
+
+    if (welded_indices != reference_indices) {
+        std::printf("VertexWelder: output differs from the std::map dedup\n");
+        return 1;
+    }
+
+    std::printf("VertexWelder: %zu triangles, %zu corners, %u unique vertices\n", num_triangles, corners.size(), welder.GetNumUnique());
+    std::printf("  flat hash map %8.1f ms, %7.1f Mcorners/s\n", weld_time.count() * 1e3, corners.size() / weld_time.count() * 1e-6);
+    std::printf("  std::map      %8.1f ms, %7.1f Mcorners/s, %.1fx slower\n", map_time.count() * 1e3, corners.size() / map_time.count() * 1e-6, map_time.count() / weld_time.count());
+    return 0;
+}